@@ -84,6 +84,8 @@ inline CLayerClassRegistrar<T>::~CLayerClassRegistrar()
 class CDnn;
 class CDnnLayerGraph;
 class CBaseLayer;
+class CDnnLayerScheduler;
+class CDnnMemoryPlanner;
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -270,6 +272,16 @@ protected:
 	// The default implementation creates the outputBlobs array using the output descriptions
 	virtual void AllocateOutputBlobs();
 
+	// The reshape cache support (see CDnn::SetReshapeCacheSize)
+	// A layer may return true if Reshape() calculates nothing but the output descriptions, the runtime blobs
+	// and the state that is detached from the layer by DetachReshapeState when the inputs change
+	// Such a layer is not reshaped when its inputs get the sizes they had before:
+	// the output descriptions and the runtime blobs are restored and the state is passed to AttachReshapeState
+	// By default the layer is always reshaped
+	virtual bool IsReshapeCacheSupported() const { return false; }
+	virtual CPtr<IObject> DetachReshapeState() { return nullptr; }
+	virtual void AttachReshapeState( IObject* /*state*/ ) {}
+
 private:
 	// Describes an input connection
 	struct CInputInfo {
@@ -330,6 +342,18 @@ private:
 	CObjectArray<CDnnBlob> runtimeBlobs;
 	CArray<CPtr<CDnnBlob>*> runtimeBlobPtrs;
 
+	// The result of the reshape for some input sizes
+	class CReshapeCacheEntry : public IObject {
+	public:
+		CArray<CBlobDesc> InputDescs;
+		CArray<CBlobDesc> OutputDescs;
+		CObjectArray<CDnnBlob> RuntimeBlobs;
+		CArray<CPtr<CDnnBlob>*> RuntimeBlobPtrs;
+		CPtr<IObject> State;
+	};
+	// The results of the previous reshapes; the most recently used is the last
+	CObjectArray<CReshapeCacheEntry> reshapeCache;
+
 	// The temporary blob cache for sequence processing in a recurrent layer
 	enum TBlobCacheType {
 		BCT_Input,
@@ -356,6 +380,9 @@ private:
 	void switchBlobsToNonSequentialMode(CObjectArray<CDnnBlob>& blobs, TBlobCacheType cacheType, bool clear);
 	CDnnBlob* switchBlobToNonSequentialMode(CDnnBlob* blob);
 	void clearAllRuntimeBlobs();
+	bool isReshapeCacheUsed() const;
+	void saveReshapeResult( const CArray<CBlobDesc>& prevInputDescs );
+	bool restoreReshapeResult();
 
 	// Clones a blob to store diffs
 	CDnnBlob* cloneBlobForDiff(CDnnBlob* blob);
@@ -369,6 +396,9 @@ private:
 	// The methods and data for interacting with the network
 
 	void setDnn( CDnn* newDnn );
+	void referenceParamBlobs( CBaseLayer& original );
+	// Shares the data calculated from the parameters (e.g. the quantized weights) with the original layer
+	virtual void referenceCalculatedParams( CBaseLayer& /*original*/ ) {}
 	void link();
 	void addOutput(int number);
 	void unlink();
@@ -383,6 +413,7 @@ private:
 	friend class CDnn;
 	friend class CDnnLayerGraph;
 	friend class CDnnSolver;
+	friend class CDnnMemoryPlanner;
 };
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -539,6 +570,47 @@ public:
 	// Enables profiling for all the layers in the network
 	void EnableProfile( bool profile );
 
+	// Builds a copy of this network in referenceDnn that shares the trainable parameters with this network
+	// Only the structure is copied: all the blobs stored by the layers and the quantized weights are shared
+	// Only the output and runtime blobs are allocated separately, so several copies may run inference
+	// in parallel threads without duplicating the weights
+	// referenceDnn must use the same math engine; its previous contents are deleted and learning is disabled
+	// The parameters may be changed by the layer methods (SetFilterData, SetWeightsData, etc.) while no copy is running;
+	// the data calculated from them (e.g. the quantized weights) is recalculated by the copies on the next run
+	// The parameters are not copied, so this network must not be trained while its copies are in use
+	void CreateReferenceDnn( CDnn& referenceDnn );
+
+	// Sets the number of threads used to run the independent layers of the network concurrently in RunOnce
+	// The layers are started as soon as all their inputs are calculated, so the parallel branches
+	// of the network (e.g. inception blocks or attention heads) are processed at the same time
+	// Each layer still uses the math engine threads, so the total number of threads is
+	// the number set here multiplied by the thread count of the math engine;
+	// for the best performance create the math engine with ( thread budget / inter-layer thread count ) threads
+	// Supported only for CPU math engine; 1 (the default) means sequential processing
+	// RunAndBackwardOnce and RunAndLearnOnce always process the layers sequentially
+	void SetInterLayerThreadCount( int threadCount );
+	int GetInterLayerThreadCount() const;
+
+	// Enables planning the memory for the layer outputs in RunOnce
+	// After reshape the lifetimes of all the outputs (the ones inside composite layers included) are calculated
+	// and the outputs are placed into one buffer, so that the outputs which are not used at the same time share memory
+	// The outputs passed to the sink layers and the outputs of the recurrent layers are allocated as usual
+	// The planning is not used if the layers are processed in parallel (see SetInterLayerThreadCount)
+	void EnableMemoryPlanning( bool enable );
+	bool IsMemoryPlanningEnabled() const;
+	// Gets the size in bytes of the buffer planned for the layer outputs on the last RunOnce
+	// Compare it with IMathEngine::GetPeakMemoryUsage to estimate the memory used for the rest of the network
+	size_t GetPlannedMemorySize() const;
+
+	// The number of the input sizes for which each layer keeps the result of the reshape in RunOnce
+	// When the inputs of the network (e.g. the batch size) switch between several recurring sizes,
+	// the layers that support the cache (the convolutions and the poolings) don't recalculate their outputs
+	// and keep the math engine descriptors, so after the warm-up the reshape costs almost nothing
+	// The least recently used sizes are evicted; 0 (the default) turns the cache off
+	// The cache is not used in RunAndBackwardOnce and is cleared when any layer settings change
+	void SetReshapeCacheSize( int size );
+	int GetReshapeCacheSize() const { return reshapeCacheSize; }
+
 private:
 	// Adds or deletes a layer
 	void AddLayerImpl(CBaseLayer& layer) override;
@@ -580,17 +652,25 @@ private:
 	bool autoRestartMode;
 	// The low memory use mode
 	bool isReuseMemoryMode;
+	// The scheduler for the concurrent layers processing (null if the layers are processed sequentially)
+	CDnnLayerScheduler* layerScheduler;
+	// The memory planner for the layer outputs (null if the planning is off)
+	CPtr<CDnnMemoryPlanner> memoryPlanner;
+	// The number of the input sizes in the reshape cache of each layer
+	int reshapeCacheSize;
 
 	void setProcessingParams(bool isRecurrentMode, int sequenceLength, bool isReverseSequense, bool isBackwardPerformed);
 	void runOnce(int curSequencePos);
 	void backwardRunAndLearnOnce(int curSequencePos);
 	void reshape();
 	void rebuild();
+	void setSchedulerGraph();
 	size_t getOutputBlobsSize() const;
 
 	friend class CBaseLayer;
 	friend class CCompositeLayer;
 	friend class CRecurrentLayer;
+	friend class CDnnMemoryPlanner;
 };
 
 inline CArchive& operator<<( CArchive& archive, const CDnn& dnn)
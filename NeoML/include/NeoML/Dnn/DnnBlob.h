@@ -204,11 +204,16 @@ public:
 	void SetParentPos( int pos );
 	void ShiftParentPos( int shift );
 
+	// The version of the data is increased by the layers when they change their parameters blobs in place
+	// The data calculated from the blob (e.g. the quantized weights) is recalculated if the version changes
+	int GetDataVersion() const { return dataVersion; }
+	void DataChanged() { dataVersion++; }
+
 protected:
 	virtual ~CDnnBlob();
 
 	CDnnBlob( IMathEngine& _mathEngine, const CBlobDesc& _desc, CMemoryHandle _data, bool _dataOwned ) :
-		mathEngine( _mathEngine ), desc( _desc ), data( _data ), dataOwned( _dataOwned ), parentPos( 0 )
+		mathEngine( _mathEngine ), desc( _desc ), data( _data ), dataOwned( _dataOwned ), parentPos( 0 ), dataVersion( 0 )
 	{
 		NeoAssert( desc.GetDataType() != CT_Invalid );
 		NeoAssert( &mathEngine == data.GetMathEngine() );
@@ -219,15 +224,20 @@ private:
 	CBlobDesc desc;
 	CMemoryHandle data;
 	bool dataOwned;
+	CPtr<IObject> mapping; // keeps the memory-mapped file alive while the blob uses its data
 
 	CPtr<CDnnBlob> parent;	// parent blob
 	int parentPos;
+	int dataVersion; // see GetDataVersion
 
 	void initializeBlob(TBlobType _type, int batchLength, int batchWidth, int listSize, int height, int width,
 		int depth, int channels);
 	void initializeTensor(TBlobType _type, std::initializer_list<int> dimensions);
 	void initializeWindow(const CPtr<CDnnBlob>& _parent, int windowSize);
 	void initializeByPattern(TBlobType type, const CBlobDesc& pattern);
+	bool mapArchiveData( CArchive& archive, TBlobType type, int size,
+		int batchLength, int batchWidth, int listSize, int height, int width, int depth, int channels );
+	bool serializeReference( CArchive& archive );
 
 	friend class CDnnBlobClassRegistrar;
 };
@@ -430,6 +440,12 @@ inline T* CDnnBlob::GetBuffer( int pos, int size, bool exchange )
 		case CT_Int:
 			dataSize = sizeof( int );
 			break;
+		case CT_Int8:
+			dataSize = sizeof( int8_t );
+			break;
+		case CT_BFloat16:
+			dataSize = sizeof( uint16_t );
+			break;
 		default:
 			NeoAssert( false );
 	}
@@ -456,6 +472,12 @@ inline void CDnnBlob::SetParentPos(int pos)
 		case CT_Int:
 			data = parent->GetData<int>() + arrayPos;
 			break;
+		case CT_Int8:
+			data = parent->GetData<int8_t>() + arrayPos;
+			break;
+		case CT_BFloat16:
+			data = parent->GetData<uint16_t>() + arrayPos;
+			break;
 		default:
 			NeoAssert(0);
 	}
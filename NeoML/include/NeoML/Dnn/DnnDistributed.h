@@ -22,16 +22,36 @@ public:
 	virtual void SetInputBatch( CDnn& dnn, int thread ) = 0;
 };
 
+// Interface for the dataset which prepares the next batch while the current step is running
+// PrepareInputBatch for the next step is called in parallel with the training of the thread-th model,
+// then SetInputBatch passes the prepared data to that model at the start of the next step
+// The first batch is prepared right before the first step
+class IDistributedPipelinedDataset : public IDistributedDataset {
+public:
+	virtual void PrepareInputBatch( int thread ) = 0;
+};
+
+class CDistributedWorker;
+
 // Single process, multiple threads distributed training
+// Each model is trained by its own persistent thread
 class NEOML_API CDistributedTraining {
 public:
-	// Creates `count` cpu models
-	explicit CDistributedTraining( CArchive& archive, int count );
+	// Creates `count` cpu models, each model may use `threadCount` threads
+	// If there are enough cores each model is pinned to its own `threadCount` cores (Linux only)
+	explicit CDistributedTraining( CArchive& archive, int count, int threadCount = 1 );
+	// Creates one cpu model of the training distributed over `processCount` processes on the same host
+	// All processes should pass the same name, port and thread count; `process` is the number of the calling process
+	// The models exchange data via shared memory or via loopback TCP, see CreateMultiProcessCpuMathEngine
+	// The `thread` argument of the dataset methods is the number of the process
+	explicit CDistributedTraining( CArchive& archive, const char* name, int tcpPort, int process, int processCount,
+		int threadCount = 1 );
 	// Creates gpu models, `devs` should contain numbers of using devices
 	explicit CDistributedTraining( CArchive& archive, const CArray<int>& cudaDevs );
 	// Runs the networks, performs a backward pass and updates the trainable weights of all models
+	// The gradients are averaged over the models during the backward pass, so all models get the same update
 	void RunAndLearnOnce( IDistributedDataset& data );
-	// Returns last loss of `layerName` for all models
+	// Returns last loss of `layerName` for all models of this process
 	// `layerName` should correspond to CLossLayer or CCtcLossLayer
 	void GetLastLoss( const CString& layerName, CArray<float>& losses );
 	~CDistributedTraining();
@@ -39,8 +59,15 @@ private:
 	CArray<IMathEngine*> mathEngines;
 	CArray<CRandom*> rands;
 	CArray<CDnn*> cnns;
+	// The threads which train the models
+	CArray<CDistributedWorker*> workers;
+	// The threads which prepare the next batches
+	CArray<CDistributedWorker*> feeders;
+	// The dataset for which the next batch is being prepared by the feeder; nullptr if none
+	CArray<IDistributedPipelinedDataset*> preparingDatasets;
 
-	void initialize( CArchive& archive, int count );
+	void initialize( CArchive& archive, int count, int threadCount );
+	void runAndLearnOnce( IDistributedDataset& data, int model );
 };
 
 
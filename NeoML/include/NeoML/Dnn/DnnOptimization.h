@@ -0,0 +1,34 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <NeoML/NeoMLDefs.h>
+#include <NeoML/Dnn/Dnn.h>
+
+namespace NeoML {
+
+// Optimizes a trained network for inference by merging the layers that follow the convolution
+// and fully connected layers into them:
+// - the batch normalization is folded into the weights and the free terms of the previous layer
+// - the ReLU (including ReLU6 as the ReLU with the upper threshold), sigmoid and h-swish activations
+//   are fused into the previous layer, which applies them to its result (see CFusedActivation)
+// The layer is merged only if it is the only consumer of the previous layer's output
+// Only the layers of the network itself are optimized (the layers inside the composite layers are not)
+// The optimized network cannot be trained but may be serialized as usual
+// Returns the number of the removed layers
+NEOML_API int OptimizeDnnForInference( CDnn& dnn );
+
+} // namespace NeoML
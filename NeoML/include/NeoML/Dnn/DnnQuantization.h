@@ -0,0 +1,72 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <NeoML/NeoMLDefs.h>
+#include <NeoML/Dnn/Dnn.h>
+
+namespace NeoML {
+
+class CSinkLayer;
+
+// Quantizes the weights matrix (one row per object) to 8-bit integers with a separate scale for each row
+// The scale of a row is the maximum absolute value of its elements divided by 127
+NEOML_API void QuantizeWeights( const CDnnBlob& weights, CPtr<CDnnBlob>& quantizedWeights, CPtr<CDnnBlob>& scales );
+
+// Creates a copy of the blob with the data converted into the specified type
+// Only the conversions between CT_Float and CT_BFloat16 are supported
+NEOML_API CPtr<CDnnBlob> ConvertBlobDataType( const CDnnBlob& blob, TBlobType type );
+
+// CDnnPostTrainingQuantization switches the fully connected and convolution layers of a trained network
+// to 8-bit integer inference
+// The input scale of each layer is calibrated on the sample data: the range of the layer input is collected
+// over several runs of the network
+// Only the layers of the network itself are quantized (the layers inside the composite layers are not)
+class NEOML_API CDnnPostTrainingQuantization {
+public:
+	// Adds the calibration layers to the network
+	explicit CDnnPostTrainingQuantization( CDnn& dnn );
+	// Removes the calibration layers from the network if Quantize has not been called
+	~CDnnPostTrainingQuantization();
+
+	CDnnPostTrainingQuantization( const CDnnPostTrainingQuantization& ) = delete;
+	CDnnPostTrainingQuantization& operator=( const CDnnPostTrainingQuantization& ) = delete;
+
+	// Runs the network on the data set in the source layers and updates the input ranges
+	// Should be called for several sample batches before quantization
+	void Calibrate();
+
+	// Sets the input scales of the calibrated layers and removes the calibration layers from the network
+	// Returns the number of the quantized layers
+	int Quantize();
+
+private:
+	// The input of a layer being calibrated
+	struct CLayerInput {
+		CPtr<CBaseLayer> Layer;
+		// The layer which holds the input data after the run
+		CPtr<CSinkLayer> Sink;
+		// The maximum absolute value of the input
+		float MaxAbs;
+	};
+
+	CDnn& dnn;
+	CArray<CLayerInput> inputs;
+
+	void removeSinks();
+};
+
+} // namespace NeoML
@@ -56,6 +56,7 @@ public:
 
 protected:
 	explicit CDnnSolver( IMathEngine& mathEngine );
+	~CDnnSolver() override;
 
 	// Gets the reference to the math engine
 	IMathEngine& MathEngine() const { return mathEngine; }
@@ -94,8 +95,10 @@ private:
 	// Used in the inheriting classes
 	CMap<CBaseLayer*, CObjectArray<CDnnBlob>> layerToGradientHistory;
 
-	// Averages weights over all threads
-	void allReduce();
+	// Averages the gradients over the distributed math engines while the backward pass is running
+	// Created on the first AddDiff call if the math engine is distributed
+	class CGradientReducer;
+	CGradientReducer* gradientReducer;
 
 	// Clips gradients according to the settings
 	void clipGradients(const CObjectArray<CDnnBlob>& paramDiffBlobs);
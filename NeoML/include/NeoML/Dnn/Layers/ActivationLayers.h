@@ -25,6 +25,27 @@ namespace NeoML {
 // Creates an activation layer using the specified activation function
 CPtr<CBaseLayer> NEOML_API CreateActivationLayer( IMathEngine& mathEngine, TActivationFunction type );
 
+// The activation function fused into the layer that calculates its input (see OptimizeDnnForInference)
+// Only the functions without trainable parameters are supported:
+// AF_ReLU (Param is the upper threshold, 0 means no threshold), AF_Sigmoid and AF_HSwish
+// AF_Linear means that no activation is fused
+struct NEOML_API CFusedActivation {
+	TActivationFunction Type;
+	float Param;
+
+	CFusedActivation() : Type( AF_Linear ), Param( 0 ) {}
+	CFusedActivation( TActivationFunction type, float param = 0 ) : Type( type ), Param( param ) {}
+
+	bool IsEmpty() const { return Type == AF_Linear; }
+	// Checks if the function may be fused
+	static bool IsSupported( TActivationFunction type ) { return type == AF_ReLU || type == AF_Sigmoid || type == AF_HSwish; }
+
+	// Applies the function to the data in place
+	void Apply( IMathEngine& mathEngine, const CFloatHandle& data, int dataSize ) const;
+
+	void Serialize( CArchive& archive );
+};
+
 //------------------------------------------------------------------------------------------------------------
 
 // The layer that uses a linear activation function a*x + b
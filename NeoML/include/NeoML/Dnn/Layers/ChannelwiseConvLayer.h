@@ -48,6 +48,9 @@ protected:
 	void BackwardOnce() override;
 	void LearnOnce() override;
 	bool IsFilterTransposed() const override { return true; }
+	bool IsReshapeCacheSupported() const override { return true; }
+	CPtr<IObject> DetachReshapeState() override;
+	void AttachReshapeState( IObject* state ) override;
 
 private:
 	// Convolution descriptor
@@ -17,6 +17,7 @@ limitations under the License.
 
 #include <NeoML/NeoMLDefs.h>
 #include <NeoML/Dnn/Layers/BatchNormalizationLayer.h>
+#include <NeoML/Dnn/Layers/ActivationLayers.h>
 #include <NeoML/Dnn/Dnn.h>
 
 namespace NeoML {
@@ -119,6 +120,29 @@ public:
 
 	void Serialize( CArchive& archive ) override;
 
+	CPtr<CDnnBlob> GetFilterData() const override;
+	void SetFilterData( const CPtr<CDnnBlob>& newFilter ) override;
+
+	// The data type used to store the filter: CT_Float or CT_BFloat16
+	// The bfloat16 filter takes half the memory and is converted to float on the fly
+	// The layer with the bfloat16 filter cannot be trained; GetFilterData and SetFilterData still work with floats
+	// By default the filter is stored in CT_Float
+	TBlobType GetFilterType() const { return filterType; }
+	void SetFilterType( TBlobType type );
+
+	// The scale of the 8-bit quantized input (the input is converted into round( input / scale ))
+	// If the scale is not zero the layer performs the inference in 8-bit integers
+	// The filters are quantized separately; the layer with the quantized input cannot be trained
+	// By default the scale is 0 and the layer works with floats
+	float GetInputQuantizationScale() const { return inputQuantizationScale; }
+	void SetInputQuantizationScale( float scale );
+
+	// The activation applied to the result right after the convolution, usually set by OptimizeDnnForInference
+	// The layer with a fused activation cannot be trained
+	// By default no activation is fused
+	const CFusedActivation& GetFusedActivation() const { return fusedActivation; }
+	void SetFusedActivation( const CFusedActivation& activation );
+
 protected:
 	virtual ~CConvLayer();
 
@@ -126,13 +150,28 @@ protected:
 	void RunOnce() override;
 	void BackwardOnce() override;
 	void LearnOnce() override;
+	void FilterLayerParams( float threshold ) override;
+	bool IsReshapeCacheSupported() const override { return true; }
+	CPtr<IObject> DetachReshapeState() override;
+	void AttachReshapeState( IObject* state ) override;
 
 private:
 	CConvolutionDesc* convDesc; // the convolution descriptor
-
+	// The version of the filter and the free terms with which convDesc is used
+	// The math engine may keep the filter prepared for the calculation in the descriptor
+	int convDescParamsVersion;
+	float inputQuantizationScale; // the scale of the quantized input, 0 if the input is not quantized
+	TBlobType filterType; // the data type of the filter
+	CFusedActivation fusedActivation; // the activation applied to the result
+	CPtr<CDnnBlob> quantizedFilter; // the filter quantized to 8 bits, calculated on the first run
+	CPtr<CDnnBlob> filterScales; // the scales of the quantized filters
+	int quantizedFilterVersion; // the version of the filter from which quantizedFilter is calculated
+
+	int getParamsVersion() const;
 	void calcOutputBlobSize(int& outputHeight, int& outputWidth) const;
 	void initConvDesc();
 	void destroyConvDesc();
+	void referenceCalculatedParams( CBaseLayer& original ) override;
 };
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -17,6 +17,7 @@ limitations under the License.
 
 #include <NeoML/NeoMLDefs.h>
 #include <NeoML/Dnn/Layers/BatchNormalizationLayer.h>
+#include <NeoML/Dnn/Layers/ActivationLayers.h>
 #include <NeoML/Dnn/Dnn.h>
 
 namespace NeoML {
@@ -54,6 +55,26 @@ public:
 	bool IsZeroFreeTerm() const { return isZeroFreeTerm; }
 	void SetZeroFreeTerm(bool _isZeroFreeTerm);
 
+	// The scale of the 8-bit quantized input (the input is converted into round( input / scale ))
+	// If the scale is not zero the layer performs the inference in 8-bit integers
+	// The weights are quantized per neuron; the layer with the quantized input cannot be trained
+	// By default the scale is 0 and the layer works with floats
+	float GetInputQuantizationScale() const { return inputQuantizationScale; }
+	void SetInputQuantizationScale( float scale );
+
+	// The data type used to store the weights: CT_Float or CT_BFloat16
+	// The bfloat16 weights take half the memory and are converted to float on the fly
+	// The layer with the bfloat16 weights cannot be trained; GetWeightsData and SetWeightsData still work with floats
+	// By default the weights are stored in CT_Float
+	TBlobType GetWeightsType() const { return weightsType; }
+	void SetWeightsType( TBlobType type );
+
+	// The activation applied to the result right after the multiplication, usually set by OptimizeDnnForInference
+	// The layer with a fused activation cannot be trained
+	// By default no activation is fused
+	const CFusedActivation& GetFusedActivation() const { return fusedActivation; }
+	void SetFusedActivation( const CFusedActivation& activation );
+
 protected:
 	virtual ~CFullyConnectedLayer();
 
@@ -76,6 +97,19 @@ protected:
 private:
 	int numberOfElements; // the number of elements (neurons) of the fully-connected layer
 	bool isZeroFreeTerm; // indicates if the free term should be set to zero
+	float inputQuantizationScale; // the scale of the quantized input, 0 if the input is not quantized
+	TBlobType weightsType; // the data type of the weights
+	CFusedActivation fusedActivation; // the activation applied to the result
+	CPtr<CDnnBlob> quantizedWeights; // the weights quantized to 8 bits, calculated on the first run
+	CPtr<CDnnBlob> weightScales; // the scales of the quantized weights
+	int quantizedWeightsVersion; // the version of the weights from which quantizedWeights are calculated
+
+	void runQuantized( int inputIndex );
+	void referenceCalculatedParams( CBaseLayer& original ) override;
+
+	// The recurrent layers use the weights directly when processing the whole sequence at once
+	friend class CLstmLayer;
+	friend class CGruLayer;
 };
 
 NEOML_API CLayerWrapper<CFullyConnectedLayer> FullyConnected(
@@ -47,6 +47,12 @@ public:
 	void SetGateWeightsData(CDnnBlob* newWeights) { gateLayer->SetWeightsData(newWeights); }
 	void SetGateFreeTermData(CDnnBlob* newFreeTerm) { gateLayer->SetFreeTermData(newFreeTerm); }
 
+protected:
+	void Reshape() override;
+	void RunOnce() override;
+	void BackwardOnce() override;
+	void LearnOnce() override;
+
 private:
 	// The indices of the gates in the hidden layer output
 	enum TGateOut {
@@ -61,7 +67,15 @@ private:
 	CPtr<CSplitChannelsLayer> splitLayer;
 	CPtr<CBackLinkLayer> mainBackLink;
 
+	// Indicates that the whole sequence is processed by a single math engine call (float weights)
+	bool useSequenceKernel;
+	// The data saved on the forward pass of the sequence kernel for backward
+	CPtr<CDnnBlob> sequenceGates; // the activated gates
+	CPtr<CDnnBlob> initialHidden; // the initial state, null for the zero state
+
 	void buildLayer();
+	void runSequence();
+	void runSequenceBackward();
 };
 
 NEOML_API CLayerWrapper<CGruLayer> Gru( int hiddenSize );
@@ -66,6 +66,12 @@ public:
 	bool IsInCompatibilityMode() const { return isInCompatibilityMode; }
 	void SetCompatibilityMode( bool compatibilityMode );
 
+protected:
+	void Reshape() override;
+	void RunOnce() override;
+	void BackwardOnce() override;
+	void LearnOnce() override;
+
 private:
 	// The gate numbers for the hidden layer output
 	enum TGateOut {
@@ -92,8 +98,19 @@ private:
 	TActivationFunction recurrentActivation;
 	bool isInCompatibilityMode;
 
+	// Indicates that the whole sequence is processed by a single math engine call
+	// (no dropout, sigmoid gates, float weights)
+	bool useSequenceKernel;
+	// The data saved on the forward pass of the sequence kernel for backward
+	CPtr<CDnnBlob> sequenceGates; // the activated gates
+	CPtr<CDnnBlob> sequenceCell; // the cell state if there is no second output
+	CPtr<CDnnBlob> initialHidden; // the initial states, null for the zero state
+	CPtr<CDnnBlob> initialCell;
+
 	void buildLayer(float dropout);
 	void setWeightsData(const CPtr<CDnnBlob>& newWeights);
+	void runSequence();
+	void runSequenceBackward();
 };
 
 NEOML_API CLayerWrapper<CLstmLayer> Lstm(
@@ -17,6 +17,7 @@ limitations under the License.
 
 #include <NeoML/Dnn/Dnn.h>
 #include <NeoML/Dnn/Layers/CompositeLayer.h>
+#include <NeoML/Dnn/Layers/ScaledDotProductAttentionLayer.h>
 
 namespace NeoML {
 
@@ -43,6 +44,14 @@ namespace NeoML {
 //  W_* - trainable parameters and W_O is an additional trainable matrix of size (GetHiddenSize() x GetOutputSize())
 //
 // Result has size (1, BatchWidth, ListSize_Q, 1, 1, 1, GetOutputSize())
+//
+// On CPU, if there is no dropout and the softmax output is not connected, all the heads are calculated
+// by one CScaledDotProductAttentionLayer that doesn't store the ListSize_Q x ListSize_V attention weights
+// In this case the diff of the mask is zero
+//
+// For the autoregressive generation the key-value cache may be turned on (see SetUseKeyValueCache)
+// Then the layer keeps W_K * K and W_V * V of each sequence between the runs, the inputs contain only the new
+// elements of the sequences and each of them attends to the previous elements of its sequence
 class NEOML_API CMultiheadAttentionLayer : public CCompositeLayer {
 	NEOML_DNN_LAYER( CMultiheadAttentionLayer )
 public:
@@ -73,6 +82,20 @@ public:
 	int GetOutputSize() const { return outputSize; }
 	void SetOutputSize( int _outputSize );
 
+	// Key-value cache for the incremental decoding (inference only)
+	// Requires the fused attention and no mask; the cache is not serialized
+	// See CScaledDotProductAttentionLayer for the details
+	bool GetUseKeyValueCache() const { return useKeyValueCache; }
+	void SetUseKeyValueCache( bool use );
+	// The maximum number of elements cached for one sequence, 0 means no limit
+	int GetMaxCacheLength() const { return maxCacheLength; }
+	void SetMaxCacheLength( int length );
+	// The current number of elements cached for the sequence
+	int GetCacheLength( int sequence ) const;
+	// Evicts all the sequences or only one of them from the cache
+	void ResetCache();
+	void ResetCache( int sequence );
+
 	void Serialize( CArchive& archive ) override;
 
 protected:
@@ -89,8 +112,14 @@ private:
 	bool useMask;
 	// Output size
 	int outputSize;
+	// Key-value cache mode
+	bool useKeyValueCache;
+	// The maximum cached length of one sequence
+	int maxCacheLength;
 
-	void create();
+	bool isFusedAttentionAvailable() const;
+	CScaledDotProductAttentionLayer* getFusedAttention();
+	void create( bool useFusedAttention );
 
 	// Layer inputs
 	enum TInputs {
@@ -109,6 +138,7 @@ private:
 	CBaseLayer* multiplyInputByMatrixWeights( int size, const char* name, TInputs input );
 	CBaseLayer* multiplyByMatrixWeights( CBaseLayer* input, 
 		int width, const char* prefix );
+	CBaseLayer* getOrCreateMatrixWeights( int size, const char* name );
 	CBaseLayer* softmaxByChannels( CBaseLayer& input );
 	CBaseLayer* applyMask( CBaseLayer* layer );
 	CBaseLayer* prepareQ( CBaseLayer* input );
@@ -64,6 +64,9 @@ protected:
 	void RunOnce() override;
 	void BackwardOnce() override;
 	void Reshape() override;
+	bool IsReshapeCacheSupported() const override { return true; }
+	CPtr<IObject> DetachReshapeState() override;
+	void AttachReshapeState( IObject* state ) override;
 
 private:
 	CPtr<CDnnBlob> maxIndices; // contains the maximums' indices (for the backward pass)
@@ -92,6 +95,9 @@ protected:
 	void RunOnce() override;
 	void BackwardOnce() override;
 	void Reshape() override;
+	bool IsReshapeCacheSupported() const override { return true; }
+	CPtr<IObject> DetachReshapeState() override;
+	void AttachReshapeState( IObject* state ) override;
 
 private:
 	CMeanPoolingDesc* desc;
@@ -55,6 +55,11 @@ protected:
 	void RunInternalDnnBackward() override;
 	void SetInternalDnnParams() override;
 
+	// Checks if the whole sequence may be processed by a single math engine call
+	// instead of running the internal network step by step:
+	// the layer is the outermost recurrent layer on CPU, has one input and processes the sequence once
+	bool IsSequenceKernelAvailable() const;
+
 private:
 	// The backward links
 	CObjectArray<CBackLinkLayer> backLinks;
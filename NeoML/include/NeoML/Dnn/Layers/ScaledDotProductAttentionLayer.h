@@ -0,0 +1,125 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <NeoML/NeoMLDefs.h>
+#include <NeoML/Dnn/Dnn.h>
+
+namespace NeoML {
+
+// Scaled dot-product attention with several heads
+// Calculates softmax( scale * Q_i * K_i_t - 1e9 * mask ) * V_i for each head i
+// The keys are processed by tiles, so the ListSize_Q x ListSize_K matrix of the attention weights
+// is never stored and the memory grows linearly with the sequence length
+//
+// Inputs:
+// #0 - Q (BatchLength x BatchWidth x ListSize_Q x Height x Width x Depth x Channels)
+// #1 - K (BatchLength x BatchWidth x ListSize_K x Height x Width x Depth x Channels)
+// #2 - V (BatchLength x BatchWidth x ListSize_K x Height x Width x Depth x Channels)
+// #3 (optional) - mask with ListSize_Q * ListSize_K elements, the same for all sequences and heads
+// Each sequence element is an object; the object is split into GetHeadCount() parts of the same size
+//
+// The result has the same size as Q
+// Only the CPU math engine is supported
+//
+// For the incremental decoding the layer may keep the keys and values of each sequence between the runs
+// (see SetUseKeyValueCache). In this mode the inputs contain only the new elements of the sequences,
+// ListSize_K must be equal to ListSize_Q and the mask isn't used: each new element attends
+// to the cached elements, to itself and to the previous new elements of its sequence.
+// So the step of the generation costs one row of attention instead of the recalculation of the whole prefix
+class NEOML_API CScaledDotProductAttentionLayer : public CBaseLayer {
+	NEOML_DNN_LAYER( CScaledDotProductAttentionLayer )
+public:
+	explicit CScaledDotProductAttentionLayer( IMathEngine& mathEngine );
+
+	// The number of heads
+	// The object size of the inputs must be a multiple of this value
+	// By default attention consists of 1 head
+	int GetHeadCount() const { return headCount; }
+	void SetHeadCount( int headCount );
+
+	// The multiplier of the scores before softmax
+	// By default the scale is 1
+	float GetScale() const { return scale; }
+	void SetScale( float scale );
+
+	// Keeps the keys and values of the sequences between the runs (inference only)
+	// The i-th sequence of the batch continues the i-th cached sequence
+	// The cache is not serialized; by default it is not used
+	bool GetUseKeyValueCache() const { return useKeyValueCache; }
+	void SetUseKeyValueCache( bool use );
+
+	// The maximum number of elements cached for one sequence; the older elements are evicted
+	// The cache takes at most 2 * 2 * sizeof( float ) * ObjectSize * GetMaxCacheLength() bytes per sequence
+	// 0 means no limit (the default)
+	int GetMaxCacheLength() const { return maxCacheLength; }
+	void SetMaxCacheLength( int length );
+
+	// The current number of elements cached for the sequence
+	int GetCacheLength( int sequence ) const;
+	// Evicts all the sequences or only one of them from the cache
+	// The next element of an evicted sequence starts a new sequence
+	void ResetCache();
+	void ResetCache( int sequence );
+
+	void Serialize( CArchive& archive ) override;
+
+protected:
+	void Reshape() override;
+	void RunOnce() override;
+	void BackwardOnce() override;
+
+private:
+	// The number of heads
+	int headCount;
+	// The multiplier of the scores
+	float scale;
+	// The logarithms of the softmax denominators, needed for backward
+	CPtr<CDnnBlob> logSumExp;
+	// Key-value cache mode
+	bool useKeyValueCache;
+	// The maximum cached length of one sequence
+	int maxCacheLength;
+
+	// The cached keys and values of one sequence
+	struct CSequenceCache {
+		// The blobs of Capacity x ObjectSize size
+		CPtr<CDnnBlob> Keys;
+		CPtr<CDnnBlob> Values;
+		// The cached elements are stored at [Start, Start + Length) positions
+		int Start;
+		int Length;
+
+		CSequenceCache() : Start( 0 ), Length( 0 ) {}
+	};
+	CArray<CSequenceCache> cache;
+
+	// Inputs
+	enum TInputs {
+		I_Q = 0,
+		I_K = 1,
+		I_V = 2,
+		I_Mask = 3
+	};
+
+	CConstFloatHandle getMask() const;
+	void runWithCache();
+	void appendToCache( CSequenceCache& sequenceCache, int sequence );
+};
+
+NEOML_API CLayerWrapper<CScaledDotProductAttentionLayer> ScaledDotProductAttention( int headCount, float scale );
+
+} // namespace NeoML
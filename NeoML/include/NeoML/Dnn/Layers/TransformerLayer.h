@@ -70,6 +70,10 @@ namespace NeoML {
 //          - BatchWidth and ListSize are equal to the corresponding dims of the first input
 //          - BatchLength, Height, Width and Depth are equal to 1
 //          - Channels is equal to the Channels of the first input
+//
+// For the autoregressive generation the key-value cache of the self-attention may be turned on
+// (see SetUseKeyValueCache). Then the input contains only the new elements of the sequences,
+// the mask must not be connected and each new element attends to the previous elements of its sequence
 class NEOML_API CTransformerEncoderLayer : public CCompositeLayer {
 	NEOML_DNN_LAYER( CTransformerEncoderLayer )
 public:
@@ -98,6 +102,19 @@ public:
 	// ReLU by default
 	void SetActivation( TActivationFunction newFunction );
 
+	// Key-value cache of the self-attention for the incremental decoding (inference only)
+	// See CMultiheadAttentionLayer for the details
+	bool GetUseKeyValueCache() const { return selfAttention->GetUseKeyValueCache(); }
+	void SetUseKeyValueCache( bool use );
+	// The maximum number of elements cached for one sequence, 0 means no limit
+	int GetMaxCacheLength() const { return selfAttention->GetMaxCacheLength(); }
+	void SetMaxCacheLength( int length ) { selfAttention->SetMaxCacheLength( length ); }
+	// The current number of elements cached for the sequence
+	int GetCacheLength( int sequence ) const { return selfAttention->GetCacheLength( sequence ); }
+	// Evicts all the sequences or only one of them from the cache
+	void ResetCache() { selfAttention->ResetCache(); }
+	void ResetCache( int sequence ) { selfAttention->ResetCache( sequence ); }
+
 protected:
 	void Reshape() override;
 
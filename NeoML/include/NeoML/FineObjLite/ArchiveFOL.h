@@ -40,6 +40,8 @@ public:
 	void Open( CBaseFile* baseFile, TDirection direction );
 	void Close();
 	bool IsOpen() const { return file != 0; }
+	// Gets the file the archive works with
+	CBaseFile* GetFile() const { return file; }
 
 	void Read( void* ptr, int size );
 	void Write( const void* ptr, int size );
@@ -0,0 +1,72 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <NeoML/NeoMLDefs.h>
+
+namespace NeoML {
+
+// Read-only archive file mapped into memory
+// When a network is loaded from this file by a CPU math engine, the blob data is not copied:
+// the blobs point directly into the mapped memory. The mapping is private (copy-on-write),
+// so changing the blobs never changes the file, while the unchanged pages are shared
+// by all processes that load the same file
+// The memory stays mapped until the file is closed and all the blobs that use it are destroyed
+// The archive should be opened at the beginning of the file
+class NEOML_API CMappedArchiveFile : public CBaseFile {
+public:
+	CMappedArchiveFile() : data( nullptr ), length( 0 ), position( 0 ) {}
+	// Creates an object and maps the file
+	// The same as calling a constructor without parameters and then the Open method
+	explicit CMappedArchiveFile( const char* fileName );
+	virtual ~CMappedArchiveFile() { Abort(); }
+
+	// Checks if the file is open
+	bool IsOpen() const { return mapping != nullptr; }
+
+	// Maps the file into memory
+	void Open( const char* fileName );
+
+	// The mapped file contents
+	char* GetData() const { return data; }
+	// The object that keeps the file mapped; the data stays valid while there are references to it
+	IObject* GetMapping() const { return mapping; }
+
+	// CBaseFile class methods
+#ifdef FINEOBJ_VERSION
+	virtual CUnicodeString GetFileName() const { return fileName.CreateUnicodeString( CP_UTF8 ); }
+#else
+	virtual const char* GetFileName() const { return fileName; }
+#endif
+	virtual int Read( void*, int bytesCount );
+	virtual void Write( const void*, int bytesCount );
+	virtual __int64 GetPosition() const;
+	virtual __int64 Seek( __int64 offset, TSeekPosition from );
+	virtual void SetLength( __int64 newLength );
+	virtual __int64 GetLength() const;
+	virtual void Abort();
+	virtual void Flush();
+	virtual void Close();
+
+private:
+	CPtr<IObject> mapping; // the mapped memory
+	char* data; // the file contents
+	__int64 length; // the file length
+	__int64 position; // the current position
+	CString fileName; // the file name (needed for the CBaseFile::GetFileName() method)
+};
+
+} // namespace NeoML
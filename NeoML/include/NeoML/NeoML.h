@@ -28,6 +28,7 @@ limitations under the License.
 #include <NeoML/TraditionalML/MemoryProblem.h>
 #include <NeoML/TraditionalML/Linear.h>
 #include <NeoML/TraditionalML/DecisionTree.h>
+#include <NeoML/TraditionalML/RandomForest.h>
 #include <NeoML/TraditionalML/OneVersusAll.h>
 #include <NeoML/TraditionalML/OneVersusOne.h>
 #include <NeoML/TraditionalML/Svm.h>
@@ -65,6 +66,7 @@ limitations under the License.
 #include <NeoML/TraditionalML/Score.h>
 #include <NeoML/TraditionalML/Shuffler.h>
 #include <NeoML/TraditionalML/GradientBoost.h>
+#include <NeoML/TraditionalML/GradientBoostBinnedProblem.h>
 #include <NeoML/TraditionalML/GradientBoostQuickScorer.h>
 #include <NeoML/Dnn/Layers/CompositeLayer.h>
 #include <NeoML/Dnn/Layers/RecurrentLayer.h>
@@ -78,6 +80,8 @@ limitations under the License.
 #include <NeoML/Dnn/Layers/GruLayer.h>
 #include <NeoML/Dnn/DnnSolver.h>
 #include <NeoML/Dnn/DnnInitializer.h>
+#include <NeoML/Dnn/DnnOptimization.h>
+#include <NeoML/Dnn/DnnQuantization.h>
 #include <NeoML/Dnn/Layers/MultichannelLookupLayer.h>
 #include <NeoML/Dnn/Layers/MaxOverTimePoolingLayer.h>
 #include <NeoML/Dnn/Layers/3dConvLayer.h>
@@ -108,6 +112,7 @@ limitations under the License.
 #include <NeoML/Dnn/Layers/AddToObjectLayer.h>
 #include <NeoML/Dnn/Layers/MatrixMultiplicationLayer.h>
 #include <NeoML/Dnn/Layers/MultiheadAttentionLayer.h>
+#include <NeoML/Dnn/Layers/ScaledDotProductAttentionLayer.h>
 #include <NeoML/Dnn/Layers/PositionalEmbeddingLayer.h>
 #include <NeoML/Dnn/Layers/GELULayer.h>
 #include <NeoML/Dnn/Layers/ProjectionPoolingLayer.h>
@@ -123,6 +128,7 @@ limitations under the License.
 #include <NeoML/Dnn/Layers/TransformerLayer.h>
 #include <NeoML/Dnn/Layers/BertConvLayer.h>
 #include <NeoML/ArchiveFile.h>
+#include <NeoML/MappedArchiveFile.h>
 
 #ifndef NO_NEOML_NAMESPACE
 using namespace NeoML;
@@ -25,6 +25,8 @@ namespace NeoML {
 
 class CDecisionTreeNodeBase;
 class CDecisionTreeNodeStatisticBase;
+class CDecisionTreeFastHistProblem;
+struct CDecisionTreeSplit;
 
 // The node types for a decision tree
 enum TDecisionTreeNodeType {
@@ -113,6 +115,16 @@ public:
 		SC_Count
 	};
 
+	// The type of the algorithm that gathers the feature statistics in the nodes
+	enum TTreeBuilder {
+		// All feature values are kept in the node statistics and merged into intervals when there are too many of them
+		TB_Full = 0,
+		// The feature values are quantized into histogram bins once before training
+		// Continuous features get no more than MaxBins bins; discrete features keep all their values
+		TB_FastHist,
+		TB_Count
+	};
+
 	// Classification parameters
 	struct CParams {
 		// The minimum number of vectors corresponding to a node subtree:
@@ -138,6 +150,13 @@ public:
 		size_t AvailableMemory; 
 		// The algorithm used for multi-class classification
 		TMulticlassMode MulticlassMode;
+		// The number of processing threads to be used while training the tree
+		// The statistics are gathered and the splits are searched in parallel over nodes or features
+		int ThreadCount;
+		// The type of the statistics gathering algorithm
+		TTreeBuilder TreeBuilder;
+		// The maximum number of histogram bins for a continuous feature (used only with TB_FastHist)
+		int MaxBins;
 
 		CParams() :
 			MinContinuousSubsetSize( 1 ),
@@ -151,7 +170,10 @@ public:
 			ConstNodeThreshold( 0.99 ),
 			RandomSelectedFeaturesCount( NotFound ),
 			AvailableMemory( Gigabyte ),
-			MulticlassMode( MM_SingleClassifier )
+			MulticlassMode( MM_SingleClassifier ),
+			ThreadCount( 1 ),
+			TreeBuilder( TB_Full ),
+			MaxBins( 32 )
 		{
 		}
 	};
@@ -173,20 +195,28 @@ private:
 	CRandom& random; // the actual random numbers generator
 	CTextStream* logStream; // the logging stream
 	CPtr<const IProblem> classificationProblem; // the current input data as an IProblem interface
+	CPtr<const CDecisionTreeFastHistProblem> fastHistProblem; // the histogram data for TB_FastHist
+	CArray<int> sample; // the indices of the vectors used for training; a vector may be used several times
 	mutable int nodesCount; // the number of tree nodes
 	mutable int statisticsCacheSize; // the cache size for statistics
 	mutable CPointerArray<CDecisionTreeNodeStatisticBase> statisticsCache; // the cache for statistics
 	mutable CArray<CDecisionTreeNodeBase*> classifyNodesCache; // the cache for leaf nodes
 	mutable CArray<int> classifyNodesLevel; // the levels of leaf nodes
 
-	CPtr<CDecisionTreeNodeBase> buildTree( int vectorCount );
+	CPtr<IModel> trainOnSample( const IProblem& problem, const CDecisionTreeFastHistProblem* histProblem );
+	CPtr<CDecisionTreeNodeBase> buildTree();
 	bool buildTreeLevel( const CFloatMatrixDesc& matrix, int level, CDecisionTreeNodeBase& root ) const;
 	bool collectStatistics( const CFloatMatrixDesc& matrix, int level, CDecisionTreeNodeBase* root ) const;
-	bool split( const CDecisionTreeNodeStatisticBase& nodeStatistics, int level ) const;
+	void fillStatistics( const CFloatMatrixDesc& matrix, const CArray<int>& vectors, const CArray<int>& statisticPos ) const;
+	bool splitNodes( int level ) const;
+	bool split( const CDecisionTreeNodeStatisticBase& nodeStatistics, CDecisionTreeSplit& bestSplit, int level ) const;
 	void generateUsedFeatures( int randomSelectedFeaturesCount, int featuresCount, CArray<int>& features ) const;
 
 	CPtr<CDecisionTreeNodeBase> createNode() const;
 	CDecisionTreeNodeStatisticBase* createStatistic( CDecisionTreeNodeBase* node ) const;
+
+	// The random forest trains its trees on bootstrap samples sharing the histogram data
+	friend class CRandomForest;
 };
 
 // DEPRECATED: for backward compatibility
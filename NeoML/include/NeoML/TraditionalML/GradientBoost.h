@@ -34,6 +34,7 @@ class IGradientBoostingLossFunction;
 class CGradientBoostModel;
 class CGradientBoostFullProblem;
 class CGradientBoostFastHistProblem;
+class CGradientBoostBinnedProblem;
 
 // Decision tree ensemble that has been built by gradient boosting
 class CGradientBoostEnsemble : public CObjectArray<IRegressionTreeNode> {
@@ -115,6 +116,12 @@ public:
 		int MaxBins; // the largest possible histogram size to be used in *GBTB_FastHist* mode
 		float MinSubsetWeight; // the minimum subtree weight (set to 0 to have no lower limit)
 		float DenseTreeBoostCoefficient; // the dense tree boost coefficient (only for GBTB_MultiFull)
+		// Gradient-based one-side sampling (GOSS): each tree is built on the GossTopRate fraction of vectors
+		// with the largest gradients and the GossOtherRate fraction randomly selected from the rest;
+		// the weights of the randomly selected vectors are increased to compensate for the rest
+		// The sampling is applied after Subsample; set GossTopRate to 0 to turn it off
+		float GossTopRate;
+		float GossOtherRate;
 		// Representation of training result.
 		TGradientBoostModelRepresentation Representation;
 
@@ -135,6 +142,8 @@ public:
 			MaxBins( 32 ),
 			MinSubsetWeight( 0.f ),
 			DenseTreeBoostCoefficient( 0.f ),
+			GossTopRate( 0.f ),
+			GossOtherRate( 0.1f ),
 			Representation( GBMR_Compact )
 		{
 		}
@@ -156,6 +165,12 @@ public:
 	// ITrainingModel interface methods:
 	virtual CPtr<IModel> Train( const IProblem& problem );
 
+	// Trains the model on the binned data (see CGradientBoostBinnedProblem)
+	// Only the GBTB_FastHist and GBTB_MultiFastHist tree builders may be used; the binned data defines the histograms
+	// The classification model is trained if the problem values are the class indicators
+	CPtr<IModel> Train( const CGradientBoostBinnedProblem& problem );
+	CPtr<IMultivariateRegressionModel> TrainRegression( const CGradientBoostBinnedProblem& problem );
+
 	// Returns the last loss mean
 	double GetLastLossMean() const { return loss; }
 
@@ -164,6 +179,7 @@ public:
 	bool TrainStep( const IProblem& _problem );
 	bool TrainStep( const IRegressionProblem& _problem );
 	bool TrainStep( const IMultivariateRegressionProblem& _problem );
+	bool TrainStep( const CGradientBoostBinnedProblem& _problem );
 
 	// Save/load checkpoint
 	void Serialize( CArchive& archive );
@@ -172,6 +188,8 @@ public:
 	CPtr<IModel> GetClassificationModel( const IProblem& _problem );
 	CPtr<IRegressionModel> GetRegressionModel( const IRegressionProblem& _problem );
 	CPtr<IMultivariateRegressionModel> GetMultivariateRegressionModel( const IMultivariateRegressionProblem& _problem );
+	CPtr<IModel> GetClassificationModel( const CGradientBoostBinnedProblem& _problem );
+	CPtr<IMultivariateRegressionModel> GetMultivariateRegressionModel( const CGradientBoostBinnedProblem& _problem );
 
 private:
 	// A cache element that contains the ensemble predictions for a vector on a given step
@@ -202,6 +220,8 @@ private:
 	CPtr<IMultivariateRegressionProblem> baseProblem; // base problem
 	CPtr<CGradientBoostFullProblem> fullProblem; // the problem data for TGBT_Full mode
 	CPtr<CGradientBoostFastHistProblem> fastHistProblem; // the problem data for TGBT_FastHist mode
+	CPtr<const CGradientBoostBinnedProblem> binnedProblem; // the binned problem data, if training on it
+	CArray<int> binnedVectors; // the indices of the binned problem vectors with not null weight
 	CArray< CArray<CPredictionCacheItem> > predictCache; // the cache for predictions of the models being built
 	// In the predicts, answers, gradients, hessians arrays the first index corresponds to the number of the class
 	// if you are training a multi-class classifier; 
@@ -234,12 +254,15 @@ private:
 	void prepareProblem( const IProblem& _problem );
 	void prepareProblem( const IRegressionProblem& _problem );
 	void prepareProblem( const IMultivariateRegressionProblem& _problem );
+	void prepareProblem( const CGradientBoostBinnedProblem& _problem );
 	void initialize();
 	bool trainStep();
 	void executeStep( IGradientBoostingLossFunction& lossFunction,
 		const IMultivariateRegressionProblem* problem, CObjectArray<IRegressionTreeNode>& curModels );
+	void selectGossVectors( CArray<double>& weights );
 	void buildPredictions( const IMultivariateRegressionProblem& problem, const CArray<CGradientBoostEnsemble>& models, int curStep );
 	void buildFullPredictions( const IMultivariateRegressionProblem& problem, const CArray<CGradientBoostEnsemble>& models );
+	void getVector( const CFloatMatrixDesc& matrix, int index, CArray<float>& buffer, CFloatVectorDesc& vector ) const;
 	CPtr<IObject> createOutputRepresentation(
 		CArray<CGradientBoostEnsemble>& models, int predictionSize );
 	bool isMultiTreesModel() { return params.TreeBuilder == GBTB_MultiFull || params.TreeBuilder == GBTB_MultiFastHist; }
@@ -273,6 +296,10 @@ public:
 	virtual bool ClassifyEx( const CSparseFloatVector& data, CArray<CClassificationResult>& results ) const = 0;
 	virtual bool ClassifyEx( const CFloatVectorDesc& data, CArray<CClassificationResult>& results ) const = 0;
 
+	// Classifies all rows of the matrix, distributing them among threadCount threads
+	// The IGradientBoostQSModel built from this model classifies the batches much faster
+	virtual void ClassifyBatch( const CFloatMatrixDesc& data, CArray<CClassificationResult>& results, int threadCount = 1 ) const = 0;
+
 	// Calculates feature usage statistics
 	// Returns the number of times each feature was used for node splitting
 	virtual void CalcFeatureStatistics( int maxFeature, CArray<int>& result ) const = 0;
@@ -303,6 +330,10 @@ public:
 	// Gets the loss function
 	virtual CGradientBoost::TLossFunction GetLossFunction() const = 0;
 
+	// Predicts the values for all rows of the matrix, distributing them among threadCount threads
+	// The IGradientBoostQSRegressionModel built from this model predicts the batches much faster
+	virtual void PredictBatch( const CFloatMatrixDesc& data, CArray<double>& results, int threadCount = 1 ) const = 0;
+
 	// Calculates feature usage statistics
 	// Returns the number of times each feature was used for node splitting
 	virtual void CalcFeatureStatistics( int maxFeature, CArray<int>& result ) const = 0;
@@ -0,0 +1,141 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <NeoML/NeoMLDefs.h>
+#include <NeoML/ArchiveFile.h>
+#include <NeoML/TraditionalML/SparseFloatMatrix.h>
+
+namespace NeoML {
+
+// The gradient boosting training data in which each feature value is replaced by the index of its histogram bin
+// A bin index takes 1 byte if no feature has more than 256 bins and 2 bytes otherwise
+// The problem may be used for training with the GBTB_FastHist and GBTB_MultiFastHist tree builders
+class NEOML_API CGradientBoostBinnedProblem : public IObject {
+public:
+	// Loads the problem stored in the file by CGradientBoostBinnedProblemBuilder
+	// The file is mapped into memory and the bin indices are used right from it
+	static CPtr<CGradientBoostBinnedProblem> Load( const char* fileName );
+
+	// The number of vectors
+	int GetVectorCount() const { return vectorCount; }
+	// The number of features
+	int GetFeatureCount() const { return featurePos.Size() - 1; }
+	// The length of the function value vector
+	int GetValueSize() const { return valueSize; }
+	// The function value on the vector with the given index; GetValueSize() elements
+	const float* GetValue( int index ) const { return values.GetPtr() + index * valueSize; }
+	// The vector weight
+	float GetVectorWeight( int index ) const { return weights[index]; }
+
+	// The size of a bin index in bytes
+	int GetBinSize() const { return binSize; }
+	// The bin indices of all features of the vector
+	const unsigned char* GetBins( int index ) const
+		{ return binData + static_cast<size_t>( index ) * GetFeatureCount() * binSize; }
+	// The bin index of the feature of the vector
+	int GetBin( int index, int feature ) const;
+	// The position of the first bin of each feature among all bins; the last element is the total number of bins
+	const CArray<int>& GetFeaturePos() const { return featurePos; }
+	// The upper bound of each bin: the bin contains the values greater than the previous bound
+	const CArray<float>& GetCuts() const { return cuts; }
+
+	// Fills the feature values of the vector with the upper bounds of their bins
+	// The trees trained on the problem split the features by these bounds,
+	// so the result leads to the same leaves as the original vector
+	void GetBinValues( int index, float* result ) const;
+
+protected:
+	virtual ~CGradientBoostBinnedProblem() {} // delete prohibited
+
+private:
+	int vectorCount; // the number of vectors
+	int valueSize; // the length of the function value vector
+	int binSize; // the size of a bin index in bytes
+	CArray<int> featurePos; // the position of the first bin of each feature
+	CArray<float> cuts; // the upper bounds of the bins
+	CArray<float> values; // the function values
+	CArray<float> weights; // the vector weights
+	CArray<unsigned char> bins; // the bin indices if they are stored in memory
+	CPtr<IObject> mapping; // the mapped file if the bin indices are stored in it
+	const unsigned char* binData; // the bin indices of all vectors
+
+	CGradientBoostBinnedProblem();
+	void serializeHeader( CArchive& archive );
+
+	friend class CGradientBoostBinnedProblemBuilder;
+};
+
+inline int CGradientBoostBinnedProblem::GetBin( int index, int feature ) const
+{
+	const unsigned char* vectorBins = GetBins( index );
+	return binSize == 1 ? vectorBins[feature] : reinterpret_cast<const unsigned short*>( vectorBins )[feature];
+}
+
+//------------------------------------------------------------------------------------------------------------
+
+// Builds CGradientBoostBinnedProblem in one pass over the data, which is added by chunks
+// The bins are calculated on the first SampleSize vectors, which are kept in memory until then
+// After that each chunk is binned right away, so the whole data set never has to fit into memory
+class NEOML_API CGradientBoostBinnedProblemBuilder {
+public:
+	struct CParams {
+		// The maximum number of bins for a feature; no more than 65536
+		int MaxBins;
+		// The number of the first vectors used to calculate the bins
+		int SampleSize;
+		// The number of processing threads
+		int ThreadCount;
+		// The file for the bin indices; if empty, the bin indices are kept in memory
+		// The file is mapped into memory once the problem is built, and may be loaded later by CGradientBoostBinnedProblem::Load
+		CString FileName;
+
+		CParams() :
+			MaxBins( 32 ),
+			SampleSize( 100000 ),
+			ThreadCount( 1 )
+		{
+		}
+	};
+
+	CGradientBoostBinnedProblemBuilder( int featureCount, int valueSize, const CParams& params );
+	~CGradientBoostBinnedProblemBuilder();
+
+	// Adds the next chunk of vectors
+	// The values array contains valueSize values for each vector (0 or 1 for binary classification
+	// and the class indicators for multi-class classification)
+	// The weights array may be empty if all vectors have the weight 1
+	void AddChunk( const CFloatMatrixDesc& matrix, const CArray<float>& values, const CArray<float>& weights );
+
+	// Gets the built problem; no more chunks may be added after that
+	CPtr<CGradientBoostBinnedProblem> Build();
+
+private:
+	const CParams params; // the building parameters
+	const int featureCount; // the number of features
+	CPtr<CGradientBoostBinnedProblem> problem; // the problem being built
+	CSparseFloatMatrix sample; // the vectors for calculating the bins
+	CArray<int> nullBins; // the bin of the zero value for each feature
+	CArchiveFile file; // the file for the bin indices
+	CArray<unsigned char> chunkBins; // the bin indices of the chunk to be written to the file
+
+	void calcBins();
+	void addBins( const CFloatMatrixDesc& matrix );
+	template<class TBin>
+	void fillBins( const CFloatVectorDesc& vector, TBin* result ) const;
+};
+
+} // namespace NeoML
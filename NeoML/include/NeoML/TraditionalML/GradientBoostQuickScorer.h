@@ -37,6 +37,12 @@ public:
 	// with k taking values from 1 to the total number of trees
 	virtual bool ClassifyEx( const CSparseFloatVector& data, CArray<CClassificationResult>& results ) const = 0;
 	virtual bool ClassifyEx( const CFloatVectorDesc& data, CArray<CClassificationResult>& results ) const = 0;
+
+	// Classifies all rows of the matrix; the sparse rows must have sorted indices
+	// The rows are scored in blocks, checking each tree node for the whole block at once,
+	// which is much faster than classifying the rows one by one
+	// The blocks are distributed among threadCount threads
+	virtual void ClassifyBatch( const CFloatMatrixDesc& data, CArray<CClassificationResult>& results, int threadCount = 1 ) const = 0;
 };
 
 // Optimized regression model interface
@@ -46,6 +52,10 @@ public:
 
 	// Gets the learning rate
 	virtual double GetLearningRate() const = 0;
+
+	// Predicts the values for all rows of the matrix; the sparse rows must have sorted indices
+	// Works in the same way as IGradientBoostQSModel::ClassifyBatch
+	virtual void PredictBatch( const CFloatMatrixDesc& data, CArray<double>& results, int threadCount = 1 ) const = 0;
 };
 
 // The QuickScorer algorithm for optimizing a gradient boosting model
@@ -0,0 +1,85 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <NeoML/NeoMLDefs.h>
+#include <NeoML/TraditionalML/DecisionTree.h>
+#include <NeoML/TraditionalML/TrainingModel.h>
+#include <NeoML/Random.h>
+
+namespace NeoML {
+
+DECLARE_NEOML_MODEL_NAME( RandomForestModelName, "FmlRandomForestModel" )
+
+// Random forest model interface
+// The model averages the class probabilities predicted by its trees
+class NEOML_API IRandomForestModel : public IModel {
+public:
+	virtual ~IRandomForestModel();
+
+	// Gets the number of trees in the forest
+	virtual int GetTreeCount() const = 0;
+
+	// Classifies all rows of the matrix, distributing them among threadCount threads
+	// The rows are processed in blocks, so that each tree is traversed for the whole block at once
+	virtual void ClassifyBatch( const CFloatMatrixDesc& data, CArray<CClassificationResult>& results, int threadCount = 1 ) const = 0;
+};
+
+//------------------------------------------------------------------------------------------------------------
+
+// Random forest training algorithm
+// The decision trees are trained concurrently, each on its own bootstrap sample of the problem vectors
+class NEOML_API CRandomForest : public ITrainingModel {
+public:
+	// Training parameters
+	struct CParams {
+		// The number of trees in the forest
+		int TreeCount;
+		// The size of each bootstrap sample relative to the number of vectors in the problem (may be from 0 to 1)
+		double Subsample;
+		// The number of processing threads; the trees are trained in parallel
+		int ThreadCount;
+		// The random numbers generator used for sampling
+		// If null, each training starts a new generator with the default seed, so the result is reproducible
+		CRandom* Random;
+		// The parameters of each tree
+		// MulticlassMode must be MM_SingleClassifier, ThreadCount is ignored
+		// If RandomSelectedFeaturesCount is -1, the square root of the number of features is used
+		// TB_FastHist is used by default: the histogram data is built once and shared by all trees
+		CDecisionTree::CParams TreeParams;
+
+		CParams() :
+			TreeCount( 100 ),
+			Subsample( 1.0 ),
+			ThreadCount( 1 ),
+			Random( 0 )
+		{
+			TreeParams.TreeBuilder = CDecisionTree::TB_FastHist;
+		}
+	};
+
+	explicit CRandomForest( const CParams& params );
+	~CRandomForest();
+
+	// ITrainingModel interface methods:
+	// The resulting IModel is an IRandomForestModel, use TrainModel<IRandomForestModel> to get it directly
+	CPtr<IModel> Train( const IProblem& problem ) override;
+
+private:
+	const CParams params; // the training parameters
+};
+
+} // namespace NeoML
@@ -20,6 +20,7 @@ limitations under the License.
 #include <NeoMathEngine/NeoMathEngine.h>
 #include <NeoML/Dnn/Layers/CompositeLayer.h>
 #include <NeoML/Dnn/Layers/BaseInPlaceLayer.h>
+#include <Dnn/DnnMemoryPlanner.h>
 #include <memory>
 
 namespace NeoML {
@@ -100,6 +101,7 @@ void CBaseLayer::unlink()
 	readyOutputDiffs.DeleteAll();
 
 	clearAllRuntimeBlobs();
+	reshapeCache.DeleteAll();
 }
 
 // Establish connections
@@ -202,7 +204,12 @@ void CBaseLayer::AllocateOutputBlobs()
 
 	for( int i = 0; i < outputDescs.Size(); ++i ) {
 		if( outputBlobs[i] == 0 ) {
-			outputBlobs[i] = CDnnBlob::CreateBlob( MathEngine(), outputDescs[i].GetDataType(), outputDescs[i] );
+			if( GetDnn()->memoryPlanner != 0 ) {
+				outputBlobs[i] = GetDnn()->memoryPlanner->CreateOutputBlob( *this, i );
+			}
+			if( outputBlobs[i] == 0 ) {
+				outputBlobs[i] = CDnnBlob::CreateBlob( MathEngine(), outputDescs[i].GetDataType(), outputDescs[i] );
+			}
 		} else {
 			if( !outputBlobs[i]->GetDesc().HasEqualDimensions( outputDescs[i] ) ) {
 				// If this output can be connected to in-place transform. And on the second run outputBlob's shape can mismatch with outputDesc.
@@ -229,6 +236,7 @@ void CBaseLayer::CleanUp()
 	inputBlobs.SetSize(inputDescs.Size());
 	outputBlobs.DeleteAll();
 	outputBlobs.SetSize(outputDescs.Size());
+	reshapeCache.DeleteAll();
 }
 
 size_t CBaseLayer::GetTrainableParametersSize() const
@@ -325,6 +333,8 @@ void CBaseLayer::reshape()
 		|| outputDescs.Size() != outputs.Size()
 		|| isInPlaceProcess()
 		|| isComposite();
+	// Only the input sizes may change when the reshape cache is used, the other changes make it invalid
+	const bool isCacheUsed = !forcedReshape && isReshapeCacheUsed();
 
 	if(!forcedReshape) {
 		for(int i = 0; i < inputBlobs.Size(); i++) {
@@ -339,6 +349,12 @@ void CBaseLayer::reshape()
 	// Reshaping the layer
 	forcedReshape = false;
 
+	if( isCacheUsed ) {
+		saveReshapeResult( prevInputDescs );
+	} else {
+		reshapeCache.DeleteAll();
+	}
+
 	inputBlobs.DeleteAll();
 	outputBlobs.DeleteAll();
 
@@ -352,13 +368,15 @@ void CBaseLayer::reshape()
 	outputDiffBlobs.DeleteAll();
 	clearAllRuntimeBlobs();
 
-	if( MathEngine().GetType() == MET_Cpu && !GetDnn()->IsBackwardPerformed()
-		&& MathEngine().GetMemoryInPools() > MaxMemoryInPools )
-	{
-		MathEngine().CleanUp();
-	}
+	if( !isCacheUsed || !restoreReshapeResult() ) {
+		if( MathEngine().GetType() == MET_Cpu && !GetDnn()->IsBackwardPerformed()
+			&& MathEngine().GetMemoryInPools() > MaxMemoryInPools )
+		{
+			MathEngine().CleanUp();
+		}
 
-	Reshape();
+		Reshape();
+	}
 
 	NeoPresume( inputBlobs.IsEmpty() );
 	NeoPresume( outputBlobs.IsEmpty() );
@@ -371,6 +389,58 @@ void CBaseLayer::reshape()
 	runOnceTime = 0;
 }
 
+// Checks if the reshape results are taken from the cache
+bool CBaseLayer::isReshapeCacheUsed() const
+{
+	return dnn->reshapeCacheSize > 0 && !dnn->IsBackwardPerformed() && IsReshapeCacheSupported();
+}
+
+// Saves the result of the last reshape to the cache
+void CBaseLayer::saveReshapeResult( const CArray<CBlobDesc>& prevInputDescs )
+{
+	CPtr<CReshapeCacheEntry> entry = FINE_DEBUG_NEW CReshapeCacheEntry();
+	prevInputDescs.CopyTo( entry->InputDescs );
+	outputDescs.CopyTo( entry->OutputDescs );
+	runtimeBlobs.CopyTo( entry->RuntimeBlobs );
+	runtimeBlobPtrs.CopyTo( entry->RuntimeBlobPtrs );
+	entry->State = DetachReshapeState();
+	reshapeCache.Add( entry );
+}
+
+// Restores the result of the reshape for the current inputs from the cache
+// Returns false if the inputs have not had such sizes before
+bool CBaseLayer::restoreReshapeResult()
+{
+	bool isFound = false;
+	for( int i = reshapeCache.Size() - 1; i >= 0 && !isFound; --i ) {
+		CReshapeCacheEntry& entry = *reshapeCache[i];
+		bool isEqual = true;
+		for( int j = 0; j < inputDescs.Size() && isEqual; ++j ) {
+			isEqual = inputDescs[j].HasEqualDimensions( entry.InputDescs[j] );
+		}
+		if( !isEqual ) {
+			continue;
+		}
+
+		NeoPresume( entry.OutputDescs.Size() == outputDescs.Size() );
+		entry.OutputDescs.CopyTo( outputDescs );
+		for( int j = 0; j < entry.RuntimeBlobPtrs.Size(); ++j ) {
+			*entry.RuntimeBlobPtrs[j] = entry.RuntimeBlobs[j];
+			RegisterRuntimeBlob( *entry.RuntimeBlobPtrs[j] );
+		}
+		AttachReshapeState( entry.State );
+		// The entry describes the current state now; it is saved again when the inputs change
+		reshapeCache.DeleteAt( i );
+		isFound = true;
+	}
+
+	// The current sizes take one place in the cache
+	if( reshapeCache.Size() >= dnn->reshapeCacheSize ) {
+		reshapeCache.DeleteAt( 0, reshapeCache.Size() - dnn->reshapeCacheSize + 1 );
+	}
+	return isFound;
+}
+
 class CRunOnceTimer {
 public:
 	CRunOnceTimer( bool enable, IMathEngine& mathEngine, int& hitCount, IPerformanceCounters::CCounter::TCounterType& result );
@@ -663,6 +733,30 @@ void CBaseLayer::setDnn( CDnn* newDnn )
 	OnDnnChanged( oldDnn );
 }
 
+// Replaces the layer parameters with the ones of the original layer (the layers must have the same structure)
+void CBaseLayer::referenceParamBlobs( CBaseLayer& original )
+{
+	NeoAssert( &original.MathEngine() == &mathEngine );
+	NeoAssert( paramBlobs.Size() == original.paramBlobs.Size() );
+
+	for( int i = 0; i < paramBlobs.Size(); ++i ) {
+		paramBlobs[i] = original.paramBlobs[i];
+	}
+	paramDiffBlobs.DeleteAll();
+	referenceCalculatedParams( original );
+
+	if( isComposite() ) {
+		CCompositeLayer* composite = CheckCast<CCompositeLayer>( this );
+		CCompositeLayer* originalComposite = CheckCast<CCompositeLayer>( &original );
+		CArray<const char*> layerList;
+		composite->GetLayerList( layerList );
+		for( int i = 0; i < layerList.Size(); ++i ) {
+			composite->GetLayer( layerList[i] )->referenceParamBlobs( *originalComposite->GetLayer( layerList[i] ) );
+		}
+	}
+	ForceReshape();
+}
+
 void CBaseLayer::SetName( const char* _name )
 {
 	if(name == _name) {
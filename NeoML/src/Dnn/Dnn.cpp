@@ -77,6 +77,7 @@ limitations under the License.
 #include <NeoML/Dnn/Layers/AddToObjectLayer.h>
 #include <NeoML/Dnn/Layers/MatrixMultiplicationLayer.h>
 #include <NeoML/Dnn/Layers/MultiheadAttentionLayer.h>
+#include <NeoML/Dnn/Layers/ScaledDotProductAttentionLayer.h>
 #include <NeoML/Dnn/Layers/GELULayer.h>
 #include <NeoML/Dnn/Layers/ProjectionPoolingLayer.h>
 #include <NeoML/Dnn/Layers/QrnnLayer.h>
@@ -90,6 +91,9 @@ limitations under the License.
 #include <NeoML/Dnn/Layers/DataLayer.h>
 #include <NeoML/Dnn/Layers/TransformerLayer.h>
 #include <NeoML/Dnn/Layers/BertConvLayer.h>
+#include <Dnn/DnnLayerScheduler.h>
+#include <Dnn/DnnMemoryPlanner.h>
+#include <Dnn/DnnReferenceFile.h>
 
 namespace NeoML {
 
@@ -323,6 +327,7 @@ REGISTER_NEOML_LAYER( CAttentionSumLayer, "FmlCnnAttentionSumLayer" )
 REGISTER_NEOML_LAYER( CAddToObjectLayer, "NeoMLDnnAddToObjectLayer" )
 REGISTER_NEOML_LAYER( CMatrixMultiplicationLayer, "NeoMLDnnMatrixMultiplicationLayer" )
 REGISTER_NEOML_LAYER( CMultiheadAttentionLayer, "NeoMLDnnMultiheadAttentionLayer" )
+REGISTER_NEOML_LAYER( CScaledDotProductAttentionLayer, "NeoMLDnnScaledDotProductAttentionLayer" )
 REGISTER_NEOML_LAYER( CPositionalEmbeddingLayer, "NeoMLDnnPositionalEmbeddingLayer" )
 REGISTER_NEOML_LAYER( CGELULayer, "NeoMLDnnGELULayer" )
 REGISTER_NEOML_LAYER( CProjectionPoolingLayer, "FmlCnnProjectionPoolingLayerClass" )
@@ -359,7 +364,9 @@ CDnn::CDnn( CRandom& _random, IMathEngine& _mathEngine ) :
 	currentSequencePos( 0 ),
 	isReverseSequense( false ),
 	autoRestartMode( true ),
-	isReuseMemoryMode( false )
+	isReuseMemoryMode( false ),
+	layerScheduler( nullptr ),
+	reshapeCacheSize( 0 )
 {
 	solver = FINE_DEBUG_NEW CDnnSimpleGradientSolver( mathEngine );
 	initializer = FINE_DEBUG_NEW CDnnXavierInitializer( random );
@@ -372,6 +379,7 @@ CDnn::~CDnn()
 		DeleteLayer(*layer);
 		layer->setDnn(0);
 	}
+	delete layerScheduler;
 }
 
 void CDnn::GetLayerList( CArray<const char*>& layerList ) const
@@ -507,6 +515,10 @@ void CDnn::runOnce(int curSequencePos)
 	if( IsLogging() ) {
 		*log << "Run " << runNumber << " : " << currentSequencePos;
 	}
+	if( layerScheduler != nullptr && !isRecurrentMode && !isBackwardPerformed ) {
+		// Run the layers in parallel; the sink layers below will find they have run already
+		layerScheduler->Run( [this]( int layerIndex ) { layers[layerIndex]->runOnce(); } );
+	}
 	// Run the network for each sink layer; they will recursively call RunOnce for all their inputs
 	for( int i = 0; i < sinkLayers.Size(); ++i ) {
 		sinkLayers[i]->runOnce();
@@ -537,7 +549,18 @@ void CDnn::RunOnce()
 		}
 		reshape(); // rebuild the network if necessary
 		
-		isReuseMemoryMode = ( getOutputBlobsSize() > MinReuseMemoryModeNetSize );
+		if( memoryPlanner != 0 ) {
+			// The plan relies on the sequential order of the layers
+			if( layerScheduler == nullptr ) {
+				memoryPlanner->Plan( *this );
+			} else {
+				memoryPlanner->Reset();
+			}
+		}
+		// The output blobs release is not synchronized between the layers running in parallel
+		// and is not needed when the memory is planned
+		isReuseMemoryMode = layerScheduler == nullptr && memoryPlanner == 0
+			&& ( getOutputBlobsSize() > MinReuseMemoryModeNetSize );
 		runOnce(0);
 	}
 #ifdef NEOML_USE_FINEOBJ
@@ -572,6 +595,10 @@ void CDnn::RunAndBackwardOnce()
 			RestartSequence();
 		}
 		reshape(); // rebuild the network if necessary
+		if( memoryPlanner != 0 ) {
+			// The blobs are needed for the backward pass, so they are allocated as usual
+			memoryPlanner->Reset();
+		}
 		isReuseMemoryMode = false;
 		runOnce(0);
 		backwardRunAndLearnOnce(0);
@@ -668,9 +695,95 @@ void CDnn::rebuild()
 			sinkLayers.Add(layers[i]);
 		}
 	}
+	if( layerScheduler != nullptr ) {
+		setSchedulerGraph();
+	}
 	RequestReshape(true);
 }
 
+// Passes the layer dependencies to the scheduler
+void CDnn::setSchedulerGraph()
+{
+	NeoPresume( layerScheduler != nullptr );
+
+	CMap<const CBaseLayer*, int> layerIndices;
+	for( int i = 0; i < layers.Size(); ++i ) {
+		layerIndices.Add( layers[i], i );
+	}
+
+	CArray<CArray<int>> inputs;
+	inputs.SetSize( layers.Size() );
+	for( int i = 0; i < layers.Size(); ++i ) {
+		const CBaseLayer* layer = layers[i];
+		for( int j = 0; j < layer->GetInputCount(); ++j ) {
+			const int inputIndex = layerIndices.Get( layer->GetInputLayer( j ) );
+			if( inputs[i].Find( inputIndex ) == NotFound ) {
+				inputs[i].Add( inputIndex );
+			}
+		}
+	}
+	layerScheduler->SetGraph( inputs );
+}
+
+void CDnn::SetInterLayerThreadCount( int threadCount )
+{
+	NeoAssert( threadCount > 0 );
+	if( threadCount == GetInterLayerThreadCount() ) {
+		return;
+	}
+
+	delete layerScheduler;
+	layerScheduler = nullptr;
+	if( threadCount > 1 ) {
+		NeoAssert( mathEngine.GetType() == MET_Cpu );
+		layerScheduler = FINE_DEBUG_NEW CDnnLayerScheduler( threadCount );
+		if( !isRebuildNeeded ) {
+			setSchedulerGraph();
+		}
+	}
+}
+
+int CDnn::GetInterLayerThreadCount() const
+{
+	return layerScheduler == nullptr ? 1 : layerScheduler->GetThreadCount();
+}
+
+void CDnn::EnableMemoryPlanning( bool enable )
+{
+	if( enable == IsMemoryPlanningEnabled() ) {
+		return;
+	}
+
+	if( enable ) {
+		memoryPlanner = FINE_DEBUG_NEW CDnnMemoryPlanner( mathEngine );
+	} else {
+		memoryPlanner->Reset();
+		memoryPlanner = 0;
+	}
+}
+
+bool CDnn::IsMemoryPlanningEnabled() const
+{
+	return memoryPlanner != 0;
+}
+
+size_t CDnn::GetPlannedMemorySize() const
+{
+	return memoryPlanner == 0 ? 0 : memoryPlanner->GetPlannedSize();
+}
+
+void CDnn::SetReshapeCacheSize( int size )
+{
+	NeoAssert( size >= 0 );
+	if( size == reshapeCacheSize ) {
+		return;
+	}
+
+	reshapeCacheSize = size;
+	// The forced reshape clears the caches of the layers
+	RequestReshape( true );
+}
+
 size_t CDnn::getOutputBlobsSize() const
 {
 	size_t result = 0;
@@ -770,4 +883,29 @@ void CDnn::EnableProfile( bool profile )
 	}
 }
 
+void CDnn::CreateReferenceDnn( CDnn& referenceDnn )
+{
+	NeoAssert( &referenceDnn != this );
+	NeoAssert( &referenceDnn.GetMathEngine() == &mathEngine );
+
+	{
+		// The structure is copied through serialization; the blobs are not written,
+		// the loaded blobs use the data of the original ones
+		CDnnReferenceFile file;
+		{
+			CArchive archive( &file, CArchive::SD_Storing );
+			Serialize( archive );
+		}
+		file.SeekToBegin();
+		CArchive archive( &file, CArchive::SD_Loading );
+		referenceDnn.Serialize( archive );
+	}
+
+	for( int i = 0; i < referenceDnn.layers.Size(); ++i ) {
+		CBaseLayer* layer = referenceDnn.layers[i];
+		layer->referenceParamBlobs( *GetLayer( layer->GetName() ) );
+	}
+	referenceDnn.DisableLearning();
+}
+
 } // namespace NeoML
@@ -17,6 +17,8 @@ limitations under the License.
 #pragma hdrstop
 
 #include <NeoML/Dnn/DnnBlob.h>
+#include <NeoML/MappedArchiveFile.h>
+#include <Dnn/DnnReferenceFile.h>
 #include <NeoMathEngine/NeoMathEngine.h>
 #include <NeoML/Dnn/Layers/LossLayer.h>
 
@@ -26,7 +28,8 @@ CDnnBlob::CDnnBlob( IMathEngine& _mathEngine ) :
 	mathEngine( _mathEngine ),
 	dataOwned( true ),
 	parent(0),
-	parentPos(0)
+	parentPos(0),
+	dataVersion(0)
 {
 }
 
@@ -114,6 +117,14 @@ void CDnnBlob::initializeBlob(TBlobType type,
 			desc.SetDataType( CT_Int );
 			data = mathEngine.HeapAllocTyped<int>( allocSize );
 			break;
+		case CT_Int8:
+			desc.SetDataType( CT_Int8 );
+			data = mathEngine.HeapAllocTyped<int8_t>( allocSize );
+			break;
+		case CT_BFloat16:
+			desc.SetDataType( CT_BFloat16 );
+			data = mathEngine.HeapAllocTyped<uint16_t>( allocSize );
+			break;
 		default:
 			NeoAssert( false );
 	}
@@ -144,6 +155,14 @@ void CDnnBlob::initializeTensor(TBlobType type, std::initializer_list<int> dimen
 			desc.SetDataType( CT_Int );
 			data = mathEngine.HeapAllocTyped<int>( allocSize );
 			break;
+		case CT_Int8:
+			desc.SetDataType( CT_Int8 );
+			data = mathEngine.HeapAllocTyped<int8_t>( allocSize );
+			break;
+		case CT_BFloat16:
+			desc.SetDataType( CT_BFloat16 );
+			data = mathEngine.HeapAllocTyped<uint16_t>( allocSize );
+			break;
 		default:
 			NeoAssert( false );
 	}
@@ -180,6 +199,16 @@ void CDnnBlob::initializeByPattern(TBlobType type, const CBlobDesc& pattern)
 			desc.SetDataType( type );
 			data = mathEngine.HeapAllocTyped<int>( newPattern.BlobSize() );
 			break;
+		case CT_Int8:
+			desc = newPattern;
+			desc.SetDataType( type );
+			data = mathEngine.HeapAllocTyped<int8_t>( newPattern.BlobSize() );
+			break;
+		case CT_BFloat16:
+			desc = newPattern;
+			desc.SetDataType( type );
+			data = mathEngine.HeapAllocTyped<uint16_t>( newPattern.BlobSize() );
+			break;
 		default:
 			NeoAssert( false );
 	}
@@ -226,6 +255,16 @@ void CDnnBlob::CopyFrom(const CDnnBlob* other)
 		case CT_Int:
 			mathEngine.VectorCopy( GetData<int>(), other->GetData<int>(), GetDataSize() );
 			break;
+		case CT_Int8:
+		case CT_BFloat16:
+		{
+			// There is no special copying method for these types
+			const size_t size = GetDataSize() * ( GetDataType() == CT_Int8 ? sizeof( int8_t ) : sizeof( uint16_t ) );
+			void* buffer = mathEngine.GetBuffer( other->data, 0, size, true );
+			mathEngine.DataExchangeRaw( data, buffer, size );
+			mathEngine.ReleaseBuffer( other->data, buffer, false );
+			break;
+		}
 		default:
 			NeoAssert( false );
 	}
@@ -492,14 +531,13 @@ void CDnnBlob::SplitByObject( IMathEngine& mathEngine, const CPtr<CDnnBlob>& fro
 	SplitByDim( mathEngine, static_cast<TBlobDim>(CBlobDesc::FirstObjectDim), from, to );
 }
 
+// The raw data in the archive is aligned so that it may be used right from the memory-mapped file
+static const int BlobDataAlignment = 64;
+
 // Reads the data from archive into blob memory; in case of CPU reads directly
 template<typename T>
-static void readRawData( IMathEngine& mathEngine, CArchive& archive, const CTypedMemoryHandle<T>& handle )
+static void readRawData( IMathEngine& mathEngine, CArchive& archive, int size, const CTypedMemoryHandle<T>& handle )
 {
-	unsigned int size = 0;
-	archive >> size;
-	check( static_cast<int>( size ) >= 0, ERR_BAD_ARCHIVE, archive.Name() );
-
 	if( size > 0 ) {
 		void* ptr = mathEngine.GetBuffer( handle, 0, size * sizeof(T), false );
 		archive.Read( ptr, size * sizeof(T) );
@@ -512,6 +550,14 @@ static void writeRawData( IMathEngine& mathEngine, const int size, const CTypedM
 {
 	archive << static_cast<unsigned int>( size );
 
+	// The padding length takes one byte
+	const int padding = static_cast<int>( ( BlobDataAlignment - ( archive.GetPosition() + 1 ) % BlobDataAlignment )
+		% BlobDataAlignment );
+	archive << static_cast<unsigned char>( padding );
+	for( int i = 0; i < padding; ++i ) {
+		archive << static_cast<unsigned char>( 0 );
+	}
+
 	if( size > 0 ) {
 		void* ptr = mathEngine.GetBuffer( handle, 0, size * sizeof(T), true );
 		archive.Write( ptr, size * sizeof(T) );
@@ -519,13 +565,17 @@ static void writeRawData( IMathEngine& mathEngine, const int size, const CTypedM
 	}
 }
 
-static const int BlobVersion = 2000;
+static const int BlobVersion = 2001;
 
 void CDnnBlob::Serialize( CArchive& archive )
 {
 	NeoAssert( parent == 0 ); // a blob that links to another may not be serialized
 
-	archive.SerializeVersion( BlobVersion, CDnn::ArchiveMinSupportedVersion );
+	if( serializeReference( archive ) ) {
+		return;
+	}
+
+	const int version = archive.SerializeVersion( BlobVersion, CDnn::ArchiveMinSupportedVersion );
 
 	if( archive.IsStoring() ) {
 		archive << static_cast<int>( GetDataType() );
@@ -541,6 +591,12 @@ void CDnnBlob::Serialize( CArchive& archive )
 			case CT_Int:
 				writeRawData( mathEngine, desc.BlobSize(), GetData<int>(), archive );
 				break;
+			case CT_Int8:
+				writeRawData( mathEngine, desc.BlobSize(), GetData<int8_t>(), archive );
+				break;
+			case CT_BFloat16:
+				writeRawData( mathEngine, desc.BlobSize(), GetData<uint16_t>(), archive );
+				break;
 			default:
 				NeoAssert( false );
 		}
@@ -553,17 +609,36 @@ void CDnnBlob::Serialize( CArchive& archive )
 		archive >> intPack;
 		int batchLength, batchWidth, listSize, height, width, depth, channels;
 		archive >> batchLength >> batchWidth >> listSize >> height >> width >> depth >> channels;
-		initializeBlob(type, batchLength, batchWidth, listSize, height, width, depth, channels);
 
-		switch( type ) {
-			case CT_Float:
-				readRawData( mathEngine, archive, GetData<float>() );
-				break;
-			case CT_Int:
-				readRawData( mathEngine, archive, GetData<int>() );
-				break;
-			default:
-				NeoAssert( false );
+		unsigned int size = 0;
+		archive >> size;
+		check( static_cast<int>( size ) >= 0, ERR_BAD_ARCHIVE, archive.Name() );
+		if( version >= 2001 ) {
+			unsigned char padding = 0;
+			archive >> padding;
+			archive.Skip( padding );
+		}
+
+		if( !mapArchiveData( archive, type, size, batchLength, batchWidth, listSize, height, width, depth, channels ) ) {
+			initializeBlob(type, batchLength, batchWidth, listSize, height, width, depth, channels);
+			check( static_cast<int>( size ) == desc.BlobSize(), ERR_BAD_ARCHIVE, archive.Name() );
+
+			switch( type ) {
+				case CT_Float:
+					readRawData( mathEngine, archive, size, GetData<float>() );
+					break;
+				case CT_Int:
+					readRawData( mathEngine, archive, size, GetData<int>() );
+					break;
+				case CT_Int8:
+					readRawData( mathEngine, archive, size, GetData<int8_t>() );
+					break;
+				case CT_BFloat16:
+					readRawData( mathEngine, archive, size, GetData<uint16_t>() );
+					break;
+				default:
+					NeoAssert( false );
+			}
 		}
 		parentPos = 0;
 	} else {
@@ -571,4 +646,92 @@ void CDnnBlob::Serialize( CArchive& archive )
 	}
 }
 
+// Stores only the reference to the blob in the network structure copy (see CDnn::CreateReferenceDnn)
+// and points the loaded blob to the data of the stored one
+// Returns false if the archive is not used for such copying
+bool CDnnBlob::serializeReference( CArchive& archive )
+{
+	CDnnReferenceFile* file = dynamic_cast<CDnnReferenceFile*>( archive.GetFile() );
+	if( file == nullptr ) {
+		return false;
+	}
+
+	if( archive.IsStoring() ) {
+		archive << file->AddBlob( this );
+	} else if( archive.IsLoading() ) {
+		NeoAssert( desc.GetDataType() == CT_Invalid );
+		int index = 0;
+		archive >> index;
+		NeoAssert( 0 <= index && index < file->GetBlobCount() );
+		CDnnBlob* original = file->GetBlob( index );
+		NeoAssert( &original->GetMathEngine() == &mathEngine );
+		desc = original->GetDesc();
+		data = original->data;
+		dataOwned = false;
+		mapping = original;
+		parentPos = 0;
+	} else {
+		NeoAssert( false );
+	}
+	return true;
+}
+
+// Points the blob to the data in the memory-mapped archive file instead of reading it
+// Returns false if the data should be read as usual
+bool CDnnBlob::mapArchiveData( CArchive& archive, TBlobType type, int size,
+	int batchLength, int batchWidth, int listSize, int height, int width, int depth, int channels )
+{
+	NeoAssert( desc.GetDataType() == CT_Invalid );
+
+	CMappedArchiveFile* file = dynamic_cast<CMappedArchiveFile*>( archive.GetFile() );
+	if( file == nullptr || size == 0 ) {
+		return false;
+	}
+
+	size_t elementSize = 0;
+	switch( type ) {
+		case CT_Float:
+			elementSize = sizeof( float );
+			break;
+		case CT_Int:
+			elementSize = sizeof( int );
+			break;
+		case CT_Int8:
+			elementSize = sizeof( int8_t );
+			break;
+		case CT_BFloat16:
+			elementSize = sizeof( uint16_t );
+			break;
+		default:
+			return false;
+	}
+	const __int64 byteSize = static_cast<__int64>( size ) * elementSize;
+	const __int64 position = archive.GetPosition();
+	char* ptr = file->GetData() + position;
+	// The archives written by the older versions are not aligned
+	if( reinterpret_cast<uintptr_t>( ptr ) % BlobDataAlignment != 0 || position + byteSize > file->GetLength() ) {
+		return false;
+	}
+	const CMemoryHandle handle = mathEngine.CreateExternalMemoryHandle( ptr );
+	if( handle.IsNull() ) {
+		return false;
+	}
+
+	desc.SetDataType( type );
+	desc.SetDimSize( BD_BatchLength, batchLength );
+	desc.SetDimSize( BD_BatchWidth, batchWidth );
+	desc.SetDimSize( BD_ListSize, listSize );
+	desc.SetDimSize( BD_Height, height );
+	desc.SetDimSize( BD_Width, width );
+	desc.SetDimSize( BD_Depth, depth );
+	desc.SetDimSize( BD_Channels, channels );
+	check( size == desc.BlobSize(), ERR_BAD_ARCHIVE, archive.Name() );
+
+	archive.Seek( byteSize, CBaseFile::current );
+	data = handle;
+	dataOwned = false;
+	mapping = file->GetMapping();
+	return true;
+}
+
 } // namespace NeoML
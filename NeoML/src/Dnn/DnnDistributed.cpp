@@ -14,60 +14,236 @@ limitations under the License.
 #pragma hdrstop
 
 #include <thread>
-#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
 #include <functional>
 #include <NeoMathEngine/NeoMathEngine.h>
 #include <NeoML/Dnn/DnnDistributed.h>
 
+#if FINE_PLATFORM( FINE_LINUX )
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 namespace NeoML {
 
-void CDistributedTraining::initialize( CArchive& archive, int count )
+// The persistent thread which runs the tasks one by one
+class CDistributedWorker {
+public:
+    // The thread is pinned to the given cores of the process; no pinning if coreCount is 0
+    CDistributedWorker( int firstCore, int coreCount );
+    ~CDistributedWorker();
+
+    // Starts the task; the previous task should be finished
+    void Start( const std::function<void()>& task );
+    // Waits for the task to finish and rethrows the exception thrown by the task
+    void Wait();
+
+private:
+    std::thread thread;
+    std::mutex mutex;
+    // Signaled when a task is started or finished and when the worker is destroyed
+    std::condition_variable stateChanged;
+    std::function<void()> task;
+    bool isRunning;
+    bool isDestroying;
+    std::exception_ptr exception;
+
+    void run( int firstCore, int coreCount );
+};
+
+// Pins the current thread to coreCount cores, starting from the firstCore core available to the process
+static void pinCurrentThread( int firstCore, int coreCount )
+{
+#if FINE_PLATFORM( FINE_LINUX )
+    cpu_set_t available;
+    if( sched_getaffinity( 0, sizeof( available ), &available ) != 0 ){
+        return;
+    }
+    cpu_set_t pinned;
+    CPU_ZERO( &pinned );
+    int index = 0;
+    for( int cpu = 0; cpu < CPU_SETSIZE && index < firstCore + coreCount; ++cpu ){
+        if( CPU_ISSET( cpu, &available ) ){
+            if( index >= firstCore ){
+                CPU_SET( cpu, &pinned );
+            }
+            ++index;
+        }
+    }
+    if( index == firstCore + coreCount ){
+        // The threads started by this thread inherit the affinity
+        pthread_setaffinity_np( pthread_self(), sizeof( pinned ), &pinned );
+    }
+#else
+    ( void ) firstCore;
+    ( void ) coreCount;
+#endif
+}
+
+CDistributedWorker::CDistributedWorker( int firstCore, int coreCount ) :
+    isRunning( false ),
+    isDestroying( false )
+{
+    thread = std::thread( [this, firstCore, coreCount] { run( firstCore, coreCount ); } );
+}
+
+CDistributedWorker::~CDistributedWorker()
+{
+    {
+        std::lock_guard<std::mutex> lock( mutex );
+        isDestroying = true;
+    }
+    stateChanged.notify_all();
+    thread.join();
+}
+
+void CDistributedWorker::Start( const std::function<void()>& _task )
+{
+    {
+        std::lock_guard<std::mutex> lock( mutex );
+        NeoAssert( !isRunning );
+        task = _task;
+        isRunning = true;
+    }
+    stateChanged.notify_all();
+}
+
+void CDistributedWorker::Wait()
+{
+    std::unique_lock<std::mutex> lock( mutex );
+    stateChanged.wait( lock, [this] { return !isRunning; } );
+    if( exception != nullptr ){
+        std::exception_ptr error = exception;
+        exception = nullptr;
+        std::rethrow_exception( error );
+    }
+}
+
+void CDistributedWorker::run( int firstCore, int coreCount )
+{
+    if( coreCount > 0 ){
+        pinCurrentThread( firstCore, coreCount );
+    }
+
+    std::unique_lock<std::mutex> lock( mutex );
+    while( true ){
+        // The running task is finished before the destruction
+        stateChanged.wait( lock, [this] { return isDestroying || isRunning; } );
+        if( !isRunning ){
+            return;
+        }
+        lock.unlock();
+        try {
+            task();
+        } catch( ... ) {
+            lock.lock();
+            exception = std::current_exception();
+            lock.unlock();
+        }
+        lock.lock();
+        isRunning = false;
+        stateChanged.notify_all();
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+
+void CDistributedTraining::initialize( CArchive& archive, int count, int threadCount )
 {
     for( int i = 0; i < count; i++ ){
+        // Pin the models to the cores only if each model gets its own cores
+        const CMathEngineDistributedInfo info = mathEngines[i]->GetDistributedInfo();
+        const bool pin = threadCount > 0
+            && info.Threads * threadCount <= static_cast<int>( std::thread::hardware_concurrency() );
         rands.Add( new CRandom( 42 ) );
         cnns.Add( new CDnn( *rands[i], *mathEngines[i] ) );
         cnns[i]->SetInitializer( new CDnnDistributedInitializer( *rands[i], mathEngines[i], cnns[i]->GetInitializer() ) );
         archive.Serialize( *cnns[i] );
         archive.Seek( 0, static_cast<CBaseFile::TSeekPosition>( 0 ) );
+        workers.Add( new CDistributedWorker( info.Thread * threadCount, pin ? threadCount : 0 ) );
+        feeders.Add( new CDistributedWorker( 0, 0 ) );
+        preparingDatasets.Add( nullptr );
     }
 }
 
-CDistributedTraining::CDistributedTraining( CArchive& archive, int count )
+CDistributedTraining::CDistributedTraining( CArchive& archive, int count, int threadCount )
 {
     mathEngines.SetSize( count );
-    CreateDistributedCpuMathEngines( mathEngines.GetPtr(), count );
-    initialize( archive, count );
+    CreateDistributedCpuMathEngines( mathEngines.GetPtr(), count, threadCount );
+    initialize( archive, count, threadCount );
+}
+
+CDistributedTraining::CDistributedTraining( CArchive& archive, const char* name, int tcpPort,
+        int process, int processCount, int threadCount )
+{
+    mathEngines.Add( CreateMultiProcessCpuMathEngine( name, tcpPort, process, processCount, DT_Auto, threadCount ) );
+    initialize( archive, 1, threadCount );
 }
 
 CDistributedTraining::CDistributedTraining( CArchive& archive, const CArray<int>& cudaDevs )
 {
     mathEngines.SetSize( cudaDevs.Size() );
     CreateDistributedCudaMathEngines( mathEngines.GetPtr(), cudaDevs.Size(), cudaDevs.GetPtr() );
-    initialize( archive, cudaDevs.Size() );
+    initialize( archive, cudaDevs.Size(), 0 );
 }
 
 CDistributedTraining::~CDistributedTraining()
 {
     for( int i = 0; i < cnns.Size(); i++ ){
+        // The workers wait for the running tasks to finish
+        delete feeders[i];
+        delete workers[i];
         delete cnns[i];
         delete rands[i];
         delete mathEngines[i];
     }
 }
 
+void CDistributedTraining::runAndLearnOnce( IDistributedDataset& data, int model )
+{
+    // The number of the model among all models of all processes
+    const int thread = mathEngines[model]->GetDistributedInfo().Thread;
+    IDistributedPipelinedDataset* pipelined = dynamic_cast<IDistributedPipelinedDataset*>( &data );
+    if( preparingDatasets[model] != nullptr ){
+        try {
+            feeders[model]->Wait();
+        } catch( ... ) {
+            preparingDatasets[model] = nullptr;
+            throw;
+        }
+    }
+    if( pipelined != nullptr && preparingDatasets[model] != pipelined ){
+        // The first batch of this dataset
+        pipelined->PrepareInputBatch( thread );
+    }
+    preparingDatasets[model] = nullptr;
+
+    data.SetInputBatch( *cnns[model], thread );
+    if( pipelined != nullptr ){
+        // The next batch is prepared while the model is being trained
+        preparingDatasets[model] = pipelined;
+        feeders[model]->Start( [pipelined, thread] { pipelined->PrepareInputBatch( thread ); } );
+    }
+    cnns[model]->RunAndLearnOnce();
+}
+
 void CDistributedTraining::RunAndLearnOnce( IDistributedDataset& data )
 {
-    std::vector<std::thread> threads;
-    for ( int i = 0; i < cnns.Size(); i++ ) {
-        std::thread t( std::bind(
-            [&]( int thread ){
-                data.SetInputBatch( *cnns[thread], thread );
-                cnns[thread]->RunAndLearnOnce();
-            },  i ) );
-        threads.push_back( std::move( t ) );
-    }
-    for ( int i = 0; i < cnns.Size(); i++ ) {
-        threads[i].join();
+    for( int i = 0; i < cnns.Size(); i++ ){
+        workers[i]->Start( [this, &data, i] { runAndLearnOnce( data, i ); } );
+    }
+    std::exception_ptr exception;
+    for( int i = 0; i < cnns.Size(); i++ ){
+        try {
+            workers[i]->Wait();
+        } catch( ... ) {
+            exception = std::current_exception();
+        }
+    }
+    if( exception != nullptr ){
+        std::rethrow_exception( exception );
     }
 }
 
@@ -0,0 +1,194 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <common.h>
+#pragma hdrstop
+
+#include <Dnn/DnnGradientReducer.h>
+#include <NeoML/Dnn/Dnn.h>
+
+namespace NeoML {
+
+// The size of the bucket with the fused gradients
+static const int GradientBucketSize = 1 << 18;
+
+CDnnSolver::CGradientReducer::CGradientReducer( IMathEngine& _mathEngine ) :
+	mathEngine( _mathEngine ),
+	isDestroying( false ),
+	closedCount( 0 ),
+	reducedCount( 0 )
+{
+	NeoAssert( mathEngine.IsDistributed() );
+	if( mathEngine.GetType() == MET_Cpu ) {
+		thread = std::thread( [this] { workerThread(); } );
+	}
+}
+
+CDnnSolver::CGradientReducer::~CGradientReducer()
+{
+	if( isAsync() ) {
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+			isDestroying = true;
+		}
+		stateChanged.notify_all();
+		thread.join();
+	}
+}
+
+void CDnnSolver::CGradientReducer::Add( CBaseLayer* layer, const CObjectArray<CDnnBlob>& paramDiffBlobs )
+{
+	for( int i = 0; i < paramDiffBlobs.Size(); ++i ) {
+		CDnnBlob* diff = paramDiffBlobs[i];
+		const int size = diff->GetDataSize();
+
+		CPart& part = parts.Append();
+		part.Layer = layer;
+		part.ParamIndex = i;
+		part.Desc = diff->GetDesc();
+
+		if( size >= GradientBucketSize ) {
+			// The large gradient is averaged in place
+			closeBucket();
+			{
+				std::lock_guard<std::mutex> lock( mutex );
+				buckets.Add( diff );
+				bucketSizes.Add( size );
+			}
+			part.Bucket = buckets.Size() - 1;
+			part.Offset = -1;
+			closeBucket();
+		} else {
+			if( closedCount < buckets.Size() && bucketSizes.Last() + size > GradientBucketSize ) {
+				closeBucket();
+			}
+			part.Bucket = closedCount < buckets.Size() ? buckets.Size() - 1 : openBucket();
+			part.Offset = bucketSizes[part.Bucket];
+			mathEngine.VectorCopy( buckets[part.Bucket]->GetData() + part.Offset, diff->GetData(), size );
+			std::lock_guard<std::mutex> lock( mutex );
+			bucketSizes[part.Bucket] += size;
+		}
+	}
+}
+
+void CDnnSolver::CGradientReducer::Finish( CMap<CBaseLayer*, CDiffBlobSum>& sums )
+{
+	closeBucket();
+	if( isAsync() ) {
+		std::unique_lock<std::mutex> lock( mutex );
+		stateChanged.wait( lock, [this] { return reducedCount == closedCount; } );
+		if( exception != nullptr ) {
+			std::exception_ptr error = exception;
+			exception = nullptr;
+			std::rethrow_exception( error );
+		}
+	}
+
+	for( int i = 0; i < parts.Size(); ++i ) {
+		const CPart& part = parts[i];
+		CObjectArray<CDnnBlob>& sum = sums.GetOrCreateValue( part.Layer ).Sum;
+		CDnnBlob* bucket = buckets[part.Bucket];
+		if( part.Offset < 0 ) {
+			if( sum.Size() == part.ParamIndex ) {
+				sum.Add( bucket );
+			} else {
+				sum[part.ParamIndex]->Add( bucket );
+			}
+			continue;
+		}
+		if( sum.Size() == part.ParamIndex ) {
+			sum.Add( CDnnBlob::CreateBlob( mathEngine, CT_Float, part.Desc ) );
+			mathEngine.VectorCopy( sum[part.ParamIndex]->GetData(), bucket->GetData() + part.Offset,
+				part.Desc.BlobSize() );
+		} else {
+			mathEngine.VectorAdd( sum[part.ParamIndex]->GetData(), bucket->GetData() + part.Offset,
+				sum[part.ParamIndex]->GetData(), part.Desc.BlobSize() );
+		}
+	}
+
+	for( int i = 0; i < parts.Size(); ++i ) {
+		if( parts[i].Offset == 0 ) {
+			// The first part of each fused bucket
+			freeBuckets.Add( buckets[parts[i].Bucket] );
+		}
+	}
+	parts.DeleteAll();
+	std::lock_guard<std::mutex> lock( mutex );
+	buckets.DeleteAll();
+	bucketSizes.DeleteAll();
+	closedCount = 0;
+	reducedCount = 0;
+}
+
+// Starts a new fused bucket and returns its index
+int CDnnSolver::CGradientReducer::openBucket()
+{
+	CPtr<CDnnBlob> bucket;
+	if( freeBuckets.IsEmpty() ) {
+		bucket = CDnnBlob::CreateVector( mathEngine, CT_Float, GradientBucketSize );
+	} else {
+		bucket = freeBuckets.Last();
+		freeBuckets.DeleteLast();
+	}
+	std::lock_guard<std::mutex> lock( mutex );
+	buckets.Add( bucket );
+	bucketSizes.Add( 0 );
+	return buckets.Size() - 1;
+}
+
+// Marks the last bucket as ready to be averaged
+void CDnnSolver::CGradientReducer::closeBucket()
+{
+	if( closedCount == buckets.Size() ) {
+		return;
+	}
+	if( !isAsync() ) {
+		mathEngine.AllReduce( buckets[closedCount]->GetData(), bucketSizes[closedCount] );
+		++closedCount;
+		++reducedCount;
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+		++closedCount;
+	}
+	stateChanged.notify_all();
+}
+
+void CDnnSolver::CGradientReducer::workerThread()
+{
+	std::unique_lock<std::mutex> lock( mutex );
+	while( true ) {
+		stateChanged.wait( lock, [this] { return isDestroying || reducedCount < closedCount; } );
+		if( isDestroying ) {
+			return;
+		}
+		CDnnBlob* bucket = buckets[reducedCount];
+		const int size = bucketSizes[reducedCount];
+		lock.unlock();
+		try {
+			mathEngine.AllReduce( bucket->GetData(), size );
+		} catch( ... ) {
+			lock.lock();
+			exception = std::current_exception();
+			lock.unlock();
+		}
+		lock.lock();
+		++reducedCount;
+		stateChanged.notify_all();
+	}
+}
+
+} // namespace NeoML
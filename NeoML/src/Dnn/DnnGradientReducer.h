@@ -0,0 +1,76 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <NeoML/Dnn/DnnSolver.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+namespace NeoML {
+
+// Averages the parameter gradients over the distributed math engines
+// The small gradient blobs are fused together into buckets; a bucket is averaged as soon as it is full,
+// so the averaging of the gradients of the last layers overlaps with the backward pass through the first ones
+// On CPU the buckets are averaged by a separate thread, other math engines average them synchronously
+// All math engines must add the same gradients in the same order
+class CDnnSolver::CGradientReducer {
+public:
+	explicit CGradientReducer( IMathEngine& mathEngine );
+	~CGradientReducer();
+
+	// Starts averaging the gradients of the layer
+	void Add( CBaseLayer* layer, const CObjectArray<CDnnBlob>& paramDiffBlobs );
+	// Waits until all the added gradients are averaged and adds them to the sums
+	void Finish( CMap<CBaseLayer*, CDiffBlobSum>& sums );
+
+private:
+	// The gradient blob placed into a bucket
+	struct CPart {
+		CBaseLayer* Layer;
+		int ParamIndex;
+		CBlobDesc Desc;
+		int Bucket;
+		// The position of the gradient in the bucket; -1 if the gradient blob is the bucket itself
+		int Offset;
+	};
+
+	IMathEngine& mathEngine;
+	std::thread thread;
+	std::mutex mutex;
+	// Signaled when a bucket is closed or averaged and when the reducer is destroyed
+	std::condition_variable stateChanged;
+	bool isDestroying;
+	std::exception_ptr exception;
+
+	// The buckets of the current step
+	// The first closedCount buckets are ready to be averaged, the first reducedCount buckets are averaged
+	CObjectArray<CDnnBlob> buckets;
+	CArray<int> bucketSizes;
+	int closedCount;
+	int reducedCount;
+	CArray<CPart> parts;
+	// The fused buckets of the previous steps which may be reused
+	CObjectArray<CDnnBlob> freeBuckets;
+
+	bool isAsync() const { return thread.joinable(); }
+	int openBucket();
+	void closeBucket();
+	void workerThread();
+};
+
+} // namespace NeoML
@@ -0,0 +1,166 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <common.h>
+#pragma hdrstop
+
+#include <Dnn/DnnLayerScheduler.h>
+
+namespace NeoML {
+
+CDnnLayerScheduler::CDnnLayerScheduler( int threadCount ) :
+	isDestroying( false ),
+	runTask( nullptr ),
+	finishedCount( 0 ),
+	runningCount( 0 )
+{
+	NeoAssert( threadCount > 1 );
+	for( int i = 0; i < threadCount - 1; ++i ) {
+		threads.emplace_back( [this]() { workerThread(); } );
+	}
+}
+
+CDnnLayerScheduler::~CDnnLayerScheduler()
+{
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+		isDestroying = true;
+	}
+	stateChanged.notify_all();
+	for( size_t i = 0; i < threads.size(); ++i ) {
+		threads[i].join();
+	}
+}
+
+void CDnnLayerScheduler::SetGraph( const CArray<CArray<int>>& inputs )
+{
+	std::lock_guard<std::mutex> lock( mutex );
+	NeoAssert( runTask == nullptr );
+
+	const int taskCount = inputs.Size();
+	inputCounts.SetSize( taskCount );
+	outputsOffsets.DeleteAll();
+	outputsOffsets.Add( 0, taskCount + 1 );
+	for( int i = 0; i < taskCount; ++i ) {
+		inputCounts[i] = inputs[i].Size();
+		for( int j = 0; j < inputs[i].Size(); ++j ) {
+			NeoAssert( 0 <= inputs[i][j] && inputs[i][j] < taskCount );
+			outputsOffsets[inputs[i][j] + 1]++;
+		}
+	}
+	for( int i = 0; i < taskCount; ++i ) {
+		outputsOffsets[i + 1] += outputsOffsets[i];
+	}
+
+	CArray<int> outputsEnds;
+	outputsOffsets.CopyTo( outputsEnds );
+	outputs.SetSize( outputsOffsets.Last() );
+	for( int i = 0; i < taskCount; ++i ) {
+		for( int j = 0; j < inputs[i].Size(); ++j ) {
+			outputs[outputsEnds[inputs[i][j]]++] = i;
+		}
+	}
+}
+
+void CDnnLayerScheduler::Run( const std::function<void( int )>& task )
+{
+	std::unique_lock<std::mutex> lock( mutex );
+	NeoAssert( runTask == nullptr );
+
+	inputCounts.CopyTo( waitingInputCounts );
+	readyTasks.DeleteAll();
+	// The tasks are taken from the end, so add the sources in reverse order to keep the original one
+	for( int i = inputCounts.Size() - 1; i >= 0; --i ) {
+		if( inputCounts[i] == 0 ) {
+			readyTasks.Add( i );
+		}
+	}
+	runTask = &task;
+	finishedCount = 0;
+	runningCount = 0;
+	exception = nullptr;
+	stateChanged.notify_all();
+
+	// The calling thread processes the tasks together with the pool
+	while( !isRunFinished() ) {
+		if( readyTasks.IsEmpty() ) {
+			stateChanged.wait( lock );
+		} else {
+			runReadyTask( lock );
+		}
+	}
+	runTask = nullptr;
+
+	std::exception_ptr runException = exception;
+	exception = nullptr;
+	lock.unlock();
+	if( runException != nullptr ) {
+		std::rethrow_exception( runException );
+	}
+}
+
+bool CDnnLayerScheduler::isRunFinished() const
+{
+	return runningCount == 0 && ( finishedCount == inputCounts.Size() || exception != nullptr );
+}
+
+// Takes one of the ready tasks and runs it with the mutex unlocked
+void CDnnLayerScheduler::runReadyTask( std::unique_lock<std::mutex>& lock )
+{
+	const int task = readyTasks.Last();
+	readyTasks.DeleteLast();
+	runningCount++;
+
+	lock.unlock();
+	std::exception_ptr taskException;
+	try {
+		( *runTask )( task );
+	} catch( ... ) {
+		taskException = std::current_exception();
+	}
+	lock.lock();
+
+	runningCount--;
+	finishedCount++;
+	if( taskException != nullptr ) {
+		if( exception == nullptr ) {
+			exception = taskException;
+		}
+		readyTasks.DeleteAll();
+	} else if( exception == nullptr ) {
+		for( int i = outputsOffsets[task]; i < outputsOffsets[task + 1]; ++i ) {
+			if( --waitingInputCounts[outputs[i]] == 0 ) {
+				readyTasks.Add( outputs[i] );
+			}
+		}
+	}
+	if( !readyTasks.IsEmpty() || isRunFinished() ) {
+		stateChanged.notify_all();
+	}
+}
+
+void CDnnLayerScheduler::workerThread()
+{
+	std::unique_lock<std::mutex> lock( mutex );
+	while( !isDestroying ) {
+		if( runTask != nullptr && !readyTasks.IsEmpty() ) {
+			runReadyTask( lock );
+		} else {
+			stateChanged.wait( lock );
+		}
+	}
+}
+
+} // namespace NeoML
@@ -0,0 +1,71 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <vector>
+
+namespace NeoML {
+
+// Runs a graph of dependent tasks (the network layers) on a pool of persistent threads
+// A task is started as soon as all the tasks it depends on are finished,
+// so the independent branches of the graph are processed concurrently
+class CDnnLayerScheduler {
+public:
+	// threadCount is the total number of threads, the thread that calls Run included
+	explicit CDnnLayerScheduler( int threadCount );
+	~CDnnLayerScheduler();
+
+	int GetThreadCount() const { return static_cast<int>( threads.size() ) + 1; }
+
+	// Sets the task graph: inputs[i] contains the tasks that must be finished before the i-th task is started
+	void SetGraph( const CArray<CArray<int>>& inputs );
+
+	// Runs all the tasks of the graph and waits for them to finish
+	// If a task throws an exception the tasks that have not been started are skipped
+	// and the exception is rethrown in the calling thread
+	void Run( const std::function<void( int )>& runTask );
+
+private:
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	// Signaled when new tasks are ready, when the run is over and when the pool is destroyed
+	std::condition_variable stateChanged;
+	bool isDestroying;
+
+	// The graph: the number of inputs of each task and the tasks which depend on it
+	CArray<int> inputCounts;
+	CArray<int> outputsOffsets;
+	CArray<int> outputs;
+
+	// The state of the current run
+	const std::function<void( int )>* runTask;
+	CArray<int> waitingInputCounts;
+	CArray<int> readyTasks;
+	int finishedCount;
+	int runningCount;
+	std::exception_ptr exception;
+
+	bool isRunFinished() const;
+	void runReadyTask( std::unique_lock<std::mutex>& lock );
+	void workerThread();
+};
+
+} // namespace NeoML
@@ -0,0 +1,344 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <common.h>
+#pragma hdrstop
+
+#include <Dnn/DnnMemoryPlanner.h>
+#include <NeoML/Dnn/Layers/BaseInPlaceLayer.h>
+#include <NeoML/Dnn/Layers/CompositeLayer.h>
+#include <NeoML/Dnn/Layers/RecurrentLayer.h>
+#include <NeoML/Dnn/Layers/SinkLayer.h>
+
+namespace NeoML {
+
+// The alignment of the blobs in the planned buffer (in elements)
+static const int PlannedBlobAlignment = 16;
+
+// The blob that occupies a part of the planned buffer
+class CPlannedBlob : public CDnnBlob {
+public:
+	CPlannedBlob( CDnnBlob& _buffer, int offset, const CBlobDesc& desc ) :
+		CDnnBlob( _buffer.GetMathEngine(), desc, _buffer.GetData() + offset, false ),
+		buffer( &_buffer )
+	{
+	}
+
+private:
+	// The buffer is kept alive while any of its blobs is used
+	const CPtr<CDnnBlob> buffer;
+};
+
+// A group of outputs that share data
+struct CPlannedGroup {
+	int Id;
+	int Size;
+	int Begin;
+	int End;
+	int Offset;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+
+CDnnMemoryPlanner::CDnnMemoryPlanner( IMathEngine& _mathEngine ) :
+	mathEngine( _mathEngine ),
+	step( 0 )
+{
+}
+
+CDnnMemoryPlanner::~CDnnMemoryPlanner()
+{
+	Reset();
+}
+
+void CDnnMemoryPlanner::Plan( CDnn& dnn )
+{
+	NeoAssert( &dnn.GetMathEngine() == &mathEngine );
+
+	CArray<CSlot> prevSlots;
+	slots.MoveTo( prevSlots );
+	firstSlots.DeleteAll();
+	step = 0;
+	addNetwork( dnn );
+
+	for( int i = 0; i < slots.Size(); ++i ) {
+		slots[i].Group = getGroup( i );
+	}
+	if( !prevSlots.IsEmpty() && isPlanEqual( prevSlots ) ) {
+		return;
+	}
+
+	// The blobs of the previous plan are placed differently
+	releasePlannedBlobs( prevSlots );
+	releasePlannedBlobs( slots );
+	placeGroups();
+}
+
+void CDnnMemoryPlanner::Reset()
+{
+	releasePlannedBlobs( slots );
+	slots.DeleteAll();
+	firstSlots.DeleteAll();
+	offsets.DeleteAll();
+	buffer = nullptr;
+}
+
+CPtr<CDnnBlob> CDnnMemoryPlanner::CreateOutputBlob( const CBaseLayer& layer, int outputNumber ) const
+{
+	if( buffer == nullptr ) {
+		return nullptr;
+	}
+
+	const int slot = getSlot( layer, outputNumber );
+	if( slot == NotFound || offsets[slot] == NotFound ) {
+		return nullptr;
+	}
+
+	const CBlobDesc& desc = layer.outputDescs[outputNumber];
+	NeoAssert( desc.BlobSize() <= slots[slot].Size );
+	return FINE_DEBUG_NEW CPlannedBlob( *buffer, offsets[slot], desc );
+}
+
+size_t CDnnMemoryPlanner::GetPlannedSize() const
+{
+	return buffer == nullptr ? 0 : buffer->GetDataSize() * sizeof( float );
+}
+
+// Adds the layers of the network in the order in which CDnn::runOnce calls them
+void CDnnMemoryPlanner::addNetwork( CDnn& dnn )
+{
+	for( int i = 0; i < dnn.sinkLayers.Size(); ++i ) {
+		addLayer( *dnn.sinkLayers[i] );
+	}
+}
+
+void CDnnMemoryPlanner::addLayer( CBaseLayer& layer )
+{
+	if( firstSlots.Has( &layer ) ) {
+		return;
+	}
+
+	// The outputs of the source layers belong to the user
+	const bool isSource = layer.GetInputCount() == 0 && dynamic_cast<CCompositeSourceLayer*>( &layer ) == nullptr;
+	const int firstSlot = slots.Size();
+	firstSlots.Add( &layer, firstSlot );
+	for( int i = 0; i < layer.GetOutputCount(); ++i ) {
+		CSlot& slot = slots.Append();
+		slot.Layer = &layer;
+		slot.Output = i;
+		slot.Size = ( layer.outputDescs[i].BlobSize() + PlannedBlobAlignment - 1 ) / PlannedBlobAlignment * PlannedBlobAlignment;
+		slot.Begin = NotFound;
+		slot.End = NotFound;
+		slot.Group = firstSlot + i;
+		slot.IsPlannable = !isSource;
+	}
+
+	for( int i = 0; i < layer.GetInputCount(); ++i ) {
+		addLayer( *layer.GetInputLayer( i ) );
+	}
+
+	CCompositeLayer* composite = dynamic_cast<CCompositeLayer*>( &layer );
+	if( composite != nullptr && dynamic_cast<CRecurrentLayer*>( composite ) == nullptr ) {
+		// The internal network is run inside the composite layer step
+		addNetwork( *composite->internalDnn );
+		for( int i = 0; i < composite->sources.Size(); ++i ) {
+			const int sourceSlot = getSlot( *composite->sources[i], 0 );
+			if( sourceSlot != NotFound ) {
+				uniteGroups( sourceSlot, getSlot( *layer.GetInputLayer( i ), layer.inputLinks[i].OutputNumber ) );
+			}
+		}
+		for( int i = 0; i < composite->sinks.Size(); ++i ) {
+			const CCompositeSinkLayer* sink = composite->sinks[i];
+			uniteGroups( firstSlot + i, getSlot( *sink->GetInputLayer( 0 ), sink->inputLinks[0].OutputNumber ) );
+		}
+	} else if( composite != nullptr ) {
+		// The recurrent layers switch their blobs to sequential mode
+		for( int i = 0; i < layer.GetOutputCount(); ++i ) {
+			slots[firstSlot + i].IsPlannable = false;
+		}
+	}
+
+	const int layerStep = step++;
+	const bool isSink = dynamic_cast<CSinkLayer*>( &layer ) != nullptr;
+	for( int i = 0; i < layer.GetInputCount(); ++i ) {
+		CSlot& inputSlot = slots[getSlot( *layer.GetInputLayer( i ), layer.inputLinks[i].OutputNumber )];
+		inputSlot.End = max( inputSlot.End, layerStep );
+		if( isSink ) {
+			// The sink layer blob is accessed by the user after the run
+			inputSlot.IsPlannable = false;
+		}
+	}
+	for( int i = 0; i < layer.GetOutputCount(); ++i ) {
+		slots[firstSlot + i].Begin = layerStep;
+		slots[firstSlot + i].End = max( slots[firstSlot + i].End, layerStep );
+	}
+
+	if( dynamic_cast<CBaseInPlaceLayer*>( &layer ) != nullptr && layer.IsInPlaceProcessAvailable() ) {
+		// The in-place layer outputs are its input blobs
+		for( int i = 0; i < min( layer.GetInputCount(), layer.GetOutputCount() ); ++i ) {
+			uniteGroups( firstSlot + i, getSlot( *layer.GetInputLayer( i ), layer.inputLinks[i].OutputNumber ) );
+		}
+	}
+}
+
+int CDnnMemoryPlanner::getSlot( const CBaseLayer& layer, int outputNumber ) const
+{
+	int firstSlot = NotFound;
+	if( !firstSlots.Lookup( &layer, firstSlot ) || outputNumber >= layer.GetOutputCount() ) {
+		return NotFound;
+	}
+	return firstSlot + outputNumber;
+}
+
+int CDnnMemoryPlanner::getGroup( int slot )
+{
+	int group = slot;
+	while( slots[group].Group != group ) {
+		group = slots[group].Group;
+	}
+	// Shorten the path for the next searches
+	while( slots[slot].Group != group ) {
+		const int next = slots[slot].Group;
+		slots[slot].Group = group;
+		slot = next;
+	}
+	return group;
+}
+
+void CDnnMemoryPlanner::uniteGroups( int first, int second )
+{
+	NeoPresume( first != NotFound && second != NotFound );
+	const int firstGroup = getGroup( first );
+	const int secondGroup = getGroup( second );
+	// The group is identified by its earliest output
+	if( firstGroup < secondGroup ) {
+		slots[secondGroup].Group = firstGroup;
+	} else if( secondGroup < firstGroup ) {
+		slots[firstGroup].Group = secondGroup;
+	}
+}
+
+// Assigns the offsets to the groups of outputs
+// The groups are placed from the largest to the smallest one, each at the lowest offset
+// where it does not overlap any of the already placed groups alive at the same time
+void CDnnMemoryPlanner::placeGroups()
+{
+	CArray<CPlannedGroup> groups;
+	CArray<int> groupIndices;
+	groupIndices.Add( NotFound, slots.Size() );
+	for( int i = 0; i < slots.Size(); ++i ) {
+		const CSlot& slot = slots[i];
+		int& groupIndex = groupIndices[slot.Group];
+		if( groupIndex == NotFound ) {
+			groupIndex = groups.Size();
+			CPlannedGroup& group = groups.Append();
+			group.Id = groupIndex;
+			group.Size = slot.Size;
+			group.Begin = slot.Begin;
+			group.End = slot.End;
+			group.Offset = slot.IsPlannable ? 0 : NotFound;
+		} else {
+			CPlannedGroup& group = groups[groupIndex];
+			group.Size = max( group.Size, slot.Size );
+			group.Begin = min( group.Begin, slot.Begin );
+			group.End = max( group.End, slot.End );
+			if( !slot.IsPlannable ) {
+				group.Offset = NotFound;
+			}
+		}
+	}
+
+	// The largest groups are placed first
+	CArray<CPlannedGroup> order;
+	for( int i = 0; i < groups.Size(); ++i ) {
+		if( groups[i].Offset != NotFound && groups[i].Size > 0 ) {
+			order.Add( groups[i] );
+		} else {
+			groups[i].Offset = NotFound;
+		}
+	}
+	order.QuickSort< CompositeComparer<CPlannedGroup, DescendingByMember<CPlannedGroup, int, &CPlannedGroup::Size>,
+		AscendingByMember<CPlannedGroup, int, &CPlannedGroup::Begin> > >();
+
+	int bufferSize = 0;
+	CArray<CPlannedGroup> placed;
+	CArray<CPlannedGroup> conflicts;
+	for( int i = 0; i < order.Size(); ++i ) {
+		CPlannedGroup& group = groups[order[i].Id];
+		conflicts.DeleteAll();
+		for( int j = 0; j < placed.Size(); ++j ) {
+			if( placed[j].Begin <= group.End && group.Begin <= placed[j].End ) {
+				conflicts.Add( placed[j] );
+			}
+		}
+		conflicts.QuickSort< AscendingByMember<CPlannedGroup, int, &CPlannedGroup::Offset> >();
+
+		int offset = 0;
+		for( int j = 0; j < conflicts.Size(); ++j ) {
+			if( offset + group.Size <= conflicts[j].Offset ) {
+				break;
+			}
+			offset = max( offset, conflicts[j].Offset + conflicts[j].Size );
+		}
+		group.Offset = offset;
+		bufferSize = max( bufferSize, offset + group.Size );
+		placed.Add( group );
+	}
+
+	offsets.SetSize( slots.Size() );
+	for( int i = 0; i < slots.Size(); ++i ) {
+		offsets[i] = groups[groupIndices[slots[i].Group]].Offset;
+	}
+	buffer = bufferSize > 0 ? CDnnBlob::CreateVector( mathEngine, CT_Float, bufferSize ) : nullptr;
+}
+
+bool CDnnMemoryPlanner::isPlanEqual( const CArray<CSlot>& prevSlots ) const
+{
+	if( prevSlots.Size() != slots.Size() ) {
+		return false;
+	}
+	for( int i = 0; i < slots.Size(); ++i ) {
+		const CSlot& slot = slots[i];
+		const CSlot& prevSlot = prevSlots[i];
+		if( slot.Layer != prevSlot.Layer || slot.Output != prevSlot.Output || slot.Size != prevSlot.Size
+			|| slot.Begin != prevSlot.Begin || slot.End != prevSlot.End || slot.Group != prevSlot.Group
+			|| slot.IsPlannable != prevSlot.IsPlannable )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// Releases the blobs of the layers that were created in the planned buffer
+void CDnnMemoryPlanner::releasePlannedBlobs( const CArray<CSlot>& slots )
+{
+	for( int i = 0; i < slots.Size(); ++i ) {
+		CBaseLayer& layer = *slots[i].Layer;
+		const int output = slots[i].Output;
+		if( output < layer.outputBlobs.Size() && dynamic_cast<CPlannedBlob*>( layer.outputBlobs[output].Ptr() ) != nullptr ) {
+			layer.outputBlobs[output] = nullptr;
+		}
+		if( output == 0 ) {
+			for( int j = 0; j < layer.inputBlobs.Size(); ++j ) {
+				if( dynamic_cast<CPlannedBlob*>( layer.inputBlobs[j].Ptr() ) != nullptr ) {
+					layer.inputBlobs[j] = nullptr;
+				}
+			}
+		}
+	}
+}
+
+} // namespace NeoML
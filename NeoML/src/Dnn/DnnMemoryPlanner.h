@@ -0,0 +1,82 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <NeoML/Dnn/Dnn.h>
+
+namespace NeoML {
+
+// Plans the memory for the output blobs of the network layers
+// The lifetime of each output is calculated in the order in which the layers are run
+// (the layers of the composite layers included), then all the outputs are placed into one buffer
+// so that the outputs which are alive at the same time do not overlap
+class CDnnMemoryPlanner : public IObject {
+public:
+	explicit CDnnMemoryPlanner( IMathEngine& mathEngine );
+
+	// Plans the outputs of the network layers; should be called after reshape
+	// The plan is recalculated only if the network graph or the blob sizes have changed
+	void Plan( CDnn& dnn );
+	// Discards the plan and releases the planned blobs
+	void Reset();
+
+	// Creates the blob for the given layer output inside the planned buffer
+	// Returns null if the output is not planned
+	CPtr<CDnnBlob> CreateOutputBlob( const CBaseLayer& layer, int outputNumber ) const;
+
+	// The size of the planned buffer in bytes
+	size_t GetPlannedSize() const;
+
+protected:
+	~CDnnMemoryPlanner() override;
+
+private:
+	// A layer output
+	struct CSlot {
+		CPtr<CBaseLayer> Layer;
+		int Output;
+		// The blob size, aligned
+		int Size;
+		// The steps on which the output is created and used for the last time
+		int Begin;
+		int End;
+		// The outputs which share data (e.g. the input and output of an in-place layer) are united in groups
+		int Group;
+		// Indicates if the output may be placed in the buffer
+		bool IsPlannable;
+	};
+
+	IMathEngine& mathEngine;
+	// The outputs in the order of creation and the index of the first output of each layer
+	CArray<CSlot> slots;
+	CMap<const CBaseLayer*, int> firstSlots;
+	// The offsets of the outputs in the buffer (NotFound for the outputs that are not planned)
+	CArray<int> offsets;
+	CPtr<CDnnBlob> buffer;
+	// The current step while calculating the lifetimes
+	int step;
+
+	void addNetwork( CDnn& dnn );
+	void addLayer( CBaseLayer& layer );
+	int getSlot( const CBaseLayer& layer, int outputNumber ) const;
+	int getGroup( int slot );
+	void uniteGroups( int first, int second );
+	void placeGroups();
+	bool isPlanEqual( const CArray<CSlot>& prevSlots ) const;
+	static void releasePlannedBlobs( const CArray<CSlot>& slots );
+};
+
+} // namespace NeoML
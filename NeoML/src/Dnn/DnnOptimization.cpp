@@ -0,0 +1,176 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <common.h>
+#pragma hdrstop
+
+#include <NeoML/Dnn/DnnOptimization.h>
+#include <NeoML/Dnn/Layers/ActivationLayers.h>
+#include <NeoML/Dnn/Layers/BatchNormalizationLayer.h>
+#include <NeoML/Dnn/Layers/ConvLayer.h>
+#include <NeoML/Dnn/Layers/FullyConnectedLayer.h>
+#include <NeoML/Dnn/Layers/FullyConnectedSourceLayer.h>
+
+namespace NeoML {
+
+// Gets the number of the inputs connected to the specified output of the layer
+static int getConsumerCount( const CDnn& dnn, const char* layerName, int outputNumber )
+{
+	CArray<const char*> layerNames;
+	dnn.GetLayerList( layerNames );
+	int result = 0;
+	for( int i = 0; i < layerNames.Size(); ++i ) {
+		CPtr<const CBaseLayer> layer = dnn.GetLayer( layerNames[i] );
+		for( int j = 0; j < layer->GetInputCount(); ++j ) {
+			if( strcmp( layer->GetInputName( j ), layerName ) == 0 && layer->GetInputOutputNumber( j ) == outputNumber ) {
+				++result;
+			}
+		}
+	}
+	return result;
+}
+
+// Gets the activation that may be fused instead of the layer
+static bool getFusedActivation( const CBaseLayer& layer, CFusedActivation& activation )
+{
+	const CReLULayer* relu = dynamic_cast<const CReLULayer*>( &layer );
+	if( relu != nullptr ) {
+		activation = CFusedActivation( AF_ReLU, relu->GetUpperThreshold() );
+		return true;
+	}
+	if( dynamic_cast<const CSigmoidLayer*>( &layer ) != nullptr ) {
+		activation = CFusedActivation( AF_Sigmoid );
+		return true;
+	}
+	if( dynamic_cast<const CHSwishLayer*>( &layer ) != nullptr ) {
+		activation = CFusedActivation( AF_HSwish );
+		return true;
+	}
+	return false;
+}
+
+// Merges the layer into the convolution
+// The convolution output is used only by this layer
+static bool mergeIntoConv( CConvLayer& conv, CBaseLayer& layer )
+{
+	if( !conv.GetFusedActivation().IsEmpty() ) {
+		return false;
+	}
+	CFusedActivation activation;
+	if( getFusedActivation( layer, activation ) ) {
+		conv.SetFusedActivation( activation );
+		return true;
+	}
+	CBatchNormalizationLayer* batchNorm = dynamic_cast<CBatchNormalizationLayer*>( &layer );
+	if( batchNorm == nullptr || conv.GetFilterData() == 0 || conv.GetFreeTermData() == 0 ) {
+		return false;
+	}
+	CPtr<CDnnBlob> params = batchNorm->GetFinalParams();
+	if( params == 0 || params->GetObjectSize() != conv.GetFilterCount() ) {
+		// The batch normalization is not trained or is not channel-based
+		return false;
+	}
+	conv.ApplyBatchNormalization( *batchNorm );
+	return true;
+}
+
+// Merges the layer into the fully connected layer
+// The fully connected layer output is used only by this layer
+static bool mergeIntoFullyConnected( CFullyConnectedLayer& fc, CBaseLayer& layer )
+{
+	if( !fc.GetFusedActivation().IsEmpty() ) {
+		return false;
+	}
+	CFusedActivation activation;
+	if( getFusedActivation( layer, activation ) ) {
+		fc.SetFusedActivation( activation );
+		return true;
+	}
+	CBatchNormalizationLayer* batchNorm = dynamic_cast<CBatchNormalizationLayer*>( &layer );
+	if( batchNorm == nullptr || fc.GetWeightsData() == 0 || fc.GetFreeTermData() == 0 ) {
+		return false;
+	}
+	CPtr<CDnnBlob> params = batchNorm->GetFinalParams();
+	if( params == 0 || params->GetObjectSize() != fc.GetNumberOfElements() ) {
+		return false;
+	}
+	fc.ApplyBatchNormalization( *batchNorm );
+	// The free terms of the batch normalization are now in the layer
+	fc.SetZeroFreeTerm( false );
+	return true;
+}
+
+// Merges the layer into the layer that calculates its input
+static bool mergeIntoPreviousLayer( CDnn& dnn, CBaseLayer& layer )
+{
+	if( layer.GetInputCount() != 1 || !dnn.HasLayer( layer.GetInputName( 0 ) ) ) {
+		return false;
+	}
+	CPtr<CBaseLayer> previous = dnn.GetLayer( layer.GetInputName( 0 ) );
+	if( previous->GetInputCount() != 1
+		|| getConsumerCount( dnn, previous->GetName(), layer.GetInputOutputNumber( 0 ) ) != 1 )
+	{
+		return false;
+	}
+
+	CConvLayer* conv = dynamic_cast<CConvLayer*>( previous.Ptr() );
+	CFullyConnectedLayer* fc = dynamic_cast<CFullyConnectedLayer*>( previous.Ptr() );
+	if( conv != nullptr ) {
+		if( !mergeIntoConv( *conv, layer ) ) {
+			return false;
+		}
+	} else if( fc != nullptr && dynamic_cast<CFullyConnectedSourceLayer*>( fc ) == nullptr ) {
+		if( !mergeIntoFullyConnected( *fc, layer ) ) {
+			return false;
+		}
+	} else {
+		return false;
+	}
+
+	// Connect the consumers of the layer to the previous layer
+	CArray<const char*> layerNames;
+	dnn.GetLayerList( layerNames );
+	for( int i = 0; i < layerNames.Size(); ++i ) {
+		CPtr<CBaseLayer> consumer = dnn.GetLayer( layerNames[i] );
+		for( int j = 0; j < consumer->GetInputCount(); ++j ) {
+			if( strcmp( consumer->GetInputName( j ), layer.GetName() ) == 0 ) {
+				consumer->Connect( j, previous->GetName(), layer.GetInputOutputNumber( 0 ) );
+			}
+		}
+	}
+	dnn.DeleteLayer( layer );
+	return true;
+}
+
+int OptimizeDnnForInference( CDnn& dnn )
+{
+	int result = 0;
+	bool isChanged = true;
+	while( isChanged ) {
+		isChanged = false;
+		CArray<const char*> layerNames;
+		dnn.GetLayerList( layerNames );
+		for( int i = 0; i < layerNames.Size() && !isChanged; ++i ) {
+			CPtr<CBaseLayer> layer = dnn.GetLayer( layerNames[i] );
+			isChanged = mergeIntoPreviousLayer( dnn, *layer );
+		}
+		if( isChanged ) {
+			++result;
+		}
+	}
+	return result;
+}
+
+} // namespace NeoML
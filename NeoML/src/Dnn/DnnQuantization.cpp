@@ -0,0 +1,180 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <common.h>
+#pragma hdrstop
+
+#include <NeoML/Dnn/DnnQuantization.h>
+#include <NeoML/Dnn/Layers/FullyConnectedLayer.h>
+#include <NeoML/Dnn/Layers/FullyConnectedSourceLayer.h>
+#include <NeoML/Dnn/Layers/ConvLayer.h>
+#include <NeoML/Dnn/Layers/SinkLayer.h>
+#include <NeoMathEngine/NeoMathEngine.h>
+
+namespace NeoML {
+
+// The maximum absolute value of the quantized number
+static const float MaxQuantizedValue = 127.f;
+
+void QuantizeWeights( const CDnnBlob& weights, CPtr<CDnnBlob>& quantizedWeights, CPtr<CDnnBlob>& scales )
+{
+	NeoAssert( weights.GetDataType() == CT_Float );
+
+	const int rowCount = weights.GetObjectCount();
+	const int rowSize = weights.GetObjectSize();
+
+	CArray<float> weightsData;
+	weightsData.SetSize( weights.GetDataSize() );
+	weights.CopyTo( weightsData.GetPtr() );
+
+	CArray<int8_t> quantizedData;
+	quantizedData.SetSize( weightsData.Size() );
+	CArray<float> scalesData;
+	scalesData.SetSize( rowCount );
+
+	for( int row = 0; row < rowCount; ++row ) {
+		const float* rowData = weightsData.GetPtr() + row * rowSize;
+		float maxAbs = 0;
+		for( int i = 0; i < rowSize; ++i ) {
+			maxAbs = max( maxAbs, fabsf( rowData[i] ) );
+		}
+		const float scale = maxAbs > 0 ? maxAbs / MaxQuantizedValue : 1.f;
+		scalesData[row] = scale;
+
+		int8_t* quantizedRow = quantizedData.GetPtr() + row * rowSize;
+		for( int i = 0; i < rowSize; ++i ) {
+			const float value = min( MaxQuantizedValue, max( -MaxQuantizedValue, roundf( rowData[i] / scale ) ) );
+			quantizedRow[i] = static_cast<int8_t>( value );
+		}
+	}
+
+	IMathEngine& mathEngine = weights.GetMathEngine();
+	quantizedWeights = CDnnBlob::CreateBlob( mathEngine, CT_Int8, weights.GetDesc() );
+	quantizedWeights->CopyFrom( quantizedData.GetPtr() );
+	scales = CDnnBlob::CreateVector( mathEngine, CT_Float, rowCount );
+	scales->CopyFrom( scalesData.GetPtr() );
+}
+
+CPtr<CDnnBlob> ConvertBlobDataType( const CDnnBlob& blob, TBlobType type )
+{
+	IMathEngine& mathEngine = blob.GetMathEngine();
+	CPtr<CDnnBlob> result = CDnnBlob::CreateBlob( mathEngine, type, blob.GetDesc() );
+	if( blob.GetDataType() == type ) {
+		result->CopyFrom( &blob );
+	} else if( type == CT_BFloat16 ) {
+		NeoAssert( blob.GetDataType() == CT_Float );
+		mathEngine.VectorConvert( blob.GetData<float>(), result->GetData<uint16_t>(), blob.GetDataSize() );
+	} else {
+		NeoAssert( type == CT_Float && blob.GetDataType() == CT_BFloat16 );
+		mathEngine.VectorConvert( blob.GetData<uint16_t>(), result->GetData<float>(), blob.GetDataSize() );
+	}
+	return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+
+// Checks if the layer supports the quantized input
+static bool isQuantizable( const CBaseLayer& layer )
+{
+	return ( dynamic_cast<const CFullyConnectedLayer*>( &layer ) != nullptr
+			&& dynamic_cast<const CFullyConnectedSourceLayer*>( &layer ) == nullptr )
+		|| dynamic_cast<const CConvLayer*>( &layer ) != nullptr;
+}
+
+CDnnPostTrainingQuantization::CDnnPostTrainingQuantization( CDnn& _dnn ) :
+	dnn( _dnn )
+{
+	CArray<const char*> layerNames;
+	dnn.GetLayerList( layerNames );
+
+	for( int i = 0; i < layerNames.Size(); ++i ) {
+		CPtr<CBaseLayer> layer = dnn.GetLayer( layerNames[i] );
+		if( !isQuantizable( *layer ) || layer->GetInputCount() != 1 ) {
+			continue;
+		}
+
+		CString sinkName = CString( "QuantizationSink." ) + layer->GetName();
+		for( int suffix = 0; dnn.HasLayer( sinkName ); ++suffix ) {
+			sinkName = CString( "QuantizationSink." ) + layer->GetName() + "." + Str( suffix );
+		}
+
+		CLayerInput& input = inputs.Append();
+		input.Layer = layer;
+		input.Sink = new CSinkLayer( dnn.GetMathEngine() );
+		input.Sink->SetName( sinkName );
+		input.Sink->Connect( 0, layer->GetInputName( 0 ), layer->GetInputOutputNumber( 0 ) );
+		input.MaxAbs = 0;
+	}
+
+	for( int i = 0; i < inputs.Size(); ++i ) {
+		dnn.AddLayer( *inputs[i].Sink );
+	}
+}
+
+CDnnPostTrainingQuantization::~CDnnPostTrainingQuantization()
+{
+	removeSinks();
+}
+
+void CDnnPostTrainingQuantization::Calibrate()
+{
+	NeoAssert( inputs.IsEmpty() || inputs[0].Sink->GetDnn() != nullptr );
+
+	dnn.RunOnce();
+
+	CArray<float> data;
+	for( int i = 0; i < inputs.Size(); ++i ) {
+		const CPtr<CDnnBlob>& blob = inputs[i].Sink->GetBlob();
+		data.SetSize( blob->GetDataSize() );
+		blob->CopyTo( data.GetPtr() );
+		for( int j = 0; j < data.Size(); ++j ) {
+			inputs[i].MaxAbs = max( inputs[i].MaxAbs, fabsf( data[j] ) );
+		}
+	}
+}
+
+int CDnnPostTrainingQuantization::Quantize()
+{
+	removeSinks();
+
+	int quantizedCount = 0;
+	for( int i = 0; i < inputs.Size(); ++i ) {
+		if( inputs[i].MaxAbs == 0 ) {
+			// The input has not been calibrated
+			continue;
+		}
+		const float scale = inputs[i].MaxAbs / MaxQuantizedValue;
+		CFullyConnectedLayer* fc = dynamic_cast<CFullyConnectedLayer*>( inputs[i].Layer.Ptr() );
+		if( fc != nullptr ) {
+			fc->SetInputQuantizationScale( scale );
+		} else {
+			CheckCast<CConvLayer>( inputs[i].Layer )->SetInputQuantizationScale( scale );
+		}
+		++quantizedCount;
+	}
+	inputs.DeleteAll();
+	return quantizedCount;
+}
+
+void CDnnPostTrainingQuantization::removeSinks()
+{
+	for( int i = 0; i < inputs.Size(); ++i ) {
+		if( inputs[i].Sink->GetDnn() != nullptr ) {
+			dnn.DeleteLayer( *inputs[i].Sink );
+		}
+	}
+}
+
+} // namespace NeoML
@@ -0,0 +1,64 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <common.h>
+#pragma hdrstop
+
+#include <Dnn/DnnReferenceFile.h>
+
+namespace NeoML {
+
+int CDnnReferenceFile::Read( void* ptr, int bytesCount )
+{
+	const int size = min( bytesCount, buffer.Size() - position );
+	if( size > 0 ) {
+		::memcpy( ptr, buffer.GetPtr() + position, size );
+		position += size;
+	}
+	return max( size, 0 );
+}
+
+void CDnnReferenceFile::Write( const void* ptr, int bytesCount )
+{
+	// Only the structure is written here, so the size never comes close to INT_MAX
+	NeoAssert( bytesCount >= 0 && position <= INT_MAX - bytesCount );
+	if( position + bytesCount > buffer.Size() ) {
+		buffer.SetSize( position + bytesCount );
+	}
+	::memcpy( buffer.GetPtr() + position, ptr, bytesCount );
+	position += bytesCount;
+}
+
+__int64 CDnnReferenceFile::Seek( __int64 offset, TSeekPosition from )
+{
+	__int64 newPosition = offset;
+	if( from == current ) {
+		newPosition += position;
+	} else if( from == end ) {
+		newPosition += buffer.Size();
+	}
+	NeoAssert( 0 <= newPosition && newPosition <= buffer.Size() );
+	position = static_cast<int>( newPosition );
+	return position;
+}
+
+void CDnnReferenceFile::SetLength( __int64 newLength )
+{
+	NeoAssert( 0 <= newLength && newLength <= INT_MAX );
+	buffer.SetSize( static_cast<int>( newLength ) );
+	position = min( position, buffer.Size() );
+}
+
+} // namespace NeoML
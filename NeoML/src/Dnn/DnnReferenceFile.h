@@ -0,0 +1,58 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <NeoML/NeoMLDefs.h>
+#include <NeoML/Dnn/DnnBlob.h>
+
+namespace NeoML {
+
+// The file in memory used for copying the network structure (see CDnn::CreateReferenceDnn)
+// The blobs serialized into this file keep only their index in the blob table instead of the data,
+// and the blobs loaded from it use the data of the stored blobs
+class CDnnReferenceFile : public CBaseFile {
+public:
+	CDnnReferenceFile() : position( 0 ) {}
+
+	// Adds the blob to the table and returns its index
+	int AddBlob( CDnnBlob* blob ) { blobs.Add( blob ); return blobs.Size() - 1; }
+	// Gets the blob by its index
+	CDnnBlob* GetBlob( int index ) const { return blobs[index]; }
+	int GetBlobCount() const { return blobs.Size(); }
+
+	// CBaseFile class methods
+#ifdef FINEOBJ_VERSION
+	CUnicodeString GetFileName() const override { return CUnicodeString( "CDnnReferenceFile" ); }
+#else
+	const char* GetFileName() const override { return "CDnnReferenceFile"; }
+#endif
+	int Read( void* ptr, int bytesCount ) override;
+	void Write( const void* ptr, int bytesCount ) override;
+	__int64 GetPosition() const override { return position; }
+	__int64 Seek( __int64 offset, TSeekPosition from ) override;
+	void SetLength( __int64 newLength ) override;
+	__int64 GetLength() const override { return buffer.Size(); }
+	void Abort() override {}
+	void Flush() override {}
+	void Close() override {}
+
+private:
+	CArray<char> buffer; // the network structure without the blob data
+	int position;
+	CObjectArray<CDnnBlob> blobs; // the stored blobs
+};
+
+} // namespace NeoML
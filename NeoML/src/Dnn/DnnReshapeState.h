@@ -0,0 +1,38 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#pragma once
+
+namespace NeoML {
+
+// The reshape state of the layer that keeps one math engine descriptor (see CBaseLayer::DetachReshapeState)
+// The descriptor is deleted together with the state if the state is evicted from the reshape cache
+// paramsVersion is the version of the layer parameters the descriptor has been used with (see CDnnBlob::GetDataVersion)
+template<class TDesc>
+class CDescReshapeState : public IObject {
+public:
+	explicit CDescReshapeState( TDesc* _desc, int _paramsVersion = 0 ) : desc( _desc ), paramsVersion( _paramsVersion ) {}
+	~CDescReshapeState() override { delete desc; }
+
+	// Passes the descriptor to the caller
+	TDesc* Detach() { TDesc* result = desc; desc = nullptr; return result; }
+	int GetParamsVersion() const { return paramsVersion; }
+
+private:
+	TDesc* desc;
+	int paramsVersion;
+};
+
+} // namespace NeoML
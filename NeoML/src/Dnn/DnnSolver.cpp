@@ -20,6 +20,7 @@ limitations under the License.
 #include <NeoML/Dnn/Dnn.h>
 #include <NeoML/Dnn/Layers/CompositeLayer.h>
 #include <NeoMathEngine/NeoMathEngine.h>
+#include <Dnn/DnnGradientReducer.h>
 
 // For LAMB solver init
 #include <NeoML/Dnn/Layers/BatchNormalizationLayer.h>
@@ -159,10 +160,16 @@ CDnnSolver::CDnnSolver( IMathEngine& _mathEngine ) :
 	learningRate( 0.01f ),
 	regularizationL2( 0.f ),
 	regularizationL1( 0.f ),
-	maxGradientNorm( -1.f )
+	maxGradientNorm( -1.f ),
+	gradientReducer( nullptr )
 {
 }
 
+CDnnSolver::~CDnnSolver()
+{
+	delete gradientReducer;
+}
+
 // Calculates the layer parameter gradients to then use them in Train method
 void CDnnSolver::AddDiff( CBaseLayer* layer, const CObjectArray<CDnnBlob>& paramDiffBlobs,
 	bool sharedWeights )
@@ -175,6 +182,16 @@ void CDnnSolver::AddDiff( CBaseLayer* layer, const CObjectArray<CDnnBlob>& param
 		++paramDiffBlobsSum.Count;
 	}
 
+	if( mathEngine.IsDistributed() ) {
+		// The average of the sums is equal to the sum of the averages,
+		// so the gradients are averaged over the math engines right away
+		if( gradientReducer == nullptr ) {
+			gradientReducer = FINE_DEBUG_NEW CGradientReducer( mathEngine );
+		}
+		gradientReducer->Add( layer, paramDiffBlobs );
+		return;
+	}
+
 	if( paramDiffBlobsSum.Sum.IsEmpty() ) {
 		paramDiffBlobs.CopyTo( paramDiffBlobsSum.Sum );
 	} else {
@@ -191,6 +208,10 @@ void CDnnSolver::Train()
 {
 	OnTrain();
 
+	if( gradientReducer != nullptr ) {
+		gradientReducer->Finish( layerToParamDiffBlobsSum );
+	}
+
 	CFloatHandleStackVar oneDivEpoch( mathEngine );
 
 	for( TMapPosition pos = layerToParamDiffBlobsSum.GetFirstPosition(); pos != NotFound;
@@ -222,35 +243,18 @@ void CDnnSolver::Train()
 		paramDiffBlobsSum.Sum.Empty();
 		paramDiffBlobsSum.Count = 0;
 	}
-
-	if( MathEngine().IsDistributed() ){
-		allReduce();
-	}
 }
 
 void CDnnSolver::Reset()
 {
+	if( gradientReducer != nullptr ) {
+		gradientReducer->Finish( layerToParamDiffBlobsSum );
+	}
 	layerToParamDiffBlobsSum.DeleteAll();
 	layerToGradientHistory.DeleteAll();
 	OnReset();
 }
 
-void CDnnSolver::allReduce()
-{
-	CDnn* dnn = layerToParamDiffBlobsSum.GetKey( layerToParamDiffBlobsSum.GetFirstPosition() )->GetDnn();
-	CArray<const char*> layerList;
-	dnn->GetLayerList( layerList );
-	for( int i = 0; i < layerList.Size(); i++ ){
-		CBaseLayer* layer = dnn->GetLayer( layerList[i] );
-		if( layer->IsLearnable() && layer->IsLearningEnabled() ){
-			const CObjectArray<CDnnBlob>& params = layer->paramBlobs;
-			for( int j = 0; j < params.Size(); j++ ){
-				MathEngine().AllReduce( params[j]->GetData(), params[j]->GetDataSize() );
-			}
-		}
-	}
-}
-
 void CDnnSolver::clipGradients(const CObjectArray<CDnnBlob>& paramDiffBlobs)
 {
 	if(maxGradientNorm < 0 || paramDiffBlobs.Size() == 0) {
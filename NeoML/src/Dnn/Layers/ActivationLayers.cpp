@@ -57,6 +57,38 @@ CPtr<CBaseLayer> CreateActivationLayer( IMathEngine& mathEngine, TActivationFunc
 	return 0;
 }
 
+void CFusedActivation::Apply( IMathEngine& mathEngine, const CFloatHandle& data, int dataSize ) const
+{
+	switch( Type ) {
+		case AF_Linear:
+			break;
+		case AF_ReLU:
+		{
+			CFloatHandleStackVar threshold( mathEngine );
+			threshold.SetValue( Param );
+			mathEngine.VectorReLU( data, data, dataSize, threshold );
+			break;
+		}
+		case AF_Sigmoid:
+			mathEngine.VectorSigmoid( data, data, dataSize );
+			break;
+		case AF_HSwish:
+			mathEngine.VectorHSwish( data, data, dataSize );
+			break;
+		default:
+			NeoAssert( false );
+	}
+}
+
+void CFusedActivation::Serialize( CArchive& archive )
+{
+	archive.SerializeEnum( Type );
+	archive.Serialize( Param );
+	if( archive.IsLoading() ) {
+		check( Type == AF_Linear || IsSupported( Type ), ERR_BAD_ARCHIVE, archive.Name() );
+	}
+}
+
 ///////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////
 CLinearLayer::CLinearLayer( IMathEngine& mathEngine ) :
@@ -112,6 +112,8 @@ void CBaseConvLayer::SetFilterData(const CPtr<CDnnBlob>& newFilter)
 	} else if(Filter() != 0 && GetDnn() != 0) {
 		NeoAssert(Filter()->HasEqualDimensions(newFilter));
 		Filter()->CopyFrom(newFilter);
+		// The data prepared from the filter (by this layer and its copies) should be updated
+		Filter()->DataChanged();
 	} else {
 		Filter() = newFilter->GetCopy();
 	}
@@ -136,6 +138,7 @@ void CBaseConvLayer::SetFreeTermData(const CPtr<CDnnBlob>& newFreeTerms)
 			NeoAssert(FreeTerms()->GetDataSize() == newFreeTerms->GetDataSize());
 
 			FreeTerms()->CopyFrom(newFreeTerms);
+			FreeTerms()->DataChanged();
 		} else {
 			FreeTerms() = newFreeTerms->GetCopy();
 		}
@@ -179,9 +182,10 @@ void CBaseConvLayer::ApplyBatchNormalization(CBatchNormalizationLayer& batchNorm
 void CBaseConvLayer::FilterLayerParams( float threshold )
 {
 	for( int blobIndex = 0; blobIndex < paramBlobs.Size(); ++blobIndex ) {
-		if( paramBlobs[blobIndex] != 0 ) {
+		if( paramBlobs[blobIndex] != 0 && paramBlobs[blobIndex]->GetDataType() == CT_Float ) {
 			MathEngine().FilterSmallValues( paramBlobs[blobIndex]->GetData(),
 				paramBlobs[blobIndex]->GetDataSize(), threshold );
+			paramBlobs[blobIndex]->DataChanged();
 		}
 	}
 }
@@ -17,6 +17,7 @@ limitations under the License.
 #pragma hdrstop
 
 #include <NeoML/Dnn/Layers/ChannelwiseConvLayer.h>
+#include <Dnn/DnnReshapeState.h>
 
 namespace NeoML {
 
@@ -101,6 +102,19 @@ void CChannelwiseConvLayer::Reshape()
 	destroyConvDesc();
 }
 
+CPtr<IObject> CChannelwiseConvLayer::DetachReshapeState()
+{
+	CPtr<IObject> state = FINE_DEBUG_NEW CDescReshapeState<CChannelwiseConvolutionDesc>( convDesc );
+	convDesc = 0;
+	return state;
+}
+
+void CChannelwiseConvLayer::AttachReshapeState( IObject* state )
+{
+	destroyConvDesc();
+	convDesc = CheckCast<CDescReshapeState<CChannelwiseConvolutionDesc>>( state )->Detach();
+}
+
 void CChannelwiseConvLayer::RunOnce()
 {
 	initConvDesc();
@@ -19,6 +19,7 @@ limitations under the License.
 #include <NeoML/Dnn/Dnn.h>
 #include <NeoMathEngine/NeoMathEngine.h>
 #include <NeoML/Dnn/Layers/CompositeLayer.h>
+#include <Dnn/DnnMemoryPlanner.h>
 
 namespace NeoML {
 
@@ -410,6 +411,7 @@ void CCompositeLayer::SetInternalDnnParams()
 		GetDnn()->IsReverseSequense(), GetDnn()->IsBackwardPerformed());
 	internalDnn->SetLog(GetDnn()->IsLogging() && areInternalLogsEnabled ? GetDnn()->GetLog() : 0);
 	internalDnn->SetLogFrequency(GetDnn()->GetLogFrequency());
+	internalDnn->reshapeCacheSize = GetDnn()->reshapeCacheSize;
 	internalDnn->RequestReshape(forcedReshape);
 	// Switch learning on or off
 	if(IsLearningEnabled()) {
@@ -482,6 +484,7 @@ void CCompositeLayer::Reshape()
 void CCompositeLayer::RunInternalDnn()
 {
 	internalDnn->isReuseMemoryMode = GetDnn()->isReuseMemoryMode;
+	internalDnn->memoryPlanner = GetDnn()->memoryPlanner;
 	internalDnn->runOnce(GetDnn()->GetCurrentSequencePos());
 }
 
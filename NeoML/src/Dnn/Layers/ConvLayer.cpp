@@ -17,13 +17,19 @@ limitations under the License.
 #pragma hdrstop
 
 #include <NeoML/Dnn/Layers/ConvLayer.h>
+#include <NeoML/Dnn/DnnQuantization.h>
 #include <NeoMathEngine/NeoMathEngine.h>
+#include <Dnn/DnnReshapeState.h>
 
 namespace NeoML {
 
 CConvLayer::CConvLayer( IMathEngine& mathEngine ) :
 	CBaseConvLayer( mathEngine, "CCnnConvLayer" ),
-	convDesc( 0 )
+	convDesc( 0 ),
+	convDescParamsVersion( 0 ),
+	inputQuantizationScale( 0 ),
+	filterType( CT_Float ),
+	quantizedFilterVersion( 0 )
 {
 }
 
@@ -32,12 +38,24 @@ CConvLayer::~CConvLayer()
 	destroyConvDesc();
 }
 
+// The sum of the versions changes whenever the filter or the free terms are changed
+// (the same blobs are used by the copies of the network created by CDnn::CreateReferenceDnn)
+int CConvLayer::getParamsVersion() const
+{
+	return Filter()->GetDataVersion() + FreeTerms()->GetDataVersion();
+}
+
 void CConvLayer::initConvDesc()
 {
+	if( convDesc != 0 && convDescParamsVersion != getParamsVersion() ) {
+		// The filter prepared by the math engine for the calculation should be updated
+		destroyConvDesc();
+	}
 	if( convDesc == 0 ) {
 		convDesc = MathEngine().InitBlobConvolution( inputBlobs[0]->GetDesc(),
 			paddingHeight, paddingWidth, strideHeight, strideWidth, dilationHeight, dilationWidth,
 			Filter()->GetDesc(), outputBlobs[0]->GetDesc() );
+		convDescParamsVersion = getParamsVersion();
 	}
 }
 void CConvLayer::destroyConvDesc()
@@ -66,6 +84,16 @@ void CConvLayer::Reshape()
 		GetName(), "different number of inputs and outputs in conv layer" );
 	CheckArchitecture( paddingHeight < filterHeight * dilationHeight && paddingWidth < filterWidth * dilationWidth,
 		GetName(), "padding is more or equal to receptive field size" );
+	if( inputQuantizationScale != 0 ) {
+		CheckArchitecture( !IsLearningPerformed(), GetName(), "convolution with quantized input cannot be trained" );
+		CheckArchitecture( MathEngine().GetType() == MET_Cpu, GetName(), "quantized inference is supported only on CPU" );
+	}
+	if( filterType != CT_Float ) {
+		CheckArchitecture( !IsBackwardPerformed(), GetName(), "convolution with bfloat16 filter cannot be trained" );
+		CheckArchitecture( MathEngine().GetType() == MET_Cpu, GetName(), "bfloat16 filter is supported only on CPU" );
+	}
+	CheckArchitecture( fusedActivation.IsEmpty() || !IsBackwardPerformed(),
+		GetName(), "convolution with fused activation cannot be trained" );
 
 	int outputHeight, outputWidth;
 	calcOutputBlobSize(outputHeight, outputWidth);
@@ -80,6 +108,8 @@ void CConvLayer::Reshape()
 				inputDescs[i].Depth(), inputDescs[i].Channels() );
 			// Initialize
 			InitializeParamBlob(i, *Filter(), Filter()->GetObjectSize());
+			quantizedFilter = 0;
+			filterScales = 0;
 		} else {
 			NeoAssert(Filter()->GetObjectCount() == filterCount);
 			NeoAssert(Filter()->GetHeight() == filterHeight);
@@ -87,6 +117,11 @@ void CConvLayer::Reshape()
 			NeoAssert(Filter()->GetDepth() == inputDescs[i].Depth());
 			NeoAssert(Filter()->GetChannelsCount() == inputDescs[i].Channels());
 		}
+		if( Filter()->GetDataType() != filterType ) {
+			Filter() = ConvertBlobDataType( *Filter(), filterType );
+			quantizedFilter = 0;
+			filterScales = 0;
+		}
 
 		if(FreeTerms() == 0) {
 			FreeTerms() = CDnnBlob::CreateVector( MathEngine(), CT_Float, filterCount );
@@ -108,14 +143,48 @@ void CConvLayer::Reshape()
 	destroyConvDesc();
 }
 
+// The descriptor is kept for the input sizes it has been created for
+CPtr<IObject> CConvLayer::DetachReshapeState()
+{
+	CPtr<IObject> state = FINE_DEBUG_NEW CDescReshapeState<CConvolutionDesc>( convDesc, convDescParamsVersion );
+	convDesc = 0;
+	return state;
+}
+
+void CConvLayer::AttachReshapeState( IObject* state )
+{
+	destroyConvDesc();
+	CDescReshapeState<CConvolutionDesc>* descState = CheckCast<CDescReshapeState<CConvolutionDesc>>( state );
+	convDescParamsVersion = descState->GetParamsVersion();
+	convDesc = descState->Detach();
+}
+
 void CConvLayer::RunOnce()
 {
 	initConvDesc();
 
+	if( inputQuantizationScale != 0
+		&& ( quantizedFilter == 0 || quantizedFilterVersion != Filter()->GetDataVersion() ) )
+	{
+		QuantizeWeights( *GetFilterData(), quantizedFilter, filterScales );
+		quantizedFilterVersion = Filter()->GetDataVersion();
+	}
+
 	for( int i = 0; i < outputBlobs.Size(); ++i ) {
 		CFloatHandle freeTerm = FreeTerms()->GetData();
-		MathEngine().BlobConvolution( *convDesc, inputBlobs[i]->GetData(),
-			Filter()->GetData(), &freeTerm, outputBlobs[i]->GetData() );
+		if( inputQuantizationScale != 0 ) {
+			CConstFloatHandle constFreeTerm = freeTerm;
+			MathEngine().BlobQuantizedConvolution( *convDesc, inputBlobs[i]->GetData(), inputQuantizationScale,
+				quantizedFilter->GetData<int8_t>(), filterScales->GetData(), &constFreeTerm, outputBlobs[i]->GetData() );
+		} else if( filterType == CT_BFloat16 ) {
+			CConstFloatHandle constFreeTerm = freeTerm;
+			MathEngine().BlobBFloat16Convolution( *convDesc, inputBlobs[i]->GetData(),
+				Filter()->GetData<uint16_t>(), &constFreeTerm, outputBlobs[i]->GetData() );
+		} else {
+			MathEngine().BlobConvolution( *convDesc, inputBlobs[i]->GetData(),
+				Filter()->GetData(), &freeTerm, outputBlobs[i]->GetData() );
+		}
+		fusedActivation.Apply( MathEngine(), outputBlobs[i]->GetData(), outputBlobs[i]->GetDataSize() );
 	}
 }
 
@@ -140,12 +209,119 @@ void CConvLayer::LearnOnce()
 	}
 }
 
-static const int ConvLayerVersion = 2000;
+void CConvLayer::FilterLayerParams( float threshold )
+{
+	quantizedFilter = 0;
+	filterScales = 0;
+	if( Filter() != 0 && filterType != CT_Float ) {
+		CPtr<CDnnBlob> filter = GetFilterData();
+		MathEngine().FilterSmallValues( filter->GetData(), filter->GetDataSize(), threshold );
+		SetFilterData( filter );
+	}
+	CBaseConvLayer::FilterLayerParams( threshold );
+}
+
+// The quantized filter is calculated once for the original layer and all its copies
+// If the filter is changed later, every layer quantizes it again on its next run
+void CConvLayer::referenceCalculatedParams( CBaseLayer& original )
+{
+	CConvLayer* originalConv = CheckCast<CConvLayer>( &original );
+	if( inputQuantizationScale != 0 && originalConv->Filter() != 0 && ( originalConv->quantizedFilter == 0
+		|| originalConv->quantizedFilterVersion != originalConv->Filter()->GetDataVersion() ) )
+	{
+		QuantizeWeights( *originalConv->GetFilterData(), originalConv->quantizedFilter, originalConv->filterScales );
+		originalConv->quantizedFilterVersion = originalConv->Filter()->GetDataVersion();
+	}
+	quantizedFilter = originalConv->quantizedFilter;
+	filterScales = originalConv->filterScales;
+	quantizedFilterVersion = originalConv->quantizedFilterVersion;
+}
+
+CPtr<CDnnBlob> CConvLayer::GetFilterData() const
+{
+	if( Filter() != 0 && Filter()->GetDataType() != CT_Float ) {
+		return ConvertBlobDataType( *Filter(), CT_Float );
+	}
+	return CBaseConvLayer::GetFilterData();
+}
+
+void CConvLayer::SetFilterData( const CPtr<CDnnBlob>& newFilter )
+{
+	quantizedFilter = 0;
+	filterScales = 0;
+	if( newFilter != 0 && Filter() != 0 && GetDnn() != 0 && Filter()->GetDataType() == CT_BFloat16 ) {
+		NeoAssert( Filter()->HasEqualDimensions( newFilter ) );
+		MathEngine().VectorConvert( newFilter->GetData(), Filter()->GetData<uint16_t>(), Filter()->GetDataSize() );
+		Filter()->DataChanged();
+		return;
+	}
+	CBaseConvLayer::SetFilterData( newFilter );
+	if( Filter() != 0 && Filter()->GetDataType() != filterType ) {
+		Filter() = ConvertBlobDataType( *Filter(), filterType );
+	}
+}
+
+void CConvLayer::SetFilterType( TBlobType type )
+{
+	NeoAssert( type == CT_Float || type == CT_BFloat16 );
+	if( filterType == type ) {
+		return;
+	}
+	filterType = type;
+	if( Filter() != 0 ) {
+		Filter() = ConvertBlobDataType( *Filter(), filterType );
+	}
+	quantizedFilter = 0;
+	filterScales = 0;
+	ForceReshape();
+}
+
+void CConvLayer::SetInputQuantizationScale( float scale )
+{
+	NeoAssert( scale >= 0 );
+	if( inputQuantizationScale != scale ) {
+		inputQuantizationScale = scale;
+		quantizedFilter = 0;
+		filterScales = 0;
+		ForceReshape();
+	}
+}
+
+void CConvLayer::SetFusedActivation( const CFusedActivation& activation )
+{
+	NeoAssert( activation.IsEmpty() || CFusedActivation::IsSupported( activation.Type ) );
+	fusedActivation = activation;
+	ForceReshape();
+}
+
+static const int ConvLayerVersion = 2003;
 
 void CConvLayer::Serialize( CArchive& archive )
 {
-	archive.SerializeVersion( ConvLayerVersion, CDnn::ArchiveMinSupportedVersion );
+	const int version = archive.SerializeVersion( ConvLayerVersion, CDnn::ArchiveMinSupportedVersion );
 	CBaseConvLayer::Serialize( archive );
+
+	if( version >= 2001 ) {
+		archive.Serialize( inputQuantizationScale );
+	} else {
+		inputQuantizationScale = 0;
+	}
+	if( version >= 2002 ) {
+		int filterTypeInt = static_cast<int>( filterType );
+		archive.Serialize( filterTypeInt );
+		filterType = static_cast<TBlobType>( filterTypeInt );
+	} else {
+		filterType = CT_Float;
+	}
+	if( version >= 2003 ) {
+		fusedActivation.Serialize( archive );
+	} else {
+		fusedActivation = CFusedActivation();
+	}
+	if( archive.IsLoading() ) {
+		quantizedFilter = 0;
+		filterScales = 0;
+	}
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////
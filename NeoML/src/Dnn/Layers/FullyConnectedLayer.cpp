@@ -17,6 +17,7 @@ limitations under the License.
 #pragma hdrstop
 
 #include <NeoML/Dnn/Layers/FullyConnectedLayer.h>
+#include <NeoML/Dnn/DnnQuantization.h>
 #include <NeoMathEngine/NeoMathEngine.h>
 
 namespace NeoML {
@@ -24,7 +25,10 @@ namespace NeoML {
 CFullyConnectedLayer::CFullyConnectedLayer( IMathEngine& mathEngine, const char* name ) :
 	CBaseLayer( mathEngine, name == nullptr ? "CCnnFullyConnectedLayer" : name, true ),
 	numberOfElements(0),
-	isZeroFreeTerm(false)
+	isZeroFreeTerm(false),
+	inputQuantizationScale(0),
+	weightsType(CT_Float),
+	quantizedWeightsVersion(0)
 {
 	paramBlobs.SetSize(2);
 }
@@ -38,8 +42,20 @@ void CFullyConnectedLayer::Reshape()
 	CheckInputs();
 	CheckArchitecture( GetInputCount() == GetOutputCount(),
 		GetName(), "fully connected layer with different numbers of input and output" );
+	if( inputQuantizationScale != 0 ) {
+		CheckArchitecture( !IsLearningPerformed(), GetName(), "fully connected layer with quantized input cannot be trained" );
+		CheckArchitecture( MathEngine().GetType() == MET_Cpu, GetName(), "quantized inference is supported only on CPU" );
+	}
+	if( weightsType != CT_Float ) {
+		CheckArchitecture( !IsBackwardPerformed(), GetName(), "fully connected layer with bfloat16 weights cannot be trained" );
+		CheckArchitecture( MathEngine().GetType() == MET_Cpu, GetName(), "bfloat16 weights are supported only on CPU" );
+	}
+	CheckArchitecture( fusedActivation.IsEmpty() || !IsBackwardPerformed(),
+		GetName(), "fully connected layer with fused activation cannot be trained" );
 	for(int i = 0; i < GetInputCount(); i++) {
 		if(Weights() == 0) {
+			quantizedWeights = 0;
+			weightScales = 0;
 			// Create a weights matrix
 			CBlobDesc weightsDesc = inputDescs[i];
 			weightsDesc.SetDimSize(BD_BatchLength, 1);
@@ -48,11 +64,19 @@ void CFullyConnectedLayer::Reshape()
 			Weights() = CDnnBlob::CreateBlob(MathEngine(), CT_Float, weightsDesc);
 			// Initialize
 			InitializeParamBlob(i, *Weights());
+			if( weightsType != CT_Float ) {
+				Weights() = ConvertBlobDataType( *Weights(), weightsType );
+			}
 		} else {
 			CheckArchitecture( Weights()->GetObjectCount() == numberOfElements,
 				GetName(), "weights number is not equal to number of elements" );
 			CheckArchitecture( Weights()->GetObjectSize() == inputDescs[i].ObjectSize(),
 				GetName(), "weights size mismatch" );
+			if( Weights()->GetDataType() != weightsType ) {
+				Weights() = ConvertBlobDataType( *Weights(), weightsType );
+				quantizedWeights = 0;
+				weightScales = 0;
+			}
 		}
 
 		if(FreeTerms() == 0) {
@@ -76,19 +100,54 @@ void CFullyConnectedLayer::Reshape()
 void CFullyConnectedLayer::RunOnce()
 {
 	for( int i = 0; i < GetInputCount(); i++ ) {
-		CConstFloatHandle inputData = inputBlobs[i]->GetData();
 		CFloatHandle outputData = outputBlobs[i]->GetData();
-		CConstFloatHandle weightData = Weights()->GetData();
+		if( inputQuantizationScale != 0 ) {
+			runQuantized( i );
+			fusedActivation.Apply( MathEngine(), outputData, outputBlobs[i]->GetDataSize() );
+			continue;
+		}
+		CConstFloatHandle inputData = inputBlobs[i]->GetData();
 
-		MathEngine().MultiplyMatrixByTransposedMatrix(inputData, inputBlobs[i]->GetObjectCount(),
-			inputBlobs[i]->GetObjectSize(), inputBlobs[i]->GetObjectSize(),
-			weightData, numberOfElements, Weights()->GetObjectSize(),
-			outputData, outputBlobs[i]->GetObjectSize(), outputBlobs[i]->GetObjectSize() * inputBlobs[i]->GetObjectCount());
+		if( weightsType == CT_BFloat16 ) {
+			MathEngine().MultiplyMatrixByTransposedBFloat16Matrix( inputData, inputBlobs[i]->GetObjectCount(),
+				inputBlobs[i]->GetObjectSize(), Weights()->GetData<uint16_t>(), numberOfElements,
+				outputData, outputBlobs[i]->GetDataSize() );
+		} else {
+			MathEngine().MultiplyMatrixByTransposedMatrix(inputData, inputBlobs[i]->GetObjectCount(),
+				inputBlobs[i]->GetObjectSize(), inputBlobs[i]->GetObjectSize(),
+				Weights()->GetData(), numberOfElements, Weights()->GetObjectSize(),
+				outputData, outputBlobs[i]->GetObjectSize(), outputBlobs[i]->GetObjectSize() * inputBlobs[i]->GetObjectCount());
+		}
 
 		if( !isZeroFreeTerm ) {
 			MathEngine().AddVectorToMatrixRows(1, outputData, outputData, inputBlobs[i]->GetObjectCount(),
 				outputBlobs[i]->GetObjectSize(), FreeTerms()->GetData());
 		}
+		fusedActivation.Apply( MathEngine(), outputData, outputBlobs[i]->GetDataSize() );
+	}
+}
+
+void CFullyConnectedLayer::runQuantized( int inputIndex )
+{
+	if( quantizedWeights == 0 || quantizedWeightsVersion != Weights()->GetDataVersion() ) {
+		QuantizeWeights( *GetWeightsData(), quantizedWeights, weightScales );
+		quantizedWeightsVersion = Weights()->GetDataVersion();
+	}
+
+	const int objectCount = inputBlobs[inputIndex]->GetObjectCount();
+	const int objectSize = inputBlobs[inputIndex]->GetObjectSize();
+	CFloatHandle outputData = outputBlobs[inputIndex]->GetData();
+
+	CMemoryHandleStackVar<int8_t> quantizedInput( MathEngine(), inputBlobs[inputIndex]->GetDataSize() );
+	MathEngine().VectorQuantize( inputBlobs[inputIndex]->GetData(), quantizedInput.GetHandle(),
+		inputBlobs[inputIndex]->GetDataSize(), inputQuantizationScale );
+	MathEngine().MultiplyQuantizedMatrixByTransposedMatrix( quantizedInput.GetHandle(), objectCount, objectSize,
+		inputQuantizationScale, quantizedWeights->GetData<int8_t>(), numberOfElements, weightScales->GetData(),
+		outputData, outputBlobs[inputIndex]->GetDataSize() );
+
+	if( !isZeroFreeTerm ) {
+		MathEngine().AddVectorToMatrixRows( 1, outputData, outputData, objectCount,
+			outputBlobs[inputIndex]->GetObjectSize(), FreeTerms()->GetData() );
 	}
 }
 
@@ -116,12 +175,36 @@ void CFullyConnectedLayer::LearnOnce()
 	}
 }
 
+// The quantized weights are calculated once for the original layer and all its copies
+// If the weights are changed later, every layer quantizes them again on its next run
+void CFullyConnectedLayer::referenceCalculatedParams( CBaseLayer& original )
+{
+	CFullyConnectedLayer* originalFc = CheckCast<CFullyConnectedLayer>( &original );
+	if( inputQuantizationScale != 0 && originalFc->Weights() != 0 && ( originalFc->quantizedWeights == 0
+		|| originalFc->quantizedWeightsVersion != originalFc->Weights()->GetDataVersion() ) )
+	{
+		QuantizeWeights( *originalFc->GetWeightsData(), originalFc->quantizedWeights, originalFc->weightScales );
+		originalFc->quantizedWeightsVersion = originalFc->Weights()->GetDataVersion();
+	}
+	quantizedWeights = originalFc->quantizedWeights;
+	weightScales = originalFc->weightScales;
+	quantizedWeightsVersion = originalFc->quantizedWeightsVersion;
+}
+
 void CFullyConnectedLayer::FilterLayerParams( float threshold )
 {
+	quantizedWeights = 0;
+	weightScales = 0;
+	if( Weights() != 0 && weightsType != CT_Float ) {
+		CPtr<CDnnBlob> weights = GetWeightsData();
+		MathEngine().FilterSmallValues( weights->GetData(), weights->GetDataSize(), threshold );
+		SetWeightsData( weights );
+	}
 	for( int blobIndex = 0; blobIndex < paramBlobs.Size(); ++blobIndex ) {
-		if( paramBlobs[blobIndex] != 0 ) {
+		if( paramBlobs[blobIndex] != 0 && paramBlobs[blobIndex]->GetDataType() == CT_Float ) {
 			MathEngine().FilterSmallValues( paramBlobs[blobIndex]->GetData(),
 				paramBlobs[blobIndex]->GetDataSize(), threshold );
+			paramBlobs[blobIndex]->DataChanged();
 		}
 	}
 }
@@ -138,6 +221,9 @@ CPtr<CDnnBlob> CFullyConnectedLayer::GetWeightsData() const
 		return 0;
 	}
 
+	if( Weights()->GetDataType() != CT_Float ) {
+		return ConvertBlobDataType( *Weights(), CT_Float );
+	}
 	return Weights()->GetCopy();
 }
 
@@ -149,10 +235,18 @@ void CFullyConnectedLayer::SetWeightsData(const CDnnBlob* newWeights)
 	} else if(Weights() != 0 && GetDnn() != 0) {
 		NeoAssert(Weights()->GetObjectCount() == newWeights->GetObjectCount());
 		NeoAssert(Weights()->GetObjectSize() == newWeights->GetObjectSize());
-		Weights()->CopyFrom(newWeights);
+		if( Weights()->GetDataType() == CT_BFloat16 ) {
+			MathEngine().VectorConvert( newWeights->GetData(), Weights()->GetData<uint16_t>(), Weights()->GetDataSize() );
+		} else {
+			Weights()->CopyFrom(newWeights);
+		}
+		// The quantized weights of this layer and its copies should be updated
+		Weights()->DataChanged();
 	} else {
-		Weights() = newWeights->GetCopy();
+		Weights() = ConvertBlobDataType( *newWeights, weightsType );
 	}
+	quantizedWeights = 0;
+	weightScales = 0;
 
 	if(Weights() != 0) {
 		numberOfElements = Weights()->GetObjectCount();
@@ -178,6 +272,7 @@ void CFullyConnectedLayer::SetFreeTermData(const CDnnBlob* newFreeTerms)
 			NeoAssert(FreeTerms()->GetDataSize() == newFreeTerms->GetDataSize());
 
 			FreeTerms()->CopyFrom(newFreeTerms);
+			FreeTerms()->DataChanged();
 		} else {
 			FreeTerms() = newFreeTerms->GetCopy();
 		}
@@ -193,38 +288,100 @@ void CFullyConnectedLayer::SetZeroFreeTerm(bool _isZeroFreeTerm)
 	isZeroFreeTerm = _isZeroFreeTerm;
 }
 
+void CFullyConnectedLayer::SetInputQuantizationScale( float scale )
+{
+	NeoAssert( scale >= 0 );
+	if( inputQuantizationScale != scale ) {
+		inputQuantizationScale = scale;
+		quantizedWeights = 0;
+		weightScales = 0;
+		ForceReshape();
+	}
+}
+
+void CFullyConnectedLayer::SetWeightsType( TBlobType type )
+{
+	NeoAssert( type == CT_Float || type == CT_BFloat16 );
+	if( weightsType == type ) {
+		return;
+	}
+	weightsType = type;
+	if( Weights() != 0 ) {
+		Weights() = ConvertBlobDataType( *Weights(), weightsType );
+	}
+	quantizedWeights = 0;
+	weightScales = 0;
+	ForceReshape();
+}
+
 void CFullyConnectedLayer::ApplyBatchNormalization(CBatchNormalizationLayer& batchNorm)
 {
 	CPtr<CDnnBlob> params = batchNorm.GetFinalParams();
 	if(params.Ptr() == 0 || Weights().Ptr() == 0) {
 		return;
 	}
+	quantizedWeights = 0;
+	weightScales = 0;
 	NeoAssert(params->GetObjectSize() == numberOfElements);
 	CConstFloatHandle gamma = params->GetObjectData( 0 );
 	CConstFloatHandle beta = params->GetObjectData( 1 );
 
-	CFloatHandle weightData = Weights()->GetData();
+	// The bfloat16 weights are changed in the float copy
+	CPtr<CDnnBlob> weights = weightsType == CT_Float ? Weights() : GetWeightsData();
+	CFloatHandle weightData = weights->GetData();
 	CFloatHandle freeTermData = FreeTerms()->GetData();
-	int wieghtCount = Weights()->GetObjectSize();
+	int wieghtCount = weights->GetObjectSize();
 	MathEngine().VectorEltwiseMultiply(freeTermData, gamma, freeTermData, numberOfElements);
 	MathEngine().VectorAdd(freeTermData, beta, freeTermData, numberOfElements);
 	for(int i = 0; i < numberOfElements; ++i) {
 		MathEngine().VectorMultiply(weightData, weightData, wieghtCount, gamma++);
 		weightData += wieghtCount;
 	}
+	if( weightsType != CT_Float ) {
+		SetWeightsData( weights );
+	} else {
+		Weights()->DataChanged();
+	}
+	FreeTerms()->DataChanged();
+}
+
+void CFullyConnectedLayer::SetFusedActivation( const CFusedActivation& activation )
+{
+	NeoAssert( activation.IsEmpty() || CFusedActivation::IsSupported( activation.Type ) );
+	fusedActivation = activation;
+	ForceReshape();
 }
 
-static const int FullyConnectedLayerVersion = 2000;
+static const int FullyConnectedLayerVersion = 2003;
 
 void CFullyConnectedLayer::Serialize( CArchive& archive )
 {
-	archive.SerializeVersion( FullyConnectedLayerVersion, CDnn::ArchiveMinSupportedVersion );
+	const int version = archive.SerializeVersion( FullyConnectedLayerVersion, CDnn::ArchiveMinSupportedVersion );
 	CBaseLayer::Serialize( archive );
 
 	archive.Serialize( numberOfElements );
 	archive.Serialize( isZeroFreeTerm );
+	if( version >= 2001 ) {
+		archive.Serialize( inputQuantizationScale );
+	} else {
+		inputQuantizationScale = 0;
+	}
+	if( version >= 2002 ) {
+		int weightsTypeInt = static_cast<int>( weightsType );
+		archive.Serialize( weightsTypeInt );
+		weightsType = static_cast<TBlobType>( weightsTypeInt );
+	} else {
+		weightsType = CT_Float;
+	}
+	if( version >= 2003 ) {
+		fusedActivation.Serialize( archive );
+	} else {
+		fusedActivation = CFusedActivation();
+	}
 
 	if( archive.IsLoading() ) {
+		quantizedWeights = 0;
+		weightScales = 0;
 		// Converts the free terms blob into a new tensor with the length in the first dimension not Channels
 		CDnnBlob* freeTerms = FreeTerms();
 		if( freeTerms != 0 && freeTerms->DimSize(0) != freeTerms->GetDataSize() ) {
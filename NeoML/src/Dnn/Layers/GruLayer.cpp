@@ -25,7 +25,8 @@ limitations under the License.
 namespace NeoML {
 
 CGruLayer::CGruLayer( IMathEngine& mathEngine ) :
-	CRecurrentLayer( mathEngine, "CCnnGruLayer" )
+	CRecurrentLayer( mathEngine, "CCnnGruLayer" ),
+	useSequenceKernel( false )
 {
 	buildLayer();
 }
@@ -127,6 +128,130 @@ void CGruLayer::SetHiddenSize(int size)
 	mainBackLink->SetDimSize(BD_Channels, size);
 }
 
+// Checks if the fully connected layer works with float weights and data
+static bool isFloatFullyConnected( const CFullyConnectedLayer& layer )
+{
+	return layer.GetWeightsType() == CT_Float && layer.GetInputQuantizationScale() == 0;
+}
+
+void CGruLayer::Reshape()
+{
+	CRecurrentLayer::Reshape();
+
+	useSequenceKernel = IsSequenceKernelAvailable()
+		&& isFloatFullyConnected( *gateLayer ) && isFloatFullyConnected( *mainLayer );
+	sequenceGates = nullptr;
+	initialHidden = nullptr;
+}
+
+void CGruLayer::RunOnce()
+{
+	if( useSequenceKernel ) {
+		runSequence();
+	} else {
+		CRecurrentLayer::RunOnce();
+	}
+}
+
+void CGruLayer::BackwardOnce()
+{
+	if( useSequenceKernel ) {
+		runSequenceBackward();
+	} else {
+		CRecurrentLayer::BackwardOnce();
+	}
+}
+
+void CGruLayer::LearnOnce()
+{
+	if( !useSequenceKernel ) {
+		CRecurrentLayer::LearnOnce();
+	} else if( !IsBackwardPerformed() ) {
+		runSequenceBackward();
+	}
+}
+
+// Processes the whole sequence without running the internal network
+void CGruLayer::runSequence()
+{
+	const int sequenceLength = inputBlobs[0]->GetBatchLength();
+	const int batchSize = inputBlobs[0]->GetObjectCount() / sequenceLength;
+	const int inputSize = inputBlobs[0]->GetObjectSize();
+	const int hiddenSize = GetHiddenSize();
+	const int stateSize = batchSize * hiddenSize;
+	const bool isBackward = GetDnn()->IsBackwardPerformed();
+
+	// The state left by the previous run is stored in the back link; a reverse sequence starts from zero
+	const CPtr<CDnnBlob>& hiddenState = mainBackLink->GetState();
+	const CConstFloatHandle initialHiddenData = IsReverseSequence() ? CConstFloatHandle() : hiddenState->GetData();
+	if( isBackward ) {
+		initialHidden = IsReverseSequence() ? nullptr : hiddenState->GetCopy();
+		if( sequenceGates == nullptr || sequenceGates->GetBatchLength() != sequenceLength
+			|| sequenceGates->GetBatchWidth() != batchSize )
+		{
+			sequenceGates = CDnnBlob::CreateDataBlob( MathEngine(), CT_Float, sequenceLength, batchSize,
+				( G_Count + 1 ) * hiddenSize );
+		}
+	}
+
+	MathEngine().GruSequence( IsReverseSequence(), sequenceLength, batchSize, inputSize, hiddenSize,
+		inputBlobs[0]->GetData(), gateLayer->Weights()->GetData(),
+		gateLayer->IsZeroFreeTerm() ? CConstFloatHandle() : gateLayer->FreeTerms()->GetData(),
+		mainLayer->Weights()->GetData(),
+		mainLayer->IsZeroFreeTerm() ? CConstFloatHandle() : mainLayer->FreeTerms()->GetData(),
+		initialHiddenData, isBackward ? sequenceGates->GetData() : CFloatHandle(), outputBlobs[0]->GetData() );
+
+	// Keep the state of the last processed step as the internal network does
+	const int lastPos = IsReverseSequence() ? 0 : sequenceLength - 1;
+	MathEngine().VectorCopy( hiddenState->GetData(), outputBlobs[0]->GetData() + lastPos * stateSize, stateSize );
+}
+
+// Backpropagates through the whole sequence processed by runSequence
+void CGruLayer::runSequenceBackward()
+{
+	const int sequenceLength = inputBlobs[0]->GetBatchLength();
+	const int batchSize = inputBlobs[0]->GetObjectCount() / sequenceLength;
+	const int inputSize = inputBlobs[0]->GetObjectSize();
+	const int hiddenSize = GetHiddenSize();
+
+	const bool learnGate = IsLearningPerformed() && gateLayer->IsLearningEnabled();
+	const bool learnMain = IsLearningPerformed() && mainLayer->IsLearningEnabled();
+
+	CObjectArray<CDnnBlob> gateDiffs;
+	if( learnGate ) {
+		gateDiffs.Add( gateLayer->Weights()->GetClone() );
+		gateDiffs.Add( gateLayer->FreeTerms()->GetClone() );
+	}
+	CObjectArray<CDnnBlob> mainDiffs;
+	if( learnMain ) {
+		mainDiffs.Add( mainLayer->Weights()->GetClone() );
+		mainDiffs.Add( mainLayer->FreeTerms()->GetClone() );
+	}
+	for( int i = 0; i < gateDiffs.Size(); ++i ) {
+		gateDiffs[i]->Clear();
+	}
+	for( int i = 0; i < mainDiffs.Size(); ++i ) {
+		mainDiffs[i]->Clear();
+	}
+
+	MathEngine().GruSequenceBackward( IsReverseSequence(), sequenceLength, batchSize, inputSize, hiddenSize,
+		inputBlobs[0]->GetData(), gateLayer->Weights()->GetData(), mainLayer->Weights()->GetData(),
+		initialHidden == nullptr ? CConstFloatHandle() : initialHidden->GetData(),
+		sequenceGates->GetData(), outputBlobs[0]->GetData(), outputDiffBlobs[0]->GetData(),
+		IsBackwardPerformed() ? inputDiffBlobs[0]->GetData() : CFloatHandle(),
+		learnGate ? gateDiffs[0]->GetData() : CFloatHandle(),
+		learnGate && !gateLayer->IsZeroFreeTerm() ? gateDiffs[1]->GetData() : CFloatHandle(),
+		learnMain ? mainDiffs[0]->GetData() : CFloatHandle(),
+		learnMain && !mainLayer->IsZeroFreeTerm() ? mainDiffs[1]->GetData() : CFloatHandle() );
+
+	if( learnGate ) {
+		GetDnn()->GetSolver()->AddDiff( gateLayer, gateDiffs );
+	}
+	if( learnMain ) {
+		GetDnn()->GetSolver()->AddDiff( mainLayer, mainDiffs );
+	}
+}
+
 static const int GruLayerVersion = 2000;
 
 void CGruLayer::Serialize( CArchive& archive )
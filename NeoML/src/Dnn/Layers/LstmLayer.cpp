@@ -36,7 +36,8 @@ static const char* recurHiddenLayerName = "RecurHidden";
 CLstmLayer::CLstmLayer( IMathEngine& mathEngine ) :
 	CRecurrentLayer( mathEngine, "CCnnLstmLayer" ),
 	recurrentActivation( AF_Sigmoid ),
-	isInCompatibilityMode( false )
+	isInCompatibilityMode( false ),
+	useSequenceKernel( false )
 {
 	buildLayer(0);
 }
@@ -238,6 +239,179 @@ void CLstmLayer::SetCompatibilityMode( bool compatibilityMode )
 	ForceReshape();
 }
 
+// Checks if the fully connected layer works with float weights and data
+static bool isFloatFullyConnected( const CFullyConnectedLayer& layer )
+{
+	return layer.GetWeightsType() == CT_Float && layer.GetInputQuantizationScale() == 0;
+}
+
+void CLstmLayer::Reshape()
+{
+	CRecurrentLayer::Reshape();
+
+	useSequenceKernel = IsSequenceKernelAvailable() && inputDropoutLayer == nullptr
+		&& recurrentActivation == AF_Sigmoid && !isInCompatibilityMode
+		&& isFloatFullyConnected( *inputHiddenLayer ) && isFloatFullyConnected( *recurHiddenLayer );
+	sequenceGates = nullptr;
+	sequenceCell = nullptr;
+	initialHidden = nullptr;
+	initialCell = nullptr;
+}
+
+void CLstmLayer::RunOnce()
+{
+	if( useSequenceKernel ) {
+		runSequence();
+	} else {
+		CRecurrentLayer::RunOnce();
+	}
+}
+
+void CLstmLayer::BackwardOnce()
+{
+	if( useSequenceKernel ) {
+		runSequenceBackward();
+	} else {
+		CRecurrentLayer::BackwardOnce();
+	}
+}
+
+void CLstmLayer::LearnOnce()
+{
+	if( !useSequenceKernel ) {
+		CRecurrentLayer::LearnOnce();
+	} else if( !IsBackwardPerformed() ) {
+		runSequenceBackward();
+	}
+}
+
+// Processes the whole sequence without running the internal network
+void CLstmLayer::runSequence()
+{
+	const int sequenceLength = inputBlobs[0]->GetBatchLength();
+	const int batchSize = inputBlobs[0]->GetObjectCount() / sequenceLength;
+	const int inputSize = inputBlobs[0]->GetObjectSize();
+	const int hiddenSize = GetHiddenSize();
+	const int stateSize = batchSize * hiddenSize;
+	const bool isBackward = GetDnn()->IsBackwardPerformed();
+
+	// The state left by the previous run is stored in the back links; a reverse sequence starts from zero
+	const CPtr<CDnnBlob>& hiddenState = mainBackLink->GetState();
+	const CPtr<CDnnBlob>& cellState = stateBackLink->GetState();
+	CConstFloatHandle initialHiddenData;
+	CConstFloatHandle initialCellData;
+	if( !IsReverseSequence() ) {
+		initialHiddenData = hiddenState->GetData();
+		initialCellData = cellState->GetData();
+	}
+	if( isBackward ) {
+		initialHidden = IsReverseSequence() ? nullptr : hiddenState->GetCopy();
+		initialCell = IsReverseSequence() ? nullptr : cellState->GetCopy();
+		if( sequenceGates == nullptr || sequenceGates->GetBatchLength() != sequenceLength
+			|| sequenceGates->GetBatchWidth() != batchSize )
+		{
+			sequenceGates = CDnnBlob::CreateDataBlob( MathEngine(), CT_Float, sequenceLength, batchSize,
+				G_Count * hiddenSize );
+		}
+	}
+
+	// The cell state is needed even if the second output is not connected
+	CFloatHandleStackVar cellBuffer( MathEngine(), GetOutputCount() > 1 || isBackward ? 1 : sequenceLength * stateSize );
+	CFloatHandle cell = cellBuffer.GetHandle();
+	if( GetOutputCount() > 1 ) {
+		cell = outputBlobs[1]->GetData();
+	} else if( isBackward ) {
+		if( sequenceCell == nullptr || sequenceCell->GetDataSize() != sequenceLength * stateSize ) {
+			sequenceCell = CDnnBlob::CreateDataBlob( MathEngine(), CT_Float, sequenceLength, batchSize, hiddenSize );
+		}
+		cell = sequenceCell->GetData();
+	}
+
+	MathEngine().LstmSequence( IsReverseSequence(), sequenceLength, batchSize, inputSize, hiddenSize,
+		inputBlobs[0]->GetData(), inputHiddenLayer->Weights()->GetData(), recurHiddenLayer->Weights()->GetData(),
+		inputHiddenLayer->IsZeroFreeTerm() ? CConstFloatHandle() : inputHiddenLayer->FreeTerms()->GetData(),
+		recurHiddenLayer->IsZeroFreeTerm() ? CConstFloatHandle() : recurHiddenLayer->FreeTerms()->GetData(),
+		initialHiddenData, initialCellData, isBackward ? sequenceGates->GetData() : CFloatHandle(),
+		outputBlobs[0]->GetData(), cell );
+
+	// Keep the state of the last processed step as the internal network does
+	const int lastPos = IsReverseSequence() ? 0 : sequenceLength - 1;
+	MathEngine().VectorCopy( hiddenState->GetData(), outputBlobs[0]->GetData() + lastPos * stateSize, stateSize );
+	MathEngine().VectorCopy( cellState->GetData(), cell + lastPos * stateSize, stateSize );
+}
+
+// Backpropagates through the whole sequence processed by runSequence
+void CLstmLayer::runSequenceBackward()
+{
+	const int sequenceLength = inputBlobs[0]->GetBatchLength();
+	const int batchSize = inputBlobs[0]->GetObjectCount() / sequenceLength;
+	const int inputSize = inputBlobs[0]->GetObjectSize();
+	const int hiddenSize = GetHiddenSize();
+	const int outputSize = sequenceLength * batchSize * hiddenSize;
+
+	const bool learnInputHidden = IsLearningPerformed() && inputHiddenLayer->IsLearningEnabled();
+	const bool learnRecurHidden = IsLearningPerformed() && recurHiddenLayer->IsLearningEnabled();
+
+	CObjectArray<CDnnBlob> inputHiddenDiffs;
+	if( learnInputHidden ) {
+		inputHiddenDiffs.Add( inputHiddenLayer->Weights()->GetClone() );
+		inputHiddenDiffs.Add( inputHiddenLayer->FreeTerms()->GetClone() );
+	}
+	CObjectArray<CDnnBlob> recurHiddenDiffs;
+	if( learnRecurHidden ) {
+		recurHiddenDiffs.Add( recurHiddenLayer->Weights()->GetClone() );
+		recurHiddenDiffs.Add( recurHiddenLayer->FreeTerms()->GetClone() );
+	}
+	// The free terms of both layers are added to the same sum so they have the same diff
+	CPtr<CDnnBlob> freeTermDiff;
+	if( learnInputHidden || learnRecurHidden ) {
+		freeTermDiff = CDnnBlob::CreateVector( MathEngine(), CT_Float, G_Count * hiddenSize );
+		freeTermDiff->Clear();
+	}
+	for( int i = 0; i < inputHiddenDiffs.Size(); ++i ) {
+		inputHiddenDiffs[i]->Clear();
+	}
+	for( int i = 0; i < recurHiddenDiffs.Size(); ++i ) {
+		recurHiddenDiffs[i]->Clear();
+	}
+
+	// The unconnected outputs have no diff
+	CFloatHandleStackVar zeroDiff( MathEngine(), outputDiffBlobs[0] == nullptr ? outputSize : 1 );
+	CConstFloatHandle hiddenDiff;
+	if( outputDiffBlobs[0] != nullptr ) {
+		hiddenDiff = outputDiffBlobs[0]->GetData();
+	} else {
+		MathEngine().VectorFill( zeroDiff.GetHandle(), 0, outputSize );
+		hiddenDiff = zeroDiff.GetHandle();
+	}
+	const CConstFloatHandle cellDiff = outputDiffBlobs.Size() > 1 && outputDiffBlobs[1] != nullptr
+		? outputDiffBlobs[1]->GetData() : CConstFloatHandle();
+	const CConstFloatHandle cell = GetOutputCount() > 1 ? outputBlobs[1]->GetData() : sequenceCell->GetData();
+
+	MathEngine().LstmSequenceBackward( IsReverseSequence(), sequenceLength, batchSize, inputSize, hiddenSize,
+		inputBlobs[0]->GetData(), inputHiddenLayer->Weights()->GetData(), recurHiddenLayer->Weights()->GetData(),
+		initialHidden == nullptr ? CConstFloatHandle() : initialHidden->GetData(),
+		initialCell == nullptr ? CConstFloatHandle() : initialCell->GetData(),
+		sequenceGates->GetData(), outputBlobs[0]->GetData(), cell, hiddenDiff, cellDiff,
+		IsBackwardPerformed() ? inputDiffBlobs[0]->GetData() : CFloatHandle(),
+		learnInputHidden ? inputHiddenDiffs[0]->GetData() : CFloatHandle(),
+		learnRecurHidden ? recurHiddenDiffs[0]->GetData() : CFloatHandle(),
+		freeTermDiff == nullptr ? CFloatHandle() : freeTermDiff->GetData() );
+
+	if( learnInputHidden ) {
+		if( !inputHiddenLayer->IsZeroFreeTerm() ) {
+			inputHiddenDiffs[1]->CopyFrom( freeTermDiff );
+		}
+		GetDnn()->GetSolver()->AddDiff( inputHiddenLayer, inputHiddenDiffs );
+	}
+	if( learnRecurHidden ) {
+		if( !recurHiddenLayer->IsZeroFreeTerm() ) {
+			recurHiddenDiffs[1]->CopyFrom( freeTermDiff );
+		}
+		GetDnn()->GetSolver()->AddDiff( recurHiddenLayer, recurHiddenDiffs );
+	}
+}
+
 static const int LstmLayerVersion = 2001;
 
 void CLstmLayer::Serialize( CArchive& archive )
@@ -22,19 +22,25 @@ limitations under the License.
 #include <NeoML/Dnn/Layers/AddToObjectLayer.h>
 #include <NeoML/Dnn/Layers/DropoutLayer.h>
 #include <NeoML/Dnn/Layers/FullyConnectedLayer.h>
+#include <NeoML/Dnn/Layers/ScaledDotProductAttentionLayer.h>
 #include <NeoML/Dnn/Layers/TransformLayer.h>
 #include <NeoML/Dnn/Layers/TransposeLayer.h>
 #include <NeoML/Dnn/Layers/SoftmaxLayer.h>
 
 namespace NeoML {
 
+// The name of the internal layer with the fused attention
+static const char* const FusedAttentionLayerName = "ScaledDotProductAttention";
+
 CMultiheadAttentionLayer::CMultiheadAttentionLayer( IMathEngine& mathEngine ) :
 	CCompositeLayer( mathEngine ),
 	headCount( 1 ),
 	hiddenSize( 8 ),
 	dropoutRate( -1 ),
 	useMask( false ),
-	outputSize( 8 )
+	outputSize( 8 ),
+	useKeyValueCache( false ),
+	maxCacheLength( 0 )
 {
 }
 
@@ -74,6 +80,48 @@ void CMultiheadAttentionLayer::SetOutputSize( int _outputSize )
 	DeleteAllLayers();
 }
 
+void CMultiheadAttentionLayer::SetUseKeyValueCache( bool use )
+{
+	useKeyValueCache = use;
+	if( getFusedAttention() != nullptr ) {
+		getFusedAttention()->SetUseKeyValueCache( use );
+	}
+	ForceReshape();
+}
+
+void CMultiheadAttentionLayer::SetMaxCacheLength( int length )
+{
+	NeoAssert( length >= 0 );
+
+	maxCacheLength = length;
+	if( getFusedAttention() != nullptr ) {
+		getFusedAttention()->SetMaxCacheLength( length );
+	}
+}
+
+int CMultiheadAttentionLayer::GetCacheLength( int sequence ) const
+{
+	if( !HasLayer( FusedAttentionLayerName ) ) {
+		return 0;
+	}
+	return CheckCast<const CScaledDotProductAttentionLayer>( GetLayer( FusedAttentionLayerName ).Ptr() )
+		->GetCacheLength( sequence );
+}
+
+void CMultiheadAttentionLayer::ResetCache()
+{
+	if( getFusedAttention() != nullptr ) {
+		getFusedAttention()->ResetCache();
+	}
+}
+
+void CMultiheadAttentionLayer::ResetCache( int sequence )
+{
+	if( getFusedAttention() != nullptr ) {
+		getFusedAttention()->ResetCache( sequence );
+	}
+}
+
 static const int MultiheadAttentionLayerVersion = 0;
 
 void CMultiheadAttentionLayer::Serialize( CArchive& archive )
@@ -89,16 +137,53 @@ void CMultiheadAttentionLayer::Serialize( CArchive& archive )
 
 void CMultiheadAttentionLayer::Reshape()
 {
+	const bool useFusedAttention = isFusedAttentionAvailable();
+	if( useKeyValueCache ) {
+		CheckArchitecture( useFusedAttention, GetName(),
+			"key-value cache requires the fused attention (CPU, no dropout, no softmax output)" );
+		CheckArchitecture( !useMask, GetName(), "mask isn't supported with key-value cache" );
+	}
 	if( !HasLayer( "Q" ) ) {
-		create();
+		create( useFusedAttention );
+	} else if( HasLayer( FusedAttentionLayerName ) != useFusedAttention ) {
+		// The layer has been built for other conditions (e.g. loaded from an archive or its softmax output is connected)
+		// Rebuild it keeping the trained weights
+		CArray<const char*> layerList;
+		GetLayerList( layerList );
+		CArray<CString> untrainedLayers;
+		for( int i = 0; i < layerList.Size(); ++i ) {
+			if( dynamic_cast<CFullyConnectedLayer*>( GetLayer( layerList[i] ).Ptr() ) == nullptr ) {
+				untrainedLayers.Add( layerList[i] );
+			}
+		}
+		for( int i = 0; i < untrainedLayers.Size(); ++i ) {
+			DeleteLayer( untrainedLayers[i] );
+		}
+		create( useFusedAttention );
 	}
 
 	CCompositeLayer::Reshape();
 }
 
+// Checks if the fused attention kernel may be used instead of the separate layers
+// The kernel doesn't store the softmax result, so it can't be used with dropout or when the softmax output is connected
+bool CMultiheadAttentionLayer::isFusedAttentionAvailable() const
+{
+	return MathEngine().GetType() == MET_Cpu && dropoutRate <= 0 && GetOutputCount() <= O_Softmax;
+}
+
+// The internal layer with the fused attention (null if the attention is calculated by the separate layers)
+CScaledDotProductAttentionLayer* CMultiheadAttentionLayer::getFusedAttention()
+{
+	if( !HasLayer( FusedAttentionLayerName ) ) {
+		return nullptr;
+	}
+	return CheckCast<CScaledDotProductAttentionLayer>( GetLayer( FusedAttentionLayerName ).Ptr() );
+}
+
 // Creates layer with new parameters
 // Here and further blob sizes are shown as [BathcWidth, ListSize, Width, Channels]
-void CMultiheadAttentionLayer::create()
+void CMultiheadAttentionLayer::create( bool useFusedAttention )
 {
 	NeoAssert( headCount > 0 );
 	NeoAssert( hiddenSize % headCount == 0 );
@@ -114,6 +199,28 @@ void CMultiheadAttentionLayer::create()
 	CBaseLayer* K = multiplyInputByMatrixWeights( hiddenSize, "K", I_K );
 	CBaseLayer* V = multiplyInputByMatrixWeights( hiddenSize, "V", I_V );
 
+	if( useFusedAttention ) {
+		// All the heads in one layer without the intermediate [B, n_head, seq_Q, seq_to] blobs
+		// [B, seq_Q, 1, hiddenSize]
+		CPtr<CScaledDotProductAttentionLayer> attention = new CScaledDotProductAttentionLayer( MathEngine() );
+		attention->SetName( FusedAttentionLayerName );
+		attention->SetHeadCount( headCount );
+		attention->SetScale( multiplier );
+		attention->SetUseKeyValueCache( useKeyValueCache );
+		attention->SetMaxCacheLength( maxCacheLength );
+		attention->Connect( 0, *Q );
+		attention->Connect( 1, *K );
+		attention->Connect( 2, *V );
+		AddLayer( *attention );
+		if( useMask ) {
+			SetInputMapping( I_Mask, *attention, 3 );
+		}
+
+		CPtr<CBaseLayer> output = multiplyByMatrixWeights( attention, outputSize, "Out.Dense" );
+		SetOutputMapping( O_Output, *output );
+		return;
+	}
+
 	// [B, n_head, seq_Q, d_k]
 	Q = prepareQ( Q );
 
@@ -186,11 +293,7 @@ CBaseLayer* CMultiheadAttentionLayer::multiplyInputByMatrixWeights(
 {
 	NeoAssert( size > 0 );
 
-	CPtr<CFullyConnectedLayer> fcLayer = new CFullyConnectedLayer( MathEngine() );
-	fcLayer->SetNumberOfElements( size );
-	fcLayer->SetZeroFreeTerm( false );
-	fcLayer->SetName( name );
-	AddLayer( *fcLayer );
+	CPtr<CBaseLayer> fcLayer = getOrCreateMatrixWeights( size, name );
 
 	// Вход маппится на этот слой.
 	SetInputMapping( input, *fcLayer, 0 );
@@ -205,9 +308,21 @@ CBaseLayer* CMultiheadAttentionLayer::multiplyByMatrixWeights( CBaseLayer* input
 	NeoAssert( width >= 0 );
 	NeoAssert( input != 0 );
 
-	CPtr<CFullyConnectedLayer> fcLayer = new CFullyConnectedLayer( MathEngine() );
-	fcLayer->SetNumberOfElements( width );
+	CPtr<CBaseLayer> fcLayer = getOrCreateMatrixWeights( width, name );
 	fcLayer->Connect( *input );
+
+	return fcLayer;
+}
+
+// Creates the layer with trainable weights or returns the existing one if the layer is being rebuilt
+CBaseLayer* CMultiheadAttentionLayer::getOrCreateMatrixWeights( int size, const char* name )
+{
+	if( HasLayer( name ) ) {
+		return GetLayer( name );
+	}
+
+	CPtr<CFullyConnectedLayer> fcLayer = new CFullyConnectedLayer( MathEngine() );
+	fcLayer->SetNumberOfElements( size );
 	fcLayer->SetZeroFreeTerm( false );
 	fcLayer->SetName( name );
 	AddLayer( *fcLayer );
@@ -18,6 +18,7 @@ limitations under the License.
 
 #include <NeoML/Dnn/Layers/PoolingLayer.h>
 #include <NeoMathEngine/NeoMathEngine.h>
+#include <Dnn/DnnReshapeState.h>
 #include <float.h>
 
 namespace NeoML {
@@ -125,6 +126,19 @@ void CMeanPoolingLayer::Reshape()
 	destroyDesc();
 }
 
+CPtr<IObject> CMeanPoolingLayer::DetachReshapeState()
+{
+	CPtr<IObject> state = FINE_DEBUG_NEW CDescReshapeState<CMeanPoolingDesc>( desc );
+	desc = 0;
+	return state;
+}
+
+void CMeanPoolingLayer::AttachReshapeState( IObject* state )
+{
+	destroyDesc();
+	desc = CheckCast<CDescReshapeState<CMeanPoolingDesc>>( state )->Detach();
+}
+
 void CMeanPoolingLayer::initDesc()
 {
 	if( desc == 0 ) {
@@ -163,6 +177,19 @@ void CMaxPoolingLayer::Reshape()
 	destroyDesc();
 }
 
+CPtr<IObject> CMaxPoolingLayer::DetachReshapeState()
+{
+	CPtr<IObject> state = FINE_DEBUG_NEW CDescReshapeState<CMaxPoolingDesc>( desc );
+	desc = 0;
+	return state;
+}
+
+void CMaxPoolingLayer::AttachReshapeState( IObject* state )
+{
+	destroyDesc();
+	desc = CheckCast<CDescReshapeState<CMaxPoolingDesc>>( state )->Detach();
+}
+
 void CMaxPoolingLayer::RunOnce()
 {
 	initDesc();
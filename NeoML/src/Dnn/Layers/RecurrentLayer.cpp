@@ -137,6 +137,12 @@ void CRecurrentLayer::SetRepeatCount(int count)
 	repeatCount = count;
 }
 
+bool CRecurrentLayer::IsSequenceKernelAvailable() const
+{
+	return MathEngine().GetType() == MET_Cpu && !GetDnn()->IsRecurrentMode()
+		&& GetInputCount() == 1 && repeatCount == 1;
+}
+
 void CRecurrentLayer::getSequenceParams(int& batchWidth, int& sequenceLength)
 {
 	// The outermost recurrent layer runs in recurrent mode, 
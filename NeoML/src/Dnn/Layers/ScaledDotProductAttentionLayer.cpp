@@ -0,0 +1,287 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <common.h>
+#pragma hdrstop
+
+#include <NeoML/Dnn/Layers/ScaledDotProductAttentionLayer.h>
+
+namespace NeoML {
+
+// The multiplier of the mask added to the scores (the same as in CMultiheadAttentionLayer)
+static const float AttentionMaskMultiplier = -1e+9f;
+
+CScaledDotProductAttentionLayer::CScaledDotProductAttentionLayer( IMathEngine& mathEngine ) :
+	CBaseLayer( mathEngine, "CScaledDotProductAttentionLayer", false ),
+	headCount( 1 ),
+	scale( 1.f ),
+	useKeyValueCache( false ),
+	maxCacheLength( 0 )
+{
+}
+
+void CScaledDotProductAttentionLayer::SetHeadCount( int _headCount )
+{
+	NeoAssert( _headCount >= 1 );
+	if( headCount == _headCount ) {
+		return;
+	}
+
+	headCount = _headCount;
+	ForceReshape();
+}
+
+void CScaledDotProductAttentionLayer::SetScale( float _scale )
+{
+	scale = _scale;
+}
+
+void CScaledDotProductAttentionLayer::SetUseKeyValueCache( bool use )
+{
+	if( useKeyValueCache == use ) {
+		return;
+	}
+
+	useKeyValueCache = use;
+	ResetCache();
+	ForceReshape();
+}
+
+void CScaledDotProductAttentionLayer::SetMaxCacheLength( int length )
+{
+	NeoAssert( length >= 0 );
+	if( maxCacheLength == length ) {
+		return;
+	}
+
+	maxCacheLength = length;
+	ResetCache();
+	ForceReshape();
+}
+
+int CScaledDotProductAttentionLayer::GetCacheLength( int sequence ) const
+{
+	NeoAssert( sequence >= 0 );
+	return sequence < cache.Size() ? cache[sequence].Length : 0;
+}
+
+void CScaledDotProductAttentionLayer::ResetCache()
+{
+	for( int i = 0; i < cache.Size(); ++i ) {
+		ResetCache( i );
+	}
+}
+
+void CScaledDotProductAttentionLayer::ResetCache( int sequence )
+{
+	NeoAssert( sequence >= 0 );
+	if( sequence < cache.Size() ) {
+		cache[sequence] = CSequenceCache();
+	}
+}
+
+static const int ScaledDotProductAttentionLayerVersion = 0;
+
+void CScaledDotProductAttentionLayer::Serialize( CArchive& archive )
+{
+	archive.SerializeVersion( ScaledDotProductAttentionLayerVersion );
+	CBaseLayer::Serialize( archive );
+	archive.Serialize( headCount );
+	archive.Serialize( scale );
+}
+
+void CScaledDotProductAttentionLayer::Reshape()
+{
+	CheckInputs();
+	CheckArchitecture( inputDescs.Size() == 3 || inputDescs.Size() == 4, GetName(), "layer must have 3 or 4 inputs" );
+	CheckArchitecture( MathEngine().GetType() == MET_Cpu, GetName(), "layer is supported only on CPU" );
+
+	const CBlobDesc& q = inputDescs[I_Q];
+	const CBlobDesc& k = inputDescs[I_K];
+	const CBlobDesc& v = inputDescs[I_V];
+	for( int i = 0; i < inputDescs.Size(); ++i ) {
+		CheckArchitecture( inputDescs[i].GetDataType() == CT_Float, GetName(), "inputs must be float" );
+	}
+	CheckArchitecture( q.ObjectSize() % headCount == 0, GetName(), "object size must be a multiple of head count" );
+	CheckArchitecture( k.ObjectSize() == q.ObjectSize() && v.ObjectSize() == q.ObjectSize(), GetName(),
+		"Q, K and V object size mismatch" );
+	CheckArchitecture( k.BatchLength() * k.BatchWidth() == q.BatchLength() * q.BatchWidth(), GetName(),
+		"Q and K batch size mismatch" );
+	CheckArchitecture( v.ObjectCount() == k.ObjectCount() && v.ListSize() == k.ListSize(), GetName(),
+		"K and V size mismatch" );
+	if( useKeyValueCache ) {
+		CheckArchitecture( !IsBackwardPerformed(), GetName(), "key-value cache is supported only for inference" );
+		CheckArchitecture( inputDescs.Size() == 3, GetName(), "mask isn't supported with key-value cache" );
+		CheckArchitecture( k.ListSize() == q.ListSize(), GetName(),
+			"Q and K must contain the same number of new elements when key-value cache is used" );
+		CheckArchitecture( maxCacheLength == 0 || q.ListSize() <= maxCacheLength, GetName(),
+			"the number of new elements is greater than the maximum cache length" );
+		// The sequences that are not in the batch any more are evicted
+		cache.SetSize( q.BatchLength() * q.BatchWidth() );
+		for( int i = 0; i < cache.Size(); ++i ) {
+			if( cache[i].Keys != nullptr && cache[i].Keys->GetObjectSize() != q.ObjectSize() ) {
+				ResetCache( i );
+			}
+		}
+	} else if( inputDescs.Size() > I_Mask ) {
+		CheckArchitecture( inputDescs[I_Mask].ObjectCount() == 1, GetName(), "mask must contain one object" );
+		CheckArchitecture( inputDescs[I_Mask].ObjectSize() == q.ListSize() * k.ListSize(), GetName(),
+			"mask size must be equal to Q ListSize * K ListSize" );
+	}
+
+	outputDescs.SetSize( 1 );
+	outputDescs[0] = q;
+
+	logSumExp = nullptr;
+	if( IsBackwardPerformed() ) {
+		logSumExp = CDnnBlob::CreateVector( MathEngine(), CT_Float, q.ObjectCount() * headCount );
+		RegisterRuntimeBlob( logSumExp );
+	}
+}
+
+void CScaledDotProductAttentionLayer::RunOnce()
+{
+	if( useKeyValueCache ) {
+		runWithCache();
+		return;
+	}
+
+	const CDnnBlob& q = *inputBlobs[I_Q];
+	MathEngine().ScaledDotProductAttention( q.GetBatchLength() * q.GetBatchWidth(), headCount, q.GetListSize(),
+		inputBlobs[I_K]->GetListSize(), q.GetObjectSize() / headCount, scale, q.GetData(),
+		inputBlobs[I_K]->GetData(), inputBlobs[I_V]->GetData(), getMask(), AttentionMaskMultiplier,
+		logSumExp == nullptr ? CFloatHandle() : logSumExp->GetData(), outputBlobs[0]->GetData() );
+}
+
+void CScaledDotProductAttentionLayer::BackwardOnce()
+{
+	NeoAssert( logSumExp != nullptr );
+
+	const CDnnBlob& q = *inputBlobs[I_Q];
+	MathEngine().ScaledDotProductAttentionBackward( q.GetBatchLength() * q.GetBatchWidth(), headCount,
+		q.GetListSize(), inputBlobs[I_K]->GetListSize(), q.GetObjectSize() / headCount, scale, q.GetData(),
+		inputBlobs[I_K]->GetData(), inputBlobs[I_V]->GetData(), getMask(), AttentionMaskMultiplier,
+		logSumExp->GetData(), outputBlobs[0]->GetData(), outputDiffBlobs[0]->GetData(),
+		inputDiffBlobs[I_Q]->GetData(), inputDiffBlobs[I_K]->GetData(), inputDiffBlobs[I_V]->GetData() );
+	// The mask is not trained
+	if( inputDiffBlobs.Size() > I_Mask ) {
+		inputDiffBlobs[I_Mask]->Clear();
+	}
+}
+
+// The mask handle (null if there is no mask)
+CConstFloatHandle CScaledDotProductAttentionLayer::getMask() const
+{
+	return inputBlobs.Size() > I_Mask ? inputBlobs[I_Mask]->GetData() : CConstFloatHandle();
+}
+
+// Appends the new elements to the cache and calculates the attention for each sequence separately
+// as the cached sequences may have different lengths
+void CScaledDotProductAttentionLayer::runWithCache()
+{
+	const CDnnBlob& q = *inputBlobs[I_Q];
+	const int newLength = q.GetListSize();
+	const int objectSize = q.GetObjectSize();
+
+	CPtr<CDnnBlob> mask;
+	CArray<float> maskBuffer;
+	for( int i = 0; i < cache.Size(); ++i ) {
+		CSequenceCache& sequenceCache = cache[i];
+		appendToCache( sequenceCache, i );
+		const int keyLength = sequenceCache.Length;
+
+		// The new elements are the last in the cache; each of them doesn't see the next ones
+		if( newLength > 1 ) {
+			maskBuffer.SetSize( newLength * keyLength );
+			for( int row = 0; row < newLength; ++row ) {
+				const int position = keyLength - newLength + row;
+				for( int col = 0; col < keyLength; ++col ) {
+					maskBuffer[row * keyLength + col] = col > position ? 1.f : 0.f;
+				}
+			}
+			mask = CDnnBlob::CreateVector( MathEngine(), CT_Float, maskBuffer.Size() );
+			mask->CopyFrom( maskBuffer.GetPtr() );
+		}
+
+		const int offset = i * newLength * objectSize;
+		const int cacheOffset = sequenceCache.Start * objectSize;
+		MathEngine().ScaledDotProductAttention( 1, headCount, newLength, keyLength, objectSize / headCount, scale,
+			q.GetData() + offset, sequenceCache.Keys->GetData() + cacheOffset,
+			sequenceCache.Values->GetData() + cacheOffset, mask == nullptr ? CConstFloatHandle() : mask->GetData(),
+			AttentionMaskMultiplier, CFloatHandle(), outputBlobs[0]->GetData() + offset );
+	}
+}
+
+// Appends the new keys and values of the sequence to its cache
+// The cache has the space for twice the maximum length, so the evicted elements are just skipped
+// and the cached elements are moved only once in GetMaxCacheLength() runs
+void CScaledDotProductAttentionLayer::appendToCache( CSequenceCache& sequenceCache, int sequence )
+{
+	const int newLength = inputBlobs[I_K]->GetListSize();
+	const int objectSize = inputBlobs[I_K]->GetObjectSize();
+
+	if( maxCacheLength > 0 && sequenceCache.Length + newLength > maxCacheLength ) {
+		const int evictedLength = sequenceCache.Length + newLength - maxCacheLength;
+		sequenceCache.Start += evictedLength;
+		sequenceCache.Length -= evictedLength;
+	}
+
+	const int capacity = sequenceCache.Keys == nullptr ? 0 : sequenceCache.Keys->GetBatchWidth();
+	if( sequenceCache.Start + sequenceCache.Length + newLength > capacity ) {
+		int newCapacity = max( sequenceCache.Length + newLength, 2 * capacity );
+		if( maxCacheLength > 0 ) {
+			newCapacity = 2 * maxCacheLength;
+		}
+		if( capacity < newCapacity ) {
+			CPtr<CDnnBlob> keys = CDnnBlob::CreateDataBlob( MathEngine(), CT_Float, 1, newCapacity, objectSize );
+			CPtr<CDnnBlob> values = CDnnBlob::CreateDataBlob( MathEngine(), CT_Float, 1, newCapacity, objectSize );
+			if( sequenceCache.Length > 0 ) {
+				MathEngine().VectorCopy( keys->GetData(), sequenceCache.Keys->GetData() + sequenceCache.Start * objectSize,
+					sequenceCache.Length * objectSize );
+				MathEngine().VectorCopy( values->GetData(),
+					sequenceCache.Values->GetData() + sequenceCache.Start * objectSize, sequenceCache.Length * objectSize );
+			}
+			sequenceCache.Keys = keys;
+			sequenceCache.Values = values;
+		} else {
+			// The evicted elements take at least the half of the blobs, so the kept ones don't overlap their new place
+			NeoPresume( sequenceCache.Start >= sequenceCache.Length );
+			MathEngine().VectorCopy( sequenceCache.Keys->GetData(),
+				sequenceCache.Keys->GetData() + sequenceCache.Start * objectSize, sequenceCache.Length * objectSize );
+			MathEngine().VectorCopy( sequenceCache.Values->GetData(),
+				sequenceCache.Values->GetData() + sequenceCache.Start * objectSize, sequenceCache.Length * objectSize );
+		}
+		sequenceCache.Start = 0;
+	}
+
+	const int end = ( sequenceCache.Start + sequenceCache.Length ) * objectSize;
+	const int offset = sequence * newLength * objectSize;
+	MathEngine().VectorCopy( sequenceCache.Keys->GetData() + end, inputBlobs[I_K]->GetData() + offset,
+		newLength * objectSize );
+	MathEngine().VectorCopy( sequenceCache.Values->GetData() + end, inputBlobs[I_V]->GetData() + offset,
+		newLength * objectSize );
+	sequenceCache.Length += newLength;
+}
+
+CLayerWrapper<CScaledDotProductAttentionLayer> ScaledDotProductAttention( int headCount, float scale )
+{
+	return CLayerWrapper<CScaledDotProductAttentionLayer>( "ScaledDotProductAttention",
+		[=]( CScaledDotProductAttentionLayer* result ) {
+			result->SetHeadCount( headCount );
+			result->SetScale( scale );
+		} );
+}
+
+} // namespace NeoML
@@ -158,6 +158,12 @@ void CTransformerEncoderLayer::SetActivation( TActivationFunction newFunction )
 	NeoPresume( HasLayer( activationName ) );
 }
 
+void CTransformerEncoderLayer::SetUseKeyValueCache( bool use )
+{
+	selfAttention->SetUseKeyValueCache( use );
+	ForceReshape();
+}
+
 void CTransformerEncoderLayer::Reshape()
 {
 	CheckArchitecture( GetHiddenSize() % GetHeadCount() == 0, GetName(), "HiddenSize must be a multiple of HeadCount" );
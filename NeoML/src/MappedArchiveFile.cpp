@@ -0,0 +1,256 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <common.h>
+#pragma hdrstop
+
+#include <NeoML/NeoMLDefs.h>
+#include <NeoML/MappedArchiveFile.h>
+
+#if FINE_PLATFORM( FINE_WINDOWS )
+#include <Windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace NeoML {
+
+static inline void throwMappedFileException( int errorCode, const CString& fileName )
+{
+#ifdef NEOML_USE_FINEOBJ
+	ThrowFileException( errorCode, fileName.CreateUnicodeString( CP_UTF8 ) );
+#else
+	ThrowFileException( errorCode, fileName );
+#endif
+}
+
+// Checks a condition and generates an exception with the last system error if it is not fulfilled
+static inline void checkMappedFileError( bool condition, const CString& fileName )
+{
+	if( !condition ) {
+#if FINE_PLATFORM( FINE_WINDOWS )
+		throwMappedFileException( static_cast<int>( ::GetLastError() ), fileName );
+#else
+		throwMappedFileException( errno, fileName );
+#endif
+	}
+}
+
+// The private (copy-on-write) mapping of the whole file
+class CFileMapping : public IObject {
+public:
+	explicit CFileMapping( const CString& fileName );
+
+	char* GetData() const { return data; }
+	__int64 GetLength() const { return length; }
+
+protected:
+	~CFileMapping() override;
+
+private:
+	char* data;
+	__int64 length;
+};
+
+#if FINE_PLATFORM( FINE_WINDOWS )
+
+CFileMapping::CFileMapping( const CString& fileName ) :
+	data( nullptr ),
+	length( 0 )
+{
+	HANDLE file = ::CreateFileA( fileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL, nullptr );
+	checkMappedFileError( file != INVALID_HANDLE_VALUE, fileName );
+
+	LARGE_INTEGER fileSize;
+	if( !::GetFileSizeEx( file, &fileSize ) ) {
+		const DWORD error = ::GetLastError();
+		::CloseHandle( file );
+		throwMappedFileException( static_cast<int>( error ), fileName );
+	}
+	length = fileSize.QuadPart;
+	if( length == 0 ) {
+		// An empty file can't be mapped
+		::CloseHandle( file );
+		return;
+	}
+
+	// The view keeps the mapping alive, so both handles may be closed right away
+	HANDLE mapping = ::CreateFileMappingA( file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr );
+	const DWORD mappingError = ::GetLastError();
+	::CloseHandle( file );
+	if( mapping == nullptr ) {
+		throwMappedFileException( static_cast<int>( mappingError ), fileName );
+	}
+	data = static_cast<char*>( ::MapViewOfFile( mapping, FILE_MAP_COPY, 0, 0, 0 ) );
+	const DWORD viewError = ::GetLastError();
+	::CloseHandle( mapping );
+	if( data == nullptr ) {
+		throwMappedFileException( static_cast<int>( viewError ), fileName );
+	}
+}
+
+CFileMapping::~CFileMapping()
+{
+	if( data != nullptr ) {
+		::UnmapViewOfFile( data );
+	}
+}
+
+#else
+
+CFileMapping::CFileMapping( const CString& fileName ) :
+	data( nullptr ),
+	length( 0 )
+{
+	const int file = ::open( fileName, O_RDONLY );
+	checkMappedFileError( file != -1, fileName );
+
+	struct stat fileStat;
+	if( ::fstat( file, &fileStat ) != 0 ) {
+		const int error = errno;
+		::close( file );
+		throwMappedFileException( error, fileName );
+	}
+	length = static_cast<__int64>( fileStat.st_size );
+	if( length == 0 ) {
+		// An empty file can't be mapped
+		::close( file );
+		return;
+	}
+
+	// The mapping stays valid after the descriptor is closed
+	void* ptr = ::mmap( nullptr, static_cast<size_t>( length ), PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0 );
+	const int error = errno;
+	::close( file );
+	if( ptr == MAP_FAILED ) {
+		throwMappedFileException( error, fileName );
+	}
+	data = static_cast<char*>( ptr );
+}
+
+CFileMapping::~CFileMapping()
+{
+	if( data != nullptr ) {
+		::munmap( data, static_cast<size_t>( length ) );
+	}
+}
+
+#endif
+
+//------------------------------------------------------------------------------------------------------------
+
+CMappedArchiveFile::CMappedArchiveFile( const char* fileName ) :
+	data( nullptr ),
+	length( 0 ),
+	position( 0 )
+{
+	Open( fileName );
+}
+
+void CMappedArchiveFile::Open( const char* _fileName )
+{
+	NeoAssert( !IsOpen() );
+	CPtr<CFileMapping> fileMapping = FINE_DEBUG_NEW CFileMapping( _fileName );
+	mapping = fileMapping.Ptr();
+	data = fileMapping->GetData();
+	length = fileMapping->GetLength();
+	position = 0;
+	fileName = _fileName;
+}
+
+int CMappedArchiveFile::Read( void* buffer, int bytesCount )
+{
+	NeoAssert( IsOpen() );
+	NeoAssert( bytesCount >= 0 );
+	const int bytesRead = static_cast<int>( min( static_cast<__int64>( bytesCount ), length - position ) );
+	if( bytesRead > 0 ) {
+		::memcpy( buffer, data + position, bytesRead );
+		position += bytesRead;
+	}
+	return bytesRead;
+}
+
+void CMappedArchiveFile::Write( const void*, int )
+{
+	// The file is read-only
+	NeoAssert( false );
+}
+
+__int64 CMappedArchiveFile::GetPosition() const
+{
+	NeoAssert( IsOpen() );
+	return position;
+}
+
+__int64 CMappedArchiveFile::Seek( __int64 offset, TSeekPosition from )
+{
+	NeoAssert( IsOpen() );
+	__int64 newPosition = 0;
+	switch( from ) {
+		case begin:
+			newPosition = offset;
+			break;
+		case current:
+			newPosition = position + offset;
+			break;
+		case end:
+			newPosition = length + offset;
+			break;
+		default:
+			NeoAssert( false );
+	}
+	NeoAssert( 0 <= newPosition && newPosition <= length );
+	position = newPosition;
+	return position;
+}
+
+void CMappedArchiveFile::SetLength( __int64 )
+{
+	// The file is read-only
+	NeoAssert( false );
+}
+
+__int64 CMappedArchiveFile::GetLength() const
+{
+	NeoAssert( IsOpen() );
+	return length;
+}
+
+void CMappedArchiveFile::Abort()
+{
+	// The blobs loaded from the file may still use the mapping
+	mapping = nullptr;
+	data = nullptr;
+	length = 0;
+	position = 0;
+	fileName = CString();
+}
+
+void CMappedArchiveFile::Flush()
+{
+	NeoAssert( IsOpen() );
+}
+
+void CMappedArchiveFile::Close()
+{
+	Abort();
+}
+
+} // namespace NeoML
@@ -22,6 +22,8 @@ limitations under the License.
 #include <DecisionTreeNodeBase.h>
 #include <DecisionTreeClassificationModel.h>
 #include <DecisionTreeNodeClassificationStatistic.h>
+#include <DecisionTreeFastHistProblem.h>
+#include <NeoMathEngine/OpenMP.h>
 #include <float.h>
 
 namespace NeoML {
@@ -51,6 +53,9 @@ CDecisionTree::CDecisionTree( const CParams& _params, CRandom* _random ) :
 	NeoAssert( params.MaxTreeDepth > 0 );
 	NeoAssert( params.MaxNodesCount > 1 );
 	NeoAssert( 0.00 <= params.ConstNodeThreshold && params.ConstNodeThreshold <= 1.0 );
+	NeoAssert( params.ThreadCount > 0 );
+	NeoAssert( 0 <= params.TreeBuilder && params.TreeBuilder < TB_Count );
+	NeoAssert( params.MaxBins > 1 );
 }
 
 CDecisionTree::~CDecisionTree()
@@ -69,14 +74,35 @@ CPtr<IModel> CDecisionTree::Train( const IProblem& problem )
 		return COneVersusOne( *this ).Train( problem );
 	}
 
+	sample.SetBufferSize( problem.GetVectorCount() );
+	for( int i = 0; i < problem.GetVectorCount(); i++ ) {
+		sample.Add( i );
+	}
+	return trainOnSample( problem, nullptr );
+}
+
+// Trains the tree on the vectors from the sample array
+// histProblem is the histogram data built from the same problem; if it is null, the data will be built if needed
+CPtr<IModel> CDecisionTree::trainOnSample( const IProblem& problem, const CDecisionTreeFastHistProblem* histProblem )
+{
+	NeoAssert( !sample.IsEmpty() );
+	NeoAssert( histProblem == nullptr || params.TreeBuilder == TB_FastHist );
+
 	classificationProblem = &problem;
+	if( histProblem != nullptr ) {
+		fastHistProblem = histProblem;
+	} else if( params.TreeBuilder == TB_FastHist ) {
+		fastHistProblem = FINE_DEBUG_NEW CDecisionTreeFastHistProblem( params.ThreadCount, params.MaxBins, problem );
+	}
 	CPtr<CDecisionTreeClassificationModel> root =
-		dynamic_cast<CDecisionTreeClassificationModel*>( buildTree( problem.GetVectorCount() ).Ptr() );
+		dynamic_cast<CDecisionTreeClassificationModel*>( buildTree().Ptr() );
+	fastHistProblem.Release();
+	sample.FreeBuffer();
 
 	return root.Ptr();
 }
 
-CPtr<CDecisionTreeNodeBase> CDecisionTree::buildTree( int vectorCount )
+CPtr<CDecisionTreeNodeBase> CDecisionTree::buildTree()
 {
 	if( logStream != 0 ) {
 		*logStream << "\nDecision tree training started:\n";
@@ -86,30 +112,32 @@ CPtr<CDecisionTreeNodeBase> CDecisionTree::buildTree( int vectorCount )
 	// Based on this data, decide what size cache we will need and can afford
 	CPtr<CDecisionTreeNodeBase> root = createNode();
 	nodesCount = 1;
-	CDecisionTreeNodeStatisticBase* rootStatistic = createStatistic( root );
 	CFloatMatrixDesc matrix = classificationProblem->GetMatrix();
 
-	CFloatVectorDesc desc;
-	for( int i = 0; i < vectorCount; i++ ) {
-		matrix.GetRow( i, desc );
-		rootStatistic->AddVector( i, desc );
-	}
-	rootStatistic->Finish();
+	statisticsCache.DeleteAll();
+	statisticsCache.Add( createStatistic( root ) );
+	CArray<int> statisticPos;
+	statisticPos.Add( 0 );
+	statisticPos.Add( sample.Size() );
+	fillStatistics( matrix, sample, statisticPos );
 
 	classifyNodesCache.Empty();
 	classifyNodesLevel.Empty();
-	const int classifyNodesCacheSize = min( MaxClassifyNodesCacheSize, vectorCount );
+	const int classifyNodesCacheSize = min( MaxClassifyNodesCacheSize, sample.Size() );
 	classifyNodesCache.Add( root, classifyNodesCacheSize );
 	classifyNodesLevel.Add( 0, classifyNodesCacheSize );
 
-	statisticsCacheSize = static_cast<int>( params.AvailableMemory / rootStatistic->GetSize() );
+	// The histogram data is kept during the whole training so it takes a part of the memory limit
+	const size_t histSize = fastHistProblem != nullptr ? fastHistProblem->GetSize() : 0;
+	NeoAssert( histSize < params.AvailableMemory );
+	statisticsCacheSize = static_cast<int>( ( params.AvailableMemory - histSize ) / statisticsCache[0]->GetSize() );
 	NeoAssert( statisticsCacheSize > 0 ); // we need at least the amount of memory sufficient for one node statistics
+
+	splitNodes( 0 );
+	statisticsCache.DeleteAll();
 	statisticsCache.FreeBuffer();
 	statisticsCache.SetBufferSize( statisticsCacheSize );
 
-	split( *rootStatistic, 0 );
-	delete rootStatistic;
-
 	// Build the tree level by level
 	for( int i = 1; i <= params.MaxTreeDepth; i++ ) {
 		if( !buildTreeLevel( matrix, i, *root ) ) {
@@ -160,10 +188,8 @@ bool CDecisionTree::buildTreeLevel( const CFloatMatrixDesc& matrix, int level, C
 		}
 
 		// Split according to the statistics just gathered
-		for( int i = 0; i < statisticsCache.Size(); i++ ) {
-			if( split( *statisticsCache[i], level ) ) {
-				result = true;
-			}
+		if( splitNodes( level ) ) {
+			result = true;
 		}
 
 		step++;
@@ -177,15 +203,16 @@ bool CDecisionTree::collectStatistics( const CFloatMatrixDesc& matrix, int level
 {
 	NeoAssert( level > 0 );
 	NeoAssert( root != 0 );
-	CMap<CDecisionTreeNodeBase*, int> nodesStatistics;
-
-	bool result = true;
-	const int matrixHeight = matrix.Height;
-
-	for( int i = 0; i < matrixHeight; i++ ) {
+	const int sampleSize = sample.Size();
+
+	// Find the leaf node for each vector of the sample in the current tree
+	CArray<CDecisionTreeNodeBase*> leaves;
+	leaves.SetSize( sampleSize );
+	const int curThreadCount = IsOmpRelevant( sampleSize ) ? params.ThreadCount : 1;
+	NEOML_OMP_FOR_NUM_THREADS( curThreadCount )
+	for( int i = 0; i < sampleSize; i++ ) {
 		CFloatVectorDesc vector;
-		matrix.GetRow( i, vector );
-		// Find the leaf node for this vector in the current tree
+		matrix.GetRow( sample[i], vector );
 		CPtr<CDecisionTreeNodeBase> leaf;
 		int leafLevel = 0;
 		if( i < MaxClassifyNodesCacheSize ) {
@@ -196,13 +223,23 @@ bool CDecisionTree::collectStatistics( const CFloatMatrixDesc& matrix, int level
 		} else {
 			root->GetClassifyNode( vector, leaf, leafLevel );
 		}
+		// Skip the node if it belongs to another level or was already processed on the current level
+		leaves[i] = ( leafLevel == level && leaf->GetType() == DTNT_Undefined ) ? leaf.Ptr() : nullptr;
+	}
+
+	// Create the statistics objects in the order of the vectors
+	CMap<CDecisionTreeNodeBase*, int> nodesStatistics;
+	CArray<int> vectorStatistic;
+	vectorStatistic.Add( NotFound, sampleSize );
+	CArray<int> statisticPos; // the number of vectors for each statistics object
+	bool result = true;
 
-		if( leafLevel != level || leaf->GetType() != DTNT_Undefined ) {
-			// This node belongs to another level or was already processed on the current level
+	for( int i = 0; i < sampleSize; i++ ) {
+		if( leaves[i] == nullptr ) {
 			continue;
 		}
 
-		TMapPosition pos = nodesStatistics.GetFirstPosition( leaf );
+		TMapPosition pos = nodesStatistics.GetFirstPosition( leaves[i] );
 		int nodeStatisticIndex = NotFound;
 		if( pos == NotFound ) {
 			const int curStatisticsCashSize = nodesStatistics.Size();
@@ -213,25 +250,144 @@ bool CDecisionTree::collectStatistics( const CFloatMatrixDesc& matrix, int level
 				continue;
 			}
 			nodeStatisticIndex = curStatisticsCashSize;
-			statisticsCache.Add( createStatistic( leaf ) );
-			nodesStatistics.Add( leaf, nodeStatisticIndex );
+			statisticsCache.Add( createStatistic( leaves[i] ) );
+			nodesStatistics.Add( leaves[i], nodeStatisticIndex );
+			statisticPos.Add( 0 );
 		} else {
 			nodeStatisticIndex = nodesStatistics.GetValue( pos );
 		}
+		vectorStatistic[i] = nodeStatisticIndex;
+		statisticPos[nodeStatisticIndex]++;
+	}
+	leaves.FreeBuffer();
+
+	// Group the vectors by statistics objects keeping their order
+	int vectorCount = 0;
+	for( int i = 0; i < statisticPos.Size(); i++ ) {
+		const int count = statisticPos[i];
+		statisticPos[i] = vectorCount;
+		vectorCount += count;
+	}
+	statisticPos.Add( vectorCount );
+
+	CArray<int> vectors;
+	vectors.SetSize( vectorCount );
+	CArray<int> nextVector;
+	statisticPos.CopyTo( nextVector );
+	for( int i = 0; i < sampleSize; i++ ) {
+		if( vectorStatistic[i] != NotFound ) {
+			vectors[nextVector[vectorStatistic[i]]++] = sample[i];
+		}
+	}
+
+	fillStatistics( matrix, vectors, statisticPos );
+	return result;
+}
+
+// Adds the vectors to the statistics objects in the cache and finishes accumulating
+// The vectors of the i-th object are in the [statisticPos[i], statisticPos[i + 1]) range of the vectors array
+void CDecisionTree::fillStatistics( const CFloatMatrixDesc& matrix, const CArray<int>& vectors,
+	const CArray<int>& statisticPos ) const
+{
+	const int statisticCount = statisticsCache.Size();
+	NeoAssert( statisticPos.Size() == statisticCount + 1 );
+
+	if( statisticCount >= params.ThreadCount ) {
+		// Each node is processed by one thread
+		const int curThreadCount = IsOmpRelevant( statisticCount, vectors.Size() ) ? params.ThreadCount : 1;
+		NEOML_OMP_FOR_NUM_THREADS( curThreadCount )
+		for( int i = 0; i < statisticCount; i++ ) {
+			CFloatVectorDesc vector;
+			for( int j = statisticPos[i]; j < statisticPos[i + 1]; j++ ) {
+				matrix.GetRow( vectors[j], vector );
+				statisticsCache[i]->AddVector( vectors[j], vector );
+			}
+			statisticsCache[i]->Finish();
+		}
+		return;
+	}
+
+	// There are too few nodes, so the features of each node are divided between the threads
+	for( int i = 0; i < statisticCount; i++ ) {
+		CDecisionTreeNodeStatisticBase& statistic = *statisticsCache[i];
+		for( int j = statisticPos[i]; j < statisticPos[i + 1]; j++ ) {
+			statistic.AddVectorToTotal( vectors[j] );
+		}
 
-		statisticsCache[nodeStatisticIndex]->AddVector( i, vector );
+		const int featureCount = statistic.GetUsedFeatureCount();
+		const int64_t operationCount = static_cast<int64_t>( statisticPos[i + 1] - statisticPos[i] ) * featureCount;
+		const int curThreadCount = IsOmpRelevant( featureCount, operationCount ) ? params.ThreadCount : 1;
+		NEOML_OMP_NUM_THREADS( curThreadCount )
+		{
+			int begin = 0;
+			int count = 0;
+			if( OmpGetTaskIndexAndCount( featureCount, begin, count ) ) {
+				CFloatVectorDesc vector;
+				for( int j = statisticPos[i]; j < statisticPos[i + 1]; j++ ) {
+					matrix.GetRow( vectors[j], vector );
+					statistic.AddVectorFeatures( vectors[j], vector, begin, begin + count );
+				}
+				statistic.FinishFeatures( begin, begin + count );
+			}
+		}
 	}
+}
+
+// Checks if a constant node should be created without looking for a split
+static bool isConstNode( const CDecisionTree::CParams& params, const CArray<double>& predictions,
+	double maxProbability, int vectorsCount )
+{
+	// Too similar or too small sets are not split
+	return ( predictions.Size() > 1 && maxProbability >= params.ConstNodeThreshold )
+		|| vectorsCount < params.MinSplitSize;
+}
 
-	for( int i = 0; i < statisticsCache.Size(); i++ ) {
-		statisticsCache[i]->Finish();
+// Splits all the nodes which statistics are in the cache
+// Returns true if new nodes were created when splitting
+bool CDecisionTree::splitNodes( int level ) const
+{
+	const int statisticCount = statisticsCache.Size();
+
+	// The best splits are searched in parallel over the nodes
+	// If there is only one node, the search is parallel over its features
+	const int curThreadCount = IsOmpRelevant( statisticCount ) ? params.ThreadCount : 1;
+	CParams splitParams = params;
+	if( curThreadCount > 1 ) {
+		splitParams.ThreadCount = 1;
+	}
+
+	CPointerArray<CDecisionTreeSplit> splits;
+	splits.SetBufferSize( statisticCount );
+	for( int i = 0; i < statisticCount; i++ ) {
+		splits.Add( FINE_DEBUG_NEW CDecisionTreeSplit() );
+	}
+	NEOML_OMP_FOR_NUM_THREADS( curThreadCount )
+	for( int i = 0; i < statisticCount; i++ ) {
+		const CDecisionTreeNodeStatisticBase& nodeStatistics = *statisticsCache[i];
+		CArray<double> predictions;
+		const double maxProbability = nodeStatistics.GetPredictions( predictions );
+		if( level < params.MaxTreeDepth
+			&& !isConstNode( params, predictions, maxProbability, nodeStatistics.GetVectorsCount() ) )
+		{
+			CDecisionTreeSplit& split = *splits[i];
+			split.IsFound = nodeStatistics.GetSplit( splitParams, split.IsDiscrete, split.FeatureIndex,
+				split.Values, split.CriterionValue );
+		}
 	}
 
+	// The splits are applied in the nodes order because the number of nodes is limited
+	bool result = false;
+	for( int i = 0; i < statisticCount; i++ ) {
+		if( split( *statisticsCache[i], *splits[i], level ) ) {
+			result = true;
+		}
+	}
 	return result;
 }
 
-// Splits the specified node according to the accumulated statistics
+// Splits the specified node according to the accumulated statistics and the best split found for them
 // Returns true if new nodes were created when splitting
-bool CDecisionTree::split( const CDecisionTreeNodeStatisticBase& nodeStatistics, int level ) const
+bool CDecisionTree::split( const CDecisionTreeNodeStatisticBase& nodeStatistics, CDecisionTreeSplit& bestSplit, int level ) const
 {
 	CDecisionTreeNodeBase& node = nodeStatistics.GetNode();
 	CArray<double> predictions;
@@ -245,9 +401,7 @@ bool CDecisionTree::split( const CDecisionTreeNodeStatisticBase& nodeStatistics,
 	}
 
 	// Create a constant node for too similar or too small sets
-	if( ( predictions.Size() > 1 && maxProbability >= params.ConstNodeThreshold )
-		|| nodeStatistics.GetVectorsCount() < params.MinSplitSize )
-	{
+	if( isConstNode( params, predictions, maxProbability, nodeStatistics.GetVectorsCount() ) ) {
 		if( logStream != 0 ) {
 			*logStream << "Split result: created const node.\n";
 		}
@@ -258,38 +412,34 @@ bool CDecisionTree::split( const CDecisionTreeNodeStatisticBase& nodeStatistics,
 		return false;
 	}
 
-	bool isBestFeatureDiscrete = false;
-	int bestFeature = NotFound;
-	CArray<double> bestSplitValues;
-	double bestCriterionValue = DBL_MAX;
-
-	if( nodeStatistics.GetSplit( params, isBestFeatureDiscrete, bestFeature, bestSplitValues, bestCriterionValue )
-		&& nodesCount + bestSplitValues.Size() <= params.MaxNodesCount
+	if( bestSplit.IsFound
+		&& nodesCount + bestSplit.Values.Size() <= params.MaxNodesCount
 		&& level < params.MaxTreeDepth )
 	{
 		// The new node is NOT a leaf
 
 		if( logStream != 0 ) {
-			*logStream << "Split result: splited by feature: " << bestFeature << " value = " << bestCriterionValue << "\n";
+			*logStream << "Split result: splited by feature: " << bestSplit.FeatureIndex
+				<< " value = " << bestSplit.CriterionValue << "\n";
 		}
 
-		nodesCount += bestSplitValues.Size();
+		nodesCount += bestSplit.Values.Size();
 
-		if( isBestFeatureDiscrete ) {
+		if( bestSplit.IsDiscrete ) {
 			CDecisionTreeDiscreteNodeInfo* info = FINE_DEBUG_NEW CDecisionTreeDiscreteNodeInfo();
 			node.SetInfo( info );
-			info->FeatureIndex = bestFeature;
-			bestSplitValues.MoveTo( info->Values );
+			info->FeatureIndex = bestSplit.FeatureIndex;
+			bestSplit.Values.MoveTo( info->Values );
 			predictions.MoveTo( info->Predictions );
-			info->Children.SetBufferSize( bestSplitValues.Size() );
+			info->Children.SetBufferSize( info->Values.Size() );
 			for( int i = 0; i < info->Values.Size(); i++ ) {
 				info->Children.Add( createNode() );
 			}
 		} else {
 			CDecisionTreeContinuousNodeInfo* info = FINE_DEBUG_NEW CDecisionTreeContinuousNodeInfo();
 			node.SetInfo( info );
-			info->FeatureIndex = bestFeature;
-			info->Threshold = bestSplitValues.First();
+			info->FeatureIndex = bestSplit.FeatureIndex;
+			info->Threshold = bestSplit.Values.First();
 			info->Child1 = createNode();
 			info->Child2 = createNode();
 		}
@@ -341,6 +491,9 @@ CDecisionTreeNodeStatisticBase* CDecisionTree::createStatistic( CDecisionTreeNod
 {
 	CArray<int> features;
 	generateUsedFeatures( params.RandomSelectedFeaturesCount, classificationProblem->GetFeatureCount(), features );
+	if( fastHistProblem != nullptr ) {
+		return FINE_DEBUG_NEW CClassificationHistStatistics( node, *classificationProblem, *fastHistProblem, features );
+	}
 	return FINE_DEBUG_NEW CClassificationStatistics( node, *classificationProblem, features );
 }
 
@@ -0,0 +1,206 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <common.h>
+#pragma hdrstop
+
+#include <DecisionTreeFastHistProblem.h>
+#include <NeoMathEngine/OpenMP.h>
+
+namespace NeoML {
+
+CDecisionTreeFastHistProblem::CDecisionTreeFastHistProblem( int threadCount, int maxBins, const IProblem& problem )
+{
+	NeoAssert( threadCount > 0 );
+	NeoAssert( maxBins > 1 ); // otherwise there can be no split
+
+	CFloatMatrixDesc matrix = problem.GetMatrix();
+	NeoAssert( matrix.Height == problem.GetVectorCount() );
+	NeoAssert( matrix.Width == problem.GetFeatureCount() );
+
+	initializeFeatureInfo( threadCount, maxBins, matrix, problem );
+	buildVectorData( threadCount, matrix );
+}
+
+size_t CDecisionTreeFastHistProblem::GetSize() const
+{
+	return sizeof( CDecisionTreeFastHistProblem )
+		+ ( featurePos.BufferSize() + featureIndexes.BufferSize() + nullValueIds.BufferSize()
+			+ vectorData.BufferSize() + vectorPtr.BufferSize() ) * sizeof( int )
+		+ ( binLow.BufferSize() + binHigh.BufferSize() ) * sizeof( float );
+}
+
+// Initializes the histogram bins for all features
+void CDecisionTreeFastHistProblem::initializeFeatureInfo( int threadCount, int maxBins, const CFloatMatrixDesc& matrix,
+	const IProblem& problem )
+{
+	const int vectorCount = problem.GetVectorCount();
+	const int featureCount = problem.GetFeatureCount();
+
+	CArray< CArray<CFeatureValue> > featureValues; // the values of all features
+	featureValues.SetSize( featureCount );
+
+	CArray<double> featureWeights; // total weight of all vectors for which the current feature is not 0
+	featureWeights.Add( 0.0, featureCount );
+	double totalWeight = 0.0; // total weight of all vectors
+
+	// Adding the non-zero values
+	for( int i = 0; i < vectorCount; i++ ) {
+		CFloatVectorDesc vector;
+		matrix.GetRow( i, vector );
+		const double vectorWeight = problem.GetVectorWeight( i );
+
+		for( int j = 0; j < vector.Size; j++ ) {
+			if( vector.Values[j] != 0.0 ) {
+				const int index = vector.Indexes == nullptr ? j : vector.Indexes[j];
+				if( featureValues[index].IsEmpty()
+					|| featureValues[index].Last().Value != vector.Values[j] )
+				{
+					CFeatureValue newValue;
+					newValue.Value = vector.Values[j];
+					newValue.Weight = vectorWeight;
+					featureValues[index].Add( newValue );
+				} else {
+					featureValues[index].Last().Weight += vectorWeight;
+				}
+				featureWeights[index] += vectorWeight;
+			}
+		}
+		totalWeight += vectorWeight;
+	}
+
+	// Adding the zero values
+	for( int i = 0; i < featureCount; i++ ) {
+		CFeatureValue newValue;
+		newValue.Value = 0;
+		newValue.Weight = totalWeight - featureWeights[i];
+		featureValues[i].Add( newValue );
+	}
+
+	// Sorting, merging the same values and grouping them into bins
+	CArray< CArray<int> > binBegins;
+	binBegins.SetSize( featureCount );
+	NEOML_OMP_FOR_NUM_THREADS( threadCount )
+	for( int i = 0; i < featureCount; i++ ) {
+		CArray<CFeatureValue>& values = featureValues[i];
+		values.QuickSort< AscendingByMember<CFeatureValue, float, &CFeatureValue::Value> >();
+		int size = 1;
+		for( int j = 1; j < values.Size(); j++ ) {
+			if( values[j].Value == values[size - 1].Value ) {
+				values[size - 1].Weight += values[j].Weight;
+			} else {
+				size++;
+				values[size - 1] = values[j];
+			}
+		}
+		values.SetSize( size );
+		// The discrete features are split by their exact values so they are never compressed
+		buildFeatureBins( problem.IsDiscreteFeature( i ) ? NotFound : maxBins, totalWeight, values, binBegins[i] );
+	}
+
+	// Initializing the internal arrays
+	nullValueIds.Add( NotFound, featureCount );
+	featurePos.SetBufferSize( featureCount + 1 );
+	int curPos = 0;
+	for( int i = 0; i < featureCount; i++ ) {
+		const CArray<CFeatureValue>& values = featureValues[i];
+		const CArray<int>& begins = binBegins[i];
+		featurePos.Add( curPos );
+		featureIndexes.Add( i, begins.Size() );
+		curPos += begins.Size();
+
+		for( int j = 0; j < begins.Size(); j++ ) {
+			const int end = j + 1 == begins.Size() ? values.Size() : begins[j + 1];
+			binLow.Add( values[begins[j]].Value );
+			binHigh.Add( values[end - 1].Value );
+			if( nullValueIds[i] == NotFound && binLow.Last() <= 0 && 0 <= binHigh.Last() ) {
+				nullValueIds[i] = binHigh.Size() - 1;
+			}
+		}
+		NeoAssert( nullValueIds[i] != NotFound );
+	}
+	featurePos.Add( curPos );
+}
+
+// Groups the sorted feature values into bins of similar weight; no more than maxBins bins are created
+// maxBins == NotFound means that each value gets its own bin
+void CDecisionTreeFastHistProblem::buildFeatureBins( int maxBins, double totalWeight,
+	CArray<CFeatureValue>& values, CArray<int>& binBegins )
+{
+	binBegins.Empty();
+	if( maxBins == NotFound || values.Size() <= maxBins ) {
+		binBegins.SetBufferSize( values.Size() );
+		for( int i = 0; i < values.Size(); i++ ) {
+			binBegins.Add( i );
+		}
+		return;
+	}
+
+	const double maxBinWeight = totalWeight / maxBins;
+	double sumWeight = 0;
+	binBegins.Add( 0 );
+	for( int i = 1; i < values.Size() && binBegins.Size() < maxBins; i++ ) {
+		sumWeight += values[i - 1].Weight;
+		if( sumWeight >= binBegins.Size() * maxBinWeight ) {
+			binBegins.Add( i );
+		}
+	}
+}
+
+// Builds an array with vector data
+void CDecisionTreeFastHistProblem::buildVectorData( int threadCount, const CFloatMatrixDesc& matrix )
+{
+	const int vectorCount = matrix.Height;
+
+	vectorPtr.SetBufferSize( vectorCount + 1 );
+	int curVectorPtr = 0;
+	for( int i = 0; i < vectorCount; i++ ) {
+		vectorPtr.Add( curVectorPtr );
+		CFloatVectorDesc vector;
+		matrix.GetRow( i, vector );
+		for( int j = 0; j < vector.Size; j++ ) {
+			if( vector.Values[j] != 0.0 ) {
+				++curVectorPtr;
+			}
+		}
+	}
+	vectorPtr.Add( curVectorPtr );
+	vectorData.SetSize( curVectorPtr );
+
+	// Each vector has its own place in the data, so they may be processed in parallel
+	const int curThreadCount = IsOmpRelevant( vectorCount, curVectorPtr ) ? threadCount : 1;
+	NEOML_OMP_FOR_NUM_THREADS( curThreadCount )
+	for( int i = 0; i < vectorCount; i++ ) {
+		CFloatVectorDesc vector;
+		matrix.GetRow( i, vector );
+		int* data = vectorData.GetPtr() + vectorPtr[i];
+		for( int j = 0; j < vector.Size; j++ ) {
+			if( vector.Values[j] != 0.0 ) {
+				const int index = vector.Indexes == nullptr ? j : vector.Indexes[j];
+				const float* highPtr = binHigh.GetPtr() + featurePos[index]; // the upper bounds of this feature bins
+				const int binCount = featurePos[index + 1] - featurePos[index];
+				// Now we get the bin into which the current value falls
+				int pos = FindInsertionPoint<float, Ascending<float>, float>( vector.Values[j], highPtr, binCount );
+				if( pos > 0 && *( highPtr + pos - 1 ) == vector.Values[j] ) {
+					pos--;
+				}
+				NeoPresume( pos < binCount );
+				*data++ = featurePos[index] + pos;
+			}
+		}
+	}
+}
+
+} // namespace NeoML
@@ -0,0 +1,75 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <NeoML/TraditionalML/Problem.h>
+
+namespace NeoML {
+
+// The problem data for building a decision tree with the histogram builder
+// The non-zero values of each vector are replaced by unique integer identifiers
+// The identifier is the number of the histogram bin to which the feature value corresponds
+class CDecisionTreeFastHistProblem : public IObject {
+public:
+	// Builds the histograms from the given data
+	// Continuous features get no more than maxBins bins, discrete features keep a bin for each value
+	CDecisionTreeFastHistProblem( int threadCount, int maxBins, const IProblem& problem );
+
+	// Gets the pointer to the identifiers of the vector non-zero values
+	const int* GetVectorDataPtr( int index ) const { return vectorData.GetPtr() + vectorPtr[index]; }
+	// Gets the number of the vector non-zero values
+	int GetVectorDataSize( int index ) const { return vectorPtr[index + 1] - vectorPtr[index]; }
+
+	// Gets the number of features
+	int GetFeatureCount() const { return nullValueIds.Size(); }
+	// Gets the array of identifier beginnings for each feature
+	const CArray<int>& GetFeaturePos() const { return featurePos; }
+	// Gets the indices of the features from which the given identifier was obtained
+	const CArray<int>& GetFeatureIndexes() const { return featureIndexes; }
+	// Gets the smallest and the largest feature value that fall into each bin
+	const CArray<float>& GetBinLow() const { return binLow; }
+	const CArray<float>& GetBinHigh() const { return binHigh; }
+	// Gets the array of identifiers for zero feature values
+	const CArray<int>& GetFeatureNullValueId() const { return nullValueIds; }
+
+	// Gets the size of the data
+	size_t GetSize() const;
+
+protected:
+	// delete prohibited
+	virtual ~CDecisionTreeFastHistProblem() {}
+
+private:
+	// A feature value
+	struct CFeatureValue {
+		float Value;
+		double Weight;
+	};
+
+	CArray<int> featurePos; // the identifier positions for this feature
+	CArray<int> featureIndexes; // the indices of the feature to which the identifier belongs
+	CArray<float> binLow; // the smallest value in each bin
+	CArray<float> binHigh; // the largest value in each bin
+	CArray<int> nullValueIds; // the identifiers of the zero feature values
+	CArray<int> vectorData; // the vector data
+	CArray<int> vectorPtr; // the pointers to the data of the given vector
+
+	void initializeFeatureInfo( int threadCount, int maxBins, const CFloatMatrixDesc& matrix, const IProblem& problem );
+	static void buildFeatureBins( int maxBins, double totalWeight, CArray<CFeatureValue>& values, CArray<int>& binBegins );
+	void buildVectorData( int threadCount, const CFloatMatrixDesc& matrix );
+};
+
+} // namespace NeoML
@@ -17,6 +17,8 @@ limitations under the License.
 #pragma hdrstop
 
 #include <DecisionTreeNodeClassificationStatistic.h>
+#include <NeoMathEngine/OpenMP.h>
+#include <float.h>
 
 namespace NeoML {
 
@@ -24,7 +26,8 @@ namespace NeoML {
 const int SmallCoef = 4;
 const int BigCoef = 10;
 
-CClassificationStatistics::CClassificationStatistics( CDecisionTreeNodeBase* _node, const IProblem& _problem, const CArray<int>& _usedFeatures ) :
+CClassificationStatisticsBase::CClassificationStatisticsBase( CDecisionTreeNodeBase* _node, const IProblem& _problem,
+		const CArray<int>& _usedFeatures ) :
 	classCount( _problem.GetClassCount() ),
 	node( _node ),
 	problem( &_problem ),
@@ -41,44 +44,85 @@ CClassificationStatistics::CClassificationStatistics( CDecisionTreeNodeBase* _no
 	discretizationIntervals.SetSize( usedFeatures.Size() );
 }
 
-void CClassificationStatistics::AddVector( int index, const CFloatVectorDesc& vector )
+void CClassificationStatisticsBase::AddVector( int index, const CFloatVectorDesc& vector )
+{
+	AddVectorFeatures( index, vector, 0, usedFeatures.Size() );
+	AddVectorToTotal( index );
+}
+
+void CClassificationStatisticsBase::Finish()
+{
+	FinishFeatures( 0, usedFeatures.Size() );
+}
+
+void CClassificationStatisticsBase::AddVectorToTotal( int index )
 {
 	NeoAssert( problem != 0 );
-	const double weight = problem->GetVectorWeight( index );
-	const int classIndex = problem->GetClass( index );
-	for( int i = 0; i < vector.Size; i++ ) {
-		if( vector.Values[i] != 0.0 ) {
-			const int index = vector.Indexes == nullptr ? i : vector.Indexes[i];
-			if( usedFeatureNumber[index] != NotFound ) {
-				addValue( usedFeatureNumber[index], vector.Values[i], 1, classIndex, weight );
-				featureStatistics[usedFeatureNumber[index]].AddVectorSet( 1, classIndex, weight );
-			}
+	totalStatistics.AddVectorSet( 1, problem->GetClass( index ), problem->GetVectorWeight( index ) );
+}
+
+bool CClassificationStatisticsBase::GetSplit( CDecisionTree::CParams param,
+	bool& isDiscrete, int& featureIndex, CArray<double>& values, double& criterionValue ) const
+{
+	// Choose the feature so that splitting by it will give the smallest criterion value
+	// If that is smaller than the whole subset criterion value, splitting is successful
+	criterionValue = totalStatistics.CalcCriterion( param.SplitCriterion );
+	featureIndex = NotFound;
+
+	// The features are evaluated in parallel
+	// The best one is chosen afterwards in the same order as in the single-threaded case
+	const int featureCount = discretizationIntervals.Size();
+	CArray<double> splitCriterionValues;
+	splitCriterionValues.Add( DBL_MAX, featureCount );
+	CArray< CArray<double> > splitValues;
+	splitValues.SetSize( featureCount );
+
+	const int curThreadCount = IsOmpRelevant( featureCount ) ? param.ThreadCount : 1;
+	NEOML_OMP_FOR_NUM_THREADS( curThreadCount )
+	for( int i = 0; i < featureCount; i++ ) {
+		if( problem->IsDiscreteFeature( usedFeatures[i] ) ) {
+			splitCriterionValues[i] = calcDiscreteSplitCriterion( param, discretizationIntervals[i], totalStatistics, splitValues[i] );
+		} else {
+			splitCriterionValues[i] = calcContinuousSplitCriterion( param, discretizationIntervals[i], totalStatistics, splitValues[i] );
+		}
+	}
+
+	int bestFeatureNumber = NotFound;
+	for( int i = 0; i < featureCount; i++ ) {
+		if( criterionValue > splitCriterionValues[i] ) { // the split with a better criterion value is found
+			criterionValue = splitCriterionValues[i];
+			bestFeatureNumber = i;
 		}
 	}
 
-	totalStatistics.AddVectorSet( 1, classIndex, weight );
+	if( bestFeatureNumber == NotFound ) {
+		return false;
+	}
+	featureIndex = usedFeatures[bestFeatureNumber];
+	isDiscrete = problem->IsDiscreteFeature( featureIndex );
+	splitValues[bestFeatureNumber].MoveTo( values );
+	return true;
 }
 
-void CClassificationStatistics::Finish()
+double CClassificationStatisticsBase::GetPredictions( CArray<double>& probabilities ) const
 {
-	// We need also to add zero values for the features
-	const CArray<double>& totalWeights = totalStatistics.Weights();
-	const CArray<int>& totalCounts = totalStatistics.Counts();
-
-	for( int i = 0; i < usedFeatures.Size(); i++ ) {
-		const CArray<double>& weights = featureStatistics[i].Weights();
-		const CArray<int>& counts = featureStatistics[i].Counts();
+	NeoAssert( probabilities.IsEmpty() );
 
-		for( int j = 0; j < classCount; j++ ) {
-			if( totalCounts[j] - counts[j] > 0 ) {
-				addValue( i, 0, totalCounts[j] - counts[j], j, totalWeights[j] - weights[j] );
-			}
+	const CArray<double>& weights = totalStatistics.Weights();
+	probabilities.SetBufferSize( weights.Size() );
+	double maxClassProbability = 0;
+	for( int i = 0; i < weights.Size(); i++ ) {
+		const double classProbability = weights[i] / totalStatistics.TotalWeight();
+		probabilities.Add( classProbability );
+		if( classProbability > maxClassProbability ) {
+			maxClassProbability = classProbability;
 		}
-		mergeIntervals( problem->GetDiscretizationValue( usedFeatures[i] ), discretizationIntervals[i] );
 	}
+
+	return maxClassProbability;
 }
 
-size_t CClassificationStatistics::GetSize() const
+size_t CClassificationStatisticsBase::getBaseSize() const
 {
 	size_t result = usedFeatures.BufferSize() * sizeof(int) + usedFeatureNumber.BufferSize() * sizeof(int)
 		+ totalStatistics.GetSize();
@@ -93,51 +137,133 @@ size_t CClassificationStatistics::GetSize() const
 	return result;
 }
 
-bool CClassificationStatistics::GetSplit( CDecisionTree::CParams param,
-	bool& isDiscrete, int& featureIndex, CArray<double>& values, double& criterionValue ) const
+// Calculates the criterion value for continuous feature split
+double CClassificationStatisticsBase::calcContinuousSplitCriterion( CDecisionTree::CParams param,
+	const CIntervalArray& intervals, const CVectorSetClassificationStatistic& total, CArray<double>& splitValues ) const
 {
-	// Choose the feature so that splitting by it will give the smallest criterion value
-	// If that is smaller than the whole subset criterion value, splitting is successful
-	criterionValue = totalStatistics.CalcCriterion( param.SplitCriterion );
-	featureIndex = NotFound;
+	CVectorSetClassificationStatistic first( total.Weights().Size() ); // empty
+	CVectorSetClassificationStatistic second( total ); // all elements
 
-	CArray<double> splitValues;
-	for( int i = 0; i < discretizationIntervals.Size(); i++ ) {
-		double splitCriterionValue = 0;
-		const bool isDiscreteFeature = problem->IsDiscreteFeature( usedFeatures[i] );
-		if( isDiscreteFeature ) { 
-			splitCriterionValue = calcDiscreteSplitCriterion( param, discretizationIntervals[i], totalStatistics, splitValues );
-		} else {
-			splitCriterionValue = calcContinuousSplitCriterion( param, discretizationIntervals[i], totalStatistics, splitValues );
+	double resultValue = DBL_MAX;
+	bool success = false;
+	double threshold = 0;
+
+	for( int i = 0; i < intervals.Size(); i++ ) {
+		first.AddVectorSet( intervals[i].Count, intervals[i].Class, intervals[i].Weight );
+		second.SubVectorSet( intervals[i].Count, intervals[i].Class, intervals[i].Weight );
+
+		if( i + 1 < intervals.Size()
+			&& intervals[i].Begin == intervals[i + 1].Begin
+			&& intervals[i].End == intervals[i + 1].End )
+		{
+			continue;
 		}
+		if( first.TotalCount() < param.MinContinuousSubsetSize
+			|| first.TotalWeight() < total.TotalWeight() * param.MinContinuousSubsetPart )
+		{
+			continue;
+		}
+		if( second.TotalCount() < param.MinContinuousSubsetSize
+			|| second.TotalWeight() < total.TotalWeight() * param.MinContinuousSubsetPart )
+		{
+			break; // it can only decrease from here
+		}
+
+		const double value = ( first.CalcCriterion( param.SplitCriterion ) * first.TotalWeight()
+			+ second.CalcCriterion( param.SplitCriterion ) * second.TotalWeight() ) / total.TotalWeight();
 
-		if( criterionValue > splitCriterionValue ) { // the split with a better criterion value is found
-			criterionValue = splitCriterionValue;
-			featureIndex = usedFeatures[i];
-			isDiscrete = isDiscreteFeature;
-			splitValues.CopyTo( values );
+		if( resultValue > value ) {
+			resultValue = value;
+			success = true;
+			if( i + 1 < intervals.Size() && fabs( intervals[i].End - intervals[i + 1].Begin ) > 1e-10 ) {
+				threshold = ( intervals[i].End + intervals[i + 1].Begin ) / 2;
+			} else {
+				threshold = intervals[i].End;
+			}
 		}
 	}
 
-	return ( featureIndex != NotFound );
+	if( success ) {
+		splitValues.Empty();
+		splitValues.Add( threshold, 2 );
+	}
+	return resultValue;
 }
 
-double CClassificationStatistics::GetPredictions( CArray<double>& probabilities ) const
+// Calculates the criterion value for discrete feature split
+double CClassificationStatisticsBase::calcDiscreteSplitCriterion( CDecisionTree::CParams param,
+	const CIntervalArray& intervals, const CVectorSetClassificationStatistic& total, CArray<double>& splitValues ) const
 {
-	NeoAssert( probabilities.IsEmpty() );
+	splitValues.Empty();
+	double result = 0;
+	CVectorSetClassificationStatistic curSet( total.Weights().Size() ); // an empty set
+	for( int i = 0; i < intervals.Size(); i++ ) {
+		curSet.AddVectorSet( intervals[i].Count, intervals[i].Class, intervals[i].Weight );
+		if( i + 1 < intervals.Size() && intervals[i].Begin == intervals[i+1].Begin ) {
+			continue;
+		}
+		if( curSet.TotalCount() < param.MinDiscreteSubsetSize || curSet.TotalWeight() < total.TotalWeight() * param.MinDiscreteSubsetPart ) {
+			return DBL_MAX;
+		}
+		result += curSet.CalcCriterion( param.SplitCriterion ) * curSet.TotalWeight();
+		curSet.Erase();
+		splitValues.Add( intervals[i].Begin );
+	}
 
-	const CArray<double>& weights = totalStatistics.Weights();
-	probabilities.SetBufferSize( weights.Size() );
-	double maxClassProbability = 0;
-	for( int i = 0; i < weights.Size(); i++ ) {
-		const double classProbability = weights[i] / totalStatistics.TotalWeight();
-		probabilities.Add( classProbability );
-		if( classProbability > maxClassProbability ) {
-			maxClassProbability = classProbability;
+	return result / total.TotalWeight();
+}
+
+// Checks if the intervals are equal
+bool CClassificationStatisticsBase::isEqual( const CInterval& interval1, const CInterval& interval2 )
+{
+	return interval1.Begin == interval2.Begin && interval1.End == interval2.End;
+}
+
+//---------------------------------------------------------------------------------------------------------
+
+CClassificationStatistics::CClassificationStatistics( CDecisionTreeNodeBase* _node, const IProblem& _problem, const CArray<int>& _usedFeatures ) :
+	CClassificationStatisticsBase( _node, _problem, _usedFeatures )
+{
+}
+
+void CClassificationStatistics::AddVectorFeatures( int index, const CFloatVectorDesc& vector, int begin, int end )
+{
+	NeoAssert( problem != 0 );
+	const double weight = problem->GetVectorWeight( index );
+	const int classIndex = problem->GetClass( index );
+	for( int i = 0; i < vector.Size; i++ ) {
+		if( vector.Values[i] != 0.0 ) {
+			const int featureNumber = usedFeatureNumber[vector.Indexes == nullptr ? i : vector.Indexes[i]];
+			if( featureNumber != NotFound && begin <= featureNumber && featureNumber < end ) {
+				addValue( featureNumber, vector.Values[i], 1, classIndex, weight );
+				featureStatistics[featureNumber].AddVectorSet( 1, classIndex, weight );
+			}
 		}
 	}
+}
 
-	return maxClassProbability;
+void CClassificationStatistics::FinishFeatures( int begin, int end )
+{
+	// We need also to add zero values for the features
+	const CArray<double>& totalWeights = totalStatistics.Weights();
+	const CArray<int>& totalCounts = totalStatistics.Counts();
+
+	for( int i = begin; i < end; i++ ) {
+		const CArray<double>& weights = featureStatistics[i].Weights();
+		const CArray<int>& counts = featureStatistics[i].Counts();
+
+		for( int j = 0; j < classCount; j++ ) {
+			if( totalCounts[j] - counts[j] > 0 ) {
+				addValue( i, 0, totalCounts[j] - counts[j], j, totalWeights[j] - weights[j] );
+			}
+		}
+		mergeIntervals( problem->GetDiscretizationValue( usedFeatures[i] ), discretizationIntervals[i] );
+	}
+}
+
+size_t CClassificationStatistics::GetSize() const
+{
+	return getBaseSize();
 }
 
 // Adds a new value as a separate interval
@@ -326,96 +452,102 @@ void CClassificationStatistics::closeIntervals( double begin, double end, CArray
 	link.Add( NotFound, classCount );
 }
 
-// Calculates the criterion value for continuous feature split
-double CClassificationStatistics::calcContinuousSplitCriterion( CDecisionTree::CParams param,
-	const CIntervalArray& intervals, const CVectorSetClassificationStatistic& total, CArray<double>& splitValues ) const
+// Calculates the total interval weight in [left, right] range
+double CClassificationStatistics::sumWeight( const CIntervalArray& intervals, int left, int right )
 {
-	CVectorSetClassificationStatistic first( total.Weights().Size() ); // empty
-	CVectorSetClassificationStatistic second( total ); // all elements
-
-	double resultValue = DBL_MAX;
-	bool success = false;
-	double threshold = 0;
-
-	for( int i = 0; i < intervals.Size(); i++ ) {
-		first.AddVectorSet( intervals[i].Count, intervals[i].Class, intervals[i].Weight );
-		second.SubVectorSet( intervals[i].Count, intervals[i].Class, intervals[i].Weight );
-
-		if( i + 1 < intervals.Size()
-			&& intervals[i].Begin == intervals[i + 1].Begin
-			&& intervals[i].End == intervals[i + 1].End )
-		{
-			continue;
-		}
-		if( first.TotalCount() < param.MinContinuousSubsetSize
-			|| first.TotalWeight() < total.TotalWeight() * param.MinContinuousSubsetPart )
-		{
-			continue;
-		}
-		if( second.TotalCount() < param.MinContinuousSubsetSize
-			|| second.TotalWeight() < total.TotalWeight() * param.MinContinuousSubsetPart )
-		{
-			break; // it can only decrease from here
-		}
-
-		const double value = ( first.CalcCriterion( param.SplitCriterion ) * first.TotalWeight()
-			+ second.CalcCriterion( param.SplitCriterion ) * second.TotalWeight() ) / total.TotalWeight();
-
-		if( resultValue > value ) {
-			resultValue = value;
-			success = true;
-			if( i + 1 < intervals.Size() && fabs( intervals[i].End - intervals[i + 1].Begin ) > 1e-10 ) {
-				threshold = ( intervals[i].End + intervals[i + 1].Begin ) / 2;
-			} else {
-				threshold = intervals[i].End;
-			}
-		}
+	double weight = 0;
+	for( int i = left; i <= right; i++ ) {
+		weight += intervals[i].Weight;
 	}
+	return weight;
+}
 
-	if( success ) {
-		splitValues.Empty();
-		splitValues.Add( threshold, 2 );
+//---------------------------------------------------------------------------------------------------------
+
+CClassificationHistStatistics::CClassificationHistStatistics( CDecisionTreeNodeBase* _node, const IProblem& _problem,
+		const CDecisionTreeFastHistProblem& _histProblem, const CArray<int>& _usedFeatures ) :
+	CClassificationStatisticsBase( _node, _problem, _usedFeatures ),
+	histProblem( &_histProblem )
+{
+	const CArray<int>& featurePos = histProblem->GetFeaturePos();
+	histPos.SetBufferSize( usedFeatures.Size() );
+	int curPos = 0;
+	for( int i = 0; i < usedFeatures.Size(); i++ ) {
+		histPos.Add( curPos );
+		curPos += ( featurePos[usedFeatures[i] + 1] - featurePos[usedFeatures[i]] ) * classCount;
 	}
-	return resultValue;
+	binWeights.Add( 0.0, curPos );
+	binCounts.Add( 0, curPos );
 }
 
-// Calculates the criterion value for discrete feature split
-double CClassificationStatistics::calcDiscreteSplitCriterion( CDecisionTree::CParams param,
-	const CIntervalArray& intervals, const CVectorSetClassificationStatistic& total, CArray<double>& splitValues ) const
+void CClassificationHistStatistics::AddVectorFeatures( int index, const CFloatVectorDesc&, int begin, int end )
 {
-	splitValues.Empty();
-	double result = 0;
-	CVectorSetClassificationStatistic curSet( total.Weights().Size() ); // an empty set
-	for( int i = 0; i < intervals.Size(); i++ ) {
-		curSet.AddVectorSet( intervals[i].Count, intervals[i].Class, intervals[i].Weight );
-		if( i + 1 < intervals.Size() && intervals[i].Begin == intervals[i+1].Begin ) {
-			continue;
-		}
-		if( curSet.TotalCount() < param.MinDiscreteSubsetSize || curSet.TotalWeight() < total.TotalWeight() * param.MinDiscreteSubsetPart ) {
-			return DBL_MAX;
+	NeoAssert( problem != 0 );
+	const double weight = problem->GetVectorWeight( index );
+	const int classIndex = problem->GetClass( index );
+	const CArray<int>& featureIndexes = histProblem->GetFeatureIndexes();
+	const CArray<int>& featurePos = histProblem->GetFeaturePos();
+
+	// The bins of the vector non-zero values are already known
+	const int* ids = histProblem->GetVectorDataPtr( index );
+	const int size = histProblem->GetVectorDataSize( index );
+	for( int i = 0; i < size; i++ ) {
+		const int feature = featureIndexes[ids[i]];
+		const int featureNumber = usedFeatureNumber[feature];
+		if( featureNumber != NotFound && begin <= featureNumber && featureNumber < end ) {
+			const int pos = histPos[featureNumber] + ( ids[i] - featurePos[feature] ) * classCount + classIndex;
+			binWeights[pos] += weight;
+			binCounts[pos]++;
+			featureStatistics[featureNumber].AddVectorSet( 1, classIndex, weight );
 		}
-		result += curSet.CalcCriterion( param.SplitCriterion ) * curSet.TotalWeight();
-		curSet.Erase();
-		splitValues.Add( intervals[i].Begin );
 	}
-
-	return result / total.TotalWeight();
 }
 
-// Checks if the intervals are equal
-bool CClassificationStatistics::isEqual( const CInterval& interval1, const CInterval& interval2 )
+void CClassificationHistStatistics::FinishFeatures( int begin, int end )
 {
-	return interval1.Begin == interval2.Begin && interval1.End == interval2.End;
+	const CArray<double>& totalWeights = totalStatistics.Weights();
+	const CArray<int>& totalCounts = totalStatistics.Counts();
+	const CArray<int>& featurePos = histProblem->GetFeaturePos();
+	const CArray<int>& nullValueIds = histProblem->GetFeatureNullValueId();
+	const CArray<float>& binLow = histProblem->GetBinLow();
+	const CArray<float>& binHigh = histProblem->GetBinHigh();
+
+	for( int i = begin; i < end; i++ ) {
+		const int feature = usedFeatures[i];
+		const CArray<double>& weights = featureStatistics[i].Weights();
+		const CArray<int>& counts = featureStatistics[i].Counts();
+
+		// The zero values go to the bin that contains zero
+		const int nullPos = histPos[i] + ( nullValueIds[feature] - featurePos[feature] ) * classCount;
+		for( int j = 0; j < classCount; j++ ) {
+			binWeights[nullPos + j] += totalWeights[j] - weights[j];
+			binCounts[nullPos + j] += totalCounts[j] - counts[j];
+		}
+
+		// Each non-empty bin becomes an interval; the bins are already sorted
+		CIntervalArray& intervals = discretizationIntervals[i];
+		intervals.Empty();
+		for( int id = featurePos[feature]; id < featurePos[feature + 1]; id++ ) {
+			const int pos = histPos[i] + ( id - featurePos[feature] ) * classCount;
+			for( int j = 0; j < classCount; j++ ) {
+				if( binCounts[pos + j] > 0 ) {
+					CInterval interval;
+					interval.Begin = binLow[id];
+					interval.End = binHigh[id];
+					interval.Class = j;
+					interval.Count = binCounts[pos + j];
+					interval.Weight = binWeights[pos + j];
+					intervals.Add( interval );
+				}
+			}
+		}
+	}
 }
 
-// Calculates the total interval weight in [left, right] range
-double CClassificationStatistics::sumWeight( const CIntervalArray& intervals, int left, int right )
+size_t CClassificationHistStatistics::GetSize() const
 {
-	double weight = 0;
-	for( int i = left; i <= right; i++ ) {
-		weight += intervals[i].Weight;
-	}
-	return weight;
+	return getBaseSize() + histPos.BufferSize() * sizeof( int )
+		+ binWeights.BufferSize() * sizeof( double ) + binCounts.BufferSize() * sizeof( int );
 }
 
 } // namespace NeoML
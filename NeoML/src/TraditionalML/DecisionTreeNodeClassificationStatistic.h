@@ -18,6 +18,7 @@ limitations under the License.
 #include <NeoML/TraditionalML/DecisionTree.h>
 #include <DecisionTreeNodeStatisticBase.h>
 #include <DecisionTreeNodeBase.h>
+#include <DecisionTreeFastHistProblem.h>
 
 namespace NeoML {
 
@@ -129,22 +130,22 @@ inline double CVectorSetClassificationStatistic::CalcCriterion( CDecisionTree::T
 
 //---------------------------------------------------------------------------------------------------------
 
-// The statistics accumulated in a node
-class CClassificationStatistics : public CDecisionTreeNodeStatisticBase {
+// The base class for the statistics accumulated in a node
+// Keeps the discretization intervals for each used feature and looks for the best split using them
+class CClassificationStatisticsBase : public CDecisionTreeNodeStatisticBase {
 public:
-	explicit CClassificationStatistics( CDecisionTreeNodeBase* node, const IProblem& problem, const CArray<int>& usedFeatures );
-
 	// CDecisionTreeNodeStatisticBase interface methods
 	virtual void AddVector( int index, const CFloatVectorDesc& vector );
 	virtual void Finish();
-	virtual size_t GetSize() const;
 	virtual bool GetSplit( CDecisionTree::CParams param,
 		bool& isDiscrete, int& featureIndex, CArray<double>& values, double& criterioValue ) const;
 	virtual double GetPredictions( CArray<double>& predictions ) const;
 	virtual int GetVectorsCount() const { return totalStatistics.TotalCount(); }
 	virtual CDecisionTreeNodeBase& GetNode() const { return *node; }
+	virtual int GetUsedFeatureCount() const { return usedFeatures.Size(); }
+	virtual void AddVectorToTotal( int index );
 
-private:
+protected:
 	// Sampling interval
 	struct CInterval {
 		double Begin;
@@ -165,22 +166,65 @@ private:
 	CArray<CVectorSetClassificationStatistic> featureStatistics; // the statistics for each feature
 	CArray<CIntervalArray> discretizationIntervals; // the sampling intervals
 
+	CClassificationStatisticsBase( CDecisionTreeNodeBase* node, const IProblem& problem, const CArray<int>& usedFeatures );
+
+	// The size of the data kept by the base class
+	size_t getBaseSize() const;
+
+	static bool isEqual( const CInterval& interval1, const CInterval& interval2 );
+
+private:
+	double calcContinuousSplitCriterion( CDecisionTree::CParams param,
+		const CIntervalArray& intervals, const CVectorSetClassificationStatistic& total, CArray<double>& splitValues ) const;
+	double calcDiscreteSplitCriterion( CDecisionTree::CParams param,
+		const CIntervalArray& intervals, const CVectorSetClassificationStatistic& total, CArray<double>& splitValues ) const;
+
+	CClassificationStatisticsBase( const CClassificationStatisticsBase& );
+	CClassificationStatisticsBase& operator=( const CClassificationStatisticsBase& );
+};
+
+//---------------------------------------------------------------------------------------------------------
+
+// The statistics accumulated in a node
+// The feature values are kept as separate intervals that get merged when there are too many of them
+class CClassificationStatistics : public CClassificationStatisticsBase {
+public:
+	explicit CClassificationStatistics( CDecisionTreeNodeBase* node, const IProblem& problem, const CArray<int>& usedFeatures );
+
+	// CDecisionTreeNodeStatisticBase interface methods
+	virtual size_t GetSize() const;
+	virtual void AddVectorFeatures( int index, const CFloatVectorDesc& vector, int begin, int end );
+	virtual void FinishFeatures( int begin, int end );
+
+private:
 	void addValue( int index, double value, int count, int classIndex, double weight );
 	void mergeIntervals( int discretizationValue, CIntervalArray& intervals );
 	void mergeOverlappingIntervals( CIntervalArray& intervals );
 	void mergeIntervalsByWeight( int left, int right, int resultIntervalCount, CIntervalArray& intervals );
 	void closeIntervals( double begin, double end, CArray<int>& link, CIntervalArray& intervals );
-	void calcSplitCriterion( CDecisionTree::CParams param, bool isDiscrete,
-		const CIntervalArray& curItems, CArray<double>& splitValues );
-	double calcContinuousSplitCriterion( CDecisionTree::CParams param,
-		const CIntervalArray& intervals, const CVectorSetClassificationStatistic& total, CArray<double>& splitValues ) const;
-	double calcDiscreteSplitCriterion( CDecisionTree::CParams param,
-		const CIntervalArray& intervals, const CVectorSetClassificationStatistic& total, CArray<double>& splitValues ) const;
-	static bool isEqual( const CInterval& interval1, const CInterval& interval2 );
 	static double sumWeight( const CIntervalArray& intervals, int left, int right );
+};
+
+//---------------------------------------------------------------------------------------------------------
+
+// The statistics accumulated in a node for the histogram builder
+// The vectors are added to the precalculated histogram bins of CDecisionTreeFastHistProblem
+// Each bin becomes an interval when accumulating is finished
+class CClassificationHistStatistics : public CClassificationStatisticsBase {
+public:
+	CClassificationHistStatistics( CDecisionTreeNodeBase* node, const IProblem& problem,
+		const CDecisionTreeFastHistProblem& histProblem, const CArray<int>& usedFeatures );
 
-	CClassificationStatistics( const CClassificationStatistics& );
-	CClassificationStatistics& operator=( const CClassificationStatistics& );
+	// CDecisionTreeNodeStatisticBase interface methods
+	virtual size_t GetSize() const;
+	virtual void AddVectorFeatures( int index, const CFloatVectorDesc& vector, int begin, int end );
+	virtual void FinishFeatures( int begin, int end );
+
+private:
+	const CPtr<const CDecisionTreeFastHistProblem> histProblem; // the histogram data
+	CArray<int> histPos; // the beginning of each used feature histogram in binWeights and binCounts
+	CArray<double> binWeights; // the vector weights for each bin and class
+	CArray<int> binCounts; // the number of vectors for each bin and class
 };
 
 } // namespace NeoML
@@ -19,6 +19,17 @@ limitations under the License.
 
 namespace NeoML {
 
+// The split of a node found by the statistics
+struct CDecisionTreeSplit {
+	bool IsFound; // a split improving the criterion value was found
+	bool IsDiscrete; // the split feature is discrete
+	int FeatureIndex; // the split feature
+	CArray<double> Values; // the feature values defining the split
+	double CriterionValue; // the criterion value after the split
+
+	CDecisionTreeSplit() : IsFound( false ), IsDiscrete( false ), FeatureIndex( NotFound ), CriterionValue( 0 ) {}
+};
+
 // Statistics accumulated in a node
 class CDecisionTreeNodeStatisticBase {
 public:
@@ -30,6 +41,23 @@ public:
 	// Finishes accumulating data
 	virtual void Finish() = 0;
 
+	// The methods below allow accumulating the data for different features in parallel
+	// AddVector is equivalent to AddVectorToTotal and AddVectorFeatures for all used features,
+	// Finish is equivalent to FinishFeatures for all used features
+	// The calls for disjoint feature ranges may be made from different threads
+
+	// Gets the number of features for which the statistics are accumulated
+	virtual int GetUsedFeatureCount() const = 0;
+
+	// Adds a vector to the whole subset statistics
+	virtual void AddVectorToTotal( int index ) = 0;
+
+	// Adds the vector values of the used features with numbers in the [begin, end) range
+	virtual void AddVectorFeatures( int index, const CFloatVectorDesc& vector, int begin, int end ) = 0;
+
+	// Finishes accumulating data for the used features with numbers in the [begin, end) range
+	virtual void FinishFeatures( int begin, int end ) = 0;
+
 	// Retrieves the size of accumulated data
 	virtual size_t GetSize() const = 0;
 
@@ -285,6 +285,43 @@ static void generateRandomArray( CRandom& random, int n, int k, CArray<int>& res
 	result.QuickSort< Ascending<int> >();
 }
 
+// Finds the k-th largest element; the values are reordered
+static double findKthLargest( CArray<double>& values, int k )
+{
+	NeoAssert( 1 <= k && k <= values.Size() );
+
+	const int target = k - 1;
+	int begin = 0;
+	int end = values.Size() - 1;
+	while( begin < end ) {
+		const double pivot = values[( begin + end ) / 2];
+		int i = begin;
+		int j = end;
+		while( i <= j ) {
+			while( values[i] > pivot ) {
+				i++;
+			}
+			while( values[j] < pivot ) {
+				j--;
+			}
+			if( i <= j ) {
+				swap( values[i], values[j] );
+				i++;
+				j--;
+			}
+		}
+		// Now [begin, j] are not less than the pivot, [i, end] are not greater, and the values between are equal to it
+		if( target <= j ) {
+			end = j;
+		} else if( target >= i ) {
+			begin = i;
+		} else {
+			break;
+		}
+	}
+	return values[target];
+}
+
 //------------------------------------------------------------------------------------------------------------
 
 #if FINE_PLATFORM( FINE_IOS )
@@ -314,6 +351,8 @@ CGradientBoost::CGradientBoost( const CParams& _params ) :
 	NeoAssert( params.PruneCriterionValue >= 0 );
 	NeoAssert( params.ThreadCount > 0 );
 	NeoAssert( params.MinSubsetWeight >= 0 );
+	NeoAssert( 0 <= params.GossTopRate && params.GossTopRate < 1 );
+	NeoAssert( 0 < params.GossOtherRate && params.GossTopRate + params.GossOtherRate <= 1 );
 }
 
 CGradientBoost::~CGradientBoost()
@@ -339,6 +378,18 @@ CPtr<IModel> CGradientBoost::Train( const IProblem& problem )
 	return GetClassificationModel( problem );
 }
 
+CPtr<IModel> CGradientBoost::Train( const CGradientBoostBinnedProblem& problem )
+{
+	while( !TrainStep( problem ) ) {};
+	return GetClassificationModel( problem );
+}
+
+CPtr<IMultivariateRegressionModel> CGradientBoost::TrainRegression( const CGradientBoostBinnedProblem& problem )
+{
+	while( !TrainStep( problem ) ) {};
+	return GetMultivariateRegressionModel( problem );
+}
+
 // Creates a tree builder depending on the problem type
 void CGradientBoost::createTreeBuilder( const IMultivariateRegressionProblem* problem )
 {
@@ -384,8 +435,13 @@ void CGradientBoost::createTreeBuilder( const IMultivariateRegressionProblem* pr
 			} else {
 				fastHistSingleClassTreeBuilder = FINE_DEBUG_NEW CGradientBoostFastHistTreeBuilder<CGradientBoostStatisticsSingle>( builderParams, logStream, 1 );
 			}
-			fastHistProblem = FINE_DEBUG_NEW CGradientBoostFastHistProblem( params.ThreadCount, params.MaxBins,
-				*problem, usedVectors, usedFeatures );
+			if( binnedProblem != nullptr ) {
+				fastHistProblem = FINE_DEBUG_NEW CGradientBoostFastHistProblem( *binnedProblem, binnedVectors,
+					usedVectors, usedFeatures );
+			} else {
+				fastHistProblem = FINE_DEBUG_NEW CGradientBoostFastHistProblem( params.ThreadCount, params.MaxBins,
+					*problem, usedVectors, usedFeatures );
+			}
 			break;
 		}
 		default:
@@ -403,6 +459,8 @@ void CGradientBoost::destroyTreeBuilder()
 	fastHistMultiClassTreeBuilder.Release();
 	fastHistProblem.Release();
 	baseProblem.Release();
+	binnedProblem.Release();
+	binnedVectors.DeleteAll();
 }
 
 // Creates a loss function based on CParam.LossFunction
@@ -497,6 +555,12 @@ void CGradientBoost::executeStep( IGradientBoostingLossFunction& lossFunction,
 	if( params.Subsample < 1.0 ) {
 		generateRandomArray( params.Random != nullptr ? *params.Random : defaultRandom, vectorCount,
 			max( static_cast<int>( vectorCount * params.Subsample ), 1 ), usedVectors );
+	} else if( usedVectors.Size() != vectorCount ) {
+		// The previous step has left only the vectors selected by GOSS
+		usedVectors.DeleteAll();
+		for( int i = 0; i < vectorCount; i++ ) {
+			usedVectors.Add( i );
+		}
 	}
 	if( params.Subfeature < 1.0 ) {
 		generateRandomArray( params.Random != nullptr ? *params.Random : defaultRandom, featureCount,
@@ -537,22 +601,34 @@ void CGradientBoost::executeStep( IGradientBoostingLossFunction& lossFunction,
 	CArray<double> weights;
 	weights.SetSize( usedVectors.Size() );
 
-	double weightsSum = 0;
 	for( int i = 0; i < usedVectors.Size(); i++ ) {
 		weights[i] = problem->GetVectorWeight( usedVectors[i] );
-		weightsSum += weights[i];
 	}
 
 	for( int i = 0; i < gradients.Size(); i++ ) {
 		for( int j = 0; j < usedVectors.Size(); j++ ) {
 			gradients[i][j] = gradients[i][j] * weights[j];
-			gradientsSum[i] += gradients[i][j];
 			hessians[i][j] = hessians[i][j] * weights[j];
+		}
+	}
+
+	if( params.GossTopRate > 0 ) {
+		selectGossVectors( weights );
+	}
+
+	double weightsSum = 0;
+	for( int i = 0; i < usedVectors.Size(); i++ ) {
+		weightsSum += weights[i];
+	}
+
+	for( int i = 0; i < gradients.Size(); i++ ) {
+		for( int j = 0; j < usedVectors.Size(); j++ ) {
+			gradientsSum[i] += gradients[i][j];
 			hessiansSum[i] += hessians[i][j];
 		}
 	}
 
-	if( params.Subfeature != 1.0 || params.Subsample != 1.0 ) {
+	if( params.Subfeature != 1.0 || params.Subsample != 1.0 || params.GossTopRate > 0 ) {
 		// The sub-problem data has changed, reload it
 		if( fullProblem != nullptr ) {
 			fullProblem->Update();
@@ -587,12 +663,99 @@ void CGradientBoost::executeStep( IGradientBoostingLossFunction& lossFunction,
 	}
 }
 
+// Leaves only the vectors selected by gradient-based one-side sampling in usedVectors, gradients, hessians and weights
+// All vectors with the largest gradients are kept, the rest are subsampled and their gradients, hessians and weights
+// are scaled so that the sums over the rest stay unbiased
+void CGradientBoost::selectGossVectors( CArray<double>& weights )
+{
+	const int vectorCount = usedVectors.Size();
+	const int topCount = static_cast<int>( vectorCount * params.GossTopRate );
+	const int otherCount = min( vectorCount - topCount, max( static_cast<int>( vectorCount * params.GossOtherRate ), 1 ) );
+	if( topCount + otherCount >= vectorCount ) {
+		return;
+	}
+
+	// The vector importance is the total absolute value of its weighted gradients
+	CArray<double> gradientNorms;
+	gradientNorms.Add( 0.0, vectorCount );
+	for( int i = 0; i < gradients.Size(); i++ ) {
+		for( int j = 0; j < vectorCount; j++ ) {
+			gradientNorms[j] += abs( gradients[i][j] );
+		}
+	}
+
+	// The multiplier for each vector: 1 for the top vectors, 0 for the vectors that are not used
+	CArray<double> factors;
+	factors.Add( 0.0, vectorCount );
+	CArray<int> otherVectors;
+	otherVectors.SetBufferSize( vectorCount - topCount );
+	if( topCount > 0 ) {
+		CArray<double> sortedNorms;
+		gradientNorms.CopyTo( sortedNorms );
+		const double threshold = findKthLargest( sortedNorms, topCount );
+		// The vectors equal to the threshold are taken in order until the top is full
+		int thresholdCount = topCount;
+		for( int j = 0; j < vectorCount; j++ ) {
+			if( gradientNorms[j] > threshold ) {
+				thresholdCount--;
+			}
+		}
+		for( int j = 0; j < vectorCount; j++ ) {
+			if( gradientNorms[j] > threshold ) {
+				factors[j] = 1;
+			} else if( gradientNorms[j] == threshold && thresholdCount > 0 ) {
+				factors[j] = 1;
+				thresholdCount--;
+			} else {
+				otherVectors.Add( j );
+			}
+		}
+	} else {
+		for( int j = 0; j < vectorCount; j++ ) {
+			otherVectors.Add( j );
+		}
+	}
+
+	CArray<int> sampledVectors;
+	generateRandomArray( params.Random != nullptr ? *params.Random : defaultRandom, otherVectors.Size(),
+		otherCount, sampledVectors );
+	const double otherFactor = static_cast<double>( otherVectors.Size() ) / otherCount;
+	for( int j = 0; j < sampledVectors.Size(); j++ ) {
+		factors[otherVectors[sampledVectors[j]]] = otherFactor;
+	}
+
+	// Packing the selected vectors, keeping their order
+	int size = 0;
+	for( int j = 0; j < vectorCount; j++ ) {
+		if( factors[j] == 0 ) {
+			continue;
+		}
+		usedVectors[size] = usedVectors[j];
+		weights[size] = weights[j] * factors[j];
+		for( int i = 0; i < gradients.Size(); i++ ) {
+			gradients[i][size] = gradients[i][j] * factors[j];
+			hessians[i][size] = hessians[i][j] * factors[j];
+		}
+		size++;
+	}
+	usedVectors.SetSize( size );
+	weights.SetSize( size );
+	for( int i = 0; i < gradients.Size(); i++ ) {
+		gradients[i].SetSize( size );
+		hessians[i].SetSize( size );
+	}
+
+	if( logStream != nullptr ) {
+		*logStream << "GOSS: " << topCount << " top and " << otherCount << " sampled vectors of " << vectorCount << "\n";
+	}
+}
+
 // Builds the ensemble predictions for a set of vectors
 void CGradientBoost::buildPredictions( const IMultivariateRegressionProblem& problem, const CArray<CGradientBoostEnsemble>& models, int curStep )
 {
 	CFloatMatrixDesc matrix = problem.GetMatrix();
-	NeoAssert( matrix.Height == problem.GetVectorCount() );
-	NeoAssert( matrix.Width == problem.GetFeatureCount() );
+	NeoAssert( binnedProblem != nullptr || matrix.Height == problem.GetVectorCount() );
+	NeoAssert( binnedProblem != nullptr || matrix.Width == problem.GetFeatureCount() );
 
 	CArray<CFastArray<double, 1>> predictions;
 	predictions.SetSize( params.ThreadCount );
@@ -605,12 +768,13 @@ void CGradientBoost::buildPredictions( const IMultivariateRegressionProblem& pro
 		int index = 0;
 		int count = 0;
 		int threadNum = OmpGetThreadNum();
+		CArray<float> buffer;
 		if( OmpGetTaskIndexAndCount( usedVectors.Size(), index, count ) ) {
 			for( int i = 0; i < count; i++ ) {
 				const int usedVector = usedVectors[index];
 				const CFloatVector value = problem.GetValue( usedVectors[index] );
 				CFloatVectorDesc vector;
-				matrix.GetRow( usedVector, vector );
+				getVector( matrix, usedVector, buffer, vector );
 
 				if( isMultiTreesModel() ) {
 					CGradientBoostModel::PredictRaw( models[0], predictCache[0][usedVector].Step,
@@ -641,8 +805,8 @@ void CGradientBoost::buildPredictions( const IMultivariateRegressionProblem& pro
 void CGradientBoost::buildFullPredictions( const IMultivariateRegressionProblem& problem, const CArray<CGradientBoostEnsemble>& models )
 {
 	CFloatMatrixDesc matrix = problem.GetMatrix();
-	NeoAssert( matrix.Height == problem.GetVectorCount() );
-	NeoAssert( matrix.Width == problem.GetFeatureCount() );
+	NeoAssert( binnedProblem != nullptr || matrix.Height == problem.GetVectorCount() );
+	NeoAssert( binnedProblem != nullptr || matrix.Width == problem.GetFeatureCount() );
 
 	for( int i = 0; i < predicts.Size(); i++ ) {
 		predicts[i].SetSize( problem.GetVectorCount() );
@@ -660,11 +824,12 @@ void CGradientBoost::buildFullPredictions( const IMultivariateRegressionProblem&
 		int index = 0;
 		int count = 0;
 		int threadNum = OmpGetThreadNum();
+		CArray<float> buffer;
 		if( OmpGetTaskIndexAndCount( problem.GetVectorCount(), index, count ) ) {
 			for( int i = 0; i < count; i++ ) {
 				const CFloatVector value = problem.GetValue( index );
 				CFloatVectorDesc vector;
-				matrix.GetRow( index, vector );
+				getVector( matrix, index, buffer, vector );
 
 				if( isMultiTreesModel() ){
 					CGradientBoostModel::PredictRaw( models[0], predictCache[0][index].Step,
@@ -691,6 +856,21 @@ void CGradientBoost::buildFullPredictions( const IMultivariateRegressionProblem&
 	}
 }
 
+// Gets the vector of the problem being trained
+// The binned data is decoded into the buffer: each feature gets the cut of its bin, which leads to the same tree leaves
+void CGradientBoost::getVector( const CFloatMatrixDesc& matrix, int index, CArray<float>& buffer, CFloatVectorDesc& vector ) const
+{
+	if( binnedProblem == nullptr ) {
+		matrix.GetRow( index, vector );
+		return;
+	}
+	buffer.SetSize( binnedProblem->GetFeatureCount() );
+	binnedProblem->GetBinValues( binnedVectors[index], buffer.GetPtr() );
+	vector.Size = buffer.Size();
+	vector.Indexes = nullptr;
+	vector.Values = buffer.GetPtr();
+}
+
 // Creates model represetation requested in params.
 CPtr<IObject> CGradientBoost::createOutputRepresentation(
 	CArray<CGradientBoostEnsemble>& models, int predictionSize )
@@ -745,6 +925,23 @@ void CGradientBoost::prepareProblem( const IMultivariateRegressionProblem& _prob
 	}
 }
 
+void CGradientBoost::prepareProblem( const CGradientBoostBinnedProblem& _problem )
+{
+	if( baseProblem == 0 ) {
+		NeoAssert( params.TreeBuilder == GBTB_FastHist || params.TreeBuilder == GBTB_MultiFastHist );
+		binnedProblem = &_problem;
+		// The vectors with null weight are skipped, as CMultivariateRegressionProblemNotNullWeightsView does
+		binnedVectors.DeleteAll();
+		for( int i = 0; i < _problem.GetVectorCount(); i++ ) {
+			if( _problem.GetVectorWeight( i ) != 0 ) {
+				binnedVectors.Add( i );
+			}
+		}
+		baseProblem = FINE_DEBUG_NEW CMultivariateRegressionOverBinnedProblem( &_problem, binnedVectors );
+		initialize();
+	}
+}
+
 bool CGradientBoost::TrainStep( const IProblem& _problem )
 {
 	prepareProblem( _problem );
@@ -763,6 +960,12 @@ bool CGradientBoost::TrainStep( const IMultivariateRegressionProblem& _problem )
 	return trainStep();
 }
 
+bool CGradientBoost::TrainStep( const CGradientBoostBinnedProblem& _problem )
+{
+	prepareProblem( _problem );
+	return trainStep();
+}
+
 bool CGradientBoost::trainStep()
 {
 	try {
@@ -852,4 +1055,16 @@ CPtr<IMultivariateRegressionModel> CGradientBoost::GetMultivariateRegressionMode
 	return getModel<IMultivariateRegressionModel>();
 }
 
+CPtr<IModel> CGradientBoost::GetClassificationModel( const CGradientBoostBinnedProblem& _problem )
+{
+	prepareProblem( _problem );
+	return getModel<IModel>();
+}
+
+CPtr<IMultivariateRegressionModel> CGradientBoost::GetMultivariateRegressionModel( const CGradientBoostBinnedProblem& _problem )
+{
+	prepareProblem( _problem );
+	return getModel<IMultivariateRegressionModel>();
+}
+
 } // namespace NeoML
@@ -0,0 +1,271 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <common.h>
+#pragma hdrstop
+
+#include <NeoML/TraditionalML/GradientBoostBinnedProblem.h>
+#include <NeoML/MappedArchiveFile.h>
+#include <GradientBoostFastHistProblem.h>
+#include <NeoMathEngine/OpenMP.h>
+
+namespace NeoML {
+
+// The maximum number of bins for which a bin index fits into 1 byte
+static const int MaxSmallBinCount = 256;
+// The maximum number of bins for which a bin index fits into 2 bytes
+static const int MaxBinCount = 65536;
+
+CGradientBoostBinnedProblem::CGradientBoostBinnedProblem() :
+	vectorCount( 0 ),
+	valueSize( 0 ),
+	binSize( 0 ),
+	binData( nullptr )
+{
+}
+
+// The file consists of the bin indices, the header and the header position in the end
+CPtr<CGradientBoostBinnedProblem> CGradientBoostBinnedProblem::Load( const char* fileName )
+{
+	CMappedArchiveFile file( fileName );
+	__int64 headerPos = 0;
+	check( file.GetLength() >= static_cast<__int64>( sizeof( headerPos ) ), ERR_BAD_ARCHIVE, fileName );
+	::memcpy( &headerPos, file.GetData() + file.GetLength() - sizeof( headerPos ), sizeof( headerPos ) );
+	check( 0 <= headerPos && headerPos <= file.GetLength() - static_cast<__int64>( sizeof( headerPos ) ),
+		ERR_BAD_ARCHIVE, fileName );
+
+	CPtr<CGradientBoostBinnedProblem> problem = FINE_DEBUG_NEW CGradientBoostBinnedProblem();
+	file.Seek( headerPos, CBaseFile::begin );
+	{
+		CArchive archive( &file, CArchive::SD_Loading );
+		problem->serializeHeader( archive );
+	}
+	check( headerPos == static_cast<__int64>( problem->vectorCount ) * problem->GetFeatureCount() * problem->binSize,
+		ERR_BAD_ARCHIVE, fileName );
+
+	problem->mapping = file.GetMapping();
+	problem->binData = reinterpret_cast<const unsigned char*>( file.GetData() );
+	return problem;
+}
+
+void CGradientBoostBinnedProblem::GetBinValues( int index, float* result ) const
+{
+	const int featureCount = GetFeatureCount();
+	if( binSize == 1 ) {
+		const unsigned char* vectorBins = GetBins( index );
+		for( int i = 0; i < featureCount; i++ ) {
+			result[i] = cuts[featurePos[i] + vectorBins[i]];
+		}
+	} else {
+		const unsigned short* vectorBins = reinterpret_cast<const unsigned short*>( GetBins( index ) );
+		for( int i = 0; i < featureCount; i++ ) {
+			result[i] = cuts[featurePos[i] + vectorBins[i]];
+		}
+	}
+}
+
+void CGradientBoostBinnedProblem::serializeHeader( CArchive& archive )
+{
+	archive.SerializeVersion( 0 );
+	if( archive.IsStoring() ) {
+		archive << vectorCount << valueSize << binSize;
+	} else {
+		archive >> vectorCount >> valueSize >> binSize;
+		check( vectorCount >= 0 && valueSize > 0 && ( binSize == 1 || binSize == 2 ), ERR_BAD_ARCHIVE, archive.Name() );
+	}
+	featurePos.Serialize( archive );
+	cuts.Serialize( archive );
+	values.Serialize( archive );
+	weights.Serialize( archive );
+	if( archive.IsLoading() ) {
+		check( !featurePos.IsEmpty() && featurePos.Last() == cuts.Size()
+			&& values.Size() == vectorCount * valueSize && weights.Size() == vectorCount, ERR_BAD_ARCHIVE, archive.Name() );
+	}
+}
+
+//------------------------------------------------------------------------------------------------------------
+
+CGradientBoostBinnedProblemBuilder::CGradientBoostBinnedProblemBuilder( int _featureCount, int valueSize,
+		const CParams& _params ) :
+	params( _params ),
+	featureCount( _featureCount ),
+	sample( _featureCount )
+{
+	NeoAssert( featureCount > 0 );
+	NeoAssert( valueSize > 0 );
+	NeoAssert( 1 < params.MaxBins && params.MaxBins <= MaxBinCount );
+	NeoAssert( params.SampleSize > 0 );
+	NeoAssert( params.ThreadCount > 0 );
+
+	problem = FINE_DEBUG_NEW CGradientBoostBinnedProblem();
+	problem->valueSize = valueSize;
+	if( !params.FileName.empty() ) {
+		file.Open( params.FileName, CArchive::store );
+	}
+}
+
+CGradientBoostBinnedProblemBuilder::~CGradientBoostBinnedProblemBuilder()
+{
+}
+
+void CGradientBoostBinnedProblemBuilder::AddChunk( const CFloatMatrixDesc& matrix, const CArray<float>& values,
+	const CArray<float>& weights )
+{
+	NeoAssert( problem != nullptr );
+	NeoAssert( matrix.Width <= featureCount );
+	NeoAssert( values.Size() == matrix.Height * problem->valueSize );
+	NeoAssert( weights.IsEmpty() || weights.Size() == matrix.Height );
+	NeoAssert( problem->vectorCount <= INT_MAX - matrix.Height );
+
+	problem->vectorCount += matrix.Height;
+	problem->values.Add( values );
+	if( weights.IsEmpty() ) {
+		problem->weights.Add( 1.f, matrix.Height );
+	} else {
+		problem->weights.Add( weights );
+	}
+
+	if( problem->binSize != 0 ) {
+		addBins( matrix );
+		return;
+	}
+
+	// The bins are not known yet
+	for( int i = 0; i < matrix.Height; i++ ) {
+		sample.AddRow( matrix.GetRow( i ) );
+	}
+	if( sample.GetHeight() >= params.SampleSize ) {
+		calcBins();
+		addBins( sample.GetDesc() );
+		sample = CSparseFloatMatrix();
+	}
+}
+
+CPtr<CGradientBoostBinnedProblem> CGradientBoostBinnedProblemBuilder::Build()
+{
+	NeoAssert( problem != nullptr );
+	NeoAssert( problem->vectorCount > 0 );
+
+	if( problem->binSize == 0 ) {
+		calcBins();
+		addBins( sample.GetDesc() );
+		sample = CSparseFloatMatrix();
+	}
+
+	CPtr<CGradientBoostBinnedProblem> result = problem;
+	problem = nullptr;
+	if( !file.IsOpen() ) {
+		result->binData = result->bins.GetPtr();
+		return result;
+	}
+
+	// The header is written after the bin indices, so that the bin indices start at the beginning of the mapped file
+	const __int64 headerPos = file.GetPosition();
+	{
+		CArchive archive( &file, CArchive::SD_Storing );
+		result->serializeHeader( archive );
+	}
+	file.Write( &headerPos, sizeof( headerPos ) );
+	file.Close();
+	return CGradientBoostBinnedProblem::Load( params.FileName );
+}
+
+// Calculates the bins on the sample
+void CGradientBoostBinnedProblemBuilder::calcBins()
+{
+	const CFloatMatrixDesc& sampleDesc = sample.GetDesc();
+	// The vectors with null weight are not used for training, so they are skipped here too
+	CArray<int> pointerB;
+	CArray<int> pointerE;
+	CArray<double> sampleWeights;
+	for( int i = 0; i < sampleDesc.Height; i++ ) {
+		if( problem->weights[i] != 0 ) {
+			pointerB.Add( sampleDesc.PointerB[i] );
+			pointerE.Add( sampleDesc.PointerE[i] );
+			sampleWeights.Add( problem->weights[i] );
+		}
+	}
+	CFloatMatrixDesc matrix = sampleDesc;
+	matrix.Height = sampleWeights.Size();
+	matrix.Width = featureCount;
+	matrix.PointerB = pointerB.GetPtr();
+	matrix.PointerE = pointerE.GetPtr();
+	CGradientBoostFastHistProblem::CalcFeatureCuts( params.ThreadCount, params.MaxBins, matrix, sampleWeights,
+		problem->featurePos, problem->cuts );
+
+	int maxFeatureBinCount = 0;
+	nullBins.SetSize( featureCount );
+	for( int i = 0; i < featureCount; i++ ) {
+		const int binCount = problem->featurePos[i + 1] - problem->featurePos[i];
+		maxFeatureBinCount = max( maxFeatureBinCount, binCount );
+		nullBins[i] = CGradientBoostFastHistProblem::FindBin( 0, problem->cuts.GetPtr() + problem->featurePos[i], binCount );
+	}
+	NeoAssert( maxFeatureBinCount <= MaxBinCount );
+	problem->binSize = maxFeatureBinCount <= MaxSmallBinCount ? 1 : 2;
+}
+
+// Adds the bin indices of the matrix vectors
+void CGradientBoostBinnedProblemBuilder::addBins( const CFloatMatrixDesc& matrix )
+{
+	const int vectorSize = featureCount * problem->binSize;
+	unsigned char* result = nullptr;
+	if( file.IsOpen() ) {
+		NeoAssert( static_cast<__int64>( matrix.Height ) * vectorSize <= INT_MAX );
+		chunkBins.SetSize( matrix.Height * vectorSize );
+		result = chunkBins.GetPtr();
+	} else {
+		// Without the file, all bin indices are stored in one array
+		NeoAssert( static_cast<__int64>( problem->bins.Size() ) + static_cast<__int64>( matrix.Height ) * vectorSize <= INT_MAX );
+		const int oldSize = problem->bins.Size();
+		problem->bins.SetSize( oldSize + matrix.Height * vectorSize );
+		result = problem->bins.GetPtr() + oldSize;
+	}
+
+	const int curThreadCount = IsOmpRelevant( matrix.Height, static_cast<int64_t>( matrix.Height ) * featureCount )
+		? params.ThreadCount : 1;
+	NEOML_OMP_FOR_NUM_THREADS( curThreadCount )
+	for( int i = 0; i < matrix.Height; i++ ) {
+		unsigned char* vectorBins = result + static_cast<size_t>( i ) * vectorSize;
+		if( problem->binSize == 1 ) {
+			fillBins( matrix.GetRow( i ), vectorBins );
+		} else {
+			fillBins( matrix.GetRow( i ), reinterpret_cast<unsigned short*>( vectorBins ) );
+		}
+	}
+
+	if( file.IsOpen() ) {
+		file.Write( chunkBins.GetPtr(), chunkBins.Size() );
+	}
+}
+
+// Fills the bin indices of all features of the vector
+template<class TBin>
+void CGradientBoostBinnedProblemBuilder::fillBins( const CFloatVectorDesc& vector, TBin* result ) const
+{
+	const CArray<int>& featurePos = problem->featurePos;
+	const CArray<float>& cuts = problem->cuts;
+	for( int i = 0; i < featureCount; i++ ) {
+		result[i] = static_cast<TBin>( nullBins[i] );
+	}
+	for( int i = 0; i < vector.Size; i++ ) {
+		if( vector.Values[i] != 0 ) {
+			const int index = vector.Indexes == nullptr ? i : vector.Indexes[i];
+			result[index] = static_cast<TBin>( CGradientBoostFastHistProblem::FindBin( vector.Values[i],
+				cuts.GetPtr() + featurePos[index], featurePos[index + 1] - featurePos[index] ) );
+		}
+	}
+}
+
+} // namespace NeoML
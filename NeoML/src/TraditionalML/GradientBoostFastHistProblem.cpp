@@ -25,40 +25,44 @@ CGradientBoostFastHistProblem::CGradientBoostFastHistProblem( int threadCount, i
 		const IMultivariateRegressionProblem& baseProblem,
 		const CArray<int>& _usedVectors, const CArray<int>& _usedFeatures ) :
 	usedVectors( _usedVectors ),
-	usedFeatures( _usedFeatures )
+	usedFeatures( _usedFeatures ),
+	binnedVectors( nullptr )
 {
 	CFloatMatrixDesc matrix = baseProblem.GetMatrix();
 	NeoAssert( matrix.Height == baseProblem.GetVectorCount() );
 	NeoAssert( matrix.Width == baseProblem.GetFeatureCount() );
+
 	// Initialize features data
-	initializeFeatureInfo( threadCount, maxBins, matrix, baseProblem );
+	CArray<double> weights;
+	weights.SetBufferSize( matrix.Height );
+	for( int i = 0; i < matrix.Height; i++ ) {
+		weights.Add( baseProblem.GetVectorWeight( i ) );
+	}
+	CalcFeatureCuts( threadCount, maxBins, matrix, weights, featurePos, cuts );
+	initializeFeatureIds();
 
 	// Build vector data
 	buildVectorData( matrix );
 }
 
-const int* CGradientBoostFastHistProblem::GetUsedVectorDataPtr( int index ) const
-{
-	NeoAssert( index >= 0 );
-	NeoAssert( index < usedVectors.Size() );
-
-	return vectorData.GetPtr() + vectorPtr[usedVectors[index]];
-}
-
-int CGradientBoostFastHistProblem::GetUsedVectorDataSize( int index ) const
+CGradientBoostFastHistProblem::CGradientBoostFastHistProblem( const CGradientBoostBinnedProblem& _binnedProblem,
+		const CArray<int>& _binnedVectors, const CArray<int>& _usedVectors, const CArray<int>& _usedFeatures ) :
+	usedVectors( _usedVectors ),
+	usedFeatures( _usedFeatures ),
+	binnedProblem( &_binnedProblem ),
+	binnedVectors( &_binnedVectors )
 {
-	NeoAssert( index >= 0 );
-	NeoAssert( index < usedVectors.Size() );
-
-	return vectorPtr[usedVectors[index] + 1] - vectorPtr[usedVectors[index]];
+	binnedProblem->GetFeaturePos().CopyTo( featurePos );
+	binnedProblem->GetCuts().CopyTo( cuts );
+	initializeFeatureIds();
 }
 
-// Initializes the feature values
-void CGradientBoostFastHistProblem::initializeFeatureInfo( int threadCount, int maxBins, const CFloatMatrixDesc& matrix,
-	const IMultivariateRegressionProblem& baseProblem )
+void CGradientBoostFastHistProblem::CalcFeatureCuts( int threadCount, int maxBins, const CFloatMatrixDesc& matrix,
+	const CArray<double>& weights, CArray<int>& featurePos, CArray<float>& cuts )
 {
-	const int vectorCount = baseProblem.GetVectorCount();
-	const int featureCount = baseProblem.GetFeatureCount();
+	const int vectorCount = matrix.Height;
+	const int featureCount = matrix.Width;
+	NeoAssert( weights.Size() == vectorCount );
 
 	CArray< CArray<CFeatureValue> > featureValues; // the values of all features
 	featureValues.SetSize( featureCount );
@@ -66,17 +70,15 @@ void CGradientBoostFastHistProblem::initializeFeatureInfo( int threadCount, int
 	CArray<double> featureWeights; // total weight of all vectors for which the current feature is not 0
 	featureWeights.Add( 0.0, featureCount );
 	double totalWeight = 0.0; // total weight of all vectors
-	int totalElementCount = 0; // total number of non-zero elements
 
 	// Adding the non-zero values
 	for( int i = 0; i < vectorCount; i++ ) {
 		CFloatVectorDesc vector;
 		matrix.GetRow( i, vector );
-		const double vectorWeight = baseProblem.GetVectorWeight( i );
+		const double vectorWeight = weights[i];
 
 		for( int j = 0; j < vector.Size; j++ ) {
 			if( vector.Values[j] != 0.0 ) {
-				++totalElementCount;
 				const int index = vector.Indexes == nullptr ? j : vector.Indexes[j];
 				if( featureValues[index].IsEmpty()
 					|| featureValues[index].Last().Value != vector.Values[j] )
@@ -94,8 +96,6 @@ void CGradientBoostFastHistProblem::initializeFeatureInfo( int threadCount, int
 		totalWeight += vectorWeight;
 	}
 
-	vectorData.SetBufferSize( totalElementCount );
-
 	// Adding the zero values
 	for( int i = 0; i < featureValues.Size(); i++ ) {
 		CFeatureValue newValue;
@@ -122,26 +122,63 @@ void CGradientBoostFastHistProblem::initializeFeatureInfo( int threadCount, int
 
 	compressFeatureValues( threadCount, maxBins, totalWeight, featureValues );
 
-	// Initializing the internal arrays
-	nullValueIds.Add( NotFound, featureValues.Size() );
-	featurePos.SetBufferSize( featureValues.Size() );
+	// The cuts are in the middle between the neighboring values
+	featurePos.Empty();
+	featurePos.SetBufferSize( featureValues.Size() + 1 );
+	cuts.Empty();
 	int curPos = 0;
 	for( int i = 0; i < featureValues.Size(); i++ ) {
 		featurePos.Add( curPos );
-		featureIndexes.Add( i, featureValues[i].Size() );
 		curPos += featureValues[i].Size();
 
 		for( int j = 0; j < featureValues[i].Size(); j++ ) {
 			const float next = j + 1 == featureValues[i].Size() ? featureValues[i][j].Value : featureValues[i][j + 1].Value;
 			cuts.Add( ( featureValues[i][j].Value + next ) / 2 );
-			if( nullValueIds[i] == NotFound && 0 <= cuts.Last() ) {
-				nullValueIds[i] = cuts.Size() - 1;
-			}
 		}
 	}
 	featurePos.Add( curPos );
 }
 
+int CGradientBoostFastHistProblem::FindBin( float value, const float* cuts, int binCount )
+{
+	int pos = FindInsertionPoint<float, Ascending<float>, float>( value, cuts, binCount );
+	if( pos > 0 && cuts[pos - 1] == value ) {
+		pos--;
+	}
+	// The values greater than all cuts are possible only if the cuts have been calculated on a part of the data
+	return min( pos, binCount - 1 );
+}
+
+const int* CGradientBoostFastHistProblem::GetUsedVectorDataPtr( int index ) const
+{
+	NeoAssert( !IsBinned() );
+	NeoAssert( index >= 0 );
+	NeoAssert( index < usedVectors.Size() );
+
+	return vectorData.GetPtr() + vectorPtr[usedVectors[index]];
+}
+
+int CGradientBoostFastHistProblem::GetUsedVectorDataSize( int index ) const
+{
+	NeoAssert( !IsBinned() );
+	NeoAssert( index >= 0 );
+	NeoAssert( index < usedVectors.Size() );
+
+	return vectorPtr[usedVectors[index] + 1] - vectorPtr[usedVectors[index]];
+}
+
+// Initializes the feature indices and the zero value identifiers by the cuts
+void CGradientBoostFastHistProblem::initializeFeatureIds()
+{
+	const int featureCount = featurePos.Size() - 1;
+	nullValueIds.Add( NotFound, featureCount );
+	featureIndexes.SetBufferSize( featurePos.Last() );
+	for( int i = 0; i < featureCount; i++ ) {
+		featureIndexes.Add( i, featurePos[i + 1] - featurePos[i] );
+		nullValueIds[i] = featurePos[i] + FindBin( 0, cuts.GetPtr() + featurePos[i], featurePos[i + 1] - featurePos[i] );
+	}
+}
+
 // Compresses the values of each feature so that there are no more than maxBins different values
 void CGradientBoostFastHistProblem::compressFeatureValues( int threadCount, int maxBins, double totalWeight,
 	CArray< CArray<CFeatureValue> >& featureValues )
@@ -189,7 +226,19 @@ void CGradientBoostFastHistProblem::compressFeatureValues( int threadCount, int
 void CGradientBoostFastHistProblem::buildVectorData( const CFloatMatrixDesc& matrix )
 {
 	const int vectorCount = matrix.Height;
-	
+
+	int totalElementCount = 0; // total number of non-zero elements
+	for( int i = 0; i < vectorCount; i++ ) {
+		CFloatVectorDesc vector;
+		matrix.GetRow( i, vector );
+		for( int j = 0; j < vector.Size; j++ ) {
+			if( vector.Values[j] != 0.0 ) {
+				++totalElementCount;
+			}
+		}
+	}
+	vectorData.SetBufferSize( totalElementCount );
+
 	vectorPtr.SetBufferSize( vectorCount + 1 );
 	int curVectorPtr = 0;
 	for( int i = 0; i < vectorCount; i++ ) {
@@ -201,13 +250,9 @@ void CGradientBoostFastHistProblem::buildVectorData( const CFloatMatrixDesc& mat
 			if( vector.Values[j] != 0.0 ) {
 				++curVectorPtr;
 				const int index = vector.Indexes == nullptr ? j : vector.Indexes[j];
-				float* valuePtr = cuts.GetPtr() + featurePos[index]; // the pointer to this feature values
-				int valueCount = featurePos[index + 1] - featurePos[index]; // the number of different values for the feature
 				// Now we get the bin into which the current value falls
-				int pos = FindInsertionPoint<float, Ascending<float>, float>( vector.Values[j], valuePtr, valueCount );
-				if( pos > 0 && *(valuePtr + pos - 1) == vector.Values[j] ) {
-					pos--;
-				}
+				const int pos = FindBin( vector.Values[j], cuts.GetPtr() + featurePos[index],
+					featurePos[index + 1] - featurePos[index] );
 				vectorData.Add( featurePos[index] + pos );
 			}
 		}
@@ -16,6 +16,7 @@ limitations under the License.
 #pragma once
 
 #include <NeoML/TraditionalML/Problem.h>
+#include <NeoML/TraditionalML/GradientBoostBinnedProblem.h>
 
 namespace NeoML {
 
@@ -28,13 +29,34 @@ public:
 	CGradientBoostFastHistProblem( int threadCount, int maxBins,
 		const IMultivariateRegressionProblem& baseProblem,
 		const CArray<int>& usedVectors, const CArray<int>& usedFeatures );
+	// Builds a subproblem over the binned data, which is used as is
+	// The binnedVectors array contains the index in the binned data of each vector of the full sample
+	CGradientBoostFastHistProblem( const CGradientBoostBinnedProblem& binnedProblem, const CArray<int>& binnedVectors,
+		const CArray<int>& usedVectors, const CArray<int>& usedFeatures );
+
+	// Calculates the histogram bins of all matrix features
+	// The bin identifiers of the feature start from featurePos[feature]
+	// The bin contains the values greater than the cut of the previous bin and not greater than its own cut
+	static void CalcFeatureCuts( int threadCount, int maxBins, const CFloatMatrixDesc& matrix,
+		const CArray<double>& weights, CArray<int>& featurePos, CArray<float>& cuts );
+	// Finds the bin of the value among the given cuts of the feature
+	static int FindBin( float value, const float* cuts, int binCount );
 
 	// Gets the number of vectors used
 	int GetUsedVectorCount() const { return usedVectors.Size(); }
+	// Checks if the vectors are stored as the bin indices of all features (see CGradientBoostBinnedProblem)
+	// Otherwise only the identifiers of the non-zero values are stored
+	bool IsBinned() const { return binnedProblem != nullptr; }
 	// Gets the pointer to the vector data
 	const int* GetUsedVectorDataPtr( int index ) const;
 	// Gets the size of the vector data
 	int GetUsedVectorDataSize( int index ) const;
+	// Gets the size of a bin index in bytes (only for the binned data)
+	int GetBinSize() const { return binnedProblem->GetBinSize(); }
+	// Gets the bin indices of all features of the vector (only for the binned data)
+	const unsigned char* GetUsedVectorBins( int index ) const { return binnedProblem->GetBins( ( *binnedVectors )[usedVectors[index]] ); }
+	// Gets the bin index of the feature of the vector (only for the binned data)
+	int GetUsedVectorBin( int index, int feature ) const { return binnedProblem->GetBin( ( *binnedVectors )[usedVectors[index]], feature ); }
 
 	// Gets the number of features
 	int GetFeatureCount() const { return nullValueIds.Size(); }
@@ -75,10 +97,11 @@ private:
 	CArray<int> nullValueIds; // the identifiers of the zero feature values
 	CArray<int> vectorData; // the vector data
 	CArray<int> vectorPtr; // the pointers to the data of the given vector
+	CPtr<const CGradientBoostBinnedProblem> binnedProblem; // the binned data used instead of vectorData
+	const CArray<int>* binnedVectors; // the index in the binned data of each vector of the full sample
 
-	void initializeFeatureInfo( int threadCount, int maxBins, const CFloatMatrixDesc& matrix,
-		const IMultivariateRegressionProblem& baseProblem );
-	void compressFeatureValues( int threadCount, int maxBins, double totalWeight,
+	void initializeFeatureIds();
+	static void compressFeatureValues( int threadCount, int maxBins, double totalWeight,
 		CArray< CArray<CFeatureValue> >& featureValues );
 	void buildVectorData( const CFloatMatrixDesc& matrix );
 };
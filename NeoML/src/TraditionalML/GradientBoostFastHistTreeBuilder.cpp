@@ -232,8 +232,8 @@ void CGradientBoostFastHistTreeBuilder<T>::buildHist( const CGradientBoostFastHi
 			int i = threadNumber;
 			while( i < node.VectorSetSize ) {
 				const int vectorIndex = vectorSet[node.VectorSetPtr + i];
-				addVectorToHist( problem.GetUsedVectorDataPtr( vectorIndex ), problem.GetUsedVectorDataSize( vectorIndex ),
-					gradients, hessians, weights, tempHistStats.GetPtr() + histSize * threadNumber, vectorIndex );
+				addVectorToHist( problem, gradients, hessians, weights, tempHistStats.GetPtr() + histSize * threadNumber,
+					vectorIndex );
 				results[threadNumber].Add( gradients, hessians, weights, vectorIndex );
 				i += params.ThreadCount;
 			}
@@ -255,12 +255,16 @@ void CGradientBoostFastHistTreeBuilder<T>::buildHist( const CGradientBoostFastHi
 		// There are few vectors in the set, build the histogram using only one thread
 		for( int i = 0; i < node.VectorSetSize; i++ ) {
 			const int vectorIndex = vectorSet[node.VectorSetPtr + i];
-			addVectorToHist( problem.GetUsedVectorDataPtr( vectorIndex ), problem.GetUsedVectorDataSize( vectorIndex ),
-				gradients, hessians, weights, histStatsPtr, vectorIndex );
+			addVectorToHist( problem, gradients, hessians, weights, histStatsPtr, vectorIndex );
 			totalStats.Add( gradients, hessians, weights, vectorIndex );
 		}
 	}
 
+	if( problem.IsBinned() ) {
+		// The binned vectors have the zero values in their bins already
+		return;
+	}
+
 	// Adding zero values
 	const CArray<int>& usedFeatures = problem.GetUsedFeatures();
 	const CArray<int>& featurePos = problem.GetFeaturePos();
@@ -280,9 +284,21 @@ void CGradientBoostFastHistTreeBuilder<T>::buildHist( const CGradientBoostFastHi
 
 // Adds a vector to the histogram
 template<class T>
-void CGradientBoostFastHistTreeBuilder<T>::addVectorToHist( const int* vectorPtr, int vectorSize,
+void CGradientBoostFastHistTreeBuilder<T>::addVectorToHist( const CGradientBoostFastHistProblem& problem,
 	const CArray<typename T::Type>& gradients, const CArray<typename T::Type>& hessians, const CArray<double>& weights, T* stats, int vectorIndex )
 {
+	if( problem.IsBinned() ) {
+		const unsigned char* bins = problem.GetUsedVectorBins( vectorIndex );
+		if( problem.GetBinSize() == 1 ) {
+			addBinsToHist( problem, bins, gradients, hessians, weights, stats, vectorIndex );
+		} else {
+			addBinsToHist( problem, reinterpret_cast<const unsigned short*>( bins ), gradients, hessians, weights, stats, vectorIndex );
+		}
+		return;
+	}
+
+	const int* vectorPtr = problem.GetUsedVectorDataPtr( vectorIndex );
+	const int vectorSize = problem.GetUsedVectorDataSize( vectorIndex );
 	NeoPresume( vectorPtr != 0 );
 	NeoPresume( vectorSize >= 0 );
 
@@ -294,6 +310,20 @@ void CGradientBoostFastHistTreeBuilder<T>::addVectorToHist( const int* vectorPtr
 	}
 }
 
+// Adds a binned vector to the histogram; only the used features are added
+template<class T>
+template<class TBin>
+void CGradientBoostFastHistTreeBuilder<T>::addBinsToHist( const CGradientBoostFastHistProblem& problem, const TBin* bins,
+	const CArray<typename T::Type>& gradients, const CArray<typename T::Type>& hessians, const CArray<double>& weights, T* stats, int vectorIndex )
+{
+	const CArray<int>& usedFeatures = problem.GetUsedFeatures();
+	const CArray<int>& featurePos = problem.GetFeaturePos();
+	for( int i = 0; i < usedFeatures.Size(); i++ ) {
+		const int feature = usedFeatures[i];
+		stats[idPos[featurePos[feature] + bins[feature]]].Add( gradients, hessians, weights, vectorIndex );
+	}
+}
+
 // Calculates the optimal feature value for splitting the node
 // Returns NotFound if splitting is impossible
 template<class T>
@@ -403,16 +433,21 @@ void CGradientBoostFastHistTreeBuilder<T>::applySplit( const CGradientBoostFastH
 		NeoAssert( threadNumber < params.ThreadCount );
 		int i = threadNumber;
 		while( i < vectorCount ) {
-			const int* vectorDataPtr = problem.GetUsedVectorDataPtr( vectorSet[vectorPtr + i] );
-			const int vectorDataSize = problem.GetUsedVectorDataSize( vectorSet[vectorPtr + i] );
-
-			const int pos = FindInsertionPoint<int, Ascending<int>, int>( nextId, vectorDataPtr, vectorDataSize );
 			int vectorFeatureId = NotFound; // the ID of the feature value used for split for this vector
-			if( pos == 0 || ( featureIndexes[vectorDataPtr[pos - 1]] != featureIndex ) ) {
-				// The vector contains no feature value for the split, therefore this value is 0
-				vectorFeatureId = featureNullValueId[featureIndex];
+			if( problem.IsBinned() ) {
+				vectorFeatureId = problem.GetFeaturePos()[featureIndex]
+					+ problem.GetUsedVectorBin( vectorSet[vectorPtr + i], featureIndex );
 			} else {
-				vectorFeatureId = vectorDataPtr[pos - 1];
+				const int* vectorDataPtr = problem.GetUsedVectorDataPtr( vectorSet[vectorPtr + i] );
+				const int vectorDataSize = problem.GetUsedVectorDataSize( vectorSet[vectorPtr + i] );
+
+				const int pos = FindInsertionPoint<int, Ascending<int>, int>( nextId, vectorDataPtr, vectorDataSize );
+				if( pos == 0 || ( featureIndexes[vectorDataPtr[pos - 1]] != featureIndex ) ) {
+					// The vector contains no feature value for the split, therefore this value is 0
+					vectorFeatureId = featureNullValueId[featureIndex];
+				} else {
+					vectorFeatureId = vectorDataPtr[pos - 1];
+				}
 			}
 
 			if( vectorFeatureId <= nodes[node].SplitFeatureId ) { // the value is smaller for the smaller ID
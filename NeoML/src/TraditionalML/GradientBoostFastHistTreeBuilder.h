@@ -107,7 +107,10 @@ private:
 	void buildHist( const CGradientBoostFastHistProblem& problem, const CNode& node,
 		const CArray<typename T::Type>& gradients, const CArray<typename T::Type>& hessians, const CArray<double>& weights,
 		T& totalStats );
-	void addVectorToHist( const int* vectorPtr, int vectorSize, const CArray<typename T::Type>& gradients, 
+	void addVectorToHist( const CGradientBoostFastHistProblem& problem, const CArray<typename T::Type>& gradients,
+		const CArray<typename T::Type>& hessians, const CArray<double>& weights, T* stats, int vectorIndex );
+	template<class TBin>
+	void addBinsToHist( const CGradientBoostFastHistProblem& problem, const TBin* bins, const CArray<typename T::Type>& gradients,
 		const CArray<typename T::Type>& hessians, const CArray<double>& weights, T* stats, int vectorIndex );
 	int evaluateSplit( const CGradientBoostFastHistProblem& problem, CNode& node ) const;
 	void applySplit( const CGradientBoostFastHistProblem& problem, int node, int& leftNode, int& rightNode );
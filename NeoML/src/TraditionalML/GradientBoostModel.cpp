@@ -18,6 +18,7 @@ limitations under the License.
 
 #include <GradientBoostModel.h>
 #include <CompactRegressionTree.h>
+#include <NeoMathEngine/OpenMP.h>
 
 namespace NeoML {
 
@@ -154,6 +155,19 @@ bool CGradientBoostModel::ClassifyEx( const CFloatVectorDesc& data, CArray<CClas
 	return true;
 }
 
+void CGradientBoostModel::ClassifyBatch( const CFloatMatrixDesc& data, CArray<CClassificationResult>& results,
+	int threadCount ) const
+{
+	NeoAssert( threadCount > 0 );
+
+	results.SetSize( data.Height );
+	const int curThreadCount = IsOmpRelevant( data.Height ) ? threadCount : 1;
+	NEOML_OMP_FOR_NUM_THREADS( curThreadCount )
+	for( int i = 0; i < data.Height; i++ ) {
+		Classify( data.GetRow( i ), results[i] );
+	}
+}
+
 void CGradientBoostModel::CalcFeatureStatistics( int maxFeature, CArray<int>& result ) const
 {
 	NeoAssert( maxFeature > 0 );
@@ -243,6 +257,18 @@ double CGradientBoostModel::Predict( const CFloatVectorDesc& data ) const
 	return predictions[0];
 }
 
+void CGradientBoostModel::PredictBatch( const CFloatMatrixDesc& data, CArray<double>& results, int threadCount ) const
+{
+	NeoAssert( threadCount > 0 );
+
+	results.SetSize( data.Height );
+	const int curThreadCount = IsOmpRelevant( data.Height ) ? threadCount : 1;
+	NEOML_OMP_FOR_NUM_THREADS( curThreadCount )
+	for( int i = 0; i < data.Height; i++ ) {
+		results[i] = Predict( data.GetRow( i ) );
+	}
+}
+
 // IMultivariateRegressionModel interface method
 CFloatVector CGradientBoostModel::MultivariatePredict( const CFloatVectorDesc& data ) const
 {
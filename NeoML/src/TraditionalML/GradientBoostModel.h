@@ -47,6 +47,7 @@ public:
 	CGradientBoost::TLossFunction GetLossFunction() const override { return lossFunction; }
 	bool ClassifyEx( const CSparseFloatVector& data, CArray<CClassificationResult>& results ) const override;
 	bool ClassifyEx( const CFloatVectorDesc& data, CArray<CClassificationResult>& results ) const override;
+	void ClassifyBatch( const CFloatMatrixDesc& data, CArray<CClassificationResult>& results, int threadCount ) const override;
 	void CalcFeatureStatistics( int maxFeature, CArray<int>& result ) const override;
 	void CutNumberOfTrees( int numberOfTrees ) override;
 	virtual void ConvertToCompact() override;
@@ -54,6 +55,9 @@ public:
 	// IRegressionModel interface methods
 	double Predict( const CFloatVectorDesc& data ) const override;
 
+	// IGradientBoostRegressionModel interface methods
+	void PredictBatch( const CFloatMatrixDesc& data, CArray<double>& results, int threadCount ) const override;
+
 	// IMultivariateRegressionModel interface methods
 	CFloatVector MultivariatePredict( const CFloatVectorDesc& data ) const override;
 
@@ -34,6 +34,7 @@ limitations under the License.
 
 #include <GradientBoostQSEnsemble.h>
 #include <SerializeCompact.h>
+#include <NeoMathEngine/OpenMP.h>
 
 namespace NeoML {
 
@@ -317,7 +318,7 @@ double CGradientBoostQSEnsemble::Predict( const CFloatVectorDesc& data ) const
 		}
 	}
 
-	return calculateScore( data, resultBitvectors, GetTreesCount() - 1 );
+	return calculateScore( data, resultBitvectors.GetPtr(), 1, GetTreesCount() - 1 );
 }
 
 double CGradientBoostQSEnsemble::Predict( const CFloatVectorDesc& data, int lastTreeIndex ) const
@@ -336,7 +337,48 @@ double CGradientBoostQSEnsemble::Predict( const CFloatVectorDesc& data, int last
 		}
 	}
 
-	return calculateScore( data, resultBitvectors, lastTreeIndex );
+	return calculateScore( data, resultBitvectors.GetPtr(), 1, lastTreeIndex );
+}
+
+void CGradientBoostQSEnsemble::Predict( const CFloatMatrixDesc& data, int threadCount, CArray<double>& results ) const
+{
+	NeoAssert( threadCount > 0 );
+
+	results.SetSize( data.Height );
+	if( data.Height == 0 ) {
+		return;
+	}
+
+	// The features used in the optimized nodes, in ascending order
+	CArray<int> features;
+	features.SetBufferSize( featureQsNodesOffsets.Size() );
+	for( TMapPosition pos = featureQsNodesOffsets.GetFirstPosition(); pos != NotFound;
+		pos = featureQsNodesOffsets.GetNextPosition( pos ) )
+	{
+		features.Add( featureQsNodesOffsets.GetKey( pos ) );
+	}
+	features.QuickSort<Ascending<int>>();
+
+	const int blockCount = ( data.Height + QSBatchBlockSize - 1 ) / QSBatchBlockSize;
+	const int curThreadCount = IsOmpRelevant( blockCount,
+		static_cast<int64_t>( data.Height ) * max( 1, qsNodes.Size() ) ) ? threadCount : 1;
+
+	NEOML_OMP_NUM_THREADS( curThreadCount )
+	{
+		CArray<unsigned __int64> bitvectors;
+		CArray<float> values;
+		CArray<int> positions;
+
+		int blockIndex = 0;
+		int count = 0;
+		if( OmpGetTaskIndexAndCount( blockCount, blockIndex, count ) ) {
+			for( int i = blockIndex; i < blockIndex + count; i++ ) {
+				const int firstRow = i * QSBatchBlockSize;
+				const int rowCount = min( QSBatchBlockSize, data.Height - firstRow );
+				predictBlock( data, features, firstRow, rowCount, bitvectors, values, positions, results.GetPtr() + firstRow );
+			}
+		}
+	}
 }
 
 CArchive& operator<<( CArchive& archive, const CGradientBoostQSEnsemble& block )
@@ -736,6 +778,81 @@ void CGradientBoostQSEnsemble::processFeature( int featureIndex, float value, CF
 	}
 }
 
+// Applies the masks of the nodes of one feature to a block of rows
+// The bitvectors of one tree are stored together, QSBatchBlockSize elements per tree
+// The nodes are sorted by threshold, so the search stops at the first node which is fulfilled for all rows
+void CGradientBoostQSEnsemble::processFeatureBlock( const CQSNodeOffset& offset, const float* values, int rowCount,
+	unsigned __int64* bitvectors ) const
+{
+	if( offset.Less.Begin != NotFound ) {
+		for( int i = offset.Less.Begin; i <= offset.Less.End; i++ ) {
+			const CQSNode& node = qsNodes[i];
+			unsigned __int64* treeBitvectors = bitvectors + node.Tree * QSBatchBlockSize;
+			bool isUsed = false;
+			for( int row = 0; row < rowCount; row++ ) {
+				const bool isUnfulfilled = node.Threshold < values[row];
+				treeBitvectors[row] &= isUnfulfilled ? node.Mask : ~0ULL;
+				isUsed |= isUnfulfilled;
+			}
+			if( !isUsed ) {
+				break;
+			}
+		}
+	}
+
+	if( offset.More.Begin != NotFound ) {
+		for( int i = offset.More.Begin; i <= offset.More.End; i++ ) {
+			const CQSNode& node = qsNodes[i];
+			unsigned __int64* treeBitvectors = bitvectors + node.Tree * QSBatchBlockSize;
+			bool isUsed = false;
+			for( int row = 0; row < rowCount; row++ ) {
+				const bool isUnfulfilled = node.Threshold >= values[row];
+				treeBitvectors[row] &= isUnfulfilled ? node.Mask : ~0ULL;
+				isUsed |= isUnfulfilled;
+			}
+			if( !isUsed ) {
+				break;
+			}
+		}
+	}
+}
+
+// Scores a block of rows
+// The zero value does not change the bit masks, so the features missing from a row are passed as zeros
+void CGradientBoostQSEnsemble::predictBlock( const CFloatMatrixDesc& data, const CArray<int>& features, int firstRow, int rowCount,
+	CArray<unsigned __int64>& bitvectors, CArray<float>& values, CArray<int>& positions, double* results ) const
+{
+	bitvectors.SetSize( GetTreesCount() * QSBatchBlockSize );
+	memset( bitvectors.GetPtr(), ~0, bitvectors.Size() * sizeof( unsigned __int64 ) );
+	values.SetSize( QSBatchBlockSize );
+	positions.SetSize( QSBatchBlockSize );
+	for( int row = 0; row < rowCount; row++ ) {
+		positions[row] = data.PointerB[firstRow + row];
+	}
+
+	for( int i = 0; i < features.Size(); i++ ) {
+		const int feature = features[i];
+		for( int row = 0; row < rowCount; row++ ) {
+			const int end = data.PointerE[firstRow + row];
+			int& pos = positions[row];
+			if( data.Columns == nullptr ) {
+				values[row] = ( pos + feature < end ) ? data.Values[pos + feature] : 0.f;
+			} else {
+				while( pos < end && data.Columns[pos] < feature ) {
+					pos++;
+				}
+				values[row] = ( pos < end && data.Columns[pos] == feature ) ? data.Values[pos] : 0.f;
+			}
+		}
+		processFeatureBlock( featureQsNodesOffsets.Get( feature ), values.GetPtr(), rowCount, bitvectors.GetPtr() );
+	}
+
+	for( int row = 0; row < rowCount; row++ ) {
+		results[row] = calculateScore( data.GetRow( firstRow + row ), bitvectors.GetPtr() + row,
+			QSBatchBlockSize, GetTreesCount() - 1 );
+	}
+}
+
 static inline float getFeatureValue( const CFloatVectorDesc& data, int index )
 {
 	float result;
@@ -747,13 +864,15 @@ static inline float getFeatureValue( const CFloatVectorDesc& data, int index )
 // The leaves are numbered left to right (all masks are inverted), so look for the lowest nonzero bit
 // In each bitvector the leaf we need has the index of the lowest nonzero
 // If it is a leaf in the original tree, take its value, if a subtree call its Predict method
-double CGradientBoostQSEnsemble::calculateScore( const CFloatVectorDesc& data, const CFastArray<unsigned __int64, 512>& bitvectors, int lastTreeIndex ) const
+// The bitvector of the tree i is bitvectors[i * stride]
+double CGradientBoostQSEnsemble::calculateScore( const CFloatVectorDesc& data, const unsigned __int64* bitvectors, int stride,
+	int lastTreeIndex ) const
 {
 	float score = 0.0;
 	int prev = -1;
 	const int end = min( lastTreeIndex, GetTreesCount() - 1 );
 	for( int i = 0; i <= end; i++ ) {
-		const int leafIndex = findLowestBitIndex( bitvectors[i] );
+		const int leafIndex = findLowestBitIndex( bitvectors[i * stride] );
 		const int currentTreeOffset = treeQsLeavesOffsets[i];
 		NeoAssert( prev != currentTreeOffset );
 		prev = currentTreeOffset;
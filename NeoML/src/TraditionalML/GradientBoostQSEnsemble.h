@@ -21,6 +21,7 @@ namespace NeoML {
 
 const int MaxQSLeavesCount = 64; // maximum number of leaves in a subtree that can be optimized
 const int MaxTreesCount = 32767; // maximum supported number of trees in an ensemble
+const int QSBatchBlockSize = 64; // the number of vectors scored together in batch prediction
 
 const unsigned char PM_Inverted = 1; // the node is inverted
 const unsigned char PM_LeftLeaf = 2; // the left child is a leaf in the optimized subtree
@@ -96,6 +97,12 @@ public:
 	// The prediction method that uses only the trees in the 0 to lastTreeIndex range
 	double Predict( const CFloatVectorDesc& data, int lastTreeIndex ) const;
 
+	// Batch prediction for all rows of the matrix
+	// The rows are processed in blocks of QSBatchBlockSize: each node is checked for all the rows of a block at once,
+	// going over the features in ascending order. The blocks are distributed among threadCount threads
+	// The indices in the sparse rows must be sorted
+	void Predict( const CFloatMatrixDesc& data, int threadCount, CArray<double>& results ) const;
+
 	// Gets the number of trees in the ensemble
 	int GetTreesCount() const { return treeQsLeavesOffsets.Size(); };
 
@@ -128,7 +135,10 @@ private:
 	void buildFeatureNodesOffsets( const CArray<int>& features );
 
 	void processFeature( int feature, float value, CFastArray<unsigned __int64, 512>& bitvectors ) const;
-	double calculateScore( const CFloatVectorDesc& data, const CFastArray<unsigned __int64, 512>& bitvectors, int lastTreeIndex ) const;
+	void processFeatureBlock( const CQSNodeOffset& offset, const float* values, int rowCount, unsigned __int64* bitvectors ) const;
+	void predictBlock( const CFloatMatrixDesc& data, const CArray<int>& features, int firstRow, int rowCount,
+		CArray<unsigned __int64>& bitvectors, CArray<float>& values, CArray<int>& positions, double* results ) const;
+	double calculateScore( const CFloatVectorDesc& data, const unsigned __int64* bitvectors, int stride, int lastTreeIndex ) const;
 };
 
 } // namespace NeoML
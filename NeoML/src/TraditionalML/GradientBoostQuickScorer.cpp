@@ -18,6 +18,7 @@ limitations under the License.
 
 #include <NeoML/TraditionalML/GradientBoostQuickScorer.h>
 #include <GradientBoostQSEnsemble.h>
+#include <NeoMathEngine/OpenMP.h>
 
 namespace NeoML {
 
@@ -60,10 +61,14 @@ public:
 	// IGradientBoostQSModel interface methods
 	bool ClassifyEx( const CSparseFloatVector& data, CArray<CClassificationResult>& results ) const override;
 	bool ClassifyEx( const CFloatVectorDesc& data, CArray<CClassificationResult>& results ) const override;
+	void ClassifyBatch( const CFloatMatrixDesc& data, CArray<CClassificationResult>& results, int threadCount ) const override;
 
 	// IRegressionModel interface method
 	double Predict( const CFloatVectorDesc& data ) const override;
 
+	// IGradientBoostQSRegressionModel interface methods
+	void PredictBatch( const CFloatMatrixDesc& data, CArray<double>& results, int threadCount ) const override;
+
 	// General methods
 	double GetLearningRate() const override { return learningRate; };
 	void Serialize( CArchive& archive ) override;
@@ -152,6 +157,43 @@ bool CGradientBoostQSModel::ClassifyEx( const CFloatVectorDesc& data, CArray<CCl
 	return true;
 }
 
+void CGradientBoostQSModel::ClassifyBatch( const CFloatMatrixDesc& data, CArray<CClassificationResult>& results,
+	int threadCount ) const
+{
+	NeoAssert( !ensembles.IsEmpty() );
+
+	// The scores of all ensembles, one array per ensemble
+	CArray<CArray<double>> scores;
+	scores.SetSize( ensembles.Size() );
+	for( int ensembleIndex = 0; ensembleIndex < ensembles.Size(); ensembleIndex++ ) {
+		ensembles[ensembleIndex]->Predict( data, threadCount, scores[ensembleIndex] );
+	}
+
+	results.SetSize( data.Height );
+	const int curThreadCount = IsOmpRelevant( data.Height ) ? threadCount : 1;
+	NEOML_OMP_FOR_NUM_THREADS( curThreadCount )
+	for( int i = 0; i < data.Height; i++ ) {
+		if( GetClassCount() == 2 ) {
+			classify( scores[0][i] * learningRate, results[i] );
+		} else {
+			CArray<double> predictions;
+			predictions.SetBufferSize( ensembles.Size() );
+			for( int ensembleIndex = 0; ensembleIndex < ensembles.Size(); ensembleIndex++ ) {
+				predictions.Add( scores[ensembleIndex][i] );
+			}
+			classify( predictions, results[i] );
+		}
+	}
+}
+
+void CGradientBoostQSModel::PredictBatch( const CFloatMatrixDesc& data, CArray<double>& results, int threadCount ) const
+{
+	ensembles.First()->Predict( data, threadCount, results );
+	for( int i = 0; i < results.Size(); i++ ) {
+		results[i] *= learningRate;
+	}
+}
+
 void CGradientBoostQSModel::Serialize( CArchive& archive )
 {
 	archive.SerializeVersion( 0 );
@@ -170,6 +170,26 @@ CMultivariateRegressionProblemNotNullWeightsView::CMultivariateRegressionProblem
 {
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////
+// CMultivariateRegressionOverBinnedProblem
+
+CMultivariateRegressionOverBinnedProblem::CMultivariateRegressionOverBinnedProblem(
+		const CGradientBoostBinnedProblem* _inner, const CArray<int>& _vectorIndices ) :
+	inner( _inner ),
+	vectorIndices( _vectorIndices )
+{
+	NeoAssert( inner != nullptr );
+}
+
+// Gets the function value for the vector with the given index in the data set
+CFloatVector CMultivariateRegressionOverBinnedProblem::GetValue( int index ) const
+{
+	CFloatVectorDesc desc;
+	desc.Size = inner->GetValueSize();
+	desc.Values = const_cast<float*>( inner->GetValue( vectorIndices[index] ) );
+	return CFloatVector( desc.Size, desc );
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////
 
 } // namespace NeoML
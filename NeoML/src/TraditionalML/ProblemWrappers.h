@@ -16,6 +16,7 @@ limitations under the License.
 #pragma once
 
 #include <NeoML/TraditionalML/Problem.h>
+#include <NeoML/TraditionalML/GradientBoostBinnedProblem.h>
 
 namespace NeoML {
 
@@ -178,6 +179,38 @@ private:
 	const CPtr<const IMultivariateRegressionProblem> inner;
 };
 
+/////////////////////////////////////////////////////////////////////////////////////////
+// A multivariate regression problem created from a binned gradient boosting problem
+// Only the binned vectors with the given indices are used (the vectors with null weight are left out)
+// The vectors are not stored as a matrix, GetMatrix returns an empty matrix
+// Can be used only with an assumption that the indices array won't be changed during this class usage
+
+class CMultivariateRegressionOverBinnedProblem : public IMultivariateRegressionProblem {
+public:
+	CMultivariateRegressionOverBinnedProblem( const CGradientBoostBinnedProblem* inner, const CArray<int>& vectorIndices );
+
+	// Gets the number of features
+	int GetFeatureCount() const override;
+
+	// The number of vectors in the data set
+	int GetVectorCount() const override;
+	// Gets all vectors in the data set as a matrix
+	CFloatMatrixDesc GetMatrix() const override;
+	// Gets the vector weight
+	double GetVectorWeight( int index ) const override;
+
+	// Gets the length of the function value vector
+	int GetValueSize() const override;
+	// Gets the function value for the vector
+	CFloatVector GetValue( int index ) const override;
+
+private:
+	// The inner binned problem
+	const CPtr<const CGradientBoostBinnedProblem> inner;
+	// The index in the inner problem of each vector
+	const CArray<int>& vectorIndices;
+};
+
 /////////////////////////////////////////////////////////////////////////////////////////
 
 } // namespace NeoML
@@ -158,6 +158,41 @@ inline CFloatVector CMultivariateRegressionProblemNotNullWeightsView::GetValue(
 	return inner->GetValue( CalculateOriginalIndex( index ) );
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////
+// CMultivariateRegressionOverBinnedProblem
+
+// Gets the number of features
+inline int CMultivariateRegressionOverBinnedProblem::GetFeatureCount() const
+{
+	return inner->GetFeatureCount();
+}
+
+// Gets the number of vectors in the data set
+inline int CMultivariateRegressionOverBinnedProblem::GetVectorCount() const
+{
+	return vectorIndices.Size();
+}
+
+// Gets all vectors from the data set as a matrix
+inline CFloatMatrixDesc CMultivariateRegressionOverBinnedProblem::GetMatrix() const
+{
+	return CFloatMatrixDesc::Empty;
+}
+
+// Gets the vector weight
+inline double CMultivariateRegressionOverBinnedProblem::GetVectorWeight( int index ) const
+{
+	NeoPresume( index < GetVectorCount() );
+
+	return inner->GetVectorWeight( vectorIndices[index] );
+}
+
+// Gets the length of the function value vector
+inline int CMultivariateRegressionOverBinnedProblem::GetValueSize() const
+{
+	return inner->GetValueSize();
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////
 
 } // namespace NeoML
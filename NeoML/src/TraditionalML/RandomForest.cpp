@@ -0,0 +1,108 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <common.h>
+#pragma hdrstop
+
+#include <NeoML/TraditionalML/RandomForest.h>
+#include <RandomForestModel.h>
+#include <DecisionTreeFastHistProblem.h>
+#include <NeoMathEngine/OpenMP.h>
+#include <math.h>
+
+namespace NeoML {
+
+IRandomForestModel::~IRandomForestModel()
+{
+}
+
+//---------------------------------------------------------------------------------------------------------
+
+CRandomForest::CRandomForest( const CParams& _params ) :
+	params( _params )
+{
+	NeoAssert( params.TreeCount > 0 );
+	NeoAssert( 0 < params.Subsample && params.Subsample <= 1 );
+	NeoAssert( params.ThreadCount > 0 );
+	NeoAssert( params.TreeParams.MulticlassMode == MM_SingleClassifier );
+}
+
+CRandomForest::~CRandomForest()
+{
+}
+
+CPtr<IModel> CRandomForest::Train( const IProblem& problem )
+{
+	const int vectorCount = problem.GetVectorCount();
+	const int featureCount = problem.GetFeatureCount();
+	NeoAssert( vectorCount > 0 );
+	NeoAssert( problem.GetClassCount() > 0 );
+	NeoAssert( featureCount > 0 );
+
+	// The trees are trained in parallel, so each of them uses a single thread
+	CDecisionTree::CParams treeParams = params.TreeParams;
+	treeParams.ThreadCount = 1;
+	if( treeParams.RandomSelectedFeaturesCount == NotFound ) {
+		const int selectedFeaturesCount = static_cast<int>( sqrt( static_cast<double>( featureCount ) ) );
+		if( selectedFeaturesCount < featureCount ) {
+			treeParams.RandomSelectedFeaturesCount = selectedFeaturesCount;
+		}
+	}
+	const int sampleSize = max( 1, static_cast<int>( vectorCount * params.Subsample ) );
+
+	// The samples refer to the problem vectors by index, so the vectors and the histogram data are shared by all trees
+	CPtr<CDecisionTreeFastHistProblem> histProblem;
+	if( treeParams.TreeBuilder == CDecisionTree::TB_FastHist ) {
+		histProblem = FINE_DEBUG_NEW CDecisionTreeFastHistProblem( params.ThreadCount, treeParams.MaxBins, problem );
+	}
+
+	// Each tree gets its own random generator, so the forest doesn't depend on the number of threads
+	CRandom defaultRandom;
+	CRandom& random = params.Random != 0 ? *params.Random : defaultRandom;
+	CArray<unsigned int> seeds;
+	seeds.SetBufferSize( params.TreeCount );
+	for( int i = 0; i < params.TreeCount; i++ ) {
+		seeds.Add( random.Next() );
+	}
+
+	CObjectArray<IModel> trees;
+	trees.SetSize( params.TreeCount );
+	const int curThreadCount = IsOmpRelevant( params.TreeCount ) ? params.ThreadCount : 1;
+	NEOML_OMP_FOR_NUM_THREADS( curThreadCount )
+	for( int i = 0; i < params.TreeCount; i++ ) {
+		CRandom treeRandom( seeds[i] );
+		CDecisionTree tree( treeParams, &treeRandom );
+
+		// The bootstrap sample; the vectors are sorted to be read in the same order as they are stored
+		tree.sample.SetBufferSize( sampleSize );
+		for( int j = 0; j < sampleSize; j++ ) {
+			tree.sample.Add( treeRandom.UniformInt( 0, vectorCount - 1 ) );
+		}
+		tree.sample.QuickSort< Ascending<int> >();
+
+		trees.ReplaceAt( tree.trainOnSample( problem, histProblem ), i );
+	}
+
+	// The trees are converted into the flat arrays of the model
+	CPtr<CRandomForestModel> model = FINE_DEBUG_NEW CRandomForestModel( problem.GetClassCount() );
+	for( int i = 0; i < trees.Size(); i++ ) {
+		const IDecisionTreeModel* tree = dynamic_cast<const IDecisionTreeModel*>( trees[i].Ptr() );
+		NeoAssert( tree != nullptr );
+		model->AddTree( *tree );
+	}
+	return model.Ptr();
+}
+
+} // namespace NeoML
@@ -0,0 +1,247 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <common.h>
+#pragma hdrstop
+
+#include <RandomForestModel.h>
+#include <NeoMathEngine/OpenMP.h>
+#include <float.h>
+#include <math.h>
+
+namespace NeoML {
+
+REGISTER_NEOML_MODEL( CRandomForestModel, RandomForestModelName )
+
+// The number of vectors for which each tree is traversed at once in ClassifyBatch
+static const int RandomForestBatchBlockSize = 64;
+
+CRandomForestModel::CRandomForestModel( int _classCount ) :
+	classCount( _classCount )
+{
+	NeoAssert( classCount > 0 );
+}
+
+void CRandomForestModel::AddTree( const IDecisionTreeModel& tree )
+{
+	const int root = nodes.Size();
+	nodes.Add( CNode() );
+	addNode( root, tree );
+	treeRoots.Add( root );
+}
+
+bool CRandomForestModel::Classify( const CFloatVectorDesc& data, CClassificationResult& result ) const
+{
+	NeoAssert( !treeRoots.IsEmpty() );
+
+	CArray<double> probabilities;
+	probabilities.Add( 0.0, classCount );
+	for( int i = 0; i < treeRoots.Size(); i++ ) {
+		const float* treePredictions = getPredictions( treeRoots[i], data );
+		for( int j = 0; j < classCount; j++ ) {
+			probabilities[j] += treePredictions[j];
+		}
+	}
+	fillResult( probabilities.GetPtr(), result );
+	return true;
+}
+
+void CRandomForestModel::ClassifyBatch( const CFloatMatrixDesc& data, CArray<CClassificationResult>& results,
+	int threadCount ) const
+{
+	NeoAssert( threadCount > 0 );
+	NeoAssert( !treeRoots.IsEmpty() );
+
+	results.SetSize( data.Height );
+	const int blockCount = ( data.Height + RandomForestBatchBlockSize - 1 ) / RandomForestBatchBlockSize;
+	const int curThreadCount = IsOmpRelevant( blockCount, static_cast<int64_t>( data.Height ) * treeRoots.Size() )
+		? threadCount : 1;
+
+	NEOML_OMP_NUM_THREADS( curThreadCount )
+	{
+		int firstBlock = 0;
+		int threadBlockCount = 0;
+		if( OmpGetTaskIndexAndCount( blockCount, firstBlock, threadBlockCount ) ) {
+			CFloatVectorDesc rows[RandomForestBatchBlockSize];
+			CArray<double> probabilities;
+			for( int block = firstBlock; block < firstBlock + threadBlockCount; block++ ) {
+				const int begin = block * RandomForestBatchBlockSize;
+				const int size = min( RandomForestBatchBlockSize, data.Height - begin );
+				for( int i = 0; i < size; i++ ) {
+					data.GetRow( begin + i, rows[i] );
+				}
+				probabilities.Empty();
+				probabilities.Add( 0.0, size * classCount );
+
+				// Traverse each tree for the whole block while its nodes are in cache
+				for( int t = 0; t < treeRoots.Size(); t++ ) {
+					for( int i = 0; i < size; i++ ) {
+						const float* treePredictions = getPredictions( treeRoots[t], rows[i] );
+						double* rowProbabilities = probabilities.GetPtr() + i * classCount;
+						for( int j = 0; j < classCount; j++ ) {
+							rowProbabilities[j] += treePredictions[j];
+						}
+					}
+				}
+
+				for( int i = 0; i < size; i++ ) {
+					fillResult( probabilities.GetPtr() + i * classCount, results[begin + i] );
+				}
+			}
+		}
+	}
+}
+
+void CRandomForestModel::Serialize( CArchive& archive )
+{
+	archive.SerializeVersion( 0 );
+
+	if( archive.IsStoring() ) {
+		archive << classCount;
+		archive << nodes.Size();
+		for( int i = 0; i < nodes.Size(); i++ ) {
+			const CNode& node = nodes[i];
+			archive << node.Feature << node.Threshold << node.Child << node.Values << node.ValueCount << node.Predictions;
+		}
+		archive << treeRoots;
+		archive << discreteValues;
+		archive << predictions;
+	} else if( archive.IsLoading() ) {
+		archive >> classCount;
+		int nodeCount = 0;
+		archive >> nodeCount;
+		nodes.SetSize( nodeCount );
+		for( int i = 0; i < nodes.Size(); i++ ) {
+			CNode& node = nodes[i];
+			archive >> node.Feature >> node.Threshold >> node.Child >> node.Values >> node.ValueCount >> node.Predictions;
+		}
+		archive >> treeRoots;
+		archive >> discreteValues;
+		archive >> predictions;
+	} else {
+		NeoAssert( false );
+	}
+}
+
+// Fills the node with the given index and adds its subtree
+void CRandomForestModel::addNode( int index, const IDecisionTreeModel& treeNode )
+{
+	CDecisionTreeNodeInfo info;
+	treeNode.GetNodeInfo( info );
+
+	CNode node;
+	node.Feature = NotFound;
+	node.Threshold = 0;
+	node.Child = NotFound;
+	node.Values = NotFound;
+	node.ValueCount = 0;
+	node.Predictions = NotFound;
+
+	switch( info.Type ) {
+		case DTNT_Const:
+			node.Predictions = addPredictions( info.Probabilities );
+			break;
+		case DTNT_Continuous:
+		{
+			node.Feature = info.FeatureIndex;
+			// The float threshold is the largest float not greater than the original one,
+			// so the comparison with the float feature values gives the same result
+			node.Threshold = static_cast<float>( info.Values[0] );
+			if( node.Threshold > info.Values[0] ) {
+				node.Threshold = nextafterf( node.Threshold, -FLT_MAX );
+			}
+			node.Child = nodes.Size();
+			nodes.Add( CNode(), 2 );
+			break;
+		}
+		case DTNT_Discrete:
+			node.Feature = info.FeatureIndex;
+			node.Values = discreteValues.Size();
+			node.ValueCount = info.Values.Size();
+			for( int i = 0; i < info.Values.Size(); i++ ) {
+				discreteValues.Add( static_cast<float>( info.Values[i] ) );
+			}
+			node.Predictions = addPredictions( info.Probabilities );
+			node.Child = nodes.Size();
+			nodes.Add( CNode(), info.Values.Size() );
+			break;
+		default:
+			NeoAssert( false );
+	}
+	nodes[index] = node;
+
+	const int childCount = treeNode.GetChildrenCount();
+	for( int i = 0; i < childCount; i++ ) {
+		addNode( node.Child + i, *treeNode.GetChild( i ) );
+	}
+}
+
+// Adds the node class probabilities and returns their position
+int CRandomForestModel::addPredictions( const CArray<CClassificationProbability>& probabilities )
+{
+	NeoAssert( probabilities.Size() == classCount );
+	const int result = predictions.Size();
+	for( int i = 0; i < probabilities.Size(); i++ ) {
+		predictions.Add( static_cast<float>( probabilities[i].GetValue() ) );
+	}
+	return result;
+}
+
+// Gets the class probabilities predicted by the tree
+const float* CRandomForestModel::getPredictions( int root, const CFloatVectorDesc& data ) const
+{
+	int index = root;
+	while( true ) {
+		const CNode& node = nodes[index];
+		if( node.Feature == NotFound ) {
+			return predictions.GetPtr() + node.Predictions;
+		}
+
+		float value = 0;
+		GetValue( data, node.Feature, value );
+		if( node.ValueCount == 0 ) {
+			index = value <= node.Threshold ? node.Child : node.Child + 1;
+			continue;
+		}
+
+		const float* values = discreteValues.GetPtr() + node.Values;
+		int valueIndex = 0;
+		while( valueIndex < node.ValueCount && values[valueIndex] != value ) {
+			valueIndex++;
+		}
+		if( valueIndex == node.ValueCount ) {
+			// An unknown value of the discrete feature, the node itself makes the prediction
+			return predictions.GetPtr() + node.Predictions;
+		}
+		index = node.Child + valueIndex;
+	}
+}
+
+// Fills the classification result using the sum of the trees predictions
+void CRandomForestModel::fillResult( const double* probabilities, CClassificationResult& result ) const
+{
+	result.PreferredClass = 0;
+	result.ExceptionProbability = CClassificationProbability( 0 );
+	result.Probabilities.Empty();
+	result.Probabilities.SetBufferSize( classCount );
+	for( int i = 0; i < classCount; i++ ) {
+		result.Probabilities.Add( CClassificationProbability( probabilities[i] / treeRoots.Size() ) );
+		if( probabilities[i] > probabilities[result.PreferredClass] ) {
+			result.PreferredClass = i;
+		}
+	}
+}
+
+} // namespace NeoML
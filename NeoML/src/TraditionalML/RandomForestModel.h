@@ -0,0 +1,76 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <NeoML/TraditionalML/RandomForest.h>
+
+namespace NeoML {
+
+// The random forest model
+// All trees are stored in flat arrays: the nodes of each tree follow its root and the children of a node are consecutive
+class CRandomForestModel : public IRandomForestModel {
+public:
+	CRandomForestModel() : classCount( 0 ) {}
+	explicit CRandomForestModel( int classCount );
+
+	// For serialization
+	static CPtr<IModel> Create() { return FINE_DEBUG_NEW CRandomForestModel(); }
+
+	// Adds a trained decision tree to the forest
+	void AddTree( const IDecisionTreeModel& tree );
+
+	// IRandomForestModel interface methods
+	int GetTreeCount() const override { return treeRoots.Size(); }
+	void ClassifyBatch( const CFloatMatrixDesc& data, CArray<CClassificationResult>& results, int threadCount ) const override;
+
+	// IModel interface methods
+	int GetClassCount() const override { return classCount; }
+	bool Classify( const CFloatVectorDesc& data, CClassificationResult& result ) const override;
+	void Serialize( CArchive& archive ) override;
+
+protected:
+	virtual ~CRandomForestModel() {} // delete prohibited
+
+private:
+	// A tree node
+	struct CNode {
+		// The feature by which the node is split; NotFound for the leaves
+		int Feature;
+		// The threshold for a continuous feature: the vector goes to the first child if the value is not greater
+		float Threshold;
+		// The index of the first child node
+		int Child;
+		// The position of the discrete feature values in discreteValues; the vector goes to the child with the same number
+		int Values;
+		// The number of the discrete feature values; 0 for a continuous feature
+		int ValueCount;
+		// The position of the class probabilities in predictions; NotFound for the continuous feature nodes
+		int Predictions;
+	};
+
+	int classCount; // the number of classes
+	CArray<CNode> nodes; // the nodes of all trees
+	CArray<int> treeRoots; // the root node index for each tree
+	CArray<float> discreteValues; // the values of the discrete features for the splits
+	CArray<float> predictions; // the class probabilities of the nodes
+
+	void addNode( int index, const IDecisionTreeModel& treeNode );
+	int addPredictions( const CArray<CClassificationProbability>& probabilities );
+	const float* getPredictions( int root, const CFloatVectorDesc& data ) const;
+	void fillResult( const double* probabilities, CClassificationResult& result ) const;
+};
+
+} // namespace NeoML
@@ -327,6 +327,147 @@ TEST_F( RandomBinaryClassification4000x20, DecisionTree )
 	TestBinaryClassificationResult();
 }
 
+TEST_F( RandomBinaryClassification4000x20, DecisionTreeThreads )
+{
+	CDecisionTree::CParams param;
+	CDecisionTree decisionTree( param );
+	CPtr<IModel> model = decisionTree.Train( *DenseRandomBinaryProblem );
+	ASSERT_TRUE( model != nullptr );
+
+	// The tree must not depend on the number of threads or the number of passes over the data
+	param.ThreadCount = 4;
+	CDecisionTree parallelDecisionTree( param );
+	TrainBinary( parallelDecisionTree );
+	param.AvailableMemory = 4 * Megabyte;
+	CDecisionTree limitedDecisionTree( param );
+	CPtr<IModel> limitedModel = limitedDecisionTree.Train( *SparseRandomBinaryProblem );
+	ASSERT_TRUE( limitedModel != nullptr );
+
+	for( int i = 0; i < DenseBinaryTestData->GetVectorCount(); i++ ) {
+		CClassificationResult expected;
+		ASSERT_TRUE( model->Classify( DenseBinaryTestData->GetVector( i ), expected ) );
+		for( const IModel* other : { ModelDense.Ptr(), ModelSparse.Ptr(), limitedModel.Ptr() } ) {
+			CClassificationResult result;
+			ASSERT_TRUE( other->Classify( DenseBinaryTestData->GetVector( i ), result ) );
+			ASSERT_EQ( expected.PreferredClass, result.PreferredClass );
+			ASSERT_EQ( expected.Probabilities.Size(), result.Probabilities.Size() );
+			for( int j = 0; j < expected.Probabilities.Size(); j++ ) {
+				ASSERT_EQ( expected.Probabilities[j].GetValue(), result.Probabilities[j].GetValue() );
+			}
+		}
+	}
+}
+
+TEST_F( RandomBinaryClassification4000x20, DecisionTreeFastHist )
+{
+	CDecisionTree::CParams param;
+	param.TreeBuilder = CDecisionTree::TB_FastHist;
+	param.ThreadCount = 4;
+	CDecisionTree decisionTree( param );
+	TrainBinary( decisionTree );
+	TestBinaryClassificationResult();
+}
+
+TEST_F( RandomMultiClassification2000x20, DecisionTreeFastHist )
+{
+	CDecisionTree::CParams param;
+	param.TreeBuilder = CDecisionTree::TB_FastHist;
+	param.MaxBins = 16;
+	param.ThreadCount = 4;
+	CDecisionTree decisionTree( param );
+	TrainMulti( decisionTree );
+	TestMultiClassificationResult();
+}
+
+TEST_F( RandomBinaryClassification4000x20, RandomForest )
+{
+	CRandomForest::CParams param;
+	param.TreeCount = 20;
+	CRandomForest forest( param );
+	TrainBinary( forest );
+	TestBinaryClassificationResult();
+}
+
+TEST_F( RandomBinaryClassification4000x20, RandomForestThreads )
+{
+	CRandom random( 0 );
+	CRandomForest::CParams param;
+	param.TreeCount = 10;
+	param.Subsample = 0.5;
+	param.TreeParams.TreeBuilder = CDecisionTree::TB_Full;
+	param.Random = &random;
+	CRandomForest forest( param );
+	CPtr<IRandomForestModel> model = forest.TrainModel<IRandomForestModel>( *DenseRandomBinaryProblem );
+	ASSERT_EQ( 10, model->GetTreeCount() );
+
+	// The forest must not depend on the number of threads
+	random.Reset( 0 );
+	param.ThreadCount = 4;
+	CRandomForest parallelForest( param );
+	CPtr<IRandomForestModel> parallelModel = parallelForest.TrainModel<IRandomForestModel>( *SparseRandomBinaryProblem );
+
+	// The batch classification must give the same results as the classification of single vectors
+	for( const CClassificationRandomProblem* testData : { DenseBinaryTestData, SparseBinaryTestData } ) {
+		CArray<CClassificationResult> batchResults;
+		parallelModel->ClassifyBatch( testData->GetMatrix(), batchResults, 4 );
+		ASSERT_EQ( testData->GetVectorCount(), batchResults.Size() );
+		for( int i = 0; i < testData->GetVectorCount(); i++ ) {
+			CClassificationResult expected;
+			CClassificationResult result;
+			ASSERT_TRUE( model->Classify( testData->GetVector( i ), expected ) );
+			ASSERT_TRUE( parallelModel->Classify( testData->GetVector( i ), result ) );
+			for( const CClassificationResult* other : { &result, &batchResults[i] } ) {
+				ASSERT_EQ( expected.PreferredClass, other->PreferredClass );
+				for( int j = 0; j < expected.Probabilities.Size(); j++ ) {
+					ASSERT_EQ( expected.Probabilities[j].GetValue(), other->Probabilities[j].GetValue() );
+				}
+			}
+		}
+	}
+}
+
+TEST_F( RandomBinaryClassification4000x20, RandomForestSerialization )
+{
+	CRandomForest::CParams param;
+	param.TreeCount = 10;
+	CRandomForest forest( param );
+	CPtr<IModel> model = forest.Train( *DenseRandomBinaryProblem );
+
+	const CString archiveName = "random_forest";
+	{
+		CArchiveFile file( archiveName, CArchive::store );
+		CArchive archive( &file, CArchive::SD_Storing );
+		SerializeModel( archive, model );
+	}
+	CPtr<IModel> loadedModel;
+	{
+		CArchiveFile file( archiveName, CArchive::load );
+		CArchive archive( &file, CArchive::SD_Loading );
+		SerializeModel( archive, loadedModel );
+	}
+	::remove( archiveName );
+
+	ASSERT_TRUE( dynamic_cast<IRandomForestModel*>( loadedModel.Ptr() ) != nullptr );
+	for( int i = 0; i < DenseBinaryTestData->GetVectorCount(); i++ ) {
+		CClassificationResult expected;
+		CClassificationResult result;
+		ASSERT_TRUE( model->Classify( DenseBinaryTestData->GetVector( i ), expected ) );
+		ASSERT_TRUE( loadedModel->Classify( DenseBinaryTestData->GetVector( i ), result ) );
+		ASSERT_EQ( expected.PreferredClass, result.PreferredClass );
+		ASSERT_EQ( expected.Probabilities[0].GetValue(), result.Probabilities[0].GetValue() );
+	}
+}
+
+TEST_F( RandomMultiClassification2000x20, RandomForest )
+{
+	CRandomForest::CParams param;
+	param.TreeCount = 20;
+	param.ThreadCount = 4;
+	CRandomForest forest( param );
+	TrainMulti( forest );
+	TestMultiClassificationResult();
+}
+
 TEST_F( RandomMultiClassification2000x20, GBTB_Full )
 {
 	CRandom random( 0 );
@@ -348,6 +489,19 @@ TEST_F( RandomMultiClassification2000x20, GBTB_FastHist )
 	TestMultiClassificationResult();
 }
 
+TEST_F( RandomMultiClassification2000x20, GBTB_FastHistGoss )
+{
+	CRandom random( 0 );
+	CGradientBoost::CParams params;
+	params.Random = &random;
+	params.IterationsCount = 10;
+	params.TreeBuilder = GBTB_FastHist;
+	params.GossTopRate = 0.2f;
+	params.GossOtherRate = 0.1f;
+	TrainMultiGradientBoost( params );
+	TestMultiClassificationResult();
+}
+
 TEST_F( RandomMultiClassification2000x20, GBTB_MultiFull )
 {
 	CRandom random( 0 );
@@ -592,6 +746,19 @@ TEST_F( RandomBinaryGBRegression4000x20, FastHist )
 	TestBinaryRegressionResult();
 }
 
+TEST_F( RandomBinaryGBRegression4000x20, FastHistGoss )
+{
+	CRandom random( 0 );
+	CGradientBoost::CParams params;
+	params.Random = &random;
+	params.IterationsCount = 10;
+	params.TreeBuilder = GBTB_FastHist;
+	params.GossTopRate = 0.2f;
+	params.GossOtherRate = 0.1f;
+	TrainBinaryGradientBoost( params );
+	TestBinaryRegressionResult();
+}
+
 // GB multi tree builders
 TEST_F( RandomMultiGBRegression2000x20, Full )
 {
@@ -636,6 +803,19 @@ TEST_F( RandomMultiGBRegression2000x20, MultiFastHist )
 	TestMultiRegressionResult();
 }
 
+TEST_F( RandomMultiGBRegression2000x20, MultiFastHistGoss )
+{
+	CRandom random( 0 );
+	CGradientBoost::CParams params;
+	params.Random = &random;
+	params.IterationsCount = 10;
+	params.TreeBuilder = GBTB_MultiFastHist;
+	params.GossTopRate = 0.2f;
+	params.GossOtherRate = 0.1f;
+	TrainMultiGradientBoost( params );
+	TestMultiRegressionResult();
+}
+
 // test GB binary model's representations (to test Predict)
 TEST_F( RandomBinaryGBRegression4000x20, Linked )
 {
@@ -0,0 +1,324 @@
+/* Copyright © 2021 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <common.h>
+#pragma hdrstop
+
+#include <TestFixture.h>
+
+using namespace NeoML;
+using namespace NeoMLTest;
+
+static const int AttentionBatchSize = 2;
+// The lengths are not multiples of the tile sizes of the fused kernel
+static const int AttentionQueryLength = 37;
+static const int AttentionKeyLength = 70;
+static const int AttentionInputSize = 6;
+static const int AttentionHeadCount = 2;
+static const int AttentionHiddenSize = 8;
+static const int AttentionOutputSize = 5;
+
+static const char* const AttentionWeightLayers[] = { "Q", "K", "V", "Out.Dense" };
+
+static CPtr<CDnnBlob> createRandomBlob( CRandom& random, const CBlobDesc& desc )
+{
+	CPtr<CDnnBlob> blob = CDnnBlob::CreateBlob( MathEngine(), CT_Float, desc );
+	CArray<float> data;
+	data.SetSize( blob->GetDataSize() );
+	for( int i = 0; i < data.Size(); ++i ) {
+		data[i] = static_cast<float>( random.Uniform( -1, 1 ) );
+	}
+	blob->CopyFrom( data.GetPtr() );
+	return blob;
+}
+
+static CBlobDesc attentionListDesc( int listSize, int channels )
+{
+	CBlobDesc desc( CT_Float );
+	desc.SetDimSize( BD_BatchWidth, AttentionBatchSize );
+	desc.SetDimSize( BD_ListSize, listSize );
+	desc.SetDimSize( BD_Channels, channels );
+	return desc;
+}
+
+static void expectEqualBlobs( const CDnnBlob& expected, const CDnnBlob& actual )
+{
+	ASSERT_EQ( expected.GetDataSize(), actual.GetDataSize() );
+	CArray<float> expectedData;
+	expectedData.SetSize( expected.GetDataSize() );
+	expected.CopyTo( expectedData.GetPtr() );
+	CArray<float> actualData;
+	actualData.SetSize( actual.GetDataSize() );
+	actual.CopyTo( actualData.GetPtr() );
+	for( int i = 0; i < expectedData.Size(); ++i ) {
+		EXPECT_NEAR( expectedData[i], actualData[i], 1e-4f );
+	}
+}
+
+static CPtr<CSourceLayer> addSource( CDnn& dnn, const char* name, const CPtr<CDnnBlob>& blob )
+{
+	CPtr<CSourceLayer> source = new CSourceLayer( MathEngine() );
+	source->SetName( name );
+	source->SetBlob( blob );
+	dnn.AddLayer( *source );
+	return source;
+}
+
+// Builds the network with the multihead attention and the euclidean loss
+// If connectSoftmax is set the softmax output of the attention is connected to a sink,
+// so the layer is built from the separate layers instead of the fused attention
+static CPtr<CMultiheadAttentionLayer> buildAttentionTestDnn( CDnn& dnn, bool connectSoftmax,
+	const CPtr<CDnnBlob>& query, const CPtr<CDnnBlob>& keys, const CPtr<CDnnBlob>& mask,
+	const CPtr<CDnnBlob>& labels )
+{
+	CPtr<CSourceLayer> querySource = addSource( dnn, "query", query );
+	CPtr<CSourceLayer> keysSource = addSource( dnn, "keys", keys );
+
+	CPtr<CMultiheadAttentionLayer> attention = new CMultiheadAttentionLayer( MathEngine() );
+	attention->SetName( "attention" );
+	attention->SetHeadCount( AttentionHeadCount );
+	attention->SetHiddenSize( AttentionHiddenSize );
+	attention->SetOutputSize( AttentionOutputSize );
+	attention->SetUseMask( mask != nullptr );
+	attention->Connect( 0, *querySource );
+	attention->Connect( 1, *keysSource );
+	attention->Connect( 2, *keysSource );
+	if( mask != nullptr ) {
+		attention->Connect( 3, *addSource( dnn, "mask", mask ) );
+	}
+	dnn.AddLayer( *attention );
+
+	CPtr<CEuclideanLossLayer> loss = new CEuclideanLossLayer( MathEngine() );
+	loss->SetName( "loss" );
+	loss->Connect( 0, *attention );
+	loss->Connect( 1, *addSource( dnn, "labels", labels ) );
+	dnn.AddLayer( *loss );
+
+	CPtr<CSinkLayer> sink = new CSinkLayer( MathEngine() );
+	sink->SetName( "sink" );
+	sink->Connect( *attention );
+	dnn.AddLayer( *sink );
+
+	if( connectSoftmax ) {
+		CPtr<CSinkLayer> softmaxSink = new CSinkLayer( MathEngine() );
+		softmaxSink->SetName( "softmaxSink" );
+		softmaxSink->Connect( 0, *attention, 1 );
+		dnn.AddLayer( *softmaxSink );
+	}
+
+	CPtr<CDnnSimpleGradientSolver> solver = new CDnnSimpleGradientSolver( MathEngine() );
+	solver->SetLearningRate( 0.1f );
+	dnn.SetSolver( solver );
+	return attention;
+}
+
+static CPtr<CFullyConnectedLayer> getAttentionWeights( CMultiheadAttentionLayer& attention, const char* name )
+{
+	return CheckCast<CFullyConnectedLayer>( attention.GetLayer( name ) );
+}
+
+static void checkFusedAttention( bool useMask )
+{
+	CRandom random( 0x2417 );
+	CPtr<CDnnBlob> query = createRandomBlob( random, attentionListDesc( AttentionQueryLength, AttentionInputSize ) );
+	CPtr<CDnnBlob> keys = createRandomBlob( random, attentionListDesc( AttentionKeyLength, AttentionInputSize ) );
+	CPtr<CDnnBlob> labels = createRandomBlob( random, attentionListDesc( AttentionQueryLength, AttentionOutputSize ) );
+	CPtr<CDnnBlob> mask;
+	if( useMask ) {
+		// The mask has the layout of the attention weights: seq_Q x seq_K
+		CBlobDesc maskDesc( CT_Float );
+		maskDesc.SetDimSize( BD_Width, AttentionQueryLength );
+		maskDesc.SetDimSize( BD_Channels, AttentionKeyLength );
+		mask = CDnnBlob::CreateBlob( MathEngine(), CT_Float, maskDesc );
+		CArray<float> maskData;
+		for( int i = 0; i < AttentionQueryLength; ++i ) {
+			for( int j = 0; j < AttentionKeyLength; ++j ) {
+				// Some queries attend only to the keys up to their position
+				maskData.Add( i % 3 == 0 && j > i ? 1.f : 0.f );
+			}
+		}
+		mask->CopyFrom( maskData.GetPtr() );
+	}
+
+	CDnn expectedDnn( random, MathEngine() );
+	CPtr<CMultiheadAttentionLayer> expected = buildAttentionTestDnn( expectedDnn, true, query, keys, mask, labels );
+	CDnn dnn( random, MathEngine() );
+	CPtr<CMultiheadAttentionLayer> attention = buildAttentionTestDnn( dnn, false, query, keys, mask, labels );
+
+	expectedDnn.RunOnce();
+	dnn.RunOnce();
+	EXPECT_FALSE( expected->HasLayer( "ScaledDotProductAttention" ) );
+	EXPECT_TRUE( attention->HasLayer( "ScaledDotProductAttention" ) );
+	for( const char* name : AttentionWeightLayers ) {
+		getAttentionWeights( *attention, name )->SetWeightsData( getAttentionWeights( *expected, name )->GetWeightsData() );
+		getAttentionWeights( *attention, name )->SetFreeTermData( getAttentionWeights( *expected, name )->GetFreeTermData() );
+	}
+
+	dnn.RunOnce();
+	expectEqualBlobs( *CheckCast<CSinkLayer>( expectedDnn.GetLayer( "sink" ) )->GetBlob(),
+		*CheckCast<CSinkLayer>( dnn.GetLayer( "sink" ) )->GetBlob() );
+
+	for( int i = 0; i < 3; ++i ) {
+		expectedDnn.RunAndLearnOnce();
+		dnn.RunAndLearnOnce();
+		expectEqualBlobs( *CheckCast<CSinkLayer>( expectedDnn.GetLayer( "sink" ) )->GetBlob(),
+			*CheckCast<CSinkLayer>( dnn.GetLayer( "sink" ) )->GetBlob() );
+	}
+	// The diffs of Q, K and V reach the weights
+	for( const char* name : AttentionWeightLayers ) {
+		expectEqualBlobs( *getAttentionWeights( *expected, name )->GetWeightsData(),
+			*getAttentionWeights( *attention, name )->GetWeightsData() );
+	}
+}
+
+TEST( CDnnAttentionTest, FusedMultiheadAttention )
+{
+	checkFusedAttention( false );
+}
+
+TEST( CDnnAttentionTest, FusedMultiheadAttentionWithMask )
+{
+	checkFusedAttention( true );
+}
+
+// The layer built with the fused attention is rebuilt from the separate layers
+// when its softmax output is connected, the weights are kept
+TEST( CDnnAttentionTest, RebuildMultiheadAttention )
+{
+	CRandom random( 0x7142 );
+	CPtr<CDnnBlob> query = createRandomBlob( random, attentionListDesc( AttentionQueryLength, AttentionInputSize ) );
+	CPtr<CDnnBlob> keys = createRandomBlob( random, attentionListDesc( AttentionKeyLength, AttentionInputSize ) );
+	CPtr<CDnnBlob> labels = createRandomBlob( random, attentionListDesc( AttentionQueryLength, AttentionOutputSize ) );
+
+	CDnn dnn( random, MathEngine() );
+	CPtr<CMultiheadAttentionLayer> attention = buildAttentionTestDnn( dnn, false, query, keys, nullptr, labels );
+	dnn.RunOnce();
+	EXPECT_TRUE( attention->HasLayer( "ScaledDotProductAttention" ) );
+	CPtr<CDnnBlob> expected = CheckCast<CSinkLayer>( dnn.GetLayer( "sink" ) )->GetBlob()->GetCopy();
+
+	CPtr<CSinkLayer> softmaxSink = new CSinkLayer( MathEngine() );
+	softmaxSink->SetName( "softmaxSink" );
+	softmaxSink->Connect( 0, *attention, 1 );
+	dnn.AddLayer( *softmaxSink );
+	dnn.RunOnce();
+	EXPECT_FALSE( attention->HasLayer( "ScaledDotProductAttention" ) );
+	expectEqualBlobs( *expected, *CheckCast<CSinkLayer>( dnn.GetLayer( "sink" ) )->GetBlob() );
+}
+
+static const int DecodingLength = 9;
+
+// Runs the network on the [begin, end) elements of the sequences
+static void runOnSlice( CDnn& dnn, const CArray<float>& data, int begin, int end, CArray<float>& result )
+{
+	const int length = end - begin;
+	CArray<float> inputData;
+	for( int b = 0; b < AttentionBatchSize; ++b ) {
+		for( int i = ( b * DecodingLength + begin ) * AttentionInputSize;
+			i < ( b * DecodingLength + end ) * AttentionInputSize; ++i )
+		{
+			inputData.Add( data[i] );
+		}
+	}
+	CPtr<CDnnBlob> input = CDnnBlob::CreateBlob( MathEngine(), CT_Float, attentionListDesc( length, AttentionInputSize ) );
+	input->CopyFrom( inputData.GetPtr() );
+	CheckCast<CSourceLayer>( dnn.GetLayer( "data" ) )->SetBlob( input );
+	dnn.RunOnce();
+
+	const CDnnBlob& output = *CheckCast<CSinkLayer>( dnn.GetLayer( "sink" ) )->GetBlob();
+	result.SetSize( output.GetDataSize() );
+	output.CopyTo( result.GetPtr() );
+}
+
+// The incremental decoding with the key-value cache gives the same results
+// as the recalculation of the whole prefix (or of the last maxCacheLength elements)
+static void checkKeyValueCache( int maxCacheLength )
+{
+	CRandom random( 0x5183 );
+	CArray<float> data;
+	for( int i = 0; i < AttentionBatchSize * DecodingLength * AttentionInputSize; ++i ) {
+		data.Add( static_cast<float>( random.Uniform( -1, 1 ) ) );
+	}
+
+	CDnn dnn( random, MathEngine() );
+	CPtr<CSourceLayer> source = new CSourceLayer( MathEngine() );
+	source->SetName( "data" );
+	dnn.AddLayer( *source );
+	CPtr<CTransformerEncoderLayer> transformer = new CTransformerEncoderLayer( MathEngine() );
+	transformer->SetName( "transformer" );
+	transformer->SetHeadCount( AttentionHeadCount );
+	transformer->SetHiddenSize( AttentionHiddenSize );
+	transformer->SetFeedForwardSize( 12 );
+	transformer->Connect( *source );
+	dnn.AddLayer( *transformer );
+	CPtr<CSinkLayer> sink = new CSinkLayer( MathEngine() );
+	sink->SetName( "sink" );
+	sink->Connect( *transformer );
+	dnn.AddLayer( *sink );
+
+	CArray<float> expected;
+	expected.SetSize( data.Size() );
+	CArray<float> result;
+	for( int pos = 0; pos < DecodingLength; ++pos ) {
+		const int begin = maxCacheLength > 0 ? max( 0, pos - maxCacheLength + 1 ) : 0;
+		runOnSlice( dnn, data, begin, pos + 1, result );
+		const int length = pos + 1 - begin;
+		for( int b = 0; b < AttentionBatchSize; ++b ) {
+			for( int c = 0; c < AttentionInputSize; ++c ) {
+				expected[( b * DecodingLength + pos ) * AttentionInputSize + c]
+					= result[( b * length + length - 1 ) * AttentionInputSize + c];
+			}
+		}
+	}
+
+	transformer->SetUseKeyValueCache( true );
+	transformer->SetMaxCacheLength( maxCacheLength );
+	// The first elements are passed together
+	const int firstLength = 3;
+	runOnSlice( dnn, data, 0, firstLength, result );
+	for( int b = 0; b < AttentionBatchSize; ++b ) {
+		for( int i = 0; i < firstLength * AttentionInputSize; ++i ) {
+			EXPECT_NEAR( expected[b * DecodingLength * AttentionInputSize + i],
+				result[b * firstLength * AttentionInputSize + i], 1e-4f );
+		}
+	}
+	for( int pos = firstLength; pos < DecodingLength; ++pos ) {
+		runOnSlice( dnn, data, pos, pos + 1, result );
+		for( int b = 0; b < AttentionBatchSize; ++b ) {
+			for( int c = 0; c < AttentionInputSize; ++c ) {
+				EXPECT_NEAR( expected[( b * DecodingLength + pos ) * AttentionInputSize + c],
+					result[b * AttentionInputSize + c], 1e-4f );
+			}
+		}
+	}
+	EXPECT_EQ( maxCacheLength > 0 ? maxCacheLength : DecodingLength, transformer->GetCacheLength( 0 ) );
+
+	// The evicted sequence starts again while the other one continues
+	transformer->ResetCache( 1 );
+	runOnSlice( dnn, data, 0, 1, result );
+	for( int c = 0; c < AttentionInputSize; ++c ) {
+		EXPECT_NEAR( expected[DecodingLength * AttentionInputSize + c], result[AttentionInputSize + c], 1e-4f );
+	}
+	EXPECT_EQ( 1, transformer->GetCacheLength( 1 ) );
+}
+
+TEST( CDnnAttentionTest, TransformerKeyValueCache )
+{
+	checkKeyValueCache( 0 );
+}
+
+TEST( CDnnAttentionTest, TransformerKeyValueCacheWithLimit )
+{
+	checkKeyValueCache( 4 );
+}
@@ -0,0 +1,252 @@
+/* Copyright © 2021 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <common.h>
+#pragma hdrstop
+
+#include <TestFixture.h>
+
+using namespace NeoML;
+using namespace NeoMLTest;
+
+static CPtr<CDnnBlob> createRandomBlob( CRandom& random, const CBlobDesc& desc )
+{
+	CPtr<CDnnBlob> blob = CDnnBlob::CreateBlob( MathEngine(), CT_Float, desc );
+	CArray<float> data;
+	data.SetSize( blob->GetDataSize() );
+	for( int i = 0; i < data.Size(); ++i ) {
+		data[i] = static_cast<float>( random.Uniform( -1, 1 ) );
+	}
+	blob->CopyFrom( data.GetPtr() );
+	return blob;
+}
+
+static void getBlobData( const CDnnBlob& blob, CArray<float>& data )
+{
+	data.SetSize( blob.GetDataSize() );
+	blob.CopyTo( data.GetPtr() );
+}
+
+// Builds the network with one convolution
+static CPtr<CConvLayer> buildConvTestDnn( CDnn& dnn, const CPtr<CDnnBlob>& data,
+	int filterCount, int filterSize, int stride )
+{
+	CPtr<CSourceLayer> source = new CSourceLayer( MathEngine() );
+	source->SetName( "source" );
+	source->SetBlob( data );
+	dnn.AddLayer( *source );
+
+	CPtr<CConvLayer> conv = new CConvLayer( MathEngine() );
+	conv->SetName( "conv" );
+	conv->SetFilterCount( filterCount );
+	conv->SetFilterHeight( filterSize );
+	conv->SetFilterWidth( filterSize );
+	conv->SetStrideHeight( stride );
+	conv->SetStrideWidth( stride );
+	conv->SetPaddingHeight( filterSize / 2 );
+	conv->SetPaddingWidth( filterSize / 2 );
+	conv->Connect( *source );
+	dnn.AddLayer( *conv );
+
+	CPtr<CSinkLayer> sink = new CSinkLayer( MathEngine() );
+	sink->SetName( "sink" );
+	sink->Connect( *conv );
+	dnn.AddLayer( *sink );
+	return conv;
+}
+
+// The math engine may prepare the filter for the calculation and keep it between the runs
+// (the Winograd algorithm and the JIT kernels do that), so changing the filter of the network
+// that has already been run should be taken into account
+// If isReferenceDnn is set, the result of the copy created by CreateReferenceDnn before the change is checked
+static void checkFilterChangeAfterRun( int channels, int filterCount, int filterSize, int stride,
+	bool isReferenceDnn = false, int reshapeCacheSize = 0 )
+{
+	CRandom random( 0x1357 + channels * 17 + filterCount );
+	CBlobDesc dataDesc( CT_Float );
+	dataDesc.SetDimSize( BD_BatchWidth, 2 );
+	dataDesc.SetDimSize( BD_Height, 12 );
+	dataDesc.SetDimSize( BD_Width, 10 );
+	dataDesc.SetDimSize( BD_Channels, channels );
+	CPtr<CDnnBlob> data = createRandomBlob( random, dataDesc );
+
+	CDnn dnn( random, MathEngine() );
+	dnn.SetReshapeCacheSize( reshapeCacheSize );
+	CPtr<CConvLayer> conv = buildConvTestDnn( dnn, data, filterCount, filterSize, stride );
+	dnn.RunOnce();
+
+	CRandom referenceRandom;
+	CDnn referenceDnn( referenceRandom, MathEngine() );
+	if( isReferenceDnn ) {
+		dnn.CreateReferenceDnn( referenceDnn );
+		CheckCast<CSourceLayer>( referenceDnn.GetLayer( "source" ) )->SetBlob( data );
+		referenceDnn.RunOnce();
+	}
+
+	CPtr<CDnnBlob> newFilter = createRandomBlob( random, conv->GetFilterData()->GetDesc() );
+	CPtr<CDnnBlob> newFreeTerm = createRandomBlob( random, conv->GetFreeTermData()->GetDesc() );
+	conv->SetFilterData( newFilter );
+	conv->SetFreeTermData( newFreeTerm );
+	CDnn& checkedDnn = isReferenceDnn ? referenceDnn : dnn;
+	checkedDnn.RunOnce();
+
+	CDnn expectedDnn( random, MathEngine() );
+	CPtr<CConvLayer> expectedConv = buildConvTestDnn( expectedDnn, data, filterCount, filterSize, stride );
+	expectedConv->SetFilterData( newFilter );
+	expectedConv->SetFreeTermData( newFreeTerm );
+	expectedDnn.RunOnce();
+
+	CArray<float> expected;
+	getBlobData( *CheckCast<CSinkLayer>( expectedDnn.GetLayer( "sink" ) )->GetBlob(), expected );
+	CArray<float> result;
+	getBlobData( *CheckCast<CSinkLayer>( checkedDnn.GetLayer( "sink" ) )->GetBlob(), result );
+	ASSERT_EQ( expected.Size(), result.Size() );
+	for( int i = 0; i < expected.Size(); ++i ) {
+		EXPECT_NEAR( expected[i], result[i], 1e-3f );
+	}
+}
+
+TEST( CDnnConvTest, FilterChangeAfterRun )
+{
+	// The matrix multiplication
+	checkFilterChangeAfterRun( 3, 5, 3, 1 );
+	// The Winograd algorithm
+	checkFilterChangeAfterRun( 16, 16, 3, 1 );
+	// The JIT kernels (if available)
+	checkFilterChangeAfterRun( 8, 24, 5, 1 );
+	checkFilterChangeAfterRun( 16, 32, 3, 2 );
+	checkFilterChangeAfterRun( 8, 96, 5, 1 );
+	checkFilterChangeAfterRun( 8, 20, 3, 1 );
+}
+
+// The copies share the filter with the original network but keep their own descriptors
+TEST( CDnnConvTest, FilterChangeInReferenceDnn )
+{
+	checkFilterChangeAfterRun( 3, 5, 3, 1, true );
+	checkFilterChangeAfterRun( 16, 16, 3, 1, true );
+	checkFilterChangeAfterRun( 8, 24, 5, 1, true );
+	checkFilterChangeAfterRun( 16, 32, 3, 2, true );
+	checkFilterChangeAfterRun( 8, 96, 5, 1, true );
+	checkFilterChangeAfterRun( 8, 20, 3, 1, true );
+}
+
+// The descriptor restored from the reshape cache should not keep the old filter
+TEST( CDnnConvTest, FilterChangeWithReshapeCache )
+{
+	checkFilterChangeAfterRun( 16, 16, 3, 1, false, 2 );
+	checkFilterChangeAfterRun( 8, 96, 5, 1, false, 2 );
+}
+
+// The convolution that counts its reshapes
+class CReshapeCountingConvLayer : public CConvLayer {
+public:
+	explicit CReshapeCountingConvLayer( IMathEngine& mathEngine ) : CConvLayer( mathEngine ), ReshapeCount( 0 ) {}
+
+	int ReshapeCount;
+
+protected:
+	void Reshape() override { ++ReshapeCount; CConvLayer::Reshape(); }
+};
+
+// Runs the network for the batch sizes 1, 2 and 3 in turn
+static void runForBatchSizes( CDnn& dnn, const CObjectArray<CDnnBlob>& data, CArray<CArray<float>>& results )
+{
+	results.SetSize( data.Size() );
+	for( int i = 0; i < data.Size(); ++i ) {
+		CheckCast<CSourceLayer>( dnn.GetLayer( "source" ) )->SetBlob( data[i] );
+		dnn.RunOnce();
+		getBlobData( *CheckCast<CSinkLayer>( dnn.GetLayer( "sink" ) )->GetBlob(), results[i] );
+	}
+}
+
+static void expectEqualResults( const CArray<CArray<float>>& expected, const CArray<CArray<float>>& results )
+{
+	ASSERT_EQ( expected.Size(), results.Size() );
+	for( int i = 0; i < expected.Size(); ++i ) {
+		ASSERT_EQ( expected[i].Size(), results[i].Size() );
+		for( int j = 0; j < expected[i].Size(); ++j ) {
+			EXPECT_NEAR( expected[i][j], results[i][j], 1e-3f );
+		}
+	}
+}
+
+TEST( CDnnConvTest, ReshapeCache )
+{
+	CRandom random( 0x2468 );
+	CObjectArray<CDnnBlob> data;
+	for( int batchSize = 1; batchSize <= 3; ++batchSize ) {
+		CBlobDesc dataDesc( CT_Float );
+		dataDesc.SetDimSize( BD_BatchWidth, batchSize );
+		dataDesc.SetDimSize( BD_Height, 10 );
+		dataDesc.SetDimSize( BD_Width, 9 );
+		dataDesc.SetDimSize( BD_Channels, 8 );
+		data.Add( createRandomBlob( random, dataDesc ) );
+	}
+
+	CDnn dnn( random, MathEngine() );
+	CPtr<CSourceLayer> source = new CSourceLayer( MathEngine() );
+	source->SetName( "source" );
+	dnn.AddLayer( *source );
+	CPtr<CReshapeCountingConvLayer> conv = new CReshapeCountingConvLayer( MathEngine() );
+	conv->SetName( "conv" );
+	conv->SetFilterCount( 16 );
+	conv->SetFilterHeight( 3 );
+	conv->SetFilterWidth( 3 );
+	conv->Connect( *source );
+	dnn.AddLayer( *conv );
+	CPtr<CMaxPoolingLayer> pooling = new CMaxPoolingLayer( MathEngine() );
+	pooling->SetName( "pooling" );
+	pooling->SetFilterHeight( 2 );
+	pooling->SetFilterWidth( 2 );
+	pooling->SetStrideHeight( 2 );
+	pooling->SetStrideWidth( 2 );
+	pooling->Connect( *conv );
+	dnn.AddLayer( *pooling );
+	CPtr<CSinkLayer> sink = new CSinkLayer( MathEngine() );
+	sink->SetName( "sink" );
+	sink->Connect( *pooling );
+	dnn.AddLayer( *sink );
+
+	CArray<CArray<float>> expected;
+	runForBatchSizes( dnn, data, expected );
+
+	// After the warm-up the recurring sizes are taken from the cache
+	dnn.SetReshapeCacheSize( 3 );
+	conv->ReshapeCount = 0;
+	CArray<CArray<float>> results;
+	for( int i = 0; i < 3; ++i ) {
+		runForBatchSizes( dnn, data, results );
+		expectEqualResults( expected, results );
+	}
+	EXPECT_EQ( 3, conv->ReshapeCount );
+
+	// The least recently used size is evicted before it is needed again
+	dnn.SetReshapeCacheSize( 2 );
+	conv->ReshapeCount = 0;
+	for( int i = 0; i < 2; ++i ) {
+		runForBatchSizes( dnn, data, results );
+		expectEqualResults( expected, results );
+	}
+	EXPECT_EQ( 6, conv->ReshapeCount );
+
+	// The cached descriptors are not used after the filter change
+	dnn.SetReshapeCacheSize( 3 );
+	runForBatchSizes( dnn, data, results );
+	conv->SetFilterData( createRandomBlob( random, conv->GetFilterData()->GetDesc() ) );
+	runForBatchSizes( dnn, data, results );
+	dnn.SetReshapeCacheSize( 0 );
+	runForBatchSizes( dnn, data, expected );
+	expectEqualResults( expected, results );
+}
@@ -0,0 +1,406 @@
+/* Copyright © 2021 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <common.h>
+#pragma hdrstop
+
+#include <TestFixture.h>
+#include <NeoML/Dnn/DnnDistributed.h>
+#include <thread>
+#include <chrono>
+#include <memory>
+
+#if FINE_PLATFORM( FINE_LINUX ) || FINE_PLATFORM( FINE_DARWIN )
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#endif
+
+using namespace NeoML;
+using namespace NeoMLTest;
+
+namespace NeoMLTest {
+
+// Sets the different data for each thread
+// If SameData is set all threads get the data of the first one
+class CDistributedTestDataset : public IDistributedDataset {
+public:
+	explicit CDistributedTestDataset( int threadCount );
+
+	bool SameData;
+
+	void SetInputBatch( CDnn& dnn, int thread ) override;
+
+private:
+	CArray<CArray<float>> inputs;
+	CArray<CArray<float>> labels;
+};
+
+static const int DistributedTestBatchSize = 16;
+static const int DistributedTestInputSize = 1024;
+
+CDistributedTestDataset::CDistributedTestDataset( int threadCount ) :
+	SameData( false )
+{
+	CRandom random( 0x4321 );
+	inputs.SetSize( threadCount );
+	labels.SetSize( threadCount );
+	for( int thread = 0; thread < threadCount; ++thread ) {
+		for( int i = 0; i < DistributedTestBatchSize * DistributedTestInputSize; ++i ) {
+			inputs[thread].Add( static_cast<float>( random.Uniform( -1, 1 ) ) );
+		}
+		for( int i = 0; i < DistributedTestBatchSize; ++i ) {
+			const float* object = inputs[thread].GetPtr() + i * DistributedTestInputSize;
+			labels[thread].Add( object[0] - object[1] + 0.5f * object[2] );
+		}
+	}
+}
+
+void CDistributedTestDataset::SetInputBatch( CDnn& dnn, int thread )
+{
+	const int dataThread = SameData ? 0 : thread;
+	CPtr<CDnnBlob> input = CDnnBlob::CreateDataBlob( dnn.GetMathEngine(), CT_Float, 1,
+		DistributedTestBatchSize, DistributedTestInputSize );
+	input->CopyFrom( inputs[dataThread].GetPtr() );
+	CheckCast<CSourceLayer>( dnn.GetLayer( "data" ) )->SetBlob( input );
+
+	CPtr<CDnnBlob> label = CDnnBlob::CreateDataBlob( dnn.GetMathEngine(), CT_Float, 1, DistributedTestBatchSize, 1 );
+	label->CopyFrom( labels[dataThread].GetPtr() );
+	CheckCast<CSourceLayer>( dnn.GetLayer( "label" ) )->SetBlob( label );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+
+// Prepares the batches in advance and checks that the batches are set in the order of the preparation
+class CDistributedPipelinedTestDataset : public IDistributedPipelinedDataset {
+public:
+	explicit CDistributedPipelinedTestDataset( int threadCount );
+
+	// The number of the prepared and the set batches for each thread
+	CArray<int> PreparedCount;
+	CArray<int> SetCount;
+
+	void PrepareInputBatch( int thread ) override;
+	void SetInputBatch( CDnn& dnn, int thread ) override;
+
+private:
+	CDistributedTestDataset data;
+};
+
+CDistributedPipelinedTestDataset::CDistributedPipelinedTestDataset( int threadCount ) :
+	data( threadCount )
+{
+	PreparedCount.Add( 0, threadCount );
+	SetCount.Add( 0, threadCount );
+}
+
+void CDistributedPipelinedTestDataset::PrepareInputBatch( int thread )
+{
+	// The batch is not prepared twice before it is set
+	EXPECT_EQ( SetCount[thread], PreparedCount[thread] );
+	++PreparedCount[thread];
+}
+
+void CDistributedPipelinedTestDataset::SetInputBatch( CDnn& dnn, int thread )
+{
+	EXPECT_EQ( SetCount[thread] + 1, PreparedCount[thread] );
+	++SetCount[thread];
+	data.SetInputBatch( dnn, thread );
+}
+
+} // namespace NeoMLTest
+
+static void storeDistributedTestDnn( const CString& fileName )
+{
+	CRandom random( 0x1234 );
+	CDnn dnn( random, MathEngine() );
+	CSourceLayer* data = Source( dnn, "data" );
+	CSourceLayer* label = Source( dnn, "label" );
+	// The large enough layer is averaged without the fusion
+	CFullyConnectedLayer* hidden = FullyConnected( 1024 )( "hidden", data );
+	CFullyConnectedLayer* fc = FullyConnected( 1 )( "fc", Relu()( hidden ) );
+	EuclideanLoss()( "loss", fc, label );
+
+	CArchiveFile file( fileName, CArchive::store, GetPlatformEnv() );
+	CArchive archive( &file, CArchive::SD_Storing );
+	archive.Serialize( dnn );
+}
+
+TEST( CDnnDistributedTest, CpuTraining )
+{
+	if( MathEngine().GetType() != MET_Cpu ) {
+		return;
+	}
+
+	const CString fileName = "distributed_dnn.new_ver";
+	storeDistributedTestDnn( fileName );
+
+	const int threadCount = 4;
+	CArchiveFile file( fileName, CArchive::load, GetPlatformEnv() );
+	CArchive archive( &file, CArchive::SD_Loading );
+	CDistributedTraining distributed( archive, threadCount );
+	CDistributedTestDataset dataset( threadCount );
+
+	CArray<float> losses;
+	dataset.SameData = true;
+	distributed.RunAndLearnOnce( dataset );
+	distributed.GetLastLoss( "loss", losses );
+	const float firstLoss = losses[0];
+
+	dataset.SameData = false;
+	for( int i = 0; i < 20; ++i ) {
+		distributed.RunAndLearnOnce( dataset );
+	}
+
+	// The weights are the same after the averaging, so the same data gives the same loss
+	dataset.SameData = true;
+	distributed.RunAndLearnOnce( dataset );
+	distributed.GetLastLoss( "loss", losses );
+	ASSERT_EQ( threadCount, losses.Size() );
+	for( int i = 1; i < threadCount; ++i ) {
+		EXPECT_FLOAT_EQ( losses[0], losses[i] );
+	}
+	EXPECT_GT( firstLoss, losses[0] );
+}
+
+TEST( CDnnDistributedTest, PipelinedDataset )
+{
+	if( MathEngine().GetType() != MET_Cpu ) {
+		return;
+	}
+
+	const CString fileName = "distributed_dnn.new_ver";
+	storeDistributedTestDnn( fileName );
+
+	const int threadCount = 2;
+	CArchiveFile file( fileName, CArchive::load, GetPlatformEnv() );
+	CArchive archive( &file, CArchive::SD_Loading );
+	// Each model uses two threads
+	CDistributedTraining distributed( archive, threadCount, 2 );
+	CDistributedPipelinedTestDataset dataset( threadCount );
+
+	const int stepCount = 5;
+	for( int i = 0; i < stepCount; ++i ) {
+		distributed.RunAndLearnOnce( dataset );
+		for( int thread = 0; thread < threadCount; ++thread ) {
+			EXPECT_EQ( i + 1, dataset.SetCount[thread] );
+		}
+	}
+
+	CArray<float> losses;
+	distributed.GetLastLoss( "loss", losses );
+	ASSERT_EQ( threadCount, losses.Size() );
+	for( int thread = 0; thread < threadCount; ++thread ) {
+		EXPECT_FALSE( std::isnan( losses[thread] ) );
+	}
+}
+
+#if FINE_PLATFORM( FINE_LINUX ) || FINE_PLATFORM( FINE_DARWIN )
+
+// Gets the port that is free at the moment, so that the concurrent test runs don't interfere
+static int getFreeTcpPort()
+{
+	const int fd = ::socket( AF_INET, SOCK_STREAM, 0 );
+	EXPECT_LE( 0, fd );
+	sockaddr_in address{};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+	address.sin_port = 0;
+	socklen_t length = sizeof( address );
+	const bool isBound = ::bind( fd, reinterpret_cast<sockaddr*>( &address ), sizeof( address ) ) == 0
+		&& ::getsockname( fd, reinterpret_cast<sockaddr*>( &address ), &length ) == 0;
+	::close( fd );
+	EXPECT_TRUE( isBound );
+	return ntohs( address.sin_port );
+}
+
+// Gets the shared memory name unique for the test process
+static CString getUniqueName( const char* prefix )
+{
+	return CString( prefix ) + "_" + Str( static_cast<int>( ::getpid() ) );
+}
+
+// The processes are simulated by the threads
+static void testMultiProcessCommunication( const char* name, int port, TDistributedTransport transport )
+{
+	const int processCount = 3;
+	// More than one exchange chunk
+	const int dataSize = ( 1 << 20 ) + 100;
+	const int root = 1;
+
+	CArray<CArray<float>> reduced;
+	reduced.SetSize( processCount );
+	CArray<CArray<float>> broadcasted;
+	broadcasted.SetSize( processCount );
+	std::vector<std::thread> threads;
+	for( int process = 0; process < processCount; ++process ) {
+		threads.push_back( std::thread( [&, process] {
+			std::unique_ptr<IMathEngine> mathEngine( CreateMultiProcessCpuMathEngine( name, port, process,
+				processCount, transport ) );
+			EXPECT_EQ( process, mathEngine->GetDistributedInfo().Thread );
+			EXPECT_EQ( processCount, mathEngine->GetDistributedInfo().Threads );
+
+			CPtr<CDnnBlob> blob = CDnnBlob::CreateVector( *mathEngine, CT_Float, dataSize );
+			CArray<float> data;
+			for( int i = 0; i < dataSize; ++i ) {
+				data.Add( static_cast<float>( ( process + 1 ) * ( i % 7 ) ) );
+			}
+			blob->CopyFrom( data.GetPtr() );
+			mathEngine->AllReduce( blob->GetData(), dataSize );
+			reduced[process].SetSize( dataSize );
+			blob->CopyTo( reduced[process].GetPtr() );
+
+			for( int i = 0; i < dataSize; ++i ) {
+				data[i] = static_cast<float>( process * dataSize + i );
+			}
+			blob->CopyFrom( data.GetPtr() );
+			mathEngine->Broadcast( blob->GetData(), dataSize, root );
+			broadcasted[process].SetSize( dataSize );
+			blob->CopyTo( broadcasted[process].GetPtr() );
+			blob.Release();
+		} ) );
+	}
+	for( size_t i = 0; i < threads.size(); ++i ) {
+		threads[i].join();
+	}
+
+	for( int process = 0; process < processCount; ++process ) {
+		ASSERT_EQ( dataSize, reduced[process].Size() );
+		ASSERT_EQ( dataSize, broadcasted[process].Size() );
+		for( int i = 0; i < dataSize; ++i ) {
+			// The average of 1, 2 and 3 multiplied by the same value
+			ASSERT_FLOAT_EQ( 2.f * ( i % 7 ), reduced[process][i] );
+			ASSERT_FLOAT_EQ( static_cast<float>( root * dataSize + i ), broadcasted[process][i] );
+		}
+	}
+}
+
+TEST( CDnnDistributedTest, MultiProcessSharedMemory )
+{
+	testMultiProcessCommunication( getUniqueName( "neoml_test_shared_memory" ), 0, DT_SharedMemory );
+}
+
+// The segment left by the crashed 0th process should not be joined by the processes of the next session
+TEST( CDnnDistributedTest, MultiProcessStaleSharedMemory )
+{
+	const CString name = getUniqueName( "neoml_test_stale_shared_memory" );
+	const int processCount = 2;
+
+	// The 0th process crashes while waiting for the others
+	const pid_t crashed = ::fork();
+	if( crashed == 0 ) {
+		CreateMultiProcessCpuMathEngine( name, 0, 0, processCount, DT_SharedMemory );
+		::_exit( 0 );
+	}
+	ASSERT_LT( 0, crashed );
+	const CString segmentName = CString( "/" ) + name;
+	for( int i = 0; i < 1000; ++i ) {
+		const int fd = ::shm_open( segmentName, O_RDONLY, 0 );
+		if( fd >= 0 ) {
+			::close( fd );
+			break;
+		}
+		std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+	}
+	std::this_thread::sleep_for( std::chrono::milliseconds( 100 ) );
+	::kill( crashed, SIGKILL );
+	::waitpid( crashed, nullptr, 0 );
+
+	// The 1st process of the new session starts first and finds the stale segment
+	const auto start = std::chrono::steady_clock::now();
+	const int dataSize = 100;
+	CArray<CArray<float>> reduced;
+	reduced.SetSize( processCount );
+	std::vector<std::thread> threads;
+	for( int process = processCount - 1; process >= 0; --process ) {
+		threads.push_back( std::thread( [&, process] {
+			std::unique_ptr<IMathEngine> mathEngine( CreateMultiProcessCpuMathEngine( name, 0, process,
+				processCount, DT_SharedMemory ) );
+			CPtr<CDnnBlob> blob = CDnnBlob::CreateVector( *mathEngine, CT_Float, dataSize );
+			CArray<float> data;
+			data.Add( static_cast<float>( process + 1 ), dataSize );
+			blob->CopyFrom( data.GetPtr() );
+			mathEngine->AllReduce( blob->GetData(), dataSize );
+			reduced[process].SetSize( dataSize );
+			blob->CopyTo( reduced[process].GetPtr() );
+			blob.Release();
+		} ) );
+		std::this_thread::sleep_for( std::chrono::milliseconds( 200 ) );
+	}
+	for( size_t i = 0; i < threads.size(); ++i ) {
+		threads[i].join();
+	}
+
+	// The session doesn't wait for the crashed process until the timeout
+	EXPECT_GT( std::chrono::seconds( 30 ), std::chrono::steady_clock::now() - start );
+	for( int process = 0; process < processCount; ++process ) {
+		ASSERT_EQ( dataSize, reduced[process].Size() );
+		for( int i = 0; i < dataSize; ++i ) {
+			ASSERT_FLOAT_EQ( 1.5f, reduced[process][i] );
+		}
+	}
+}
+
+TEST( CDnnDistributedTest, MultiProcessTcp )
+{
+	testMultiProcessCommunication( getUniqueName( "neoml_test_tcp" ), getFreeTcpPort(), DT_Tcp );
+}
+
+TEST( CDnnDistributedTest, MultiProcessTraining )
+{
+	if( MathEngine().GetType() != MET_Cpu ) {
+		return;
+	}
+
+	const CString fileName = "distributed_dnn.new_ver";
+	storeDistributedTestDnn( fileName );
+
+	const int processCount = 2;
+	const CString name = getUniqueName( "neoml_test_training" );
+	const int port = getFreeTcpPort();
+	CArray<CArray<float>> losses;
+	losses.SetSize( processCount );
+	std::vector<std::thread> threads;
+	for( int process = 0; process < processCount; ++process ) {
+		threads.push_back( std::thread( [&, process] {
+			CArchiveFile file( fileName, CArchive::load, GetPlatformEnv() );
+			CArchive archive( &file, CArchive::SD_Loading );
+			CDistributedTraining distributed( archive, name, port, process, processCount );
+			CDistributedTestDataset dataset( processCount );
+			for( int i = 0; i < 3; ++i ) {
+				distributed.RunAndLearnOnce( dataset );
+			}
+			// The same data gives the same loss on the same weights
+			dataset.SameData = true;
+			distributed.RunAndLearnOnce( dataset );
+			distributed.GetLastLoss( "loss", losses[process] );
+		} ) );
+	}
+	for( size_t i = 0; i < threads.size(); ++i ) {
+		threads[i].join();
+	}
+
+	for( int process = 0; process < processCount; ++process ) {
+		ASSERT_EQ( 1, losses[process].Size() );
+	}
+	EXPECT_FLOAT_EQ( losses[0][0], losses[1][0] );
+}
+
+#endif // FINE_PLATFORM( FINE_LINUX ) || FINE_PLATFORM( FINE_DARWIN )
@@ -1933,6 +1933,37 @@ GTEST_TEST( SerializeFromFile, MultiheadAttentionLayerSerialization )
 
 // ====================================================================================================================
 
+// CScaledDotProductAttentionLayer
+
+#ifdef GENERATE_SERIALIZATION_FILES
+
+static void setSpecificParams( CScaledDotProductAttentionLayer& layer )
+{
+	layer.SetHeadCount( 5 );
+	layer.SetScale( 0.25f );
+}
+
+GTEST_TEST( SerializeToFile, ScaledDotProductAttentionLayerSerialization )
+{
+	serializeToFile<CScaledDotProductAttentionLayer>( "NeoMLDnnScaledDotProductAttentionLayer" );
+}
+
+#endif // GENERATE_SERIALIZATION_FILES
+
+template<>
+inline void checkSpecificParams<CScaledDotProductAttentionLayer>( CScaledDotProductAttentionLayer& layer )
+{
+	EXPECT_EQ( 5, layer.GetHeadCount() );
+	EXPECT_NEAR( 0.25f, layer.GetScale(), 1e-5f );
+}
+
+GTEST_TEST( SerializeFromFile, ScaledDotProductAttentionLayerSerialization )
+{
+	checkSerializeLayer<CScaledDotProductAttentionLayer>( "NeoMLDnnScaledDotProductAttentionLayer" );
+}
+
+// ====================================================================================================================
+
 // CPositionalEmbeddingLayer
 
 #ifdef GENERATE_SERIALIZATION_FILES
@@ -0,0 +1,203 @@
+/* Copyright © 2021 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <common.h>
+#pragma hdrstop
+
+#include <TestFixture.h>
+
+using namespace NeoML;
+using namespace NeoMLTest;
+
+static void getBlobData( const CDnnBlob& blob, CArray<float>& data )
+{
+	data.SetSize( blob.GetDataSize() );
+	blob.CopyTo( data.GetPtr() );
+}
+
+static void fillRandom( CDnnBlob& blob, CRandom& random, double min, double max )
+{
+	CArray<float> buffer;
+	buffer.SetSize( blob.GetDataSize() );
+	for( int i = 0; i < buffer.Size(); ++i ) {
+		buffer[i] = static_cast<float>( random.Uniform( min, max ) );
+	}
+	blob.CopyFrom( buffer.GetPtr() );
+}
+
+// Sets random final parameters to the batch normalization
+static void setRandomBatchNormParams( CBatchNormalizationLayer& batchNorm, CRandom& random )
+{
+	CPtr<CDnnBlob> params = batchNorm.GetFinalParams();
+	fillRandom( *params, random, -1, 1 );
+	batchNorm.SetFinalParams( params );
+}
+
+// Builds the network:
+// conv -> batch norm -> relu6 -> conv -> (h-swish, sink) -> fc -> batch norm -> sigmoid -> sink
+// The second convolution has two consumers, so the h-swish is not fused
+static void buildOptimizationTestDnn( CDnn& dnn, CRandom& random )
+{
+	CPtr<CSourceLayer> source = new CSourceLayer( MathEngine() );
+	source->SetName( "source" );
+	dnn.AddLayer( *source );
+	CPtr<CDnnBlob> data = CDnnBlob::Create2DImageBlob( MathEngine(), CT_Float, 1, 2, 8, 8, 3 );
+	fillRandom( *data, random, -1, 1 );
+	source->SetBlob( data );
+
+	CPtr<CConvLayer> conv = new CConvLayer( MathEngine() );
+	conv->SetName( "conv" );
+	conv->SetFilterCount( 8 );
+	conv->SetFilterHeight( 3 );
+	conv->SetFilterWidth( 3 );
+	conv->SetPaddingHeight( 1 );
+	conv->SetPaddingWidth( 1 );
+	conv->Connect( *source );
+	dnn.AddLayer( *conv );
+
+	CPtr<CBatchNormalizationLayer> convBatchNorm = new CBatchNormalizationLayer( MathEngine() );
+	convBatchNorm->SetName( "convBatchNorm" );
+	convBatchNorm->Connect( *conv );
+	dnn.AddLayer( *convBatchNorm );
+
+	CPtr<CReLULayer> relu = new CReLULayer( MathEngine() );
+	relu->SetName( "relu" );
+	relu->SetUpperThreshold( 6 );
+	relu->Connect( *convBatchNorm );
+	dnn.AddLayer( *relu );
+
+	CPtr<CConvLayer> conv2 = new CConvLayer( MathEngine() );
+	conv2->SetName( "conv2" );
+	conv2->SetFilterCount( 4 );
+	conv2->SetFilterHeight( 3 );
+	conv2->SetFilterWidth( 3 );
+	conv2->Connect( *relu );
+	dnn.AddLayer( *conv2 );
+
+	CPtr<CHSwishLayer> hSwish = new CHSwishLayer( MathEngine() );
+	hSwish->SetName( "hSwish" );
+	hSwish->Connect( *conv2 );
+	dnn.AddLayer( *hSwish );
+
+	CPtr<CSinkLayer> convSink = new CSinkLayer( MathEngine() );
+	convSink->SetName( "convSink" );
+	convSink->Connect( *conv2 );
+	dnn.AddLayer( *convSink );
+
+	CPtr<CFullyConnectedLayer> fc = new CFullyConnectedLayer( MathEngine() );
+	fc->SetName( "fc" );
+	fc->SetNumberOfElements( 10 );
+	fc->SetZeroFreeTerm( true );
+	fc->Connect( *hSwish );
+	dnn.AddLayer( *fc );
+
+	CPtr<CBatchNormalizationLayer> fcBatchNorm = new CBatchNormalizationLayer( MathEngine() );
+	fcBatchNorm->SetName( "fcBatchNorm" );
+	fcBatchNorm->Connect( *fc );
+	dnn.AddLayer( *fcBatchNorm );
+
+	CPtr<CSigmoidLayer> sigmoid = new CSigmoidLayer( MathEngine() );
+	sigmoid->SetName( "sigmoid" );
+	sigmoid->Connect( *fcBatchNorm );
+	dnn.AddLayer( *sigmoid );
+
+	CPtr<CSinkLayer> sink = new CSinkLayer( MathEngine() );
+	sink->SetName( "sink" );
+	sink->Connect( *sigmoid );
+	dnn.AddLayer( *sink );
+
+	// Initialize the weights and set non-trivial batch normalization parameters
+	dnn.RunOnce();
+	setRandomBatchNormParams( *convBatchNorm, random );
+	setRandomBatchNormParams( *fcBatchNorm, random );
+}
+
+static void expectEqualSinks( const CDnn& expected, const CDnn& actual, const char* sinkName )
+{
+	CArray<float> expectedData;
+	getBlobData( *CheckCast<const CSinkLayer>( expected.GetLayer( sinkName ) )->GetBlob(), expectedData );
+	CArray<float> actualData;
+	getBlobData( *CheckCast<const CSinkLayer>( actual.GetLayer( sinkName ) )->GetBlob(), actualData );
+	ASSERT_EQ( expectedData.Size(), actualData.Size() );
+	for( int i = 0; i < expectedData.Size(); ++i ) {
+		EXPECT_NEAR( expectedData[i], actualData[i], 1e-4f );
+	}
+}
+
+TEST( CDnnOptimizationTest, ConvBatchNormActivation )
+{
+	CRandom random( 0x2468 );
+	CDnn expected( random, MathEngine() );
+	buildOptimizationTestDnn( expected, random );
+	expected.RunOnce();
+
+	// The copy of the network
+	const CString fileName = "optimized_dnn.new_ver";
+	{
+		CArchiveFile file( fileName, CArchive::store, GetPlatformEnv() );
+		CArchive archive( &file, CArchive::SD_Storing );
+		archive.Serialize( expected );
+	}
+	CDnn dnn( random, MathEngine() );
+	{
+		CArchiveFile file( fileName, CArchive::load, GetPlatformEnv() );
+		CArchive archive( &file, CArchive::SD_Loading );
+		archive.Serialize( dnn );
+	}
+	CheckCast<CSourceLayer>( dnn.GetLayer( "source" ) )->SetBlob(
+		CheckCast<CSourceLayer>( expected.GetLayer( "source" ) )->GetBlob() );
+
+	EXPECT_EQ( 4, OptimizeDnnForInference( dnn ) );
+	CArray<const char*> layerList;
+	dnn.GetLayerList( layerList );
+	EXPECT_EQ( 7, layerList.Size() );
+	EXPECT_FALSE( dnn.HasLayer( "convBatchNorm" ) );
+	EXPECT_FALSE( dnn.HasLayer( "relu" ) );
+	EXPECT_TRUE( dnn.HasLayer( "hSwish" ) );
+	EXPECT_FALSE( dnn.HasLayer( "fcBatchNorm" ) );
+	EXPECT_FALSE( dnn.HasLayer( "sigmoid" ) );
+
+	const CFusedActivation& convActivation = CheckCast<CConvLayer>( dnn.GetLayer( "conv" ) )->GetFusedActivation();
+	EXPECT_EQ( AF_ReLU, convActivation.Type );
+	EXPECT_EQ( 6.f, convActivation.Param );
+	EXPECT_TRUE( CheckCast<CConvLayer>( dnn.GetLayer( "conv2" ) )->GetFusedActivation().IsEmpty() );
+	EXPECT_EQ( AF_Sigmoid, CheckCast<CFullyConnectedLayer>( dnn.GetLayer( "fc" ) )->GetFusedActivation().Type );
+	EXPECT_FALSE( CheckCast<CFullyConnectedLayer>( dnn.GetLayer( "fc" ) )->IsZeroFreeTerm() );
+
+	// Nothing else to merge
+	EXPECT_EQ( 0, OptimizeDnnForInference( dnn ) );
+
+	dnn.RunOnce();
+	expectEqualSinks( expected, dnn, "sink" );
+	expectEqualSinks( expected, dnn, "convSink" );
+
+	// The fused activations are serialized
+	{
+		CArchiveFile file( fileName, CArchive::store, GetPlatformEnv() );
+		CArchive archive( &file, CArchive::SD_Storing );
+		archive.Serialize( dnn );
+	}
+	CDnn loaded( random, MathEngine() );
+	{
+		CArchiveFile file( fileName, CArchive::load, GetPlatformEnv() );
+		CArchive archive( &file, CArchive::SD_Loading );
+		archive.Serialize( loaded );
+	}
+	CheckCast<CSourceLayer>( loaded.GetLayer( "source" ) )->SetBlob(
+		CheckCast<CSourceLayer>( expected.GetLayer( "source" ) )->GetBlob() );
+	loaded.RunOnce();
+	expectEqualSinks( expected, loaded, "sink" );
+	expectEqualSinks( expected, loaded, "convSink" );
+}
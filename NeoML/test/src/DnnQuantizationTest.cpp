@@ -0,0 +1,244 @@
+/* Copyright © 2021 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <common.h>
+#pragma hdrstop
+
+#include <TestFixture.h>
+
+using namespace NeoML;
+using namespace NeoMLTest;
+
+static void getBlobData( const CDnnBlob& blob, CArray<float>& data )
+{
+	data.SetSize( blob.GetDataSize() );
+	blob.CopyTo( data.GetPtr() );
+}
+
+// Builds the network: two convolutions (3x3 and 1x1) and a fully connected layer
+static void buildQuantizationTestDnn( CDnn& dnn, CRandom& random )
+{
+	CPtr<CSourceLayer> source = new CSourceLayer( MathEngine() );
+	source->SetName( "source" );
+	dnn.AddLayer( *source );
+	CPtr<CDnnBlob> data = CDnnBlob::Create2DImageBlob( MathEngine(), CT_Float, 1, 4, 8, 8, 3 );
+	CArray<float> buffer;
+	buffer.SetSize( data->GetDataSize() );
+	for( int i = 0; i < buffer.Size(); ++i ) {
+		buffer[i] = static_cast<float>( random.Uniform( -1, 1 ) );
+	}
+	data->CopyFrom( buffer.GetPtr() );
+	source->SetBlob( data );
+
+	CPtr<CConvLayer> conv = new CConvLayer( MathEngine() );
+	conv->SetName( "conv" );
+	conv->SetFilterCount( 8 );
+	conv->SetFilterHeight( 3 );
+	conv->SetFilterWidth( 3 );
+	conv->SetPaddingHeight( 1 );
+	conv->SetPaddingWidth( 1 );
+	conv->Connect( *source );
+	dnn.AddLayer( *conv );
+
+	CPtr<CReLULayer> relu = new CReLULayer( MathEngine() );
+	relu->SetName( "relu" );
+	relu->Connect( *conv );
+	dnn.AddLayer( *relu );
+
+	CPtr<CConvLayer> conv1x1 = new CConvLayer( MathEngine() );
+	conv1x1->SetName( "conv1x1" );
+	conv1x1->SetFilterCount( 5 );
+	conv1x1->SetFilterHeight( 1 );
+	conv1x1->SetFilterWidth( 1 );
+	conv1x1->Connect( *relu );
+	dnn.AddLayer( *conv1x1 );
+
+	CPtr<CFullyConnectedLayer> fc = new CFullyConnectedLayer( MathEngine() );
+	fc->SetName( "fc" );
+	fc->SetNumberOfElements( 10 );
+	fc->Connect( *conv1x1 );
+	dnn.AddLayer( *fc );
+
+	CPtr<CSinkLayer> sink = new CSinkLayer( MathEngine() );
+	sink->SetName( "sink" );
+	sink->Connect( *fc );
+	dnn.AddLayer( *sink );
+}
+
+TEST( CDnnQuantizationTest, QuantizeWeights )
+{
+	CRandom random( 0x1234 );
+	CPtr<CDnnBlob> weights = CDnnBlob::CreateDataBlob( MathEngine(), CT_Float, 1, 6, 37 );
+	CArray<float> data;
+	data.SetSize( weights->GetDataSize() );
+	for( int i = 0; i < data.Size(); ++i ) {
+		// The rows have different ranges; the last row is zero
+		const int row = i / weights->GetObjectSize();
+		data[i] = row == 5 ? 0.f : static_cast<float>( random.Uniform( -1, 1 ) * ( row + 1 ) );
+	}
+	weights->CopyFrom( data.GetPtr() );
+
+	CPtr<CDnnBlob> quantized;
+	CPtr<CDnnBlob> scales;
+	QuantizeWeights( *weights, quantized, scales );
+	ASSERT_EQ( CT_Int8, quantized->GetDataType() );
+	ASSERT_TRUE( quantized->HasEqualDimensions( weights ) );
+	ASSERT_EQ( weights->GetObjectCount(), scales->GetDataSize() );
+
+	CArray<int8_t> quantizedData;
+	quantizedData.SetSize( quantized->GetDataSize() );
+	quantized->CopyTo( quantizedData.GetPtr() );
+	CArray<float> scalesData;
+	getBlobData( *scales, scalesData );
+
+	for( int i = 0; i < data.Size(); ++i ) {
+		const float scale = scalesData[i / weights->GetObjectSize()];
+		EXPECT_LE( abs( static_cast<int>( quantizedData[i] ) ), 127 );
+		EXPECT_NEAR( data[i], quantizedData[i] * scale, scale / 2 + 1e-6f );
+	}
+}
+
+TEST( CDnnQuantizationTest, PostTrainingQuantization )
+{
+	if( MathEngine().GetType() != MET_Cpu ) {
+		return;
+	}
+
+	CRandom random( 0x5678 );
+	CDnn dnn( random, MathEngine() );
+	buildQuantizationTestDnn( dnn, random );
+
+	dnn.RunOnce();
+	CArray<float> expected;
+	getBlobData( *CheckCast<CSinkLayer>( dnn.GetLayer( "sink" ) )->GetBlob(), expected );
+
+	{
+		CDnnPostTrainingQuantization quantization( dnn );
+		quantization.Calibrate();
+		EXPECT_EQ( 3, quantization.Quantize() );
+	}
+	EXPECT_LT( 0.f, CheckCast<CConvLayer>( dnn.GetLayer( "conv" ) )->GetInputQuantizationScale() );
+	EXPECT_LT( 0.f, CheckCast<CConvLayer>( dnn.GetLayer( "conv1x1" ) )->GetInputQuantizationScale() );
+	EXPECT_LT( 0.f, CheckCast<CFullyConnectedLayer>( dnn.GetLayer( "fc" ) )->GetInputQuantizationScale() );
+
+	CArray<const char*> layerList;
+	dnn.GetLayerList( layerList );
+	EXPECT_EQ( 6, layerList.Size() );
+
+	dnn.RunOnce();
+	CArray<float> quantized;
+	getBlobData( *CheckCast<CSinkLayer>( dnn.GetLayer( "sink" ) )->GetBlob(), quantized );
+
+	ASSERT_EQ( expected.Size(), quantized.Size() );
+	float maxAbs = 0;
+	for( int i = 0; i < expected.Size(); ++i ) {
+		maxAbs = max( maxAbs, fabsf( expected[i] ) );
+	}
+	for( int i = 0; i < expected.Size(); ++i ) {
+		EXPECT_NEAR( expected[i], quantized[i], 0.05f * maxAbs );
+	}
+
+	// The input scales are serialized, the quantized weights are recalculated after loading
+	const CString fileName = "quantized_dnn.new_ver";
+	{
+		CArchiveFile file( fileName, CArchive::store, GetPlatformEnv() );
+		CArchive archive( &file, CArchive::SD_Storing );
+		archive.Serialize( dnn );
+	}
+	CDnn loaded( random, MathEngine() );
+	{
+		CArchiveFile file( fileName, CArchive::load, GetPlatformEnv() );
+		CArchive archive( &file, CArchive::SD_Loading );
+		archive.Serialize( loaded );
+	}
+	CheckCast<CSourceLayer>( loaded.GetLayer( "source" ) )->SetBlob(
+		CheckCast<CSourceLayer>( dnn.GetLayer( "source" ) )->GetBlob() );
+	loaded.RunOnce();
+	CArray<float> loadedResult;
+	getBlobData( *CheckCast<CSinkLayer>( loaded.GetLayer( "sink" ) )->GetBlob(), loadedResult );
+	ASSERT_EQ( quantized.Size(), loadedResult.Size() );
+	for( int i = 0; i < quantized.Size(); ++i ) {
+		EXPECT_FLOAT_EQ( quantized[i], loadedResult[i] );
+	}
+}
+
+TEST( CDnnQuantizationTest, BFloat16Weights )
+{
+	if( MathEngine().GetType() != MET_Cpu ) {
+		return;
+	}
+
+	CRandom random( 0x9abc );
+	CDnn dnn( random, MathEngine() );
+	buildQuantizationTestDnn( dnn, random );
+
+	dnn.RunOnce();
+	CArray<float> expected;
+	getBlobData( *CheckCast<CSinkLayer>( dnn.GetLayer( "sink" ) )->GetBlob(), expected );
+
+	CPtr<CFullyConnectedLayer> fc = CheckCast<CFullyConnectedLayer>( dnn.GetLayer( "fc" ) );
+	CArray<float> floatWeights;
+	getBlobData( *fc->GetWeightsData(), floatWeights );
+
+	fc->SetWeightsType( CT_BFloat16 );
+	CheckCast<CConvLayer>( dnn.GetLayer( "conv" ) )->SetFilterType( CT_BFloat16 );
+	CheckCast<CConvLayer>( dnn.GetLayer( "conv1x1" ) )->SetFilterType( CT_BFloat16 );
+
+	// The weights are still available as floats
+	CArray<float> bFloat16Weights;
+	getBlobData( *fc->GetWeightsData(), bFloat16Weights );
+	ASSERT_EQ( floatWeights.Size(), bFloat16Weights.Size() );
+	for( int i = 0; i < floatWeights.Size(); ++i ) {
+		// bfloat16 keeps 8 bits of the mantissa
+		EXPECT_NEAR( floatWeights[i], bFloat16Weights[i], fabsf( floatWeights[i] ) / 256 );
+	}
+
+	dnn.RunOnce();
+	CArray<float> result;
+	getBlobData( *CheckCast<CSinkLayer>( dnn.GetLayer( "sink" ) )->GetBlob(), result );
+	ASSERT_EQ( expected.Size(), result.Size() );
+	float maxAbs = 0;
+	for( int i = 0; i < expected.Size(); ++i ) {
+		maxAbs = max( maxAbs, fabsf( expected[i] ) );
+	}
+	for( int i = 0; i < expected.Size(); ++i ) {
+		EXPECT_NEAR( expected[i], result[i], 0.01f * maxAbs );
+	}
+
+	// The weights are serialized in bfloat16
+	const CString fileName = "bfloat16_dnn.new_ver";
+	{
+		CArchiveFile file( fileName, CArchive::store, GetPlatformEnv() );
+		CArchive archive( &file, CArchive::SD_Storing );
+		archive.Serialize( dnn );
+	}
+	CDnn loaded( random, MathEngine() );
+	{
+		CArchiveFile file( fileName, CArchive::load, GetPlatformEnv() );
+		CArchive archive( &file, CArchive::SD_Loading );
+		archive.Serialize( loaded );
+	}
+	EXPECT_EQ( CT_BFloat16, CheckCast<CFullyConnectedLayer>( loaded.GetLayer( "fc" ) )->GetWeightsType() );
+	EXPECT_EQ( CT_BFloat16, CheckCast<CConvLayer>( loaded.GetLayer( "conv" ) )->GetFilterType() );
+	CheckCast<CSourceLayer>( loaded.GetLayer( "source" ) )->SetBlob(
+		CheckCast<CSourceLayer>( dnn.GetLayer( "source" ) )->GetBlob() );
+	loaded.RunOnce();
+	CArray<float> loadedResult;
+	getBlobData( *CheckCast<CSinkLayer>( loaded.GetLayer( "sink" ) )->GetBlob(), loadedResult );
+	ASSERT_EQ( result.Size(), loadedResult.Size() );
+	for( int i = 0; i < result.Size(); ++i ) {
+		EXPECT_FLOAT_EQ( result[i], loadedResult[i] );
+	}
+}
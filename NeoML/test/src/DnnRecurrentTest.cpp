@@ -0,0 +1,236 @@
+/* Copyright © 2021 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <common.h>
+#pragma hdrstop
+
+#include <TestFixture.h>
+#include <memory>
+
+using namespace NeoML;
+using namespace NeoMLTest;
+
+static const int RnnSequenceLength = 7;
+static const int RnnBatchSize = 3;
+static const int RnnInputSize = 5;
+static const int RnnHiddenSize = 6;
+// The hidden size large enough for the sequence kernels to split the hidden units between the threads
+static const int RnnLargeHiddenSize = 600;
+
+static CPtr<CDnnBlob> createRandomBlob( IMathEngine& mathEngine, CRandom& random,
+	int batchLength, int batchWidth, int channels )
+{
+	CPtr<CDnnBlob> blob = CDnnBlob::CreateDataBlob( mathEngine, CT_Float, batchLength, batchWidth, channels );
+	CArray<float> data;
+	data.SetSize( blob->GetDataSize() );
+	for( int i = 0; i < data.Size(); ++i ) {
+		data[i] = static_cast<float>( random.Uniform( -1, 1 ) );
+	}
+	blob->CopyFrom( data.GetPtr() );
+	return blob;
+}
+
+static void getBlobData( const CDnnBlob& blob, CArray<float>& data )
+{
+	data.SetSize( blob.GetDataSize() );
+	blob.CopyTo( data.GetPtr() );
+}
+
+static void expectEqualBlobs( const CDnnBlob& expected, const CDnnBlob& actual )
+{
+	CArray<float> expectedData;
+	getBlobData( expected, expectedData );
+	CArray<float> actualData;
+	getBlobData( actual, actualData );
+	ASSERT_EQ( expectedData.Size(), actualData.Size() );
+	for( int i = 0; i < expectedData.Size(); ++i ) {
+		EXPECT_NEAR( expectedData[i], actualData[i], 1e-4f );
+	}
+}
+
+// Builds the network: fully connected layer, the recurrent layer and the euclidean loss
+// If hasInitialState is set the zero initial state is connected to the recurrent layer,
+// so it runs the internal network step by step instead of the sequence kernel
+template<class TLayer>
+static CPtr<TLayer> buildRecurrentTestDnn( CDnn& dnn, int hiddenSize, bool hasInitialState, bool isReverse,
+	const CPtr<CDnnBlob>& data, const CPtr<CDnnBlob>& labels )
+{
+	IMathEngine& mathEngine = dnn.GetMathEngine();
+	CPtr<CSourceLayer> source = new CSourceLayer( mathEngine );
+	source->SetName( "source" );
+	source->SetBlob( data );
+	dnn.AddLayer( *source );
+
+	CPtr<CFullyConnectedLayer> fc = new CFullyConnectedLayer( mathEngine );
+	fc->SetName( "fc" );
+	fc->SetNumberOfElements( RnnInputSize );
+	fc->Connect( *source );
+	dnn.AddLayer( *fc );
+
+	CPtr<TLayer> recurrent = new TLayer( mathEngine );
+	recurrent->SetName( "recurrent" );
+	recurrent->SetHiddenSize( hiddenSize );
+	recurrent->SetReverseSequence( isReverse );
+	recurrent->Connect( *fc );
+	dnn.AddLayer( *recurrent );
+
+	if( hasInitialState ) {
+		CPtr<CSourceLayer> initialState = new CSourceLayer( mathEngine );
+		initialState->SetName( "initialState" );
+		CPtr<CDnnBlob> state = CDnnBlob::CreateDataBlob( mathEngine, CT_Float, 1, RnnBatchSize, hiddenSize );
+		state->Clear();
+		initialState->SetBlob( state );
+		dnn.AddLayer( *initialState );
+		recurrent->Connect( 1, *initialState );
+	}
+
+	CPtr<CSourceLayer> label = new CSourceLayer( mathEngine );
+	label->SetName( "label" );
+	label->SetBlob( labels );
+	dnn.AddLayer( *label );
+
+	CPtr<CEuclideanLossLayer> loss = new CEuclideanLossLayer( mathEngine );
+	loss->SetName( "loss" );
+	loss->Connect( 0, *recurrent );
+	loss->Connect( 1, *label );
+	dnn.AddLayer( *loss );
+
+	CPtr<CSinkLayer> sink = new CSinkLayer( mathEngine );
+	sink->SetName( "sink" );
+	sink->Connect( *recurrent );
+	dnn.AddLayer( *sink );
+
+	CPtr<CDnnSimpleGradientSolver> solver = new CDnnSimpleGradientSolver( mathEngine );
+	solver->SetLearningRate( 0.1f );
+	dnn.SetSolver( solver );
+	return recurrent;
+}
+
+static void copyFcWeights( const CDnn& from, CDnn& to )
+{
+	CPtr<const CFullyConnectedLayer> fromFc = CheckCast<const CFullyConnectedLayer>( from.GetLayer( "fc" ) );
+	CPtr<CFullyConnectedLayer> toFc = CheckCast<CFullyConnectedLayer>( to.GetLayer( "fc" ) );
+	toFc->SetWeightsData( fromFc->GetWeightsData() );
+	toFc->SetFreeTermData( fromFc->GetFreeTermData() );
+}
+
+static void expectEqualSinks( const CDnn& expected, const CDnn& actual )
+{
+	expectEqualBlobs( *CheckCast<const CSinkLayer>( expected.GetLayer( "sink" ) )->GetBlob(),
+		*CheckCast<const CSinkLayer>( actual.GetLayer( "sink" ) )->GetBlob() );
+}
+
+static void checkLstmSequenceKernel( IMathEngine& mathEngine, bool isReverse, int hiddenSize = RnnHiddenSize )
+{
+	CRandom random( 0x3571 );
+	CPtr<CDnnBlob> data = createRandomBlob( mathEngine, random, RnnSequenceLength, RnnBatchSize, 4 );
+	CPtr<CDnnBlob> labels = createRandomBlob( mathEngine, random, RnnSequenceLength, RnnBatchSize, hiddenSize );
+
+	CDnn expectedDnn( random, mathEngine );
+	CPtr<CLstmLayer> expected = buildRecurrentTestDnn<CLstmLayer>( expectedDnn, hiddenSize, true, isReverse, data, labels );
+	CDnn dnn( random, mathEngine );
+	CPtr<CLstmLayer> lstm = buildRecurrentTestDnn<CLstmLayer>( dnn, hiddenSize, false, isReverse, data, labels );
+
+	expectedDnn.RunOnce();
+	copyFcWeights( expectedDnn, dnn );
+	lstm->SetInputWeightsData( expected->GetInputWeightsData() );
+	lstm->SetInputFreeTermData( expected->GetInputFreeTermData() );
+	lstm->SetRecurWeightsData( expected->GetRecurWeightsData() );
+	lstm->SetRecurFreeTermData( expected->GetRecurFreeTermData() );
+
+	dnn.RunOnce();
+	expectEqualSinks( expectedDnn, dnn );
+
+	for( int i = 0; i < 3; ++i ) {
+		expectedDnn.RunAndLearnOnce();
+		dnn.RunAndLearnOnce();
+		expectEqualSinks( expectedDnn, dnn );
+	}
+	expectEqualBlobs( *expected->GetInputWeightsData(), *lstm->GetInputWeightsData() );
+	expectEqualBlobs( *expected->GetInputFreeTermData(), *lstm->GetInputFreeTermData() );
+	expectEqualBlobs( *expected->GetRecurWeightsData(), *lstm->GetRecurWeightsData() );
+	expectEqualBlobs( *expected->GetRecurFreeTermData(), *lstm->GetRecurFreeTermData() );
+	// The input diff reaches the previous layer
+	expectEqualBlobs( *CheckCast<CFullyConnectedLayer>( expectedDnn.GetLayer( "fc" ) )->GetWeightsData(),
+		*CheckCast<CFullyConnectedLayer>( dnn.GetLayer( "fc" ) )->GetWeightsData() );
+}
+
+static void checkGruSequenceKernel( IMathEngine& mathEngine, bool isReverse, int hiddenSize = RnnHiddenSize )
+{
+	CRandom random( 0x1753 );
+	CPtr<CDnnBlob> data = createRandomBlob( mathEngine, random, RnnSequenceLength, RnnBatchSize, 4 );
+	CPtr<CDnnBlob> labels = createRandomBlob( mathEngine, random, RnnSequenceLength, RnnBatchSize, hiddenSize );
+
+	CDnn expectedDnn( random, mathEngine );
+	CPtr<CGruLayer> expected = buildRecurrentTestDnn<CGruLayer>( expectedDnn, hiddenSize, true, isReverse, data, labels );
+	CDnn dnn( random, mathEngine );
+	CPtr<CGruLayer> gru = buildRecurrentTestDnn<CGruLayer>( dnn, hiddenSize, false, isReverse, data, labels );
+
+	expectedDnn.RunOnce();
+	copyFcWeights( expectedDnn, dnn );
+	gru->SetGateWeightsData( expected->GetGateWeightsData() );
+	gru->SetGateFreeTermData( expected->GetGateFreeTermData() );
+	gru->SetMainWeightsData( expected->GetMainWeightsData() );
+	gru->SetMainFreeTermData( expected->GetMainFreeTermData() );
+
+	dnn.RunOnce();
+	expectEqualSinks( expectedDnn, dnn );
+
+	for( int i = 0; i < 3; ++i ) {
+		expectedDnn.RunAndLearnOnce();
+		dnn.RunAndLearnOnce();
+		expectEqualSinks( expectedDnn, dnn );
+	}
+	expectEqualBlobs( *expected->GetGateWeightsData(), *gru->GetGateWeightsData() );
+	expectEqualBlobs( *expected->GetGateFreeTermData(), *gru->GetGateFreeTermData() );
+	expectEqualBlobs( *expected->GetMainWeightsData(), *gru->GetMainWeightsData() );
+	expectEqualBlobs( *expected->GetMainFreeTermData(), *gru->GetMainFreeTermData() );
+	expectEqualBlobs( *CheckCast<CFullyConnectedLayer>( expectedDnn.GetLayer( "fc" ) )->GetWeightsData(),
+		*CheckCast<CFullyConnectedLayer>( dnn.GetLayer( "fc" ) )->GetWeightsData() );
+}
+
+TEST( CDnnRecurrentTest, LstmSequenceKernel )
+{
+	checkLstmSequenceKernel( MathEngine(), false );
+}
+
+TEST( CDnnRecurrentTest, LstmSequenceKernelReverse )
+{
+	checkLstmSequenceKernel( MathEngine(), true );
+}
+
+TEST( CDnnRecurrentTest, GruSequenceKernel )
+{
+	checkGruSequenceKernel( MathEngine(), false );
+}
+
+TEST( CDnnRecurrentTest, GruSequenceKernelReverse )
+{
+	checkGruSequenceKernel( MathEngine(), true );
+}
+
+// The hidden units are split between the threads inside the sequence kernels
+TEST( CDnnRecurrentTest, SequenceKernelMultiThreading )
+{
+	if( MathEngine().GetType() != MET_Cpu ) {
+		return;
+	}
+
+	std::unique_ptr<IMathEngine> mathEngine( CreateCpuMathEngine( 4, 0 ) );
+	for( int isReverse = 0; isReverse < 2; ++isReverse ) {
+		checkLstmSequenceKernel( *mathEngine, isReverse != 0, RnnLargeHiddenSize );
+		checkGruSequenceKernel( *mathEngine, isReverse != 0, RnnLargeHiddenSize );
+	}
+}
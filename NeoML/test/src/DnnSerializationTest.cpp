@@ -167,6 +167,277 @@ static void checkSerializedNet( const CString& fileName )
 	}
 
 	checkNet( inputBlobs, outputBlobs, cnn, fileName );
+
+	{
+		// Load from the same file mapped into memory
+		CMappedArchiveFile archiveFile( "test_archive.new_ver" );
+		CArchive archive( &archiveFile, CArchive::SD_Loading );
+		archive.Serialize( cnn );
+	}
+
+	checkNet( inputBlobs, outputBlobs, cnn, fileName );
+}
+
+static void getSinkData( CDnn& dnn, CArray<float>& data )
+{
+	CPtr<CDnnBlob> blob = CheckCast<CSinkLayer>( dnn.GetLayer( "sink" ) )->GetBlob();
+	data.SetSize( blob->GetDataSize() );
+	blob->CopyTo( data.GetPtr() );
+}
+
+// Checks that the blobs loaded from the memory-mapped file are not copied
+TEST_F( CDnnSerializationTest, MappedArchiveFile )
+{
+	if( MathEngine().GetType() != MET_Cpu ) {
+		return;
+	}
+
+	const int inputSize = 1024;
+	const int outputSize = 256;
+	CRandom random( 0x3579 );
+	CPtr<CDnnBlob> input = CDnnBlob::CreateDataBlob( MathEngine(), CT_Float, 1, 4, inputSize );
+	CArray<float> inputData;
+	inputData.SetSize( input->GetDataSize() );
+	for( int i = 0; i < inputData.Size(); ++i ) {
+		inputData[i] = static_cast<float>( random.Uniform( -1, 1 ) );
+	}
+	input->CopyFrom( inputData.GetPtr() );
+
+	CArray<float> expected;
+	const CString fileName = "mapped_dnn.new_ver";
+	{
+		CDnn dnn( random, MathEngine() );
+		CSourceLayer* source = Source( dnn, "source" );
+		CFullyConnectedLayer* fc = new CFullyConnectedLayer( MathEngine() );
+		fc->SetName( "fc" );
+		fc->SetNumberOfElements( outputSize );
+		fc->Connect( *source );
+		dnn.AddLayer( *fc );
+		Sink( fc, "sink" );
+		source->SetBlob( input );
+		dnn.RunOnce();
+		getSinkData( dnn, expected );
+
+		CArchiveFile file( fileName, CArchive::store, GetPlatformEnv() );
+		CArchive archive( &file, CArchive::SD_Storing );
+		archive.Serialize( dnn );
+	}
+
+	std::unique_ptr<IMathEngine> mathEngine( CreateCpuMathEngine( 1, 0 ) );
+	CPtr<CDnnBlob> mappedInput = CDnnBlob::CreateDataBlob( *mathEngine, CT_Float, 1, 4, inputSize );
+	mappedInput->CopyFrom( inputData.GetPtr() );
+	const size_t initialMemoryUsage = mathEngine->GetPeakMemoryUsage();
+	for( int pass = 0; pass < 2; ++pass ) {
+		CDnn dnn( random, *mathEngine );
+		{
+			CMappedArchiveFile file( fileName );
+			CArchive archive( &file, CArchive::SD_Loading );
+			archive.Serialize( dnn );
+		}
+		if( pass == 0 ) {
+			// The weights stay in the file
+			EXPECT_GT( initialMemoryUsage + inputSize * outputSize * sizeof( float ),
+				mathEngine->GetPeakMemoryUsage() );
+		}
+
+		CheckCast<CSourceLayer>( dnn.GetLayer( "source" ) )->SetBlob( mappedInput );
+		dnn.RunOnce();
+		CArray<float> result;
+		getSinkData( dnn, result );
+		ASSERT_EQ( expected.Size(), result.Size() );
+		for( int i = 0; i < expected.Size(); ++i ) {
+			EXPECT_FLOAT_EQ( expected[i], result[i] );
+		}
+
+		// Changing the weights doesn't change the file, so the second pass gets the same result
+		CPtr<CDnnBlob> weights = CheckCast<CFullyConnectedLayer>( dnn.GetLayer( "fc" ) )->GetWeightsData();
+		weights->Fill( 0.f );
+		CheckCast<CFullyConnectedLayer>( dnn.GetLayer( "fc" ) )->SetWeightsData( weights );
+	}
+}
+
+static void getSinkData( CDnn& dnn, const char* sinkName, CArray<float>& data )
+{
+	CPtr<CDnnBlob> blob = CheckCast<CSinkLayer>( dnn.GetLayer( sinkName ) )->GetBlob();
+	data.SetSize( blob->GetDataSize() );
+	blob->CopyTo( data.GetPtr() );
+}
+
+static void setReferenceDnnInputs( CDnn& dnn, const CArray<float>& inputData, const CArray<int>& ids )
+{
+	IMathEngine& mathEngine = dnn.GetMathEngine();
+	CPtr<CDnnBlob> input = CDnnBlob::CreateDataBlob( mathEngine, CT_Float, 1, 4, inputData.Size() / 4 );
+	input->CopyFrom( inputData.GetPtr() );
+	CheckCast<CSourceLayer>( dnn.GetLayer( "source" ) )->SetBlob( input );
+	CPtr<CDnnBlob> idsBlob = CDnnBlob::CreateDataBlob( mathEngine, CT_Int, 1, 4, 1 );
+	idsBlob->CopyFrom( ids.GetPtr() );
+	CheckCast<CSourceLayer>( dnn.GetLayer( "ids" ) )->SetBlob( idsBlob );
+}
+
+// Checks that the copies created by CreateReferenceDnn calculate the same results
+// and don't allocate memory for the weights, the embeddings and the quantized weights
+TEST_F( CDnnSerializationTest, ReferenceDnn )
+{
+	if( MathEngine().GetType() != MET_Cpu ) {
+		return;
+	}
+
+	const int inputSize = 512;
+	const int outputSize = 256;
+	const int wordCount = 4096;
+	const int embeddingSize = 64;
+	CRandom random( 0x2468 );
+	std::unique_ptr<IMathEngine> mathEngine( CreateCpuMathEngine( 1, 0 ) );
+
+	CArray<float> inputData;
+	inputData.SetSize( 4 * inputSize );
+	for( int i = 0; i < inputData.Size(); ++i ) {
+		inputData[i] = static_cast<float>( random.Uniform( -1, 1 ) );
+	}
+	CArray<int> ids;
+	for( int i = 0; i < 4; ++i ) {
+		ids.Add( random.UniformInt( 0, wordCount - 1 ) );
+	}
+
+	// source -> fc -> batch norm -> sink
+	//        -> quantized fc -> quantizedSink
+	// ids -> lookup -> lookupSink
+	CDnn dnn( random, *mathEngine );
+	CSourceLayer* source = Source( dnn, "source" );
+	CPtr<CFullyConnectedLayer> fc = new CFullyConnectedLayer( *mathEngine );
+	fc->SetName( "fc" );
+	fc->SetNumberOfElements( outputSize );
+	fc->Connect( *source );
+	dnn.AddLayer( *fc );
+	CPtr<CBatchNormalizationLayer> batchNorm = new CBatchNormalizationLayer( *mathEngine );
+	batchNorm->SetName( "batchNorm" );
+	batchNorm->Connect( *fc );
+	dnn.AddLayer( *batchNorm );
+	Sink( batchNorm.Ptr(), "sink" );
+	CPtr<CFullyConnectedLayer> quantizedFc = new CFullyConnectedLayer( *mathEngine );
+	quantizedFc->SetName( "quantizedFc" );
+	quantizedFc->SetNumberOfElements( outputSize );
+	quantizedFc->SetInputQuantizationScale( 1.f / 127 );
+	quantizedFc->Connect( *source );
+	dnn.AddLayer( *quantizedFc );
+	Sink( quantizedFc.Ptr(), "quantizedSink" );
+	CSourceLayer* idsSource = Source( dnn, "ids" );
+	CPtr<CMultichannelLookupLayer> lookup = new CMultichannelLookupLayer( *mathEngine );
+	lookup->SetName( "lookup" );
+	CArray<CLookupDimension> dimensions;
+	dimensions.Add( CLookupDimension( wordCount, embeddingSize ) );
+	lookup->SetDimensions( dimensions );
+	lookup->Connect( *idsSource );
+	dnn.AddLayer( *lookup );
+	Sink( lookup.Ptr(), "lookupSink" );
+
+	setReferenceDnnInputs( dnn, inputData, ids );
+	dnn.RunOnce();
+	const char* sinkNames[] = { "sink", "quantizedSink", "lookupSink" };
+	CArray<float> expected[3];
+	for( int i = 0; i < 3; ++i ) {
+		getSinkData( dnn, sinkNames[i], expected[i] );
+	}
+
+	const size_t weightsSize = 2 * inputSize * outputSize * sizeof( float ) + wordCount * embeddingSize * sizeof( float );
+	const size_t peakMemoryUsage = mathEngine->GetPeakMemoryUsage();
+	CRandom copyRandom[2];
+	std::unique_ptr<CDnn> copies[2];
+	for( int copyIndex = 0; copyIndex < 2; ++copyIndex ) {
+		copies[copyIndex].reset( new CDnn( copyRandom[copyIndex], *mathEngine ) );
+		CDnn& copy = *copies[copyIndex];
+		dnn.CreateReferenceDnn( copy );
+		EXPECT_FALSE( copy.IsLearningEnabled() );
+		EXPECT_TRUE( CheckCast<CMultichannelLookupLayer>( copy.GetLayer( "lookup" ) )->GetEmbeddings( 0 )->GetData()
+			== lookup->GetEmbeddings( 0 )->GetData() );
+
+		setReferenceDnnInputs( copy, inputData, ids );
+		copy.RunOnce();
+		for( int i = 0; i < 3; ++i ) {
+			CArray<float> result;
+			getSinkData( copy, sinkNames[i], result );
+			ASSERT_EQ( expected[i].Size(), result.Size() );
+			for( int j = 0; j < result.Size(); ++j ) {
+				EXPECT_EQ( expected[i][j], result[j] ) << sinkNames[i];
+			}
+		}
+	}
+	// Only the inputs and the outputs are allocated for the copies
+	EXPECT_GT( peakMemoryUsage + weightsSize / 16, mathEngine->GetPeakMemoryUsage() );
+}
+
+static void fillReferenceDnnRandomBlob( CRandom& random, CDnnBlob& blob )
+{
+	CArray<float> data;
+	data.SetSize( blob.GetDataSize() );
+	for( int i = 0; i < data.Size(); ++i ) {
+		data[i] = static_cast<float>( random.Uniform( -1, 1 ) );
+	}
+	blob.CopyFrom( data.GetPtr() );
+}
+
+// Checks that the copies created by CreateReferenceDnn use the new parameters after they are changed
+// in the original network (the quantized weights calculated from the old ones should not be used)
+TEST_F( CDnnSerializationTest, ReferenceDnnParamsChange )
+{
+	if( MathEngine().GetType() != MET_Cpu ) {
+		return;
+	}
+
+	CRandom random( 0x1234 );
+	CDnn dnn( random, MathEngine() );
+	CSourceLayer* source = Source( dnn, "source" );
+	CPtr<CFullyConnectedLayer> fc = new CFullyConnectedLayer( MathEngine() );
+	fc->SetName( "fc" );
+	fc->SetNumberOfElements( 16 );
+	fc->SetInputQuantizationScale( 1.f / 127 );
+	fc->Connect( *source );
+	dnn.AddLayer( *fc );
+	Sink( fc.Ptr(), "fcSink" );
+	CPtr<CConvLayer> conv = new CConvLayer( MathEngine() );
+	conv->SetName( "conv" );
+	conv->SetFilterCount( 16 );
+	conv->SetFilterHeight( 3 );
+	conv->SetFilterWidth( 3 );
+	conv->SetPaddingHeight( 1 );
+	conv->SetPaddingWidth( 1 );
+	conv->SetInputQuantizationScale( 1.f / 127 );
+	conv->Connect( *source );
+	dnn.AddLayer( *conv );
+	Sink( conv.Ptr(), "convSink" );
+
+	CPtr<CDnnBlob> input = CDnnBlob::Create2DImageBlob( MathEngine(), CT_Float, 1, 2, 5, 5, 8 );
+	fillReferenceDnnRandomBlob( random, *input );
+	CheckCast<CSourceLayer>( dnn.GetLayer( "source" ) )->SetBlob( input );
+	dnn.RunOnce();
+
+	CRandom copyRandom;
+	CDnn copy( copyRandom, MathEngine() );
+	dnn.CreateReferenceDnn( copy );
+	CheckCast<CSourceLayer>( copy.GetLayer( "source" ) )->SetBlob( input );
+	copy.RunOnce();
+
+	// Change the parameters of the original network in place
+	CPtr<CDnnBlob> weights = fc->GetWeightsData();
+	fillReferenceDnnRandomBlob( random, *weights );
+	fc->SetWeightsData( weights );
+	CPtr<CDnnBlob> filter = conv->GetFilterData();
+	fillReferenceDnnRandomBlob( random, *filter );
+	conv->SetFilterData( filter );
+
+	dnn.RunOnce();
+	copy.RunOnce();
+	const char* sinkNames[] = { "fcSink", "convSink" };
+	for( int i = 0; i < 2; ++i ) {
+		CArray<float> expected;
+		getSinkData( dnn, sinkNames[i], expected );
+		CArray<float> result;
+		getSinkData( copy, sinkNames[i], result );
+		ASSERT_EQ( expected.Size(), result.Size() );
+		for( int j = 0; j < result.Size(); ++j ) {
+			EXPECT_EQ( expected[j], result[j] ) << sinkNames[i];
+		}
+	}
 }
 
 // Checks serialization of the old versions of CDnn
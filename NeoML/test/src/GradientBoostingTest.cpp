@@ -145,4 +145,249 @@ TEST( CGradientBoostingTest, IterativeRegressionTest )
 		params.TreeBuilder = type;
 		regressionTest( train.Ptr(), test.Ptr(), params );
 	}
-}
\ No newline at end of file
+}
+static void checkBatchClassification( const IGradientBoostQSModel& qsModel, const IGradientBoostModel& model,
+	const CClassificationRandomProblem& test )
+{
+	const CFloatMatrixDesc matrix = test.GetMatrix();
+	for( int threadCount : { 1, 4 } ) {
+		CArray<CClassificationResult> qsResults;
+		qsModel.ClassifyBatch( matrix, qsResults, threadCount );
+		CArray<CClassificationResult> results;
+		model.ClassifyBatch( matrix, results, threadCount );
+		ASSERT_EQ( matrix.Height, qsResults.Size() );
+		ASSERT_EQ( matrix.Height, results.Size() );
+
+		for( int i = 0; i < matrix.Height; i++ ) {
+			CClassificationResult expected;
+			ASSERT_TRUE( qsModel.Classify( matrix.GetRow( i ), expected ) );
+			ASSERT_EQ( expected.PreferredClass, qsResults[i].PreferredClass );
+			ASSERT_EQ( expected.Probabilities.Size(), qsResults[i].Probabilities.Size() );
+			for( int j = 0; j < expected.Probabilities.Size(); j++ ) {
+				ASSERT_EQ( expected.Probabilities[j].GetValue(), qsResults[i].Probabilities[j].GetValue() );
+			}
+
+			ASSERT_TRUE( model.Classify( matrix.GetRow( i ), expected ) );
+			ASSERT_EQ( expected.PreferredClass, results[i].PreferredClass );
+		}
+	}
+}
+
+TEST( CGradientBoostingTest, BatchClassification )
+{
+	CRandom rand( 42 );
+	auto train = CClassificationRandomProblem::Random( rand, 2000, 20, 3 );
+	auto test = CClassificationRandomProblem::Random( rand, 1000, 20, 3 );
+	auto binaryTrain = CClassificationRandomProblem::Random( rand, 2000, 20, 2 );
+	auto binaryTest = CClassificationRandomProblem::Random( rand, 1000, 20, 2 );
+
+	CGradientBoost::CParams params;
+	params.IterationsCount = 30;
+	// The deep trees do not fit into 64 leaves and are partially scored without bit masks
+	for( int depth : { 3, 8 } ) {
+		params.MaxTreeDepth = depth;
+		for( auto problems : { std::make_pair( train, test ), std::make_pair( binaryTrain, binaryTest ) } ) {
+			CGradientBoost boosting( params );
+			CPtr<IGradientBoostModel> model = boosting.TrainModel<IGradientBoostModel>( *problems.first );
+			CPtr<IGradientBoostQSModel> qsModel = CGradientBoostQuickScorer().Build( *model );
+
+			checkBatchClassification( *qsModel, *model, *problems.second );
+			checkBatchClassification( *qsModel, *model, *problems.second->CreateSparse() );
+		}
+	}
+}
+
+TEST( CGradientBoostingTest, BatchRegression )
+{
+	CRandom rand( 42 );
+	auto train = CRegressionRandomProblem::Random( rand, 2000, 20, 10 );
+	auto test = CRegressionRandomProblem::Random( rand, 1000, 20, 10 );
+
+	CGradientBoost::CParams params;
+	params.IterationsCount = 30;
+	params.MaxTreeDepth = 8;
+	CGradientBoost boosting( params );
+	CPtr<IGradientBoostRegressionModel> model = CheckCast<IGradientBoostRegressionModel>( boosting.TrainRegression( *train ) );
+	CPtr<IGradientBoostQSRegressionModel> qsModel = CGradientBoostQuickScorer().BuildRegression( *model );
+
+	auto sparseTest = test->CreateSparse();
+	for( const CFloatMatrixDesc& matrix : { test->GetMatrix(), sparseTest->GetMatrix() } ) {
+		for( int threadCount : { 1, 4 } ) {
+			CArray<double> qsResults;
+			qsModel->PredictBatch( matrix, qsResults, threadCount );
+			CArray<double> results;
+			model->PredictBatch( matrix, results, threadCount );
+			ASSERT_EQ( matrix.Height, qsResults.Size() );
+			ASSERT_EQ( matrix.Height, results.Size() );
+
+			for( int i = 0; i < matrix.Height; i++ ) {
+				ASSERT_EQ( qsModel->Predict( matrix.GetRow( i ) ), qsResults[i] );
+				ASSERT_EQ( model->Predict( matrix.GetRow( i ) ), results[i] );
+			}
+		}
+	}
+}
+
+// Builds the binned problem from the classification problem, adding the vectors by chunks
+static CPtr<CGradientBoostBinnedProblem> buildBinnedProblem( const IProblem& problem,
+	const CGradientBoostBinnedProblemBuilder::CParams& params, int chunkSize )
+{
+	const int valueSize = problem.GetClassCount() == 2 ? 1 : problem.GetClassCount();
+	CGradientBoostBinnedProblemBuilder builder( problem.GetFeatureCount(), valueSize, params );
+	const CFloatMatrixDesc matrix = problem.GetMatrix();
+	for( int begin = 0; begin < problem.GetVectorCount(); begin += chunkSize ) {
+		const int end = min( begin + chunkSize, problem.GetVectorCount() );
+		CSparseFloatMatrix chunk( problem.GetFeatureCount() );
+		CArray<float> values;
+		CArray<float> weights;
+		for( int i = begin; i < end; i++ ) {
+			chunk.AddRow( matrix.GetRow( i ) );
+			if( valueSize == 1 ) {
+				values.Add( static_cast<float>( problem.GetClass( i ) ) );
+			} else {
+				values.Add( 0.f, valueSize );
+				values[values.Size() - valueSize + problem.GetClass( i )] = 1.f;
+			}
+			weights.Add( static_cast<float>( problem.GetVectorWeight( i ) ) );
+		}
+		builder.AddChunk( chunk.GetDesc(), values, weights );
+	}
+	return builder.Build();
+}
+
+static void checkEqualBins( const CGradientBoostBinnedProblem& expected, const CGradientBoostBinnedProblem& problem )
+{
+	ASSERT_EQ( expected.GetVectorCount(), problem.GetVectorCount() );
+	ASSERT_EQ( expected.GetFeatureCount(), problem.GetFeatureCount() );
+	ASSERT_EQ( expected.GetBinSize(), problem.GetBinSize() );
+	for( int i = 0; i < expected.GetVectorCount(); i++ ) {
+		ASSERT_EQ( ::memcmp( expected.GetBins( i ), problem.GetBins( i ),
+			expected.GetFeatureCount() * expected.GetBinSize() ), 0 );
+		ASSERT_EQ( expected.GetVectorWeight( i ), problem.GetVectorWeight( i ) );
+	}
+}
+
+TEST( CGradientBoostingTest, BinnedProblemClassification )
+{
+	CRandom rand( 42 );
+	auto train = CClassificationRandomProblem::Random( rand, 2000, 20, 3 );
+	auto test = CClassificationRandomProblem::Random( rand, 500, 20, 3 );
+	auto binaryTrain = CClassificationRandomProblem::Random( rand, 2000, 20, 2 );
+	auto binaryTest = CClassificationRandomProblem::Random( rand, 500, 20, 2 );
+
+	// The bins are calculated on the whole data, as the regular histogram tree builder does
+	CGradientBoostBinnedProblemBuilder::CParams builderParams;
+	builderParams.SampleSize = train->GetVectorCount();
+
+	// The shallow trees avoid the splits of the small subsets, which may be chosen differently
+	// because of the rounding in the histograms
+	CGradientBoost::CParams params;
+	params.IterationsCount = 20;
+	params.MaxTreeDepth = 3;
+	for( auto problems : { std::make_pair( train, test ), std::make_pair( binaryTrain, binaryTest ) } ) {
+		CPtr<CGradientBoostBinnedProblem> binned = buildBinnedProblem( *problems.first, builderParams, 300 );
+		CPtr<CGradientBoostBinnedProblem> sparseBinned = buildBinnedProblem( *problems.first->CreateSparse(), builderParams, 300 );
+		checkEqualBins( *binned, *sparseBinned );
+		ASSERT_EQ( 1, binned->GetBinSize() );
+
+		for( auto type : { GBTB_FastHist, GBTB_MultiFastHist } ) {
+			params.TreeBuilder = type;
+			params.MaxBins = builderParams.MaxBins;
+			CGradientBoost boosting( params );
+			CPtr<IModel> expected = boosting.Train( *problems.first );
+			CPtr<IModel> model = boosting.Train( *binned );
+			ASSERT_EQ( expected->GetClassCount(), model->GetClassCount() );
+
+			for( int i = 0; i < problems.second->GetVectorCount(); i++ ) {
+				CClassificationResult expectedResult;
+				CClassificationResult result;
+				ASSERT_TRUE( expected->Classify( problems.second->GetVector( i ), expectedResult ) );
+				ASSERT_TRUE( model->Classify( problems.second->GetVector( i ), result ) );
+				ASSERT_EQ( expectedResult.PreferredClass, result.PreferredClass );
+			}
+		}
+	}
+}
+
+// The vectors with null weight do not affect the training on the binned problem, as on the regular one
+TEST( CGradientBoostingTest, BinnedProblemNullWeights )
+{
+	CRandom rand( 42 );
+	auto random = CClassificationRandomProblem::Random( rand, 2000, 20, 2 );
+	auto test = CClassificationRandomProblem::Random( rand, 500, 20, 2 );
+
+	// Every fourth vector gets null weight, its feature values and class are changed to mislead the training
+	CPtr<CMemoryProblem> train = new CMemoryProblem( random->GetFeatureCount(), random->GetClassCount() );
+	for( int i = 0; i < random->GetVectorCount(); i++ ) {
+		if( i % 4 != 0 ) {
+			train->Add( random->GetVector( i ), random->GetVectorWeight( i ), random->GetClass( i ) );
+			continue;
+		}
+		CSparseFloatVector vector( random->GetVector( i ) );
+		for( int j = 0; j < random->GetFeatureCount(); j++ ) {
+			vector.SetAt( j, 100.f * ( rand.UniformInt( 0, 1 ) == 0 ? -1 : 1 ) );
+		}
+		train->Add( vector, 0., 1 - random->GetClass( i ) );
+	}
+
+	CGradientBoostBinnedProblemBuilder::CParams builderParams;
+	builderParams.SampleSize = train->GetVectorCount();
+	CPtr<CGradientBoostBinnedProblem> binned = buildBinnedProblem( *train, builderParams, 300 );
+	ASSERT_EQ( train->GetVectorCount(), binned->GetVectorCount() );
+
+	CGradientBoost::CParams params;
+	params.IterationsCount = 20;
+	params.MaxTreeDepth = 3;
+	params.TreeBuilder = GBTB_FastHist;
+	params.MaxBins = builderParams.MaxBins;
+	CGradientBoost boosting( params );
+	CPtr<IModel> expected = boosting.Train( *train );
+	CPtr<IModel> model = boosting.Train( *binned );
+
+	for( int i = 0; i < test->GetVectorCount(); i++ ) {
+		CClassificationResult expectedResult;
+		CClassificationResult result;
+		ASSERT_TRUE( expected->Classify( test->GetVector( i ), expectedResult ) );
+		ASSERT_TRUE( model->Classify( test->GetVector( i ), result ) );
+		ASSERT_EQ( expectedResult.PreferredClass, result.PreferredClass );
+	}
+}
+
+TEST( CGradientBoostingTest, BinnedProblemFile )
+{
+	CRandom rand( 42 );
+	auto train = CClassificationRandomProblem::Random( rand, 2000, 20, 2 );
+	auto test = CClassificationRandomProblem::Random( rand, 500, 20, 2 );
+
+	// The bins are calculated on the first vectors, the rest are binned as they come
+	CGradientBoostBinnedProblemBuilder::CParams builderParams;
+	builderParams.SampleSize = 500;
+	builderParams.MaxBins = 512;
+	builderParams.ThreadCount = 4;
+	CPtr<CGradientBoostBinnedProblem> binned = buildBinnedProblem( *train, builderParams, 300 );
+	ASSERT_EQ( 2, binned->GetBinSize() );
+
+	const CString fileName = "binned_gb";
+	builderParams.FileName = fileName;
+	CPtr<CGradientBoostBinnedProblem> mapped = buildBinnedProblem( *train, builderParams, 300 );
+	checkEqualBins( *binned, *mapped );
+	CPtr<CGradientBoostBinnedProblem> loaded = CGradientBoostBinnedProblem::Load( fileName );
+	checkEqualBins( *binned, *loaded );
+
+	CGradientBoost::CParams params;
+	params.IterationsCount = 20;
+	params.TreeBuilder = GBTB_FastHist;
+	params.MaxBins = builderParams.MaxBins;
+	params.ThreadCount = 4;
+	CGradientBoost boosting( params );
+	CPtr<IMultivariateRegressionModel> expected = boosting.TrainRegression( *binned );
+	CPtr<IMultivariateRegressionModel> model = boosting.TrainRegression( *loaded );
+	mapped.Release();
+	loaded.Release();
+	::remove( fileName );
+
+	for( int i = 0; i < test->GetVectorCount(); i++ ) {
+		ASSERT_EQ( expected->MultivariatePredict( test->GetVector( i ) )[0],
+			model->MultivariatePredict( test->GetVector( i ) )[0] );
+	}
+}
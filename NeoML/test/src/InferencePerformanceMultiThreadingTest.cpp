@@ -82,11 +82,16 @@ public:
 	static CPtr<CDnnBlob> LoadBlob( const CString& fileName, IMathEngine& mathEngine );
 
 	static ResultType Run( const CDnnInferencePerformanceTestParam& param, IMathEngine& mathEngine );
+	static ResultType RunReference( const CDnnInferencePerformanceTestParam& param, CDnn& referenceCnn );
+	static ResultType RunInterLayerParallel( const CDnnInferencePerformanceTestParam& param, IMathEngine& mathEngine );
+	static ResultType RunMemoryPlanning( const CDnnInferencePerformanceTestParam& param, IMathEngine& mathEngine );
 
 	static CRandom& GetRandom() { return random; }
 
 private:
 	static CRandom random;
+
+	static ResultType runDnn( const CDnnInferencePerformanceTestParam& param, CDnn& cnn );
 };
 
 CRandom CDnnInferencePerformanceTest::random;
@@ -141,6 +146,50 @@ ResultType CDnnInferencePerformanceTest::Run(
 	
 	LoadCnn( param, cnn );
 
+	return runDnn( param, cnn );
+}
+
+ResultType CDnnInferencePerformanceTest::RunReference(
+	const CDnnInferencePerformanceTestParam& param, CDnn& referenceCnn )
+{
+	for( int i = 0; i < param.Sources.Size(); i++ ) {
+		CPtr<CSourceLayer> sourceLayer = CheckCast<CSourceLayer>( referenceCnn.GetLayer( param.Sources[i] ) );
+		sourceLayer->SetBlob( LoadBlob( param.Name + "." + param.Sources[i] + ".input", referenceCnn.GetMathEngine() ) );
+	}
+
+	return runDnn( param, referenceCnn );
+}
+
+ResultType CDnnInferencePerformanceTest::RunInterLayerParallel(
+	const CDnnInferencePerformanceTestParam& param, IMathEngine& mathEngine )
+{
+	CDnn cnn( GetRandom(), mathEngine );
+
+	LoadCnn( param, cnn );
+	cnn.SetInterLayerThreadCount( param.ThreadCount );
+
+	return runDnn( param, cnn );
+}
+
+ResultType CDnnInferencePerformanceTest::RunMemoryPlanning(
+	const CDnnInferencePerformanceTestParam& param, IMathEngine& mathEngine )
+{
+	CDnn cnn( GetRandom(), mathEngine );
+
+	LoadCnn( param, cnn );
+	cnn.EnableMemoryPlanning( true );
+
+	ResultType counters = runDnn( param, cnn );
+	EXPECT_LT( 0u, cnn.GetPlannedMemorySize() );
+	GTEST_LOG_( INFO ) << param.Name << " planned memory: " << cnn.GetPlannedMemorySize()
+		<< ", peak memory: " << mathEngine.GetPeakMemoryUsage();
+	return counters;
+}
+
+ResultType CDnnInferencePerformanceTest::runDnn( const CDnnInferencePerformanceTestParam& param, CDnn& cnn )
+{
+	IMathEngine& mathEngine = cnn.GetMathEngine();
+
 	cnn.RunOnce();
 
 	CObjectArray<CSinkLayer> sinkLayers;
@@ -255,6 +304,86 @@ TEST_P( CDnnInferencePerformanceTest, LocalMathEngine )
 	}
 }
 
+TEST_P( CDnnInferencePerformanceTest, ReferenceDnn )
+{
+	const auto& param = GetParam();
+
+	auto& mathEngine = MathEngine();
+
+	CDnn originalCnn( GetRandom(), mathEngine );
+	LoadCnn( param, originalCnn );
+
+	// The copies share the trainable parameters of the original network
+	std::vector<std::unique_ptr<CRandom>> randoms;
+	std::vector<std::unique_ptr<CDnn>> cnns;
+	for( int i = 0; i < param.ThreadCount; ++i ) {
+		randoms.emplace_back( new CRandom( i ) );
+		cnns.emplace_back( new CDnn( *randoms.back(), mathEngine ) );
+		originalCnn.CreateReferenceDnn( *cnns.back() );
+	}
+
+	std::vector<std::future<ResultType>> results;
+	results.reserve( param.ThreadCount );
+	for( int i = 0; i < param.ThreadCount; ++i ) {
+		results.push_back( std::async( std::launch::async, RunReference, std::ref( param ), std::ref( *cnns[i] ) ) );
+	}
+
+	try {
+		for( auto& result : results ) {
+			bool useavg = ( param.TimeType == TTimeType::TT_Average );
+			auto counters = result.get();
+			for( const auto& counter : *counters ) {
+				GTEST_LOG_( INFO ) << param.Name << " " << counter.Name << ": " <<
+					( useavg ? counter.Value / param.RunCount : counter.Value );
+			}
+		}
+	} catch( std::exception& e ) {
+		GTEST_LOG_( ERROR ) << e.what();
+		throw;
+	}
+}
+
+TEST_P( CDnnInferencePerformanceTest, InterLayerParallelism )
+{
+	const auto& param = GetParam();
+
+	auto& mathEngine = MathEngine();
+	if( mathEngine.GetType() != MET_Cpu ) {
+		return;
+	}
+
+	try {
+		bool useavg = ( param.TimeType == TTimeType::TT_Average );
+		auto counters = RunInterLayerParallel( param, mathEngine );
+		for( const auto& counter : *counters ) {
+			GTEST_LOG_( INFO ) << param.Name << " " << counter.Name << ": " <<
+				( useavg ? counter.Value / param.RunCount : counter.Value );
+		}
+	} catch( std::exception& e ) {
+		GTEST_LOG_( ERROR ) << e.what();
+		throw;
+	}
+}
+
+TEST_P( CDnnInferencePerformanceTest, MemoryPlanning )
+{
+	const auto& param = GetParam();
+
+	auto& mathEngine = MathEngine();
+
+	try {
+		bool useavg = ( param.TimeType == TTimeType::TT_Average );
+		auto counters = RunMemoryPlanning( param, mathEngine );
+		for( const auto& counter : *counters ) {
+			GTEST_LOG_( INFO ) << param.Name << " " << counter.Name << ": " <<
+				( useavg ? counter.Value / param.RunCount : counter.Value );
+		}
+	} catch( std::exception& e ) {
+		GTEST_LOG_( ERROR ) << e.what();
+		throw;
+	}
+}
+
 INSTANTIATE_TEST_CASE_P( CDnnInferencePerformanceTestInstantiation, CDnnInferencePerformanceTest,
 	::testing::Values(
 		CDnnInferencePerformanceTestParam(
@@ -267,3 +396,133 @@ INSTANTIATE_TEST_CASE_P( CDnnInferencePerformanceTestInstantiation, CDnnInferenc
 		)
 	)
 );
+
+//------------------------------------------------------------------------------------------------------------
+
+// Adds the convolution with the given filter size and "same" padding
+static CBaseLayer* addInceptionConv( CDnn& dnn, const char* name, CBaseLayer& input, int filterCount, int filterSize )
+{
+	CPtr<CConvLayer> conv = new CConvLayer( MathEngine() );
+	conv->SetName( name );
+	conv->SetFilterCount( filterCount );
+	conv->SetFilterHeight( filterSize );
+	conv->SetFilterWidth( filterSize );
+	conv->SetPaddingHeight( filterSize / 2 );
+	conv->SetPaddingWidth( filterSize / 2 );
+	conv->Connect( input );
+	dnn.AddLayer( *conv );
+
+	CPtr<CReLULayer> relu = new CReLULayer( MathEngine() );
+	relu->SetName( CString( name ) + "_relu" );
+	relu->Connect( *conv );
+	dnn.AddLayer( *relu );
+	return relu;
+}
+
+// Builds two inception blocks: each has four branches joined by the channels concatenation,
+// and the second block also has the residual connection joined by the elementwise sum
+static void buildInceptionDnn( CDnn& dnn, int channels )
+{
+	CPtr<CSourceLayer> source = new CSourceLayer( MathEngine() );
+	source->SetName( "in" );
+	dnn.AddLayer( *source );
+
+	CBaseLayer* input = source;
+	for( int block = 0; block < 2; ++block ) {
+		const CString prefix = CString( "block" ) + Str( block ) + "_";
+		CBaseLayer* branch1 = addInceptionConv( dnn, prefix + "1x1", *input, channels / 4, 1 );
+		CBaseLayer* branch3 = addInceptionConv( dnn, prefix + "3x3_reduce", *input, channels / 8, 1 );
+		branch3 = addInceptionConv( dnn, prefix + "3x3", *branch3, channels / 4, 3 );
+		CBaseLayer* branch5 = addInceptionConv( dnn, prefix + "5x5_reduce", *input, channels / 8, 1 );
+		branch5 = addInceptionConv( dnn, prefix + "5x5", *branch5, channels / 4, 5 );
+		CBaseLayer* branchPool = addInceptionConv( dnn, prefix + "pool_3x3", *input, channels / 4, 3 );
+
+		CPtr<CConcatChannelsLayer> concat = new CConcatChannelsLayer( MathEngine() );
+		concat->SetName( prefix + "concat" );
+		concat->Connect( 0, *branch1 );
+		concat->Connect( 1, *branch3 );
+		concat->Connect( 2, *branch5 );
+		concat->Connect( 3, *branchPool );
+		dnn.AddLayer( *concat );
+		input = concat;
+
+		if( block > 0 ) {
+			CPtr<CEltwiseSumLayer> residual = new CEltwiseSumLayer( MathEngine() );
+			residual->SetName( prefix + "residual" );
+			residual->Connect( 0, *concat );
+			residual->Connect( 1, *dnn.GetLayer( "block0_concat" ) );
+			dnn.AddLayer( *residual );
+			input = residual;
+		}
+	}
+
+	CPtr<CSinkLayer> sink = new CSinkLayer( MathEngine() );
+	sink->SetName( "out" );
+	sink->Connect( *input );
+	dnn.AddLayer( *sink );
+}
+
+static void runInceptionDnn( CDnn& dnn, CDnnBlob* data, CArray<float>& result )
+{
+	CheckCast<CSourceLayer>( dnn.GetLayer( "in" ) )->SetBlob( data );
+	dnn.RunOnce();
+	CPtr<CDnnBlob> output = CheckCast<CSinkLayer>( dnn.GetLayer( "out" ) )->GetBlob();
+	result.SetSize( output->GetDataSize() );
+	output->CopyTo( result.GetPtr() );
+}
+
+// The network with the parallel branches calculates the same results in any inter-layer thread count
+TEST( CDnnInterLayerParallelismTest, InceptionBlocks )
+{
+	if( MathEngine().GetType() != MET_Cpu ) {
+		return;
+	}
+
+	const int channels = 32;
+	CRandom random( 0x5A5A );
+	CObjectArray<CDnnBlob> data;
+	for( int batchSize = 1; batchSize <= 3; batchSize += 2 ) {
+		CPtr<CDnnBlob> blob = CDnnBlob::Create2DImageBlob( MathEngine(), CT_Float, 1, batchSize, 14, 12, channels );
+		CArray<float> buffer;
+		buffer.SetSize( blob->GetDataSize() );
+		for( int i = 0; i < buffer.Size(); ++i ) {
+			buffer[i] = static_cast<float>( random.Uniform( -1, 1 ) );
+		}
+		blob->CopyFrom( buffer.GetPtr() );
+		data.Add( blob );
+	}
+
+	CDnn dnn( random, MathEngine() );
+	buildInceptionDnn( dnn, channels );
+
+	CArray<CArray<float>> expected;
+	expected.SetSize( data.Size() );
+	for( int i = 0; i < data.Size(); ++i ) {
+		runInceptionDnn( dnn, data[i], expected[i] );
+	}
+
+	for( int threadCount = 2; threadCount <= 4; threadCount += 2 ) {
+		dnn.SetInterLayerThreadCount( threadCount );
+		ASSERT_EQ( threadCount, dnn.GetInterLayerThreadCount() );
+		// Several runs for each batch size, so that the different orders of the layers are checked
+		for( int run = 0; run < 5; ++run ) {
+			for( int i = 0; i < data.Size(); ++i ) {
+				CArray<float> result;
+				runInceptionDnn( dnn, data[i], result );
+				ASSERT_EQ( expected[i].Size(), result.Size() );
+				for( int j = 0; j < result.Size(); ++j ) {
+					ASSERT_EQ( expected[i][j], result[j] ) << "threads: " << threadCount << ", batch: " << i << ", index: " << j;
+				}
+			}
+		}
+	}
+
+	// The sequential processing is restored
+	dnn.SetInterLayerThreadCount( 1 );
+	CArray<float> result;
+	runInceptionDnn( dnn, data[0], result );
+	ASSERT_EQ( expected[0].Size(), result.Size() );
+	for( int j = 0; j < result.Size(); ++j ) {
+		ASSERT_EQ( expected[0][j], result[j] );
+	}
+}
@@ -15,6 +15,8 @@ limitations under the License.
 
 #pragma once
 
+#include <cstdint>
+
 namespace NeoML {
 
 // MathEngine blob data types
@@ -22,6 +24,8 @@ enum TBlobType {
 	CT_Invalid = 0,
 	CT_Float,
 	CT_Int,
+	CT_Int8,
+	CT_BFloat16,
 };
 
 // Data types used in MathEngine
@@ -72,4 +76,43 @@ struct CBlobType<const int> {
 	static TBlobType GetType() { return CT_Int; }
 };
 
+// The 8-bit integer data type description (used for the quantized data)
+template<>
+struct CBlobType<int8_t> {
+	// typedef for the base data type used in Math Engine
+	typedef int8_t TDataType;
+
+	// Gets the blob data type
+	static TBlobType GetType() { return CT_Int8; }
+};
+
+template<>
+struct CBlobType<const int8_t> {
+	// typedef for the base data type used in Math Engine
+	typedef int8_t TDataType;
+
+	// Gets the blob data type
+	static TBlobType GetType() { return CT_Int8; }
+};
+
+// The bfloat16 data type description (used for the compressed weights)
+// A bfloat16 value is stored in uint16_t and contains the upper 16 bits of the float value
+template<>
+struct CBlobType<uint16_t> {
+	// typedef for the base data type used in Math Engine
+	typedef uint16_t TDataType;
+
+	// Gets the blob data type
+	static TBlobType GetType() { return CT_BFloat16; }
+};
+
+template<>
+struct CBlobType<const uint16_t> {
+	// typedef for the base data type used in Math Engine
+	typedef uint16_t TDataType;
+
+	// Gets the blob data type
+	static TBlobType GetType() { return CT_BFloat16; }
+};
+
 } // namespace NeoML
@@ -17,6 +17,7 @@ limitations under the License.
 
 #include <NeoMathEngine/NeoMathEngineDefs.h>
 #include <cstddef>
+#include <cstdint>
 #include <type_traits>
 
 namespace NeoML {
@@ -84,7 +85,7 @@ public:
 	template<typename U = T, typename std::enable_if<std::is_same<U, T>::value && !std::is_const<U>::value, int>::type = 0>
 	operator CTypedMemoryHandle<const U>() const
 	{
-		return CTypedMemoryHandle<const U>( *this );
+		return CTypedMemoryHandle<const U>( static_cast<const CMemoryHandle&>( *this ) );
 	}
 
 	CTypedMemoryHandle& operator+=( ptrdiff_t shift )
@@ -217,6 +218,12 @@ typedef CTypedMemoryHandle<const float> CConstFloatHandle;
 typedef CTypedMemoryHandle<int> CIntHandle;
 typedef CTypedMemoryHandle<const int> CConstIntHandle;
 
+typedef CTypedMemoryHandle<int8_t> CInt8Handle;
+typedef CTypedMemoryHandle<const int8_t> CConstInt8Handle;
+
+typedef CTypedMemoryHandle<uint16_t> CBFloat16Handle;
+typedef CTypedMemoryHandle<const uint16_t> CConstBFloat16Handle;
+
 typedef CMemoryHandleVar<float> CFloatHandleVar;
 typedef CMemoryHandleVar<int> CIntHandleVar;
 
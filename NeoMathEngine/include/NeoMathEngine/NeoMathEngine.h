@@ -74,6 +74,12 @@ public:
 	// Converting data type
 	virtual void VectorConvert(const CConstFloatHandle& from, const CIntHandle& to, int vectorSize) = 0;
 	virtual void VectorConvert(const CConstIntHandle& from, const CFloatHandle& to, int vectorSize) = 0;
+	// Conversion between float and bfloat16 (the float values are rounded to the nearest even)
+	virtual void VectorConvert(const CConstFloatHandle& from, const CBFloat16Handle& to, int vectorSize) = 0;
+	virtual void VectorConvert(const CConstBFloat16Handle& from, const CFloatHandle& to, int vectorSize) = 0;
+
+	// Quantizes the vector into 8-bit integers: to[i] = round(from[i] / scale), clipped to [-127, 127]
+	virtual void VectorQuantize(const CConstFloatHandle& from, const CInt8Handle& to, int vectorSize, float scale) = 0;
 
 	// Filling a vector using the Bernoulli distribution with p being the probability of 1
 	// The elements for which the distribution gives 1 are set to the specified value
@@ -499,6 +505,19 @@ public:
 		const CConstFloatHandle& secondHandle, int secondWidth, int secondRowSize,
 		const CFloatHandle& resultHandle, int resultRowSize, int resultBufferSize) = 0;
 
+	// Multiplies the quantized matrices: result = firstScale * first * T(second) * diag(secondScales)
+	// The products are accumulated in 32-bit integers; secondScales contains a separate scale for each row of the second matrix
+	// The result will be of firstHeight * secondHeight size
+	virtual void MultiplyQuantizedMatrixByTransposedMatrix(const CConstInt8Handle& firstHandle, int firstHeight, int firstWidth,
+		float firstScale, const CConstInt8Handle& secondHandle, int secondHeight, const CConstFloatHandle& secondScalesHandle,
+		const CFloatHandle& resultHandle, int resultBufferSize) = 0;
+
+	// Multiplies the float matrix by the transposed bfloat16 matrix: result = first * T(second)
+	// The second matrix is converted to float on the fly, the products are accumulated in float
+	// The result will be of firstHeight * secondHeight size
+	virtual void MultiplyMatrixByTransposedBFloat16Matrix(const CConstFloatHandle& firstHandle, int firstHeight, int firstWidth,
+		const CConstBFloat16Handle& secondHandle, int secondHeight, const CFloatHandle& resultHandle, int resultBufferSize) = 0;
+
 	// result[i] = first[i](T) * second[i] for i in [0, batchSize)
 	virtual void MultiplyTransposedMatrixByMatrix(int batchSize, const CConstFloatHandle& firstHandle, int firstHeight, int firstWidth,
 		const CConstFloatHandle& secondHandle, int secondWidth, const CFloatHandle& resultHandle, int resultBufferSize) = 0;
@@ -655,6 +674,16 @@ public:
 	virtual void BlobConvolutionLearnAdd( const CConvolutionDesc& desc, const CFloatHandle& input,
 		const CFloatHandle& outputDiff, const CFloatHandle& filterDiff,
 		const CFloatHandle* freeTermDiff, bool isFreeTermDiffFromInput ) = 0;
+	// Quantized convolution
+	// The source is quantized with sourceScale, the filter is quantized with a separate scale for each filter
+	// (see VectorQuantize); the products are accumulated in 32-bit integers and the result is in float
+	virtual void BlobQuantizedConvolution( const CConvolutionDesc& desc, const CConstFloatHandle& source, float sourceScale,
+		const CConstInt8Handle& filter, const CConstFloatHandle& filterScales, const CConstFloatHandle* freeTerm,
+		const CFloatHandle& result ) = 0;
+	// Convolution with the bfloat16 filter
+	// The filter is converted to float on the fly, the products are accumulated in float
+	virtual void BlobBFloat16Convolution( const CConvolutionDesc& desc, const CConstFloatHandle& source,
+		const CConstBFloat16Handle& filter, const CConstFloatHandle* freeTerm, const CFloatHandle& result ) = 0;
 
 	// Calculates channelwise convolution
 	// You can pass 0 for the freeTerm parameter, and the free terms will be 0
@@ -885,6 +914,83 @@ public:
 		TActivationFunction activation, const CConstFloatHandle& mask, const CConstFloatHandle& u, const CConstFloatHandle& h,
 		const CConstFloatHandle& hDiff, const CFloatHandle& uDiff ) = 0;
 
+	// LSTM over the whole sequence (see CLstmLayer)
+	// The input projection is calculated for all the steps at once, the gate activations are applied
+	// right after the recurrent matrix multiplication
+	//    z_t = inputWeights * x_t + recurWeights * h_(t-1) + inputFreeTerm + recurFreeTerm
+	//    c_t = sigmoid(z_forget) * c_(t-1) + sigmoid(z_input) * tanh(z_main)
+	//    h_t = sigmoid(z_output) * tanh(c_t)
+	// The gates in z go in the order: main, forget, input, output
+	//    input - sequenceLength x batchSize x inputSize
+	//    inputWeights - 4*hiddenSize x inputSize, recurWeights - 4*hiddenSize x hiddenSize
+	//    inputFreeTerm, recurFreeTerm - 4*hiddenSize (optional, may be null)
+	//    initialHidden, initialCell - batchSize x hiddenSize (optional, null means zero state)
+	//    gates - sequenceLength x batchSize x 4*hiddenSize, the activated gates (optional, required for backward)
+	//    hidden, cell - sequenceLength x batchSize x hiddenSize
+	virtual void LstmSequence( bool reverse, int sequenceLength, int batchSize, int inputSize, int hiddenSize,
+		const CConstFloatHandle& input, const CConstFloatHandle& inputWeights, const CConstFloatHandle& recurWeights,
+		const CConstFloatHandle& inputFreeTerm, const CConstFloatHandle& recurFreeTerm,
+		const CConstFloatHandle& initialHidden, const CConstFloatHandle& initialCell,
+		const CFloatHandle& gates, const CFloatHandle& hidden, const CFloatHandle& cell ) = 0;
+	// LSTM backward and learn
+	// hiddenDiff is required, cellDiff is optional (the diff of the cell output)
+	// The diff of the initial state is not calculated
+	// inputDiff is optional and is overwritten; the weights diffs are optional and are added to
+	// freeTermDiff (4*hiddenSize) is the diff of either of the free terms
+	virtual void LstmSequenceBackward( bool reverse, int sequenceLength, int batchSize, int inputSize, int hiddenSize,
+		const CConstFloatHandle& input, const CConstFloatHandle& inputWeights, const CConstFloatHandle& recurWeights,
+		const CConstFloatHandle& initialHidden, const CConstFloatHandle& initialCell,
+		const CConstFloatHandle& gates, const CConstFloatHandle& hidden, const CConstFloatHandle& cell,
+		const CConstFloatHandle& hiddenDiff, const CConstFloatHandle& cellDiff, const CFloatHandle& inputDiff,
+		const CFloatHandle& inputWeightsDiff, const CFloatHandle& recurWeightsDiff, const CFloatHandle& freeTermDiff ) = 0;
+
+	// GRU over the whole sequence (see CGruLayer)
+	// The weights are applied to the concatenation of the input and the hidden state
+	//    [u_t, r_t] = sigmoid( gateWeights * [x_t, h_(t-1)] + gateFreeTerm )
+	//    m_t = tanh( mainWeights * [x_t, r_t * h_(t-1)] + mainFreeTerm )
+	//    h_t = (1 - u_t) * m_t + u_t * h_(t-1)
+	//    input - sequenceLength x batchSize x inputSize
+	//    gateWeights - 2*hiddenSize x (inputSize + hiddenSize), mainWeights - hiddenSize x (inputSize + hiddenSize)
+	//    gateFreeTerm - 2*hiddenSize, mainFreeTerm - hiddenSize (optional, may be null)
+	//    initialHidden - batchSize x hiddenSize (optional, null means zero state)
+	//    gates - sequenceLength x batchSize x 3*hiddenSize, the activated u, r, m (optional, required for backward)
+	//    hidden - sequenceLength x batchSize x hiddenSize
+	virtual void GruSequence( bool reverse, int sequenceLength, int batchSize, int inputSize, int hiddenSize,
+		const CConstFloatHandle& input, const CConstFloatHandle& gateWeights, const CConstFloatHandle& gateFreeTerm,
+		const CConstFloatHandle& mainWeights, const CConstFloatHandle& mainFreeTerm,
+		const CConstFloatHandle& initialHidden, const CFloatHandle& gates, const CFloatHandle& hidden ) = 0;
+	// GRU backward and learn
+	// The diff of the initial state is not calculated
+	// inputDiff is optional and is overwritten; the weights diffs are optional and are added to
+	virtual void GruSequenceBackward( bool reverse, int sequenceLength, int batchSize, int inputSize, int hiddenSize,
+		const CConstFloatHandle& input, const CConstFloatHandle& gateWeights, const CConstFloatHandle& mainWeights,
+		const CConstFloatHandle& initialHidden, const CConstFloatHandle& gates, const CConstFloatHandle& hidden,
+		const CConstFloatHandle& hiddenDiff, const CFloatHandle& inputDiff,
+		const CFloatHandle& gateWeightsDiff, const CFloatHandle& gateFreeTermDiff,
+		const CFloatHandle& mainWeightsDiff, const CFloatHandle& mainFreeTermDiff ) = 0;
+
+	// Scaled dot-product attention with several heads (see CScaledDotProductAttentionLayer)
+	//    result = softmax( scale * query * key^T + maskMultiplier * mask ) * value
+	// The keys are processed by tiles with the online softmax normalization,
+	// so the queryLength x keyLength matrix of the attention weights is never stored
+	//    query, result - batchSize x queryLength x headCount x headSize
+	//    key, value - batchSize x keyLength x headCount x headSize
+	//    mask - queryLength x keyLength, the same for all objects and heads (optional, may be null)
+	//    logSumExp - batchSize x headCount x queryLength, the logarithms of the softmax denominators
+	//        (optional, required for backward)
+	virtual void ScaledDotProductAttention( int batchSize, int headCount, int queryLength, int keyLength, int headSize,
+		float scale, const CConstFloatHandle& query, const CConstFloatHandle& key, const CConstFloatHandle& value,
+		const CConstFloatHandle& mask, float maskMultiplier, const CFloatHandle& logSumExp,
+		const CFloatHandle& result ) = 0;
+	// Scaled dot-product attention backward
+	// The attention weights are recalculated by tiles using logSumExp
+	// The diffs are overwritten; the diff of the mask is not calculated
+	virtual void ScaledDotProductAttentionBackward( int batchSize, int headCount, int queryLength, int keyLength,
+		int headSize, float scale, const CConstFloatHandle& query, const CConstFloatHandle& key,
+		const CConstFloatHandle& value, const CConstFloatHandle& mask, float maskMultiplier,
+		const CConstFloatHandle& logSumExp, const CConstFloatHandle& result, const CConstFloatHandle& resultDiff,
+		const CFloatHandle& queryDiff, const CFloatHandle& keyDiff, const CFloatHandle& valueDiff ) = 0;
+
 	// Local responce normalization (Lrn)
 	// For more details see CLrnLayer comments
 	virtual CLrnDesc* InitLrn( const CBlobDesc& source, int windowSize, float bias, float alpha, float beta ) = 0;
@@ -1025,6 +1131,11 @@ public:
 	// Creates a handle with data from another math engine
 	virtual CMemoryHandle CopyFrom( const CMemoryHandle& handle, size_t size ) = 0;
 
+	// Creates a handle to the host memory allocated outside of the math engine (for example, a memory-mapped file)
+	// The memory should stay valid while the handle is used and may not be freed by HeapFree
+	// Returns a null handle if the math engine can't work with the host memory directly (all but CPU)
+	virtual CMemoryHandle CreateExternalMemoryHandle( void* /*ptr*/ ) { return CMemoryHandle(); }
+
 	// Creates a object for aggregating statistics.
 	// This object should be destroyed using the standard delete operator after use.
 	virtual IPerformanceCounters* CreatePerformanceCounters() const = 0;
@@ -1093,7 +1204,26 @@ public:
 NEOMATHENGINE_API IGpuMathEngineManager* CreateGpuMathEngineManager();
 
 // Creates `count` cpu MathEngines connected via distributed communicator object
-NEOMATHENGINE_API void CreateDistributedCpuMathEngines( IMathEngine** mathEngines, int count );
+// threadCount is the number of threads that may be used by each MathEngine
+NEOMATHENGINE_API void CreateDistributedCpuMathEngines( IMathEngine** mathEngines, int count, int threadCount = 1 );
+// The way the processes of the multi-process distributed training exchange data
+enum TDistributedTransport {
+	// Shared memory if it is available, loopback TCP otherwise
+	DT_Auto = 0,
+	// POSIX shared memory segment
+	DT_SharedMemory,
+	// Loopback TCP connections to the 0th process
+	DT_Tcp
+};
+
+// Creates a cpu MathEngine for one of `count` processes on the same host connected via distributed communicator object
+// `process` is the number of the calling process; all processes should use the same name, port and transport
+// The name identifies the shared memory segment and should be unique for each training session
+// The 0th process listens on `tcpPort` if TCP is used
+// Supported on Linux and macOS only
+// This MathEngine should be destroyed using the standard delete operator after use
+NEOMATHENGINE_API IMathEngine* CreateMultiProcessCpuMathEngine( const char* name, int tcpPort, int process, int count,
+	TDistributedTransport transport = DT_Auto, int threadCount = 1 );
 // Creates `count` gpu MathEngines connected via distributed communicator object
 // i-th MathEngine placed on gpu with number devs[i]
 NEOMATHENGINE_API void CreateDistributedCudaMathEngines( IMathEngine** mathEngines, int devsCount, const int* cudaDevs );
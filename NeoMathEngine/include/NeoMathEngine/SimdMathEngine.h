@@ -37,8 +37,10 @@ public:
 		int strideHeight, int strideWidth, int dilationHeight, int dilationWidth, const CBlobDesc& filter,
         const CBlobDesc& result ) const = 0;
 
+	// The filter and the free term prepared for the calculation are kept in the descriptor
+	// isParamChanged should be set if their values changed since the previous call with the same descriptor
 	virtual void BlobConvolution( const CConvolutionDesc& convDesc, const float* source,
-		const float* filter, const float* freeTerm, float* result ) const = 0;
+		const float* filter, const float* freeTerm, float* result, bool isParamChanged ) const = 0;
 
 	virtual SgemmFunc GetSgemmFunction() const = 0;
 };
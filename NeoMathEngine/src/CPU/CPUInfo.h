@@ -170,6 +170,16 @@ struct CCPUInfo {
 		return AnyAvx512IsAvailable;
 	}
 
+	// Checks the AVX-512 subsets used by the AVX-512 simd library: F, DQ, BW and VL
+	static bool IsAvx512FDqBwVlAvailable()
+	{
+		Regs regs;
+		callCpuIdEx( regs, 7, 0 );
+
+		const unsigned int Avx512Bits = ( 1u << 16 ) + ( 1u << 17 ) + ( 1u << 30 ) + ( 1u << 31 );
+		return ( regs.ebx & Avx512Bits ) == Avx512Bits;
+	}
+
 private:
 
 #if FINE_PLATFORM(FINE_WINDOWS)
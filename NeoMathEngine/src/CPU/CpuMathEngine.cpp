@@ -191,6 +191,12 @@ CMemoryHandle CCpuMathEngine::CopyFrom( const CMemoryHandle& handle, size_t size
 	return result;
 }
 
+CMemoryHandle CCpuMathEngine::CreateExternalMemoryHandle( void* ptr )
+{
+	ASSERT_EXPR( ptr != nullptr );
+	return CMemoryHandleInternal::CreateMemoryHandle( this, ptr );
+}
+
 CMemoryHandle CCpuMathEngine::Alloc( size_t size )
 {
 	// Ensure the correct alignment
@@ -250,7 +256,7 @@ IPerformanceCounters* CCpuMathEngine::CreatePerformanceCounters() const
 #endif
 }
 
-void CCpuMathEngine::SetDistributedCommunicator( std::shared_ptr<CMultiThreadDistributedCommunicator> comm, const CMathEngineDistributedInfo& info )
+void CCpuMathEngine::SetDistributedCommunicator( std::shared_ptr<ICpuDistributedCommunicator> comm, const CMathEngineDistributedInfo& info )
 {
 	communicator = comm;
 	distributedInfo = info;
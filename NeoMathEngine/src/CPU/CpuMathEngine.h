@@ -55,6 +55,7 @@ public:
 	void DataExchangeRaw( const CMemoryHandle& handle, const void* data, size_t size ) override;
 	void DataExchangeRaw( void* data, const CMemoryHandle& handle, size_t size ) override;
 	CMemoryHandle CopyFrom( const CMemoryHandle& handle, size_t size ) override;
+	CMemoryHandle CreateExternalMemoryHandle( void* ptr ) override;
 	void GetMathEngineInfo( CMathEngineInfo& info ) const override;
 
 	// IVectorMathEngine interface methods
@@ -64,6 +65,9 @@ public:
 	void VectorFill(const CIntHandle& result, int vectorSize, const CConstIntHandle& value) override;
 	void VectorConvert(const CConstFloatHandle& from, const CIntHandle& to, int vectorSize) override;
 	void VectorConvert(const CConstIntHandle& from, const CFloatHandle& to, int vectorSize) override;
+	void VectorConvert(const CConstFloatHandle& from, const CBFloat16Handle& to, int vectorSize) override;
+	void VectorConvert(const CConstBFloat16Handle& from, const CFloatHandle& to, int vectorSize) override;
+	void VectorQuantize(const CConstFloatHandle& from, const CInt8Handle& to, int vectorSize, float scale) override;
 	void VectorFillBernoulli( const CFloatHandle& result, float p, int vectorSize, float value, int seed ) override;
 	void FilterSmallValues( const CFloatHandle& data, int dataSize, float threshold ) override;
 	void VectorCopy(const CFloatHandle& first, const CConstFloatHandle& second, int vectorSize) override;
@@ -324,6 +328,11 @@ public:
 	void MultiplyTransposedMatrixByMatrixAndAdd(const CConstFloatHandle& firstHandle, int firstHeight, int firstWidth,
 		int firstRowSize, const CConstFloatHandle& secondHandle, int secondWidth, int secondRowSize,
 		const CFloatHandle& resultHandle, int resultRowSize, int resultBufferSize) override;
+	void MultiplyQuantizedMatrixByTransposedMatrix(const CConstInt8Handle& firstHandle, int firstHeight, int firstWidth,
+		float firstScale, const CConstInt8Handle& secondHandle, int secondHeight, const CConstFloatHandle& secondScalesHandle,
+		const CFloatHandle& resultHandle, int resultBufferSize) override;
+	void MultiplyMatrixByTransposedBFloat16Matrix(const CConstFloatHandle& firstHandle, int firstHeight, int firstWidth,
+		const CConstBFloat16Handle& secondHandle, int secondHeight, const CFloatHandle& resultHandle, int resultBufferSize) override;
 	void MultiplyTransposedMatrixByMatrix(int batchSize, const CConstFloatHandle& firstHandle, int firstHeight, int firstWidth,
 		const CConstFloatHandle& secondHandle, int secondWidth, const CFloatHandle& resultHandle, int resultBufferSize) override;
 	void MultiplyDiagMatrixByMatrix(const CConstFloatHandle& firstHandle, int firstSize,
@@ -395,6 +404,11 @@ public:
 	void BlobConvolutionLearnAdd( const CConvolutionDesc& desc,
 	 const CFloatHandle& input, const CFloatHandle& outputDiff, const CFloatHandle& filterDiff,
 		const CFloatHandle* freeTermDiff, bool isFreeTermDiffFromInput ) override;
+	void BlobQuantizedConvolution( const CConvolutionDesc& desc, const CConstFloatHandle& source, float sourceScale,
+		const CConstInt8Handle& filter, const CConstFloatHandle& filterScales, const CConstFloatHandle* freeTerm,
+		const CFloatHandle& result ) override;
+	void BlobBFloat16Convolution( const CConvolutionDesc& desc, const CConstFloatHandle& source,
+		const CConstBFloat16Handle& filter, const CConstFloatHandle* freeTerm, const CFloatHandle& result ) override;
 	CChannelwiseConvolutionDesc* InitBlobChannelwiseConvolution( const CBlobDesc& input,
 		int paddingHeight, int paddingWidth, int strideHeight, int strideWidth,
 		const CBlobDesc& filter, const CBlobDesc* freeTerm, const CBlobDesc& output ) override;
@@ -504,6 +518,36 @@ public:
 	void IndRnnRecurrentLearn( bool reverse, int sequenceLength, int batchSize, int objectSize, TActivationFunction activation,
 		const CConstFloatHandle& mask, const CConstFloatHandle& u, const CConstFloatHandle& h, const CConstFloatHandle& hDiff,
 		const CFloatHandle& uDiff ) override;
+	void LstmSequence( bool reverse, int sequenceLength, int batchSize, int inputSize, int hiddenSize,
+		const CConstFloatHandle& input, const CConstFloatHandle& inputWeights, const CConstFloatHandle& recurWeights,
+		const CConstFloatHandle& inputFreeTerm, const CConstFloatHandle& recurFreeTerm,
+		const CConstFloatHandle& initialHidden, const CConstFloatHandle& initialCell,
+		const CFloatHandle& gates, const CFloatHandle& hidden, const CFloatHandle& cell ) override;
+	void LstmSequenceBackward( bool reverse, int sequenceLength, int batchSize, int inputSize, int hiddenSize,
+		const CConstFloatHandle& input, const CConstFloatHandle& inputWeights, const CConstFloatHandle& recurWeights,
+		const CConstFloatHandle& initialHidden, const CConstFloatHandle& initialCell,
+		const CConstFloatHandle& gates, const CConstFloatHandle& hidden, const CConstFloatHandle& cell,
+		const CConstFloatHandle& hiddenDiff, const CConstFloatHandle& cellDiff, const CFloatHandle& inputDiff,
+		const CFloatHandle& inputWeightsDiff, const CFloatHandle& recurWeightsDiff, const CFloatHandle& freeTermDiff ) override;
+	void GruSequence( bool reverse, int sequenceLength, int batchSize, int inputSize, int hiddenSize,
+		const CConstFloatHandle& input, const CConstFloatHandle& gateWeights, const CConstFloatHandle& gateFreeTerm,
+		const CConstFloatHandle& mainWeights, const CConstFloatHandle& mainFreeTerm,
+		const CConstFloatHandle& initialHidden, const CFloatHandle& gates, const CFloatHandle& hidden ) override;
+	void GruSequenceBackward( bool reverse, int sequenceLength, int batchSize, int inputSize, int hiddenSize,
+		const CConstFloatHandle& input, const CConstFloatHandle& gateWeights, const CConstFloatHandle& mainWeights,
+		const CConstFloatHandle& initialHidden, const CConstFloatHandle& gates, const CConstFloatHandle& hidden,
+		const CConstFloatHandle& hiddenDiff, const CFloatHandle& inputDiff,
+		const CFloatHandle& gateWeightsDiff, const CFloatHandle& gateFreeTermDiff,
+		const CFloatHandle& mainWeightsDiff, const CFloatHandle& mainFreeTermDiff ) override;
+	void ScaledDotProductAttention( int batchSize, int headCount, int queryLength, int keyLength, int headSize,
+		float scale, const CConstFloatHandle& query, const CConstFloatHandle& key, const CConstFloatHandle& value,
+		const CConstFloatHandle& mask, float maskMultiplier, const CFloatHandle& logSumExp,
+		const CFloatHandle& result ) override;
+	void ScaledDotProductAttentionBackward( int batchSize, int headCount, int queryLength, int keyLength,
+		int headSize, float scale, const CConstFloatHandle& query, const CConstFloatHandle& key,
+		const CConstFloatHandle& value, const CConstFloatHandle& mask, float maskMultiplier,
+		const CConstFloatHandle& logSumExp, const CConstFloatHandle& result, const CConstFloatHandle& resultDiff,
+		const CFloatHandle& queryDiff, const CFloatHandle& keyDiff, const CFloatHandle& valueDiff ) override;
 	CLrnDesc* InitLrn( const CBlobDesc& source, int windowSize, float bias, float alpha, float beta ) override;
 	void Lrn( const CLrnDesc& desc, const CConstFloatHandle& input, const CFloatHandle& invSum,
 		const CFloatHandle& invSumBeta, const CFloatHandle& outputHandle ) override;
@@ -521,7 +565,7 @@ public:
 		const CFloatHandle& dataDiffHandle, const CFloatHandle& kernelDiffHandle ) override;
 
 	IPerformanceCounters* CreatePerformanceCounters() const override;
-	void SetDistributedCommunicator( std::shared_ptr<CMultiThreadDistributedCommunicator> comm, const CMathEngineDistributedInfo& info );
+	void SetDistributedCommunicator( std::shared_ptr<ICpuDistributedCommunicator> comm, const CMathEngineDistributedInfo& info );
 	void AllReduce( const CFloatHandle& handle, int size ) override;
 	void Broadcast( const CFloatHandle& handle, int size, int root ) override;
 	CMathEngineDistributedInfo GetDistributedInfo() override { return distributedInfo; }
@@ -538,7 +582,7 @@ private:
 	const std::unique_ptr<CMemoryPool> memoryPool; // the memory manager
 	const std::unique_ptr<CDeviceStackAllocator> stackAllocator; // the stack memory allocator
 	mutable std::mutex mutex; // to protect the allocations
-	std::shared_ptr<CMultiThreadDistributedCommunicator> communicator;
+	std::shared_ptr<ICpuDistributedCommunicator> communicator;
 	CMathEngineDistributedInfo distributedInfo;
 
 	CDllLoader dllLoader; // loading library for simd instructions
@@ -592,6 +636,10 @@ private:
 		int firstWidth, const CConstFloatHandle& secondHandle, int secondHeight, const CFloatHandle& resultHandle );
 	void multiplyMatrixByTransposedMatrixAndAdd( const float* first, int firstHeight, int firstWidth, int firstRowSize,
 		const float* second, int secondHeight, int secondRowSize, float* result, int resultRowSize );
+	void quantizeVector( const float* from, int8_t* to, int vectorSize, float scale );
+	void multiplyQuantizedMatrixByTransposedMatrix( const int8_t* first, int firstHeight, int firstWidth, float firstScale,
+		const int8_t* second, int secondHeight, const float* secondScales, const float* freeTerm,
+		float* result, int resultRowSize );
 
 	template<class T>
 	void blobMergeByDimCommon( int dimNum, const CBlobDesc* from, const CTypedMemoryHandle<T>* fromData, int fromCount,
@@ -623,11 +671,14 @@ private:
 		int inputBatch, int outputRowStart, int outputRowCount, float* tempBlob );
 	void transposeResult( const CCpuConvolutionDesc& desc, const float* outputTransposedData,
 		int batch, int resultStart, int resultCount, float* result );
-	void fillTempData( const float* sourceData, float* filterData, const CCpuConvolutionDesc& desc, int start, int count );
+	template<class T>
+	void fillTempData( const T* sourceData, T* filterData, const CCpuConvolutionDesc& desc, int start, int count );
 	void blobConvolutionForwardAlgo0( const CCpuConvolutionDesc& desc, const float* sourceData,
 		const float* filterData, const CFloatHandle* freeTermData, float* resultData );
 	void blobConvolutionForwardAlgo1( const CCpuConvolutionDesc& desc, const float* sourceData,
 		const float* filterData, const CFloatHandle* freeTermData, float* resultData );
+	void blobConvolutionForwardWinograd( const CCpuConvolutionDesc& desc, const float* sourceData,
+		const float* filterData, const CFloatHandle* freeTermData, float* resultData );
 	void backwardConvolutionAddFilterToOutput( const CCpuConvolutionDesc& desc, const CFloatHandle& temp,
 		const CFloatHandle* freeTerm, const CFloatHandle& output );
 	void backwardDilationConvolutionAddFilterToOutput( const CCpuConvolutionDesc& desc, const CFloatHandle& temp,
@@ -667,6 +718,23 @@ private:
 		const CConstIntHandle& rowIndices, const CConstIntHandle& padLabels, const CConstFloatHandle& blankSkipMask,
 		const CConstFloatHandle& resultLogProb, const CConstIntHandle& resultLens, const CConstIntHandle& labelLens,
 		const CFloatHandle& logBeta );
+
+	// The multithreaded matrix multiplications over the whole sequence for the recurrent layers
+	// The rows of the first matrix (or the columns of the result for the transposed one) are split between the threads
+	void rnnMultiplyMatrixByTransposedMatrix( const float* first, int firstHeight, int firstWidth, int firstRowSize,
+		const float* second, int secondHeight, int secondRowSize, const float* freeTerm, float* result, int resultRowSize );
+	void rnnMultiplyMatrixByMatrix( bool add, const float* first, int firstHeight, int firstWidth, int firstRowSize,
+		const float* second, int secondWidth, int secondRowSize, float* result, int resultRowSize );
+	void rnnMultiplyTransposedMatrixByMatrixAndAdd( const float* first, int firstHeight, int firstWidth, int firstRowSize,
+		const float* second, int secondWidth, int secondRowSize, float* result, int resultRowSize );
+	void rnnAddRecurrentWeightsDiff( bool reverse, int sequenceLength, int batchSize, int hiddenSize,
+		const float* diff, int diffWidth, int diffRowSize, const float* hidden, const float* initialHidden,
+		float* result, int resultRowSize );
+
+	// Calculates the scaled attention scores of a tile of queries and keys of one head and applies the mask
+	// The query and key rows are stored with rowSize stride, the mask rows with maskRowSize stride
+	void attentionScores( const float* query, int queryCount, const float* key, int keyCount, int headSize, int rowSize,
+		float scale, const float* mask, int maskRowSize, float maskMultiplier, float* scores );
 };
 
 inline void CCpuMathEngine::VectorReLUDiffOp(const CConstFloatHandle& firstHandle, const CConstFloatHandle& secondHandle,
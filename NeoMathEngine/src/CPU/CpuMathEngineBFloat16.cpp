@@ -0,0 +1,407 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <common.h>
+#pragma hdrstop
+
+#include <CpuMathEngine.h>
+#include <CpuExecutionScope.h>
+#include <CpuMathEnginePrivate.h>
+#include <MemoryHandleInternal.h>
+#include <NeoMathEngine/NeoMathEngineException.h>
+#include <NeoMathEngine/OpenMP.h>
+
+namespace NeoML {
+
+// The number of the first and the second matrix rows processed together
+static const int BFloat16FirstBlockSize = 2;
+static const int BFloat16SecondBlockSize = 4;
+// The minimum number of the first matrix rows for which the second matrix is converted to float before multiplication
+static const int BFloat16MinConvertedHeight = 16;
+
+static inline float bFloat16ToFloat( uint16_t value )
+{
+	const uint32_t bits = static_cast<uint32_t>( value ) << 16;
+	float result;
+	memcpy( &result, &bits, sizeof( result ) );
+	return result;
+}
+
+static inline uint16_t floatToBFloat16( float value )
+{
+	uint32_t bits;
+	memcpy( &bits, &value, sizeof( bits ) );
+	if( ( bits & 0x7fffffff ) > 0x7f800000 ) {
+		// NaN should stay NaN after the rounding
+		return static_cast<uint16_t>( ( bits >> 16 ) | 0x40 );
+	}
+	// Round to the nearest even
+	bits += 0x7fff + ( ( bits >> 16 ) & 1 );
+	return static_cast<uint16_t>( bits >> 16 );
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+
+#ifdef NEOML_USE_SSE
+
+// The products are accumulated in four floats
+typedef __m128 CBFloat16Sum;
+// 8 float values
+struct CBFloat16Vector {
+	__m128 Low;
+	__m128 High;
+};
+
+static const int BFloat16VectorSize = 8;
+
+static inline CBFloat16Sum zeroBFloat16Sum()
+{
+	return _mm_setzero_ps();
+}
+
+static inline CBFloat16Vector loadFloatVector( const float* data )
+{
+	CBFloat16Vector result;
+	result.Low = _mm_loadu_ps( data );
+	result.High = _mm_loadu_ps( data + 4 );
+	return result;
+}
+
+static inline CBFloat16Vector loadBFloat16Vector( const uint16_t* data )
+{
+	// bfloat16 is the upper half of float, so it is enough to put the values into the upper 16 bits
+	const __m128i value = _mm_loadu_si128( reinterpret_cast<const __m128i*>( data ) );
+	CBFloat16Vector result;
+	result.Low = _mm_castsi128_ps( _mm_unpacklo_epi16( _mm_setzero_si128(), value ) );
+	result.High = _mm_castsi128_ps( _mm_unpackhi_epi16( _mm_setzero_si128(), value ) );
+	return result;
+}
+
+static inline CBFloat16Sum bFloat16MultiplyAdd( const CBFloat16Sum& sum,
+	const CBFloat16Vector& first, const CBFloat16Vector& second )
+{
+	return _mm_add_ps( sum, _mm_add_ps( _mm_mul_ps( first.Low, second.Low ), _mm_mul_ps( first.High, second.High ) ) );
+}
+
+static inline float horizontalBFloat16Sum( const CBFloat16Sum& sum )
+{
+	__m128 result = _mm_add_ps( sum, _mm_movehl_ps( sum, sum ) );
+	result = _mm_add_ss( result, _mm_shuffle_ps( result, result, _MM_SHUFFLE( 1, 1, 1, 1 ) ) );
+	return _mm_cvtss_f32( result );
+}
+
+// Rounds 4 floats to bfloat16 in the same way as floatToBFloat16
+// The result is in the lower 16 bits of each 32-bit integer, sign-extended
+static inline __m128i floatToBFloat16( const __m128& value )
+{
+	const __m128i bits = _mm_castps_si128( value );
+	const __m128i rounded = _mm_add_epi32( _mm_add_epi32( bits, _mm_set1_epi32( 0x7fff ) ),
+		_mm_and_si128( _mm_srli_epi32( bits, 16 ), _mm_set1_epi32( 1 ) ) );
+	const __m128i nan = _mm_or_si128( bits, _mm_set1_epi32( 0x400000 ) );
+	const __m128i isNan = _mm_cmpgt_epi32( _mm_and_si128( bits, _mm_set1_epi32( 0x7fffffff ) ),
+		_mm_set1_epi32( 0x7f800000 ) );
+	const __m128i result = _mm_or_si128( _mm_and_si128( isNan, nan ), _mm_andnot_si128( isNan, rounded ) );
+	// The arithmetic shift keeps the values in the int16 range, so the signed packing doesn't saturate them
+	return _mm_srai_epi32( result, 16 );
+}
+
+static void vectorConvertToBFloat16( const float* from, uint16_t* to, int vectorSize )
+{
+	const int sseSize = vectorSize / BFloat16VectorSize;
+	for( int i = 0; i < sseSize; ++i ) {
+		const __m128i result = _mm_packs_epi32( floatToBFloat16( _mm_loadu_ps( from ) ),
+			floatToBFloat16( _mm_loadu_ps( from + 4 ) ) );
+		_mm_storeu_si128( reinterpret_cast<__m128i*>( to ), result );
+		from += BFloat16VectorSize;
+		to += BFloat16VectorSize;
+	}
+
+	for( int i = sseSize * BFloat16VectorSize; i < vectorSize; ++i ) {
+		*to++ = floatToBFloat16( *from++ );
+	}
+}
+
+static void vectorConvertFromBFloat16( const uint16_t* from, float* to, int vectorSize )
+{
+	const int sseSize = vectorSize / BFloat16VectorSize;
+	for( int i = 0; i < sseSize; ++i ) {
+		const CBFloat16Vector value = loadBFloat16Vector( from );
+		_mm_storeu_ps( to, value.Low );
+		_mm_storeu_ps( to + 4, value.High );
+		from += BFloat16VectorSize;
+		to += BFloat16VectorSize;
+	}
+
+	for( int i = sseSize * BFloat16VectorSize; i < vectorSize; ++i ) {
+		*to++ = bFloat16ToFloat( *from++ );
+	}
+}
+
+#elif defined(NEOML_USE_NEON)
+
+// The products are accumulated in four floats
+typedef float32x4_t CBFloat16Sum;
+// 8 float values
+struct CBFloat16Vector {
+	float32x4_t Low;
+	float32x4_t High;
+};
+
+static const int BFloat16VectorSize = 8;
+
+static inline CBFloat16Sum zeroBFloat16Sum()
+{
+	return vdupq_n_f32( 0 );
+}
+
+static inline CBFloat16Vector loadFloatVector( const float* data )
+{
+	CBFloat16Vector result;
+	result.Low = vld1q_f32( data );
+	result.High = vld1q_f32( data + 4 );
+	return result;
+}
+
+static inline CBFloat16Vector loadBFloat16Vector( const uint16_t* data )
+{
+	// bfloat16 is the upper half of float, so it is enough to shift the values into the upper 16 bits
+	const uint16x8_t value = vld1q_u16( data );
+	CBFloat16Vector result;
+	result.Low = vreinterpretq_f32_u32( vshll_n_u16( vget_low_u16( value ), 16 ) );
+	result.High = vreinterpretq_f32_u32( vshll_n_u16( vget_high_u16( value ), 16 ) );
+	return result;
+}
+
+static inline CBFloat16Sum bFloat16MultiplyAdd( const CBFloat16Sum& sum,
+	const CBFloat16Vector& first, const CBFloat16Vector& second )
+{
+	return vmlaq_f32( vmlaq_f32( sum, first.Low, second.Low ), first.High, second.High );
+}
+
+static inline float horizontalBFloat16Sum( const CBFloat16Sum& sum )
+{
+	return vgetq_lane_f32( sum, 0 ) + vgetq_lane_f32( sum, 1 ) + vgetq_lane_f32( sum, 2 ) + vgetq_lane_f32( sum, 3 );
+}
+
+// Rounds 4 floats to bfloat16 in the same way as floatToBFloat16
+static inline uint16x4_t floatToBFloat16( const float32x4_t& value )
+{
+	const uint32x4_t bits = vreinterpretq_u32_f32( value );
+	const uint32x4_t rounded = vaddq_u32( vaddq_u32( bits, vdupq_n_u32( 0x7fff ) ),
+		vandq_u32( vshrq_n_u32( bits, 16 ), vdupq_n_u32( 1 ) ) );
+	const uint32x4_t nan = vorrq_u32( bits, vdupq_n_u32( 0x400000 ) );
+	const uint32x4_t isNan = vcgtq_u32( vandq_u32( bits, vdupq_n_u32( 0x7fffffff ) ), vdupq_n_u32( 0x7f800000 ) );
+	return vshrn_n_u32( vbslq_u32( isNan, nan, rounded ), 16 );
+}
+
+static void vectorConvertToBFloat16( const float* from, uint16_t* to, int vectorSize )
+{
+	const int neonSize = vectorSize / BFloat16VectorSize;
+	for( int i = 0; i < neonSize; ++i ) {
+		vst1q_u16( to, vcombine_u16( floatToBFloat16( vld1q_f32( from ) ), floatToBFloat16( vld1q_f32( from + 4 ) ) ) );
+		from += BFloat16VectorSize;
+		to += BFloat16VectorSize;
+	}
+
+	for( int i = neonSize * BFloat16VectorSize; i < vectorSize; ++i ) {
+		*to++ = floatToBFloat16( *from++ );
+	}
+}
+
+static void vectorConvertFromBFloat16( const uint16_t* from, float* to, int vectorSize )
+{
+	const int neonSize = vectorSize / BFloat16VectorSize;
+	for( int i = 0; i < neonSize; ++i ) {
+		const CBFloat16Vector value = loadBFloat16Vector( from );
+		vst1q_f32( to, value.Low );
+		vst1q_f32( to + 4, value.High );
+		from += BFloat16VectorSize;
+		to += BFloat16VectorSize;
+	}
+
+	for( int i = neonSize * BFloat16VectorSize; i < vectorSize; ++i ) {
+		*to++ = bFloat16ToFloat( *from++ );
+	}
+}
+
+#else
+#error "Unknown architecure"
+#endif
+
+// --------------------------------------------------------------------------------------------------------------------
+
+// Calculates the dot products of FirstCount rows of the float matrix and SecondCount rows of the bfloat16 matrix
+// The rows of both matrices are of the width size
+template<int FirstCount, int SecondCount>
+static inline void bFloat16DotProducts( const float* first, const uint16_t* second, int width, float* result )
+{
+	CBFloat16Sum sums[FirstCount][SecondCount];
+	for( int i = 0; i < FirstCount; ++i ) {
+		for( int j = 0; j < SecondCount; ++j ) {
+			sums[i][j] = zeroBFloat16Sum();
+		}
+	}
+
+	const int vectorWidth = width - width % BFloat16VectorSize;
+	for( int k = 0; k < vectorWidth; k += BFloat16VectorSize ) {
+		CBFloat16Vector firstVectors[FirstCount];
+		for( int i = 0; i < FirstCount; ++i ) {
+			firstVectors[i] = loadFloatVector( first + i * width + k );
+		}
+		for( int j = 0; j < SecondCount; ++j ) {
+			const CBFloat16Vector secondVector = loadBFloat16Vector( second + j * width + k );
+			for( int i = 0; i < FirstCount; ++i ) {
+				sums[i][j] = bFloat16MultiplyAdd( sums[i][j], firstVectors[i], secondVector );
+			}
+		}
+	}
+
+	for( int i = 0; i < FirstCount; ++i ) {
+		for( int j = 0; j < SecondCount; ++j ) {
+			float sum = horizontalBFloat16Sum( sums[i][j] );
+			for( int k = vectorWidth; k < width; ++k ) {
+				sum += first[i * width + k] * bFloat16ToFloat( second[j * width + k] );
+			}
+			result[i * SecondCount + j] = sum;
+		}
+	}
+}
+
+// Multiplies FirstCount rows of the first matrix by the transposed bfloat16 matrix
+template<int FirstCount>
+static inline void multiplyRowsByTransposedBFloat16Matrix( const float* first, int firstWidth,
+	const uint16_t* second, int secondHeight, float* result, int resultRowSize )
+{
+	float sums[FirstCount * BFloat16SecondBlockSize];
+	int j = 0;
+	while( j < secondHeight ) {
+		int blockSize = BFloat16SecondBlockSize;
+		if( j + BFloat16SecondBlockSize <= secondHeight ) {
+			bFloat16DotProducts<FirstCount, BFloat16SecondBlockSize>( first, second + j * firstWidth, firstWidth, sums );
+		} else {
+			blockSize = 1;
+			bFloat16DotProducts<FirstCount, 1>( first, second + j * firstWidth, firstWidth, sums );
+		}
+
+		for( int i = 0; i < FirstCount; ++i ) {
+			for( int k = 0; k < blockSize; ++k ) {
+				result[i * resultRowSize + j + k] = sums[i * blockSize + k];
+			}
+		}
+		j += blockSize;
+	}
+}
+
+static void multiplyMatrixByTransposedBFloat16Matrix( const float* first, int firstHeight, int firstWidth,
+	const uint16_t* second, int secondHeight, float* result, int resultRowSize )
+{
+	int i = 0;
+	for( ; i + BFloat16FirstBlockSize <= firstHeight; i += BFloat16FirstBlockSize ) {
+		multiplyRowsByTransposedBFloat16Matrix<BFloat16FirstBlockSize>( first + i * firstWidth, firstWidth,
+			second, secondHeight, result + i * resultRowSize, resultRowSize );
+	}
+	for( ; i < firstHeight; ++i ) {
+		multiplyRowsByTransposedBFloat16Matrix<1>( first + i * firstWidth, firstWidth,
+			second, secondHeight, result + i * resultRowSize, resultRowSize );
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+
+void CCpuMathEngine::VectorConvert( const CConstFloatHandle& fromHandle, const CBFloat16Handle& toHandle, int vectorSize )
+{
+	ASSERT_EXPR( fromHandle.GetMathEngine() == this );
+	ASSERT_EXPR( toHandle.GetMathEngine() == this );
+	ASSERT_EXPR( vectorSize >= 0 );
+	CCpuExecutionScope scope;
+
+	const float* from = GetRaw( fromHandle );
+	uint16_t* to = GetRaw( toHandle );
+
+	const int curThreadCount = IsOmpRelevant( vectorSize ) ? threadCount : 1;
+	NEOML_OMP_NUM_THREADS( curThreadCount )
+	{
+		int index;
+		int count;
+		if( OmpGetTaskIndexAndCount( vectorSize, BFloat16VectorSize, index, count ) ) {
+			vectorConvertToBFloat16( from + index, to + index, count );
+		}
+	}
+}
+
+void CCpuMathEngine::VectorConvert( const CConstBFloat16Handle& fromHandle, const CFloatHandle& toHandle, int vectorSize )
+{
+	ASSERT_EXPR( fromHandle.GetMathEngine() == this );
+	ASSERT_EXPR( toHandle.GetMathEngine() == this );
+	ASSERT_EXPR( vectorSize >= 0 );
+	CCpuExecutionScope scope;
+
+	const uint16_t* from = GetRaw( fromHandle );
+	float* to = GetRaw( toHandle );
+
+	const int curThreadCount = IsOmpRelevant( vectorSize ) ? threadCount : 1;
+	NEOML_OMP_NUM_THREADS( curThreadCount )
+	{
+		int index;
+		int count;
+		if( OmpGetTaskIndexAndCount( vectorSize, BFloat16VectorSize, index, count ) ) {
+			vectorConvertFromBFloat16( from + index, to + index, count );
+		}
+	}
+}
+
+void CCpuMathEngine::MultiplyMatrixByTransposedBFloat16Matrix( const CConstFloatHandle& firstHandle, int firstHeight,
+	int firstWidth, const CConstBFloat16Handle& secondHandle, int secondHeight, const CFloatHandle& resultHandle,
+	int resultBufferSize )
+{
+	ASSERT_EXPR( firstHandle.GetMathEngine() == this );
+	ASSERT_EXPR( secondHandle.GetMathEngine() == this );
+	ASSERT_EXPR( resultHandle.GetMathEngine() == this );
+	ASSERT_EXPR( resultBufferSize >= firstHeight * secondHeight );
+	CCpuExecutionScope scope;
+
+	if( firstHeight >= BFloat16MinConvertedHeight ) {
+		// Each value of the second matrix is used for many rows, so it is cheaper to convert the matrix once
+		// and use the float multiplication, which is optimized for the AVX processors
+		CFloatHandleStackVar secondFloat( mathEngine(), secondHeight * firstWidth );
+		VectorConvert( secondHandle, secondFloat.GetHandle(), secondHeight * firstWidth );
+		MultiplyMatrixByTransposedMatrix( firstHandle, firstHeight, firstWidth, firstWidth,
+			secondFloat.GetHandle(), secondHeight, firstWidth, resultHandle, secondHeight, resultBufferSize );
+		return;
+	}
+
+	const float* first = GetRaw( firstHandle );
+	const uint16_t* second = GetRaw( secondHandle );
+	float* result = GetRaw( resultHandle );
+
+	const int curThreadCount = IsOmpRelevant( firstHeight * secondHeight,
+		static_cast<int64_t>( firstHeight ) * secondHeight * firstWidth ) ? threadCount : 1;
+	NEOML_OMP_NUM_THREADS( curThreadCount )
+	{
+		int firstStart;
+		int firstCount;
+		int secondStart;
+		int secondCount;
+		if( OmpGetTaskIndexAndCount2D( firstHeight, BFloat16FirstBlockSize, secondHeight, BFloat16SecondBlockSize,
+			firstStart, firstCount, secondStart, secondCount ) )
+		{
+			multiplyMatrixByTransposedBFloat16Matrix( first + firstStart * firstWidth, firstCount, firstWidth,
+				second + secondStart * firstWidth, secondCount,
+				result + firstStart * secondHeight + secondStart, secondHeight );
+		}
+	}
+}
+
+} // namespace NeoML
@@ -0,0 +1,271 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <common.h>
+#pragma hdrstop
+
+#include <cmath>
+#include <cfloat>
+
+#include <CpuMathEngine.h>
+#include <CpuExecutionScope.h>
+#include <CpuMathEngineOmp.h>
+#include <MemoryHandleInternal.h>
+#include <MathEngineCommon.h>
+#include <CpuMathEnginePrivate.h>
+
+namespace NeoML {
+
+// The number of queries and keys in the tile processed at once
+// The scores of one tile fit into L1 cache
+static const int AttentionQueryTile = 32;
+static const int AttentionKeyTile = 64;
+
+void CCpuMathEngine::attentionScores( const float* query, int queryCount, const float* key, int keyCount,
+	int headSize, int rowSize, float scale, const float* mask, int maskRowSize, float maskMultiplier, float* scores )
+{
+	multiplyMatrixByTransposedMatrix( query, queryCount, headSize, rowSize, key, keyCount, rowSize,
+		scores, AttentionKeyTile );
+	for( int i = 0; i < queryCount; ++i ) {
+		float* row = scores + i * AttentionKeyTile;
+		vectorMultiply( row, row, scale, keyCount );
+		if( mask != nullptr ) {
+			const float* maskRow = mask + i * maskRowSize;
+			for( int j = 0; j < keyCount; ++j ) {
+				row[j] += maskMultiplier * maskRow[j];
+			}
+		}
+	}
+}
+
+void CCpuMathEngine::ScaledDotProductAttention( int batchSize, int headCount, int queryLength, int keyLength,
+	int headSize, float scale, const CConstFloatHandle& queryHandle, const CConstFloatHandle& keyHandle,
+	const CConstFloatHandle& valueHandle, const CConstFloatHandle& maskHandle, float maskMultiplier,
+	const CFloatHandle& logSumExpHandle, const CFloatHandle& resultHandle )
+{
+	ASSERT_EXPR( batchSize >= 1 );
+	ASSERT_EXPR( headCount >= 1 );
+	ASSERT_EXPR( queryLength >= 1 );
+	ASSERT_EXPR( keyLength >= 1 );
+	ASSERT_EXPR( headSize >= 1 );
+	ASSERT_EXPR( queryHandle.GetMathEngine() == this );
+	ASSERT_EXPR( keyHandle.GetMathEngine() == this );
+	ASSERT_EXPR( valueHandle.GetMathEngine() == this );
+	ASSERT_EXPR( maskHandle.IsNull() || maskHandle.GetMathEngine() == this );
+	ASSERT_EXPR( logSumExpHandle.IsNull() || logSumExpHandle.GetMathEngine() == this );
+	ASSERT_EXPR( resultHandle.GetMathEngine() == this );
+	CCpuExecutionScope scope;
+
+	const int rowSize = headCount * headSize;
+	const int queryTileCount = ( queryLength + AttentionQueryTile - 1 ) / AttentionQueryTile;
+	const int taskCount = batchSize * headCount * queryTileCount;
+	const int curThreadCount = IsOmpRelevant( taskCount,
+		static_cast<int64_t>( batchSize ) * rowSize * queryLength * keyLength ) ? threadCount : 1;
+
+	// Each thread stores the scores of one tile, the weighted sum of the values
+	// and the running maximum and sum of the exponents for each query of the tile
+	const int threadBufferSize = AttentionQueryTile * ( AttentionKeyTile + headSize + 2 );
+	CFloatHandleStackVar buffer( *this, curThreadCount * threadBufferSize );
+
+	const float* query = GetRaw( queryHandle );
+	const float* key = GetRaw( keyHandle );
+	const float* value = GetRaw( valueHandle );
+	const float* mask = maskHandle.IsNull() ? nullptr : GetRaw( maskHandle );
+	float* logSumExp = logSumExpHandle.IsNull() ? nullptr : GetRaw( logSumExpHandle );
+	float* result = GetRaw( resultHandle );
+
+	NEOML_OMP_NUM_THREADS( curThreadCount )
+	{
+		float* scores = GetRaw( buffer.GetHandle() ) + OmpGetThreadNum() * threadBufferSize;
+		float* sum = scores + AttentionQueryTile * AttentionKeyTile;
+		float* rowMax = sum + AttentionQueryTile * headSize;
+		float* rowExpSum = rowMax + AttentionQueryTile;
+
+		int taskStart;
+		int taskCountPerThread;
+		if( OmpGetTaskIndexAndCount( taskCount, taskStart, taskCountPerThread ) ) {
+			for( int task = taskStart; task < taskStart + taskCountPerThread; ++task ) {
+				const int queryStart = ( task % queryTileCount ) * AttentionQueryTile;
+				const int queryCount = min( AttentionQueryTile, queryLength - queryStart );
+				const int head = ( task / queryTileCount ) % headCount;
+				const int batch = task / queryTileCount / headCount;
+				const float* q = query + ( batch * queryLength + queryStart ) * rowSize + head * headSize;
+				const float* k = key + batch * keyLength * rowSize + head * headSize;
+				const float* v = value + batch * keyLength * rowSize + head * headSize;
+
+				vectorFill( sum, 0.f, queryCount * headSize );
+				vectorFill( rowMax, -FLT_MAX, queryCount );
+				vectorFill( rowExpSum, 0.f, queryCount );
+				for( int keyStart = 0; keyStart < keyLength; keyStart += AttentionKeyTile ) {
+					const int keyCount = min( AttentionKeyTile, keyLength - keyStart );
+					attentionScores( q, queryCount, k + keyStart * rowSize, keyCount, headSize, rowSize, scale,
+						mask == nullptr ? nullptr : mask + queryStart * keyLength + keyStart, keyLength,
+						maskMultiplier, scores );
+
+					// The online softmax: when the maximum of the row grows
+					// the sums accumulated so far are rescaled to the new maximum
+					for( int i = 0; i < queryCount; ++i ) {
+						float* row = scores + i * AttentionKeyTile;
+						float newMax = rowMax[i];
+						for( int j = 0; j < keyCount; ++j ) {
+							newMax = max( newMax, row[j] );
+						}
+						float expSum = 0;
+						for( int j = 0; j < keyCount; ++j ) {
+							row[j] = expf( row[j] - newMax );
+							expSum += row[j];
+						}
+						const float correction = expf( rowMax[i] - newMax );
+						if( correction != 1.f ) {
+							vectorMultiply( sum + i * headSize, sum + i * headSize, correction, headSize );
+						}
+						rowExpSum[i] = rowExpSum[i] * correction + expSum;
+						rowMax[i] = newMax;
+					}
+					multiplyMatrixByMatrixAndAdd( scores, queryCount, keyCount, AttentionKeyTile,
+						v + keyStart * rowSize, headSize, rowSize, sum, headSize );
+				}
+
+				float* res = result + ( batch * queryLength + queryStart ) * rowSize + head * headSize;
+				for( int i = 0; i < queryCount; ++i ) {
+					vectorMultiply( sum + i * headSize, res + i * rowSize, 1.f / rowExpSum[i], headSize );
+				}
+				if( logSumExp != nullptr ) {
+					float* lse = logSumExp + ( batch * headCount + head ) * queryLength + queryStart;
+					for( int i = 0; i < queryCount; ++i ) {
+						lse[i] = rowMax[i] + logf( rowExpSum[i] );
+					}
+				}
+			}
+		}
+	}
+}
+
+void CCpuMathEngine::ScaledDotProductAttentionBackward( int batchSize, int headCount, int queryLength, int keyLength,
+	int headSize, float scale, const CConstFloatHandle& queryHandle, const CConstFloatHandle& keyHandle,
+	const CConstFloatHandle& valueHandle, const CConstFloatHandle& maskHandle, float maskMultiplier,
+	const CConstFloatHandle& logSumExpHandle, const CConstFloatHandle& resultHandle,
+	const CConstFloatHandle& resultDiffHandle, const CFloatHandle& queryDiffHandle, const CFloatHandle& keyDiffHandle,
+	const CFloatHandle& valueDiffHandle )
+{
+	ASSERT_EXPR( batchSize >= 1 );
+	ASSERT_EXPR( headCount >= 1 );
+	ASSERT_EXPR( queryLength >= 1 );
+	ASSERT_EXPR( keyLength >= 1 );
+	ASSERT_EXPR( headSize >= 1 );
+	ASSERT_EXPR( queryHandle.GetMathEngine() == this );
+	ASSERT_EXPR( keyHandle.GetMathEngine() == this );
+	ASSERT_EXPR( valueHandle.GetMathEngine() == this );
+	ASSERT_EXPR( maskHandle.IsNull() || maskHandle.GetMathEngine() == this );
+	ASSERT_EXPR( logSumExpHandle.GetMathEngine() == this );
+	ASSERT_EXPR( resultHandle.GetMathEngine() == this );
+	ASSERT_EXPR( resultDiffHandle.GetMathEngine() == this );
+	ASSERT_EXPR( queryDiffHandle.GetMathEngine() == this );
+	ASSERT_EXPR( keyDiffHandle.GetMathEngine() == this );
+	ASSERT_EXPR( valueDiffHandle.GetMathEngine() == this );
+	CCpuExecutionScope scope;
+
+	const int rowSize = headCount * headSize;
+	const float* query = GetRaw( queryHandle );
+	const float* key = GetRaw( keyHandle );
+	const float* value = GetRaw( valueHandle );
+	const float* mask = maskHandle.IsNull() ? nullptr : GetRaw( maskHandle );
+	const float* logSumExp = GetRaw( logSumExpHandle );
+	const float* result = GetRaw( resultHandle );
+	const float* resultDiff = GetRaw( resultDiffHandle );
+	float* queryDiff = GetRaw( queryDiffHandle );
+	float* keyDiff = GetRaw( keyDiffHandle );
+	float* valueDiff = GetRaw( valueDiffHandle );
+
+	vectorFill( queryDiff, 0.f, batchSize * queryLength * rowSize );
+	vectorFill( keyDiff, 0.f, batchSize * keyLength * rowSize );
+	vectorFill( valueDiff, 0.f, batchSize * keyLength * rowSize );
+
+	// The heads are split between the threads, so that the key and value diffs of one head are accumulated
+	// by one thread
+	const int taskCount = batchSize * headCount;
+	const int curThreadCount = IsOmpRelevant( taskCount,
+		static_cast<int64_t>( batchSize ) * rowSize * queryLength * keyLength ) ? threadCount : 1;
+
+	// Each thread stores the attention weights of one tile, their diffs
+	// and the dot products of the result and its diff for each query of the tile
+	const int threadBufferSize = AttentionQueryTile * ( 2 * AttentionKeyTile + 1 );
+	CFloatHandleStackVar buffer( *this, curThreadCount * threadBufferSize );
+
+	NEOML_OMP_NUM_THREADS( curThreadCount )
+	{
+		float* weights = GetRaw( buffer.GetHandle() ) + OmpGetThreadNum() * threadBufferSize;
+		float* weightsDiff = weights + AttentionQueryTile * AttentionKeyTile;
+		float* resultDot = weightsDiff + AttentionQueryTile * AttentionKeyTile;
+
+		int taskStart;
+		int taskCountPerThread;
+		if( OmpGetTaskIndexAndCount( taskCount, taskStart, taskCountPerThread ) ) {
+			for( int task = taskStart; task < taskStart + taskCountPerThread; ++task ) {
+				const int head = task % headCount;
+				const int batch = task / headCount;
+				const int keyOffset = batch * keyLength * rowSize + head * headSize;
+
+				for( int queryStart = 0; queryStart < queryLength; queryStart += AttentionQueryTile ) {
+					const int queryCount = min( AttentionQueryTile, queryLength - queryStart );
+					const int queryOffset = ( batch * queryLength + queryStart ) * rowSize + head * headSize;
+					const float* q = query + queryOffset;
+					const float* outDiff = resultDiff + queryOffset;
+					const float* lse = logSumExp + task * queryLength + queryStart;
+					for( int i = 0; i < queryCount; ++i ) {
+						vectorDotProduct( outDiff + i * rowSize, result + queryOffset + i * rowSize, headSize,
+							resultDot + i );
+					}
+
+					for( int keyStart = 0; keyStart < keyLength; keyStart += AttentionKeyTile ) {
+						const int keyCount = min( AttentionKeyTile, keyLength - keyStart );
+						const float* k = key + keyOffset + keyStart * rowSize;
+						const float* v = value + keyOffset + keyStart * rowSize;
+						attentionScores( q, queryCount, k, keyCount, headSize, rowSize, scale,
+							mask == nullptr ? nullptr : mask + queryStart * keyLength + keyStart, keyLength,
+							maskMultiplier, weights );
+						for( int i = 0; i < queryCount; ++i ) {
+							float* row = weights + i * AttentionKeyTile;
+							for( int j = 0; j < keyCount; ++j ) {
+								row[j] = expf( row[j] - lse[i] );
+							}
+						}
+
+						multiplyTransposedMatrixByMatrixAndAdd( weights, queryCount, keyCount, AttentionKeyTile,
+							outDiff, headSize, rowSize, valueDiff + keyOffset + keyStart * rowSize, rowSize );
+
+						// The diff of the scores: weights * ( outDiff * v^T - resultDot ) * scale
+						multiplyMatrixByTransposedMatrix( outDiff, queryCount, headSize, rowSize, v, keyCount, rowSize,
+							weightsDiff, AttentionKeyTile );
+						for( int i = 0; i < queryCount; ++i ) {
+							const float* weightsRow = weights + i * AttentionKeyTile;
+							float* diffRow = weightsDiff + i * AttentionKeyTile;
+							for( int j = 0; j < keyCount; ++j ) {
+								diffRow[j] = weightsRow[j] * ( diffRow[j] - resultDot[i] ) * scale;
+							}
+						}
+
+						multiplyMatrixByMatrixAndAdd( weightsDiff, queryCount, keyCount, AttentionKeyTile,
+							k, headSize, rowSize, queryDiff + queryOffset, rowSize );
+						multiplyTransposedMatrixByMatrixAndAdd( weightsDiff, queryCount, keyCount, AttentionKeyTile,
+							q, headSize, rowSize, keyDiff + keyOffset + keyStart * rowSize, rowSize );
+					}
+				}
+			}
+		}
+	}
+}
+
+} // namespace NeoML
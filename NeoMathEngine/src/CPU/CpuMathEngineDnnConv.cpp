@@ -35,32 +35,78 @@ enum TConvAlgo {
 	CA_2,		// work with the data directly (only for stride = 1 and padding = 0)
 				// most efficient when the image is large and especially when it has many channels
 				
-	CA_1x1		// for convolution with a 1*1 filter, no padding and dilation (both 2D and 3D)
+	CA_1x1,		// for convolution with a 1*1 filter, no padding and dilation (both 2D and 3D)
+	CA_Winograd	// Winograd F(2x2, 3x3) for convolution with a 3*3 filter, stride 1 and no dilation
+				// (forward pass only, if there is no SIMD convolution)
 };
 
 const int BlobConvolutionCacheSize = 256 * 1024;
 
+// The minimum number of the input channels and the filters for which the Winograd algorithm is used
+// (otherwise the transformations take more time than the matrix multiplications save)
+const int WinogradMinChannels = 16;
+const int WinogradMinFilterCount = 16;
+
+// Winograd F(2x2, 3x3): every 2*2 output tile is calculated from a 4*4 input tile
+// The larger tiles need fewer multiplications but their transformations lose too much precision
+const int WinogradTileSize = 2;
+const int WinogradInputTileSize = 4;
+const int WinogradPointCount = WinogradInputTileSize * WinogradInputTileSize;
+
 // Convolution descriptor
 struct CCpuConvolutionDesc : public CCommonConvolutionDesc {
+	unique_ptr<CConvolutionDesc> SimdConvolutionDesc;
 	TConvAlgo ForwardAlgo;
 	TConvAlgo BackwardAlgo;
-	unique_ptr<CConvolutionDesc> SimdConvolutionDesc;
 
-	CCpuConvolutionDesc( unique_ptr<CConvolutionDesc>& simdConvolutionDesc, const CBlobDesc& source, const CBlobDesc& result, const CBlobDesc& filter,
-			int paddingHeight, int paddingWidth, int strideHeight, int strideWidth, int dilationHeight, int dilationWidth ) :
+	// The filter transformed for the Winograd algorithm (WinogradPointCount x FilterCount x Channels)
+	unique_ptr<CFloatHandleVar> WinogradFilter;
+	mutable const float* WinogradFilterSource; // the filter from which WinogradFilter was calculated
+	// Indicates if the filter prepared for the forward pass (WinogradFilter or the filter kept in SimdConvolutionDesc)
+	// should be updated (if the filter values changed)
+	mutable bool FilterUpdateNeeded;
+
+	CCpuConvolutionDesc( IMathEngine& mathEngine, const CBlobDesc& source, const CBlobDesc& result, const CBlobDesc& filter,
+			int paddingHeight, int paddingWidth, int strideHeight, int strideWidth, int dilationHeight, int dilationWidth,
+			CConvolutionDesc* simdConvolutionDesc ) :
 		CCommonConvolutionDesc( source, result, filter, paddingHeight, paddingWidth, strideHeight, strideWidth, dilationHeight, dilationWidth ),
+		SimdConvolutionDesc( simdConvolutionDesc ),
 		ForwardAlgo( getActualForwardAlgo() ),
 		BackwardAlgo( getActualBackwardAlgo() ),
-		SimdConvolutionDesc( std::move( simdConvolutionDesc ) )
+		WinogradFilterSource( nullptr ),
+		FilterUpdateNeeded( true )
 	{
+		if( ForwardAlgo == CA_Winograd ) {
+			WinogradFilter.reset( new CFloatHandleVar( mathEngine, WinogradPointCount * Filter.ObjectCount() * Filter.Depth() * Filter.Channels() ) );
+		}
 	}
 
 	TConvAlgo getActualForwardAlgo() const;
 	TConvAlgo getActualBackwardAlgo() const;
+
+private:
+	TConvAlgo getActualMatrixAlgo() const;
 };
 
 // Gets the algorithm to be used for this convolution
 inline TConvAlgo CCpuConvolutionDesc::getActualForwardAlgo() const
+{
+	// The SIMD convolution keeps the sums in the registers and is faster than the Winograd algorithm
+	if( SimdConvolutionDesc == nullptr
+		&& Filter.Height() == 3 && Filter.Width() == 3
+		&& StrideHeight == 1 && StrideWidth == 1
+		&& DilationHeight == 1 && DilationWidth == 1
+		&& Filter.Depth() * Filter.Channels() >= WinogradMinChannels
+		&& Filter.ObjectCount() >= WinogradMinFilterCount
+		&& Result.Height() >= WinogradTileSize && Result.Width() >= WinogradTileSize )
+	{
+		return CA_Winograd;
+	}
+	return getActualMatrixAlgo();
+}
+
+// Gets the algorithm which uses the matrix multiplication of the source and the filter
+inline TConvAlgo CCpuConvolutionDesc::getActualMatrixAlgo() const
 {
 	if( PaddingHeight == 0 && PaddingWidth == 0
 		&& DilationHeight == 1 && DilationWidth == 1
@@ -89,7 +135,7 @@ inline TConvAlgo CCpuConvolutionDesc::getActualForwardAlgo() const
 
 inline TConvAlgo CCpuConvolutionDesc::getActualBackwardAlgo() const
 {
-	TConvAlgo ret = getActualForwardAlgo();
+	TConvAlgo ret = getActualMatrixAlgo();
 	if( ret == CA_2 && ( PaddingHeight != 0 || PaddingWidth != 0 ) ) {
 		ret = CA_1;
 	}
@@ -131,15 +177,13 @@ CConvolutionDesc* CCpuMathEngine::InitBlobConvolution( const CBlobDesc& source,
 	ASSERT_EXPR( result.Channels() == filter.BatchWidth() );
 	ASSERT_EXPR( result.Depth() == 1 );
 
-	unique_ptr<CConvolutionDesc> simdConvolutionDesc;
+	CConvolutionDesc* simdConvolutionDesc = nullptr;
 	if( simdMathEngine != nullptr ) {
-		simdConvolutionDesc = unique_ptr<CConvolutionDesc>( simdMathEngine->InitBlobConvolution( source, paddingHeight, paddingWidth,
-			strideHeight, strideWidth, dilationHeight, dilationWidth, filter, result ) );
+		simdConvolutionDesc = simdMathEngine->InitBlobConvolution( source, paddingHeight, paddingWidth,
+			strideHeight, strideWidth, dilationHeight, dilationWidth, filter, result );
 	}
-
-	CCpuConvolutionDesc* desc = new CCpuConvolutionDesc( simdConvolutionDesc, source, result, filter,
-		paddingHeight, paddingWidth, strideHeight, strideWidth, dilationHeight, dilationWidth );
-	return desc;
+	return new CCpuConvolutionDesc( mathEngine(), source, result, filter,
+		paddingHeight, paddingWidth, strideHeight, strideWidth, dilationHeight, dilationWidth, simdConvolutionDesc );
 }
 
 // Creates a temporary blob with reordered input data that will be used to calculate convolution
@@ -328,7 +372,23 @@ static inline void calcPaddings( const CCpuConvolutionDesc& desc, int width, int
 		min( ( endPos - desc.Source.Width() ) / desc.DilationWidth + 1, desc.Filter.Width() );
 }
 
-void CCpuMathEngine::fillTempData( const float* sourceData, float* tempData, const CCpuConvolutionDesc& desc, int start, int count )
+static inline void fillZero( float* data, int size )
+{
+	NeoML::vectorFill( data, 0.0, size );
+}
+
+static inline void fillZero( int8_t* data, int size )
+{
+	memset( data, 0, size );
+}
+
+static inline void dataCopy( int8_t* dst, const int8_t* src, int size )
+{
+	memcpy( dst, src, size );
+}
+
+template<class T>
+void CCpuMathEngine::fillTempData( const T* sourceData, T* tempData, const CCpuConvolutionDesc& desc, int start, int count )
 {
 	const int channelsCount = desc.Filter.Depth() * desc.Filter.Channels();
 	const int filterLineSize = desc.Filter.Width() * channelsCount;
@@ -347,15 +407,15 @@ void CCpuMathEngine::fillTempData( const float* sourceData, float* tempData, con
 		const int sourceHeight = -desc.PaddingHeight + height * desc.StrideHeight;
 		const int sourceWidth = -desc.PaddingWidth + width * desc.StrideWidth + startPaddingSize * desc.DilationWidth;
 
-		const float* sourceDataPtr = sourceData + batch * desc.Source.ObjectSize() + ( sourceHeight * desc.Source.Width() + sourceWidth ) * channelsCount;
-		float* tempStartPaddingPtr = tempData + ( index - start ) * desc.Filter.ObjectSize();
-		float* tempDataPtr = tempStartPaddingPtr + startPaddingSize * channelsCount;
-		float* tempEndPaddingPtr = tempDataPtr + dataSize * channelsCount;
+		const T* sourceDataPtr = sourceData + batch * desc.Source.ObjectSize() + ( sourceHeight * desc.Source.Width() + sourceWidth ) * channelsCount;
+		T* tempStartPaddingPtr = tempData + ( index - start ) * desc.Filter.ObjectSize();
+		T* tempDataPtr = tempStartPaddingPtr + startPaddingSize * channelsCount;
+		T* tempEndPaddingPtr = tempDataPtr + dataSize * channelsCount;
 
 		for( int h = 0; h < desc.Filter.Height(); h++ ) {
 			if( 0 <= sourceHeight + h * desc.DilationHeight && sourceHeight + h * desc.DilationHeight < desc.Source.Height() ) {
 				if( startPaddingSize > 0 ) {
-					NeoML::vectorFill( tempStartPaddingPtr, 0.0, startPaddingSize * channelsCount );
+					fillZero( tempStartPaddingPtr, startPaddingSize * channelsCount );
 				}
 
 				if( desc.DilationWidth == 1 ) {
@@ -369,10 +429,10 @@ void CCpuMathEngine::fillTempData( const float* sourceData, float* tempData, con
 				}
 
 				if( endPaddingSize > 0 ) {
-					NeoML::vectorFill( tempEndPaddingPtr, 0.0, endPaddingSize * channelsCount );
+					fillZero( tempEndPaddingPtr, endPaddingSize * channelsCount );
 				}
 			} else {
-				NeoML::vectorFill( tempStartPaddingPtr, 0.0, filterLineSize );
+				fillZero( tempStartPaddingPtr, filterLineSize );
 			}
 
 			tempStartPaddingPtr += filterLineSize;
@@ -505,6 +565,200 @@ void CCpuMathEngine::blobConvolutionForwardAlgo1( const CCpuConvolutionDesc& des
 	}
 }
 
+// Winograd F(2x2, 3x3) transformations
+// Every function transforms the vectors of the given size: the k-th input vector starts at input + k * inputStride,
+// the k-th output vector starts at output + k * outputStride
+
+// The filter transformation G * g, 3 -> 4
+static inline void winogradFilterTransform( const float* input, int inputStride, float* output, int outputStride, int size )
+{
+	const float* g0 = input;
+	const float* g1 = input + inputStride;
+	const float* g2 = input + 2 * inputStride;
+	for( int i = 0; i < size; i++ ) {
+		output[i] = g0[i];
+		output[outputStride + i] = ( g0[i] + g1[i] + g2[i] ) / 2;
+		output[2 * outputStride + i] = ( g0[i] - g1[i] + g2[i] ) / 2;
+		output[3 * outputStride + i] = g2[i];
+	}
+}
+
+// The input transformation B^T * d, 4 -> 4
+static inline void winogradInputTransform( const float* input, int inputStride, float* output, int outputStride, int size )
+{
+	for( int i = 0; i < size; i++ ) {
+		const float d0 = input[i];
+		const float d1 = input[inputStride + i];
+		const float d2 = input[2 * inputStride + i];
+		const float d3 = input[3 * inputStride + i];
+		output[i] = d0 - d2;
+		output[outputStride + i] = d1 + d2;
+		output[2 * outputStride + i] = d2 - d1;
+		output[3 * outputStride + i] = d1 - d3;
+	}
+}
+
+// The output transformation A^T * m, 4 -> 2
+static inline void winogradOutputTransform( const float* input, int inputStride, float* output, int outputStride, int size )
+{
+	for( int i = 0; i < size; i++ ) {
+		const float m0 = input[i];
+		const float m1 = input[inputStride + i];
+		const float m2 = input[2 * inputStride + i];
+		const float m3 = input[3 * inputStride + i];
+		output[i] = m0 + m1 + m2;
+		output[outputStride + i] = m1 - m2 - m3;
+	}
+}
+
+// Calculates the transformed filter (WinogradPointCount x FilterCount x Channels) if the filter has changed
+static void updateWinogradFilter( const CCpuConvolutionDesc& desc, const float* filterData )
+{
+	if( !desc.FilterUpdateNeeded && desc.WinogradFilterSource == filterData ) {
+		return;
+	}
+	desc.FilterUpdateNeeded = false;
+	desc.WinogradFilterSource = filterData;
+
+	const int channels = desc.Filter.Depth() * desc.Filter.Channels();
+	const int filterCount = desc.Filter.ObjectCount();
+	float* result = GetRaw( desc.WinogradFilter->GetHandle() );
+
+	// The filter pixels are the rows of the channels vectors: 3 x 3 x channels -> 4 x 3 x channels -> 4 x 4 x channels
+	vector<float> temp( ( WinogradInputTileSize * 3 + WinogradPointCount ) * channels );
+	float* rowsTransformed = temp.data();
+	float* transformed = rowsTransformed + WinogradInputTileSize * 3 * channels;
+	for( int f = 0; f < filterCount; f++ ) {
+		const float* filter = filterData + f * desc.Filter.ObjectSize();
+		for( int x = 0; x < 3; x++ ) {
+			winogradFilterTransform( filter + x * channels, 3 * channels, rowsTransformed + x * channels, 3 * channels, channels );
+		}
+		for( int y = 0; y < WinogradInputTileSize; y++ ) {
+			winogradFilterTransform( rowsTransformed + y * 3 * channels, channels,
+				transformed + y * WinogradInputTileSize * channels, channels, channels );
+		}
+		for( int point = 0; point < WinogradPointCount; point++ ) {
+			dataCopy( result + ( point * filterCount + f ) * channels, transformed + point * channels, channels );
+		}
+	}
+}
+
+void CCpuMathEngine::blobConvolutionForwardWinograd( const CCpuConvolutionDesc& desc, const float* sourceData,
+	const float* filterData, const CFloatHandle* freeTermData, float* resultData )
+{
+	updateWinogradFilter( desc, filterData );
+	const float* transformedFilter = GetRaw( desc.WinogradFilter->GetHandle() );
+	const float* freeTerm = freeTermData == nullptr ? nullptr : GetRaw( *freeTermData );
+
+	const CBlobDesc& source = desc.Source;
+	const CBlobDesc& result = desc.Result;
+	const int channels = source.Depth() * source.Channels();
+	const int filterCount = desc.Filter.ObjectCount();
+
+	const int tileRowCount = ( result.Height() + WinogradTileSize - 1 ) / WinogradTileSize;
+	const int tileColumnCount = ( result.Width() + WinogradTileSize - 1 ) / WinogradTileSize;
+	const int imageTileCount = tileRowCount * tileColumnCount;
+	const int tileCount = result.ObjectCount() * imageTileCount;
+
+	const int curThreadCount = IsOmpRelevant( tileCount, static_cast<int64_t>( result.BlobSize() ) * desc.Filter.ObjectSize() ) ? threadCount : 1;
+	// The transformed input and the products of all tiles in a block should fit into the cache
+	const int blockTileCount = max( 1, min( BlobConvolutionCacheSize / ( WinogradPointCount * ( channels + filterCount ) ),
+		( tileCount + curThreadCount - 1 ) / curThreadCount ) );
+
+	const int transformedInputSize = WinogradPointCount * blockTileCount * channels;
+	const int productSize = WinogradPointCount * blockTileCount * filterCount;
+	const int tileBufferSize = max( 2 * WinogradPointCount * channels,
+		( WinogradTileSize * WinogradInputTileSize + WinogradTileSize * WinogradTileSize ) * filterCount );
+	const int threadBufferSize = transformedInputSize + productSize + tileBufferSize;
+
+	CFloatHandleStackVar buffer( mathEngine(), curThreadCount * threadBufferSize );
+	float* bufferRaw = GetRaw( buffer.GetHandle() );
+
+	NEOML_OMP_NUM_THREADS( curThreadCount )
+	{
+		float* transformedInput = bufferRaw + OmpGetThreadNum() * threadBufferSize;
+		float* product = transformedInput + transformedInputSize;
+		float* tileBuffer = product + productSize;
+
+		int start;
+		int count;
+		if( OmpGetTaskIndexAndCount( tileCount, start, count ) ) {
+			for( int blockStart = start; blockStart < start + count; blockStart += blockTileCount ) {
+				const int blockSize = min( blockTileCount, start + count - blockStart );
+
+				// Transform the input tiles: the point p of the tile t is stored at transformedInput[p][t]
+				for( int t = 0; t < blockSize; t++ ) {
+					const int tile = blockStart + t;
+					const int batch = tile / imageTileCount;
+					const int top = ( tile % imageTileCount ) / tileColumnCount * WinogradTileSize - desc.PaddingHeight;
+					const int left = ( tile % imageTileCount ) % tileColumnCount * WinogradTileSize - desc.PaddingWidth;
+					const float* image = sourceData + batch * source.ObjectSize();
+
+					float* inputTile = tileBuffer;
+					for( int y = 0; y < WinogradInputTileSize; y++ ) {
+						for( int x = 0; x < WinogradInputTileSize; x++ ) {
+							float* pixel = inputTile + ( y * WinogradInputTileSize + x ) * channels;
+							if( top + y < 0 || top + y >= source.Height() || left + x < 0 || left + x >= source.Width() ) {
+								vectorFill( pixel, 0.f, channels );
+							} else {
+								dataCopy( pixel, image + ( ( top + y ) * source.Width() + left + x ) * channels, channels );
+							}
+						}
+					}
+
+					float* columnsTransformed = inputTile + WinogradPointCount * channels;
+					for( int x = 0; x < WinogradInputTileSize; x++ ) {
+						winogradInputTransform( inputTile + x * channels, WinogradInputTileSize * channels,
+							columnsTransformed + x * channels, WinogradInputTileSize * channels, channels );
+					}
+					for( int y = 0; y < WinogradInputTileSize; y++ ) {
+						winogradInputTransform( columnsTransformed + y * WinogradInputTileSize * channels, channels,
+							transformedInput + ( y * WinogradInputTileSize * blockSize + t ) * channels, blockSize * channels, channels );
+					}
+				}
+
+				// Multiply the transformed input by the transformed filter separately for every point
+				for( int point = 0; point < WinogradPointCount; point++ ) {
+					multiplyMatrixByTransposedMatrix( transformedInput + point * blockSize * channels, blockSize, channels, channels,
+						transformedFilter + point * filterCount * channels, filterCount, channels,
+						product + point * blockSize * filterCount, filterCount );
+				}
+
+				// Transform the products back to the output tiles
+				for( int t = 0; t < blockSize; t++ ) {
+					const int tile = blockStart + t;
+					const int batch = tile / imageTileCount;
+					const int top = ( tile % imageTileCount ) / tileColumnCount * WinogradTileSize;
+					const int left = ( tile % imageTileCount ) % tileColumnCount * WinogradTileSize;
+
+					float* rowsTransformed = tileBuffer;
+					float* outputTile = rowsTransformed + WinogradTileSize * WinogradInputTileSize * filterCount;
+					for( int x = 0; x < WinogradInputTileSize; x++ ) {
+						winogradOutputTransform( product + ( x * blockSize + t ) * filterCount, WinogradInputTileSize * blockSize * filterCount,
+							rowsTransformed + x * filterCount, WinogradInputTileSize * filterCount, filterCount );
+					}
+					for( int y = 0; y < WinogradTileSize; y++ ) {
+						winogradOutputTransform( rowsTransformed + y * WinogradInputTileSize * filterCount, filterCount,
+							outputTile + y * WinogradTileSize * filterCount, filterCount, filterCount );
+					}
+
+					const int rowCount = min( WinogradTileSize, result.Height() - top );
+					const int columnCount = min( WinogradTileSize, result.Width() - left );
+					for( int y = 0; y < rowCount; y++ ) {
+						float* resultRow = resultData + batch * result.ObjectSize() + ( ( top + y ) * result.Width() + left ) * filterCount;
+						const float* outputRow = outputTile + y * WinogradTileSize * filterCount;
+						if( freeTerm != nullptr ) {
+							addVectorToMatrixRows( outputRow, resultRow, columnCount, filterCount, filterCount, filterCount, freeTerm );
+						} else {
+							dataCopy( resultRow, outputRow, columnCount * filterCount );
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
 void CCpuMathEngine::BlobConvolution( const CConvolutionDesc& convDesc, const CFloatHandle& source,
 	const CFloatHandle& filter, const CFloatHandle* freeTerm, const CFloatHandle& result )
 {
@@ -518,7 +772,9 @@ void CCpuMathEngine::BlobConvolution( const CConvolutionDesc& convDesc, const CF
 	const CCpuConvolutionDesc& desc = static_cast<const CCpuConvolutionDesc&>( convDesc );
 
 	if( desc.SimdConvolutionDesc != nullptr ) {
-		simdMathEngine->BlobConvolution( *desc.SimdConvolutionDesc, sourceRaw, filterRaw, freeTermRaw, resultRaw );
+		simdMathEngine->BlobConvolution( *desc.SimdConvolutionDesc, sourceRaw, filterRaw, freeTermRaw, resultRaw,
+			desc.FilterUpdateNeeded );
+		desc.FilterUpdateNeeded = false;
 		return;
 	}
 
@@ -540,6 +796,9 @@ void CCpuMathEngine::BlobConvolution( const CConvolutionDesc& convDesc, const CF
 			}
 			break;
 		}
+		case CA_Winograd:
+			blobConvolutionForwardWinograd( desc, sourceRaw, filterRaw, freeTerm, resultRaw );
+			break;
 		case CA_1x1:
 			{
 				bool needsFlatten = desc.Source.Depth() != 1;
@@ -553,6 +812,90 @@ void CCpuMathEngine::BlobConvolution( const CConvolutionDesc& convDesc, const CF
 	}
 }
 
+void CCpuMathEngine::BlobQuantizedConvolution( const CConvolutionDesc& convDesc, const CConstFloatHandle& sourceHandle,
+	float sourceScale, const CConstInt8Handle& filterHandle, const CConstFloatHandle& filterScalesHandle,
+	const CConstFloatHandle* freeTermHandle, const CFloatHandle& resultHandle )
+{
+	CCpuExecutionScope scope;
+
+	const CCpuConvolutionDesc& desc = static_cast<const CCpuConvolutionDesc&>( convDesc );
+
+	// The source is quantized once, then the convolution is calculated in the same way as in blobConvolutionForwardAlgo0
+	CMemoryHandleStackVar<int8_t> quantizedSource( mathEngine(), desc.Source.BlobSize() );
+	VectorQuantize( sourceHandle, quantizedSource.GetHandle(), desc.Source.BlobSize(), sourceScale );
+
+	const int8_t* sourceData = GetRaw( quantizedSource.GetHandle() );
+	const int8_t* filterData = GetRaw( filterHandle );
+	const float* filterScales = GetRaw( filterScalesHandle );
+	const float* freeTermData = freeTermHandle == nullptr ? nullptr : GetRaw( *freeTermHandle );
+	float* resultData = GetRaw( resultHandle );
+
+	const int resultItemCount = desc.Result.ObjectCount() * desc.Result.Width() * desc.Result.Height();
+	const int filterObjectCount = desc.Filter.ObjectCount();
+	const int filterObjectSize = desc.Filter.ObjectSize();
+	const int curThreadCount = IsOmpRelevant( resultItemCount, static_cast< int64_t >( desc.Result.BlobSize() ) * filterObjectSize ) ? threadCount : 1;
+
+	if( desc.ForwardAlgo == CA_1x1 && desc.StrideHeight == 1 && desc.StrideWidth == 1 ) {
+		// Each pixel of the source is a row of the matrix to be multiplied by the filter
+		NEOML_OMP_NUM_THREADS( curThreadCount )
+		{
+			int start;
+			int count;
+			if( OmpGetTaskIndexAndCount( resultItemCount, start, count ) ) {
+				multiplyQuantizedMatrixByTransposedMatrix( sourceData + start * filterObjectSize, count, filterObjectSize,
+					sourceScale, filterData, filterObjectCount, filterScales, freeTermData,
+					resultData + start * filterObjectCount, filterObjectCount );
+			}
+		}
+		return;
+	}
+
+	const int cacheItemCount = max( 1, min( ceilTo( BlobConvolutionCacheSize / filterObjectSize, 16 ), resultItemCount / curThreadCount ) );
+	CMemoryHandleStackVar<int8_t> tempData( mathEngine(), curThreadCount * cacheItemCount * filterObjectSize );
+	int8_t* tempDataRaw = GetRaw( tempData.GetHandle() );
+
+	NEOML_OMP_NUM_THREADS( curThreadCount )
+	{
+		int8_t* tempDataPtr = tempDataRaw + OmpGetThreadNum() * cacheItemCount * filterObjectSize;
+
+		int start;
+		int count;
+		if( OmpGetTaskIndexAndCount( resultItemCount, start, count ) ) {
+			int index = 0;
+			while( index < count ) {
+				const int size = min( count - index, cacheItemCount );
+				fillTempData( sourceData, tempDataPtr, desc, start + index, size );
+				multiplyQuantizedMatrixByTransposedMatrix( tempDataPtr, size, filterObjectSize, sourceScale,
+					filterData, filterObjectCount, filterScales, freeTermData,
+					resultData + ( start + index ) * filterObjectCount, filterObjectCount );
+				index += size;
+			}
+		}
+	}
+}
+
+void CCpuMathEngine::BlobBFloat16Convolution( const CConvolutionDesc& convDesc, const CConstFloatHandle& sourceHandle,
+	const CConstBFloat16Handle& filterHandle, const CConstFloatHandle* freeTermHandle, const CFloatHandle& resultHandle )
+{
+	CCpuExecutionScope scope;
+
+	const CCpuConvolutionDesc& desc = static_cast<const CCpuConvolutionDesc&>( convDesc );
+
+	// The filter is small compared to the convolution, so it is converted to float on each call
+	// and the fastest float algorithm for the descriptor (the JIT kernels, Winograd, etc.) is used
+	CFloatHandleStackVar filter( mathEngine(), desc.Filter.BlobSize() );
+	VectorConvert( filterHandle, filter.GetHandle(), desc.Filter.BlobSize() );
+	// The filter prepared by the algorithm was calculated from the previous temporary buffer
+	desc.FilterUpdateNeeded = true;
+
+	CFloatHandle freeTerm;
+	if( freeTermHandle != nullptr ) {
+		freeTerm = CFloatHandle( *freeTermHandle );
+	}
+	BlobConvolution( convDesc, CFloatHandle( sourceHandle ), filter.GetHandle(),
+		freeTermHandle == nullptr ? nullptr : &freeTerm, resultHandle );
+}
+
 void CCpuMathEngine::backwardConvolutionAddFilterToOutput( const CCpuConvolutionDesc& desc, const CFloatHandle& temp,
 	const CFloatHandle* freeTermData, const CFloatHandle& outputData )
 {
@@ -1083,6 +1426,7 @@ void CCpuMathEngine::BlobConvolutionLearnAdd( const CConvolutionDesc& convDesc,
 {
 	CCpuExecutionScope scope;
 	const CCpuConvolutionDesc& desc = static_cast<const CCpuConvolutionDesc&>( convDesc );
+	desc.FilterUpdateNeeded = true; // after learning, on the next forward pass the prepared filter should be updated
 
 	switch( desc.BackwardAlgo ) {
 		case CA_1:
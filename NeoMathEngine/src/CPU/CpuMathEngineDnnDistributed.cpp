@@ -15,12 +15,16 @@ limitations under the License.
 
 #include <CpuMathEngine.h>
 #include <CpuMathEngineDnnDistributed.h>
+#include <CpuMathEnginePrivate.h>
 #include <MemoryHandleInternal.h>
 
 namespace NeoML {
 
+// The chunks of different threads start on different cache lines
+static const int ChunkAlignment = 16;
+
 CMultiThreadDistributedCommunicator::CMultiThreadDistributedCommunicator( int _n_threads )
-    : counter( _n_threads ), waiting_flag( true ), n_threads( _n_threads )
+    : counter( _n_threads ), generation( 0 ), n_threads( _n_threads )
 {
     handles.resize( n_threads );
 }
@@ -34,17 +38,25 @@ void CMultiThreadDistributedCommunicator::collectHandles( const CFloatHandle& ha
 
 void CMultiThreadDistributedCommunicator::barrier()
 {
-    int wait = waiting_flag;
-    if( !--counter ){
+    std::unique_lock<std::mutex> lock( mutex );
+    const int current = generation;
+    if( --counter == 0 ){
         counter = n_threads;
-        waiting_flag++;
+        generation++;
+        condition.notify_all();
     } else {
-        while( waiting_flag == wait ){
-            std::this_thread::yield();
-        }
+        condition.wait( lock, [this, current] { return generation != current; } );
     }
 }
 
+void GetDistributedChunk( int index, int count, int size, int& start, int& chunkSize )
+{
+    int perEngine = ( size + count - 1 ) / count;
+    perEngine = ( perEngine + ChunkAlignment - 1 ) / ChunkAlignment * ChunkAlignment;
+    start = min( index * perEngine, size );
+    chunkSize = min( perEngine, size - start );
+}
+
 void CMultiThreadDistributedCommunicator::AllReduce( const CFloatHandle& handle, int size )
 {
     collectHandles( handle );
@@ -52,19 +64,30 @@ void CMultiThreadDistributedCommunicator::AllReduce( const CFloatHandle& handle,
 
     barrier();
 
-    int perThread = ( size + n_threads - 1 ) / n_threads;
-    float buf;
-    for( int i = thread * perThread; i < min( ( thread + 1 ) * perThread, size ); i++ ){
-        buf = 0;
+    // Reduce-scatter: each thread sums its own chunk over all peers into its own buffer
+    int start = 0;
+    int count = 0;
+    GetDistributedChunk( thread, n_threads, size, start, count );
+    if( count > 0 ){
+        float* result = handles[thread] + start;
         for( int j = 0; j < n_threads; j++ ){
-            buf += handles[j][i];
+            if( j != thread ){
+                vectorAdd( result, handles[j] + start, result, count );
+            }
         }
-        buf /= n_threads;
-        for( int j = 0; j < n_threads; j++ ){
-            handles[j][i] = buf;
+        vectorMultiply( result, result, 1.f / n_threads, count );
+    }
+
+    barrier();
+
+    // All-gather: each thread copies the averaged chunks of its peers
+    for( int j = 0; j < n_threads; j++ ){
+        GetDistributedChunk( j, n_threads, size, start, count );
+        if( j != thread && count > 0 ){
+            dataCopy( handles[thread] + start, handles[j] + start, count );
         }
     }
-    
+
     barrier();
 }
 
@@ -82,13 +105,26 @@ void CMultiThreadDistributedCommunicator::Broadcast( const CFloatHandle& handle,
     barrier();
 }
 
-void CreateDistributedCpuMathEngines( IMathEngine** mathEngines, int count )
+void CreateDistributedCpuMathEngines( IMathEngine** mathEngines, int count, int threadCount )
 {
     auto comm = std::make_shared<CMultiThreadDistributedCommunicator>( count );
     for( int i = 0; i < count; i++ ){
-        mathEngines[i] = CreateCpuMathEngine( 1, 0 );
+        mathEngines[i] = CreateCpuMathEngine( threadCount, 0 );
         static_cast<CCpuMathEngine*>( mathEngines[i] )->SetDistributedCommunicator( comm, {i, count} );
     }
 }
 
+IMathEngine* CreateMultiProcessCpuMathEngine( const char* name, int tcpPort, int process, int count,
+    TDistributedTransport transport, int threadCount )
+{
+    ASSERT_EXPR( name != nullptr );
+    ASSERT_EXPR( 0 <= process && process < count );
+    std::shared_ptr<ICpuDistributedCommunicator> comm( CreateMultiProcessDistributedCommunicator(
+        name, tcpPort, process, count, transport ) );
+    ASSERT_EXPR( comm != nullptr );
+    IMathEngine* mathEngine = CreateCpuMathEngine( threadCount, 0 );
+    static_cast<CCpuMathEngine*>( mathEngine )->SetDistributedCommunicator( comm, {process, count} );
+    return mathEngine;
+}
+
 }
\ No newline at end of file
@@ -13,30 +13,52 @@ limitations under the License.
 #pragma once
 
 #include <vector>
-#include <thread>
-#include <atomic>
+#include <mutex>
+#include <condition_variable>
 #include <NeoMathEngine/NeoMathEngine.h>
 
 namespace NeoML {
 
-class CMultiThreadDistributedCommunicator {
+// The communicator which connects the cpu math engines of the distributed training
+class ICpuDistributedCommunicator {
+public:
+    virtual ~ICpuDistributedCommunicator() = default;
+    // Averages the data over all math engines
+    virtual void AllReduce( const CFloatHandle& handle, int size ) = 0;
+    // Copies the data of the root math engine to all others
+    virtual void Broadcast( const CFloatHandle& handle, int size, int root ) = 0;
+};
+
+// Connects the math engines used by the threads of one process
+class CMultiThreadDistributedCommunicator : public ICpuDistributedCommunicator {
 public:
     CMultiThreadDistributedCommunicator( int n_threads );
-    void AllReduce( const CFloatHandle& handle, int size );
-    void Broadcast( const CFloatHandle& handle, int size, int root );
+    void AllReduce( const CFloatHandle& handle, int size ) override;
+    void Broadcast( const CFloatHandle& handle, int size, int root ) override;
 private:
     std::vector<float*> handles;
 
-    // non-blocking
-    std::atomic<int> counter;
-    std::atomic<int> waiting_flag;
+    // the barrier state: the number of threads still expected and the number of the passed barriers
+    std::mutex mutex;
+    std::condition_variable condition;
+    int counter;
+    int generation;
 
     int n_threads;
 
-    // non-blocking barrier
+    // blocks until all threads reach the barrier
     void barrier();
     // collects handles from all threads into the common array
     void collectHandles( const CFloatHandle& handle );
 };
 
+// Gets the part of the data of the given size processed by the index-th of the count math engines
+// The parts of different math engines start on different cache lines
+void GetDistributedChunk( int index, int count, int size, int& start, int& chunkSize );
+
+// Creates the communicator for the process-th of the count processes on the same host
+// Returns nullptr if the multi-process training is not supported on the platform
+ICpuDistributedCommunicator* CreateMultiProcessDistributedCommunicator( const char* name, int tcpPort,
+    int process, int count, TDistributedTransport transport );
+
 } // namespace NeoML
\ No newline at end of file
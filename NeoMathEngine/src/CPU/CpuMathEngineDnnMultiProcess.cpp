@@ -0,0 +1,692 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <common.h>
+#pragma hdrstop
+
+#include <CpuMathEngineDnnDistributed.h>
+#include <CpuMathEnginePrivate.h>
+#include <MemoryHandleInternal.h>
+#include <NeoMathEngine/NeoMathEngineException.h>
+
+#if FINE_PLATFORM( FINE_LINUX ) || FINE_PLATFORM( FINE_DARWIN )
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <random>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+namespace NeoML {
+
+// The time to wait for the other processes
+static const int DistributedTimeoutSeconds = 300;
+// The time to wait for the answer of the 0th process when connecting via TCP
+static const int HandshakeTimeoutSeconds = 5;
+// The maximum number of floats exchanged at once
+static const int ExchangeChunkSize = 1 << 20;
+// Marks the initialized shared memory segment and the TCP connections of the math engines
+static const uint32_t DistributedMagic = 0x4E454F4D;
+
+//------------------------------------------------------------------------------------------------------------
+// Shared memory
+
+// The header of the shared memory segment
+struct CSharedMemoryHeader {
+    std::atomic<uint32_t> Magic;
+    pthread_mutex_t Mutex;
+    pthread_cond_t Condition;
+    // The nonce of the session published by the 0th process
+    // Set to 0 when a newer session with the same name replaces this one
+    // or when some process has died holding the mutex, so a stale segment is never joined
+    uint64_t Session;
+    // The number of the other processes that have joined the session
+    int JoinedCount;
+    // Set by the 0th process after all other processes have joined
+    int IsStarted;
+    // The number of the processes the barrier is still waiting for
+    int WaitingCount;
+    // The number of the passed barriers
+    int Generation;
+};
+
+// The size of the header, the slots of the processes start on different cache lines
+static const size_t SharedMemoryHeaderSize = ( sizeof( CSharedMemoryHeader ) + 63 ) / 64 * 64;
+
+// Exchanges the data via the shared memory segment
+// Each process has its own slot of ExchangeChunkSize floats in the segment
+class CSharedMemoryCommunicator : public ICpuDistributedCommunicator {
+public:
+    CSharedMemoryCommunicator( const char* name, int process, int count );
+    ~CSharedMemoryCommunicator() override;
+
+    // Creates the segment; called by the 0th process
+    bool Create();
+    // Opens the segment created by the 0th process; returns false if the segment is not ready yet
+    bool TryOpen();
+    // Waits until all processes open the segment; returns false if the session is over
+    bool WaitForAll();
+
+    void AllReduce( const CFloatHandle& handle, int size ) override;
+    void Broadcast( const CFloatHandle& handle, int size, int root ) override;
+
+private:
+    const std::string name;
+    const int process;
+    const int count;
+    const size_t segmentSize;
+    CSharedMemoryHeader* header;
+    // The nonce of the session this process has joined
+    uint64_t session;
+    bool isUnlinkNeeded;
+
+    float* slot( int index ) const;
+    void barrier();
+};
+
+static std::string sharedMemoryName( const char* name )
+{
+    return name[0] == '/' ? std::string( name ) : "/" + std::string( name );
+}
+
+// Ends the session if the process that held the mutex has died: its data may be inconsistent
+static void onOwnerDead( CSharedMemoryHeader* header, int result )
+{
+#if FINE_PLATFORM( FINE_LINUX )
+    if( result == EOWNERDEAD ) {
+        pthread_mutex_consistent( &header->Mutex );
+        header->Session = 0;
+        pthread_cond_broadcast( &header->Condition );
+        return;
+    }
+#endif
+    ASSERT_EXPR( result == 0 || result == ETIMEDOUT );
+}
+
+static void lockHeader( CSharedMemoryHeader* header )
+{
+    onOwnerDead( header, pthread_mutex_lock( &header->Mutex ) );
+}
+
+// Returns true if the deadline has passed
+static bool waitHeader( CSharedMemoryHeader* header, const timespec& deadline )
+{
+    const int result = pthread_cond_timedwait( &header->Condition, &header->Mutex, &deadline );
+    onOwnerDead( header, result );
+    return result == ETIMEDOUT;
+}
+
+// Generates the nonzero nonce of the new session
+static uint64_t newSessionNonce()
+{
+    std::random_device device;
+    const uint64_t nonce = ( static_cast<uint64_t>( device() ) << 32 ) ^ device()
+        ^ static_cast<uint64_t>( std::chrono::steady_clock::now().time_since_epoch().count() )
+        ^ static_cast<uint64_t>( getpid() );
+    return nonce != 0 ? nonce : 1;
+}
+
+// Ends the session left in the segment by a crashed process
+// The processes still waiting in that segment notice it and look for the new one
+static void revokeStaleSession( const std::string& name )
+{
+    const int fd = shm_open( name.c_str(), O_RDWR, 0 );
+    if( fd < 0 ) {
+        return;
+    }
+    struct stat status;
+    void* segment = fstat( fd, &status ) == 0 && static_cast<size_t>( status.st_size ) >= SharedMemoryHeaderSize
+        ? mmap( nullptr, SharedMemoryHeaderSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 ) : MAP_FAILED;
+    close( fd );
+    if( segment == MAP_FAILED ) {
+        return;
+    }
+    CSharedMemoryHeader* staleHeader = static_cast<CSharedMemoryHeader*>( segment );
+    if( staleHeader->Magic.load( std::memory_order_acquire ) == DistributedMagic ) {
+        lockHeader( staleHeader );
+        staleHeader->Session = 0;
+        pthread_mutex_unlock( &staleHeader->Mutex );
+    }
+    munmap( segment, SharedMemoryHeaderSize );
+}
+
+CSharedMemoryCommunicator::CSharedMemoryCommunicator( const char* _name, int _process, int _count ) :
+    name( sharedMemoryName( _name ) ),
+    process( _process ),
+    count( _count ),
+    segmentSize( SharedMemoryHeaderSize + static_cast<size_t>( _count ) * ExchangeChunkSize * sizeof( float ) ),
+    header( nullptr ),
+    session( 0 ),
+    isUnlinkNeeded( false )
+{
+}
+
+CSharedMemoryCommunicator::~CSharedMemoryCommunicator()
+{
+    if( header != nullptr ) {
+        munmap( header, segmentSize );
+    }
+    if( isUnlinkNeeded ) {
+        shm_unlink( name.c_str() );
+    }
+}
+
+bool CSharedMemoryCommunicator::Create()
+{
+    // Remove the segment left by a crashed session
+    revokeStaleSession( name );
+    shm_unlink( name.c_str() );
+    const int fd = shm_open( name.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR );
+    if( fd < 0 ) {
+        return false;
+    }
+    isUnlinkNeeded = true;
+    void* segment = ftruncate( fd, static_cast<off_t>( segmentSize ) ) == 0
+        ? mmap( nullptr, segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 ) : MAP_FAILED;
+    close( fd );
+    if( segment == MAP_FAILED ) {
+        return false;
+    }
+    header = static_cast<CSharedMemoryHeader*>( segment );
+
+    pthread_mutexattr_t mutexAttributes;
+    pthread_mutexattr_init( &mutexAttributes );
+    pthread_condattr_t conditionAttributes;
+    pthread_condattr_init( &conditionAttributes );
+    bool isInitialized = pthread_mutexattr_setpshared( &mutexAttributes, PTHREAD_PROCESS_SHARED ) == 0;
+#if FINE_PLATFORM( FINE_LINUX )
+    // The other processes don't hang on the mutex if the process holding it dies
+    isInitialized = isInitialized && pthread_mutexattr_setrobust( &mutexAttributes, PTHREAD_MUTEX_ROBUST ) == 0;
+#endif
+    isInitialized = isInitialized
+        && pthread_condattr_setpshared( &conditionAttributes, PTHREAD_PROCESS_SHARED ) == 0
+        && pthread_mutex_init( &header->Mutex, &mutexAttributes ) == 0
+        && pthread_cond_init( &header->Condition, &conditionAttributes ) == 0;
+    pthread_condattr_destroy( &conditionAttributes );
+    pthread_mutexattr_destroy( &mutexAttributes );
+    if( !isInitialized ) {
+        return false;
+    }
+
+    session = newSessionNonce();
+    header->Session = session;
+    header->JoinedCount = 0;
+    header->IsStarted = 0;
+    header->WaitingCount = count;
+    header->Generation = 0;
+    // The other processes may use the segment after the magic is set
+    header->Magic.store( DistributedMagic, std::memory_order_release );
+    return true;
+}
+
+bool CSharedMemoryCommunicator::TryOpen()
+{
+    const int fd = shm_open( name.c_str(), O_RDWR, 0 );
+    if( fd < 0 ) {
+        return false;
+    }
+    struct stat status;
+    void* segment = fstat( fd, &status ) == 0 && static_cast<size_t>( status.st_size ) >= segmentSize
+        ? mmap( nullptr, segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 ) : MAP_FAILED;
+    close( fd );
+    if( segment == MAP_FAILED ) {
+        return false;
+    }
+    CSharedMemoryHeader* openedHeader = static_cast<CSharedMemoryHeader*>( segment );
+    if( openedHeader->Magic.load( std::memory_order_acquire ) != DistributedMagic ) {
+        munmap( segment, segmentSize );
+        return false;
+    }
+    // The session of a crashed process or the one that has already started can't be joined
+    lockHeader( openedHeader );
+    const uint64_t openedSession = openedHeader->IsStarted == 0 ? openedHeader->Session : 0;
+    pthread_mutex_unlock( &openedHeader->Mutex );
+    if( openedSession == 0 ) {
+        munmap( segment, segmentSize );
+        return false;
+    }
+    header = openedHeader;
+    session = openedSession;
+    return true;
+}
+
+bool CSharedMemoryCommunicator::WaitForAll()
+{
+    // The condition is not used here: a killed waiter may block its broadcast forever, and the crashed process
+    // of a stale session may have been waiting on it
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds( DistributedTimeoutSeconds );
+    bool isStarted = false;
+    bool isSessionOver = false;
+    for( bool isJoined = false; !isStarted && !isSessionOver; isJoined = true ) {
+        if( isJoined ) {
+            if( std::chrono::steady_clock::now() >= deadline ) {
+                return false;
+            }
+            std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+        }
+        lockHeader( header );
+        if( !isJoined && process != 0 ) {
+            header->JoinedCount++;
+        }
+        if( process == 0 && header->JoinedCount == count - 1 && header->Session == session ) {
+            header->IsStarted = 1;
+        }
+        // The 0th process of a stale session never starts it, so the process waits until the session is revoked
+        isStarted = header->IsStarted != 0 && header->Session == session;
+        isSessionOver = header->Session != session;
+        pthread_mutex_unlock( &header->Mutex );
+    }
+
+    if( isStarted && isUnlinkNeeded ) {
+        // All processes have mapped the segment, it will be freed after the last of them unmaps it
+        shm_unlink( name.c_str() );
+        isUnlinkNeeded = false;
+    }
+    return isStarted;
+}
+
+float* CSharedMemoryCommunicator::slot( int index ) const
+{
+    return reinterpret_cast<float*>( reinterpret_cast<char*>( header ) + SharedMemoryHeaderSize )
+        + static_cast<size_t>( index ) * ExchangeChunkSize;
+}
+
+void CSharedMemoryCommunicator::barrier()
+{
+    timespec deadline;
+    clock_gettime( CLOCK_REALTIME, &deadline );
+    deadline.tv_sec += DistributedTimeoutSeconds;
+
+    bool isTimedOut = false;
+    lockHeader( header );
+    const int generation = header->Generation;
+    if( --header->WaitingCount == 0 ) {
+        header->WaitingCount = count;
+        header->Generation++;
+        pthread_cond_broadcast( &header->Condition );
+    } else {
+        while( header->Generation == generation && header->Session == session && !isTimedOut ) {
+            isTimedOut = waitHeader( header, deadline );
+        }
+    }
+    const bool isSessionOver = header->Session != session;
+    pthread_mutex_unlock( &header->Mutex );
+    // Some process has not reached the barrier: it has crashed or hung
+    ASSERT_EXPR( !isTimedOut );
+    // Some process has died holding the mutex
+    ASSERT_EXPR( !isSessionOver );
+}
+
+void CSharedMemoryCommunicator::AllReduce( const CFloatHandle& handle, int size )
+{
+    float* data = GetRaw( handle );
+    for( int offset = 0; offset < size; offset += ExchangeChunkSize ) {
+        const int exchangeSize = min( ExchangeChunkSize, size - offset );
+        dataCopy( slot( process ), data + offset, exchangeSize );
+
+        barrier();
+
+        // Reduce-scatter: each process sums its own part over all slots into its own slot
+        int start = 0;
+        int chunkSize = 0;
+        GetDistributedChunk( process, count, exchangeSize, start, chunkSize );
+        if( chunkSize > 0 ) {
+            float* result = slot( process ) + start;
+            for( int i = 0; i < count; i++ ) {
+                if( i != process ) {
+                    vectorAdd( result, slot( i ) + start, result, chunkSize );
+                }
+            }
+            vectorMultiply( result, result, 1.f / count, chunkSize );
+        }
+
+        barrier();
+
+        // All-gather: each process copies the averaged parts of all processes
+        for( int i = 0; i < count; i++ ) {
+            GetDistributedChunk( i, count, exchangeSize, start, chunkSize );
+            if( chunkSize > 0 ) {
+                dataCopy( data + offset + start, slot( i ) + start, chunkSize );
+            }
+        }
+
+        // The slots may be overwritten only after all processes have read them
+        barrier();
+    }
+}
+
+void CSharedMemoryCommunicator::Broadcast( const CFloatHandle& handle, int size, int root )
+{
+    float* data = GetRaw( handle );
+    for( int offset = 0; offset < size; offset += ExchangeChunkSize ) {
+        const int exchangeSize = min( ExchangeChunkSize, size - offset );
+        if( process == root ) {
+            dataCopy( slot( root ), data + offset, exchangeSize );
+        }
+        barrier();
+        if( process != root ) {
+            dataCopy( data + offset, slot( root ), exchangeSize );
+        }
+        barrier();
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------
+// Loopback TCP
+
+// Exchanges the data via the TCP connections between the 0th process and all others
+// The 0th process sums the data of all processes and sends the result back
+class CTcpCommunicator : public ICpuDistributedCommunicator {
+public:
+    CTcpCommunicator( int process, int count );
+    ~CTcpCommunicator() override;
+
+    // Accepts the connections of all other processes; called by the 0th process
+    bool Listen( int port );
+    // Connects to the 0th process; returns false if it is not listening yet
+    bool TryConnect( int port );
+
+    void AllReduce( const CFloatHandle& handle, int size ) override;
+    void Broadcast( const CFloatHandle& handle, int size, int root ) override;
+
+private:
+    const int process;
+    const int count;
+    // The connections to the other processes for the 0th process, the connection to the 0th process for the others
+    std::vector<int> sockets;
+    std::vector<float> buffer;
+
+    void send( int socket, const void* data, size_t size );
+    void receive( int socket, void* data, size_t size );
+};
+
+// Sets the socket options common for all connections
+static void setSocketOptions( int socket, int timeoutSeconds )
+{
+    int flag = 1;
+    setsockopt( socket, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof( flag ) );
+#if FINE_PLATFORM( FINE_DARWIN )
+    setsockopt( socket, SOL_SOCKET, SO_NOSIGPIPE, &flag, sizeof( flag ) );
+#endif
+    timeval timeout;
+    timeout.tv_sec = timeoutSeconds;
+    timeout.tv_usec = 0;
+    setsockopt( socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof( timeout ) );
+    setsockopt( socket, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof( timeout ) );
+}
+
+static sockaddr_in loopbackAddress( int port )
+{
+    sockaddr_in address;
+    memset( &address, 0, sizeof( address ) );
+    address.sin_family = AF_INET;
+    address.sin_port = htons( static_cast<uint16_t>( port ) );
+    address.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+    return address;
+}
+
+CTcpCommunicator::CTcpCommunicator( int _process, int _count ) :
+    process( _process ),
+    count( _count )
+{
+}
+
+CTcpCommunicator::~CTcpCommunicator()
+{
+    for( int socket : sockets ) {
+        if( socket >= 0 ) {
+            close( socket );
+        }
+    }
+}
+
+bool CTcpCommunicator::Listen( int port )
+{
+    const int listener = socket( AF_INET, SOCK_STREAM, 0 );
+    if( listener < 0 ) {
+        return false;
+    }
+    int flag = 1;
+    setsockopt( listener, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof( flag ) );
+    const sockaddr_in address = loopbackAddress( port );
+    if( bind( listener, reinterpret_cast<const sockaddr*>( &address ), sizeof( address ) ) != 0
+        || listen( listener, count ) != 0 )
+    {
+        close( listener );
+        return false;
+    }
+
+    sockets.assign( count, -1 );
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds( DistributedTimeoutSeconds );
+    for( int accepted = 1; accepted < count; ) {
+        const int timeLeft = static_cast<int>( std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now() ).count() );
+        pollfd request = { listener, POLLIN, 0 };
+        if( timeLeft <= 0 || poll( &request, 1, timeLeft ) <= 0 ) {
+            if( timeLeft > 0 && errno == EINTR ) {
+                continue;
+            }
+            close( listener );
+            return false;
+        }
+        const int connection = accept( listener, nullptr, nullptr );
+        if( connection < 0 ) {
+            continue;
+        }
+        setSocketOptions( connection, HandshakeTimeoutSeconds );
+        uint32_t hello[2];
+        if( recv( connection, hello, sizeof( hello ), MSG_WAITALL ) != sizeof( hello )
+            || hello[0] != DistributedMagic || hello[1] == 0 || hello[1] >= static_cast<uint32_t>( count )
+            || sockets[hello[1]] >= 0 )
+        {
+            // Not a math engine of this session
+            close( connection );
+            continue;
+        }
+        setSocketOptions( connection, DistributedTimeoutSeconds );
+        sockets[hello[1]] = connection;
+        accepted++;
+        send( connection, &DistributedMagic, sizeof( DistributedMagic ) );
+    }
+    close( listener );
+    return true;
+}
+
+bool CTcpCommunicator::TryConnect( int port )
+{
+    const int connection = socket( AF_INET, SOCK_STREAM, 0 );
+    if( connection < 0 ) {
+        return false;
+    }
+    const sockaddr_in address = loopbackAddress( port );
+    if( connect( connection, reinterpret_cast<const sockaddr*>( &address ), sizeof( address ) ) != 0 ) {
+        close( connection );
+        return false;
+    }
+    // Something else may listen on the port, so the answer is not waited for long
+    setSocketOptions( connection, HandshakeTimeoutSeconds );
+    const uint32_t hello[2] = { DistributedMagic, static_cast<uint32_t>( process ) };
+    uint32_t answer = 0;
+    if( ::send( connection, hello, sizeof( hello ), 0 ) != sizeof( hello )
+        || recv( connection, &answer, sizeof( answer ), MSG_WAITALL ) != sizeof( answer )
+        || answer != DistributedMagic )
+    {
+        close( connection );
+        return false;
+    }
+    setSocketOptions( connection, DistributedTimeoutSeconds );
+    sockets.assign( 1, connection );
+    return true;
+}
+
+void CTcpCommunicator::send( int socket, const void* data, size_t size )
+{
+#if FINE_PLATFORM( FINE_LINUX )
+    const int flags = MSG_NOSIGNAL;
+#else
+    const int flags = 0;
+#endif
+    const char* ptr = static_cast<const char*>( data );
+    while( size > 0 ) {
+        const ssize_t sent = ::send( socket, ptr, size, flags );
+        if( sent < 0 && errno == EINTR ) {
+            continue;
+        }
+        // The other process has crashed or hung
+        ASSERT_EXPR( sent > 0 );
+        ptr += sent;
+        size -= static_cast<size_t>( sent );
+    }
+}
+
+void CTcpCommunicator::receive( int socket, void* data, size_t size )
+{
+    char* ptr = static_cast<char*>( data );
+    while( size > 0 ) {
+        const ssize_t received = recv( socket, ptr, size, 0 );
+        if( received < 0 && errno == EINTR ) {
+            continue;
+        }
+        // The other process has crashed or hung
+        ASSERT_EXPR( received > 0 );
+        ptr += received;
+        size -= static_cast<size_t>( received );
+    }
+}
+
+void CTcpCommunicator::AllReduce( const CFloatHandle& handle, int size )
+{
+    float* data = GetRaw( handle );
+    for( int offset = 0; offset < size; offset += ExchangeChunkSize ) {
+        const int exchangeSize = min( ExchangeChunkSize, size - offset );
+        const size_t byteSize = exchangeSize * sizeof( float );
+        if( process != 0 ) {
+            send( sockets[0], data + offset, byteSize );
+            receive( sockets[0], data + offset, byteSize );
+            continue;
+        }
+
+        buffer.resize( exchangeSize );
+        for( int i = 1; i < count; i++ ) {
+            receive( sockets[i], buffer.data(), byteSize );
+            vectorAdd( data + offset, buffer.data(), data + offset, exchangeSize );
+        }
+        vectorMultiply( data + offset, data + offset, 1.f / count, exchangeSize );
+        for( int i = 1; i < count; i++ ) {
+            send( sockets[i], data + offset, byteSize );
+        }
+    }
+}
+
+void CTcpCommunicator::Broadcast( const CFloatHandle& handle, int size, int root )
+{
+    float* data = GetRaw( handle );
+    const size_t byteSize = static_cast<size_t>( size ) * sizeof( float );
+    if( process != 0 ) {
+        if( process == root ) {
+            send( sockets[0], data, byteSize );
+        } else {
+            receive( sockets[0], data, byteSize );
+        }
+        return;
+    }
+
+    if( root != 0 ) {
+        receive( sockets[root], data, byteSize );
+    }
+    for( int i = 1; i < count; i++ ) {
+        if( i != root ) {
+            send( sockets[i], data, byteSize );
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------
+
+ICpuDistributedCommunicator* CreateMultiProcessDistributedCommunicator( const char* name, int tcpPort,
+    int process, int count, TDistributedTransport transport )
+{
+    const bool useSharedMemory = transport != DT_Tcp;
+    const bool useTcp = transport != DT_SharedMemory;
+
+    if( process == 0 ) {
+        // The 0th process chooses the transport, the others use the one which is available
+        if( useSharedMemory ) {
+            std::unique_ptr<CSharedMemoryCommunicator> sharedMemory( new CSharedMemoryCommunicator( name, process, count ) );
+            if( sharedMemory->Create() ) {
+                // The other processes have not joined: they have crashed or hung
+                const bool isStarted = sharedMemory->WaitForAll();
+                ASSERT_EXPR( isStarted );
+                return sharedMemory.release();
+            }
+        }
+        if( useTcp ) {
+            std::unique_ptr<CTcpCommunicator> tcp( new CTcpCommunicator( process, count ) );
+            if( tcp->Listen( tcpPort ) ) {
+                return tcp.release();
+            }
+        }
+        return nullptr;
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds( DistributedTimeoutSeconds );
+    while( std::chrono::steady_clock::now() < deadline ) {
+        if( useSharedMemory ) {
+            std::unique_ptr<CSharedMemoryCommunicator> sharedMemory( new CSharedMemoryCommunicator( name, process, count ) );
+            // The segment of a crashed session is revoked by the 0th process of the new one
+            if( sharedMemory->TryOpen() && sharedMemory->WaitForAll() ) {
+                return sharedMemory.release();
+            }
+        }
+        if( useTcp ) {
+            std::unique_ptr<CTcpCommunicator> tcp( new CTcpCommunicator( process, count ) );
+            if( tcp->TryConnect( tcpPort ) ) {
+                return tcp.release();
+            }
+        }
+        std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+    }
+    return nullptr;
+}
+
+} // namespace NeoML
+
+#else // FINE_PLATFORM( FINE_LINUX ) || FINE_PLATFORM( FINE_DARWIN )
+
+namespace NeoML {
+
+ICpuDistributedCommunicator* CreateMultiProcessDistributedCommunicator( const char*, int, int, int,
+    TDistributedTransport )
+{
+    return nullptr;
+}
+
+} // namespace NeoML
+
+#endif // FINE_PLATFORM( FINE_LINUX ) || FINE_PLATFORM( FINE_DARWIN )
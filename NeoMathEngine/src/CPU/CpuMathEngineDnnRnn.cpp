@@ -0,0 +1,706 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <common.h>
+#pragma hdrstop
+
+#include <cmath>
+
+#include <CpuMathEngine.h>
+#include <CpuExecutionScope.h>
+#include <CpuMathEngineOmp.h>
+#include <MemoryHandleInternal.h>
+#include <MathEngineCommon.h>
+#include <CpuMathEnginePrivate.h>
+
+namespace NeoML {
+
+// The number of gates in LSTM: main, forget, input, output
+static const int LstmGateCount = 4;
+// The number of gates in GRU: update, reset, main
+static const int GruGateCount = 3;
+
+// Exponent limited to avoid overflow
+static inline float rnnExp( float x )
+{
+	return expf( min( max( x, -87.f ), 88.f ) );
+}
+
+static inline float rnnSigmoid( float x )
+{
+	return 1.f / ( 1.f + rnnExp( -x ) );
+}
+
+static inline float rnnTanh( float x )
+{
+	return 2.f / ( 1.f + rnnExp( -2.f * x ) ) - 1.f;
+}
+
+// Applies the activations to the LSTM gates of the given hidden units and calculates the new state
+// The gates contain the pre-activation values on entry and the activated values on exit
+static void lstmStep( float* gates, const float* prevCell, int batchSize, int hiddenSize,
+	int unitStart, int unitCount, float* hidden, float* cell )
+{
+	const int gatesSize = LstmGateCount * hiddenSize;
+	const int unitEnd = unitStart + unitCount;
+	for( int b = 0; b < batchSize; ++b ) {
+		float* main = gates + b * gatesSize;
+		float* forget = main + hiddenSize;
+		float* input = forget + hiddenSize;
+		float* output = input + hiddenSize;
+		const float* c = prevCell == nullptr ? nullptr : prevCell + b * hiddenSize;
+		float* newCell = cell + b * hiddenSize;
+		float* newHidden = hidden + b * hiddenSize;
+		for( int i = unitStart; i < unitEnd; ++i ) {
+			main[i] = rnnTanh( main[i] );
+			forget[i] = rnnSigmoid( forget[i] );
+			input[i] = rnnSigmoid( input[i] );
+			output[i] = rnnSigmoid( output[i] );
+			newCell[i] = input[i] * main[i] + ( c == nullptr ? 0.f : forget[i] * c[i] );
+			newHidden[i] = output[i] * rnnTanh( newCell[i] );
+		}
+	}
+}
+
+// Calculates the diffs of the LSTM gates pre-activation values for the given hidden units
+// hiddenDiff and cellDiff contain the diffs from the next step on entry,
+// cellDiff contains the diff of the previous cell on exit
+static void lstmStepBackward( const float* gates, const float* prevCell, const float* cell,
+	const float* outputHiddenDiff, const float* outputCellDiff, int batchSize, int hiddenSize,
+	int unitStart, int unitCount, const float* hiddenDiff, float* cellDiff, float* gatesDiff )
+{
+	const int gatesSize = LstmGateCount * hiddenSize;
+	const int unitEnd = unitStart + unitCount;
+	for( int b = 0; b < batchSize; ++b ) {
+		const float* main = gates + b * gatesSize;
+		const float* forget = main + hiddenSize;
+		const float* input = forget + hiddenSize;
+		const float* output = input + hiddenSize;
+		float* mainDiff = gatesDiff + b * gatesSize;
+		float* forgetDiff = mainDiff + hiddenSize;
+		float* inputDiff = forgetDiff + hiddenSize;
+		float* outputDiff = inputDiff + hiddenSize;
+		const float* c = prevCell == nullptr ? nullptr : prevCell + b * hiddenSize;
+		const float* newCell = cell + b * hiddenSize;
+		const float* outH = outputHiddenDiff + b * hiddenSize;
+		const float* outC = outputCellDiff == nullptr ? nullptr : outputCellDiff + b * hiddenSize;
+		const float* hDiff = hiddenDiff + b * hiddenSize;
+		float* cDiff = cellDiff + b * hiddenSize;
+		for( int i = unitStart; i < unitEnd; ++i ) {
+			const float tanhCell = rnnTanh( newCell[i] );
+			const float h = outH[i] + hDiff[i];
+			const float cd = cDiff[i] + ( outC == nullptr ? 0.f : outC[i] )
+				+ h * output[i] * ( 1.f - tanhCell * tanhCell );
+			outputDiff[i] = h * tanhCell * output[i] * ( 1.f - output[i] );
+			forgetDiff[i] = c == nullptr ? 0.f : cd * c[i] * forget[i] * ( 1.f - forget[i] );
+			inputDiff[i] = cd * main[i] * input[i] * ( 1.f - input[i] );
+			mainDiff[i] = cd * input[i] * ( 1.f - main[i] * main[i] );
+			cDiff[i] = cd * forget[i];
+		}
+	}
+}
+
+// The positions of the current and the previous step in the sequence
+static inline void getRnnStepPositions( bool reverse, int sequenceLength, int step, int& pos, int& prevPos )
+{
+	pos = reverse ? sequenceLength - 1 - step : step;
+	prevPos = reverse ? pos + 1 : pos - 1;
+}
+
+void CCpuMathEngine::LstmSequence( bool reverse, int sequenceLength, int batchSize, int inputSize, int hiddenSize,
+	const CConstFloatHandle& inputHandle, const CConstFloatHandle& inputWeightsHandle,
+	const CConstFloatHandle& recurWeightsHandle, const CConstFloatHandle& inputFreeTermHandle,
+	const CConstFloatHandle& recurFreeTermHandle, const CConstFloatHandle& initialHiddenHandle,
+	const CConstFloatHandle& initialCellHandle, const CFloatHandle& gatesHandle, const CFloatHandle& hiddenHandle,
+	const CFloatHandle& cellHandle )
+{
+	ASSERT_EXPR( sequenceLength >= 1 );
+	ASSERT_EXPR( batchSize >= 1 );
+	ASSERT_EXPR( inputSize >= 1 );
+	ASSERT_EXPR( hiddenSize >= 1 );
+	ASSERT_EXPR( inputHandle.GetMathEngine() == this );
+	ASSERT_EXPR( inputWeightsHandle.GetMathEngine() == this );
+	ASSERT_EXPR( recurWeightsHandle.GetMathEngine() == this );
+	ASSERT_EXPR( inputFreeTermHandle.IsNull() || inputFreeTermHandle.GetMathEngine() == this );
+	ASSERT_EXPR( recurFreeTermHandle.IsNull() || recurFreeTermHandle.GetMathEngine() == this );
+	ASSERT_EXPR( initialHiddenHandle.IsNull() || initialHiddenHandle.GetMathEngine() == this );
+	ASSERT_EXPR( initialCellHandle.IsNull() || initialCellHandle.GetMathEngine() == this );
+	ASSERT_EXPR( gatesHandle.IsNull() || gatesHandle.GetMathEngine() == this );
+	ASSERT_EXPR( hiddenHandle.GetMathEngine() == this );
+	ASSERT_EXPR( cellHandle.GetMathEngine() == this );
+	CCpuExecutionScope scope;
+
+	const int gatesSize = LstmGateCount * hiddenSize;
+	const int stateSize = batchSize * hiddenSize;
+
+	// The gates are stored in the temporary buffer if they are not needed for backward
+	CFloatHandleStackVar gatesBuffer( *this, gatesHandle.IsNull() ? sequenceLength * batchSize * gatesSize : 1 );
+	float* gates = GetRaw( gatesHandle.IsNull() ? gatesBuffer.GetHandle() : gatesHandle );
+
+	// Both free terms are added together with the input projection
+	CFloatHandleStackVar freeTermBuffer( *this, gatesSize );
+	const float* freeTerm = nullptr;
+	if( !inputFreeTermHandle.IsNull() && !recurFreeTermHandle.IsNull() ) {
+		vectorAdd( GetRaw( inputFreeTermHandle ), GetRaw( recurFreeTermHandle ), GetRaw( freeTermBuffer.GetHandle() ),
+			gatesSize );
+		freeTerm = GetRaw( freeTermBuffer.GetHandle() );
+	} else if( !inputFreeTermHandle.IsNull() ) {
+		freeTerm = GetRaw( inputFreeTermHandle );
+	} else if( !recurFreeTermHandle.IsNull() ) {
+		freeTerm = GetRaw( recurFreeTermHandle );
+	}
+
+	// The input projection for the whole sequence in one matrix multiplication
+	rnnMultiplyMatrixByTransposedMatrix( GetRaw( inputHandle ), sequenceLength * batchSize, inputSize, inputSize,
+		GetRaw( inputWeightsHandle ), gatesSize, inputSize, freeTerm, gates, gatesSize );
+
+	const float* recurWeights = GetRaw( recurWeightsHandle );
+	const float* initialHidden = initialHiddenHandle.IsNull() ? nullptr : GetRaw( initialHiddenHandle );
+	const float* initialCell = initialCellHandle.IsNull() ? nullptr : GetRaw( initialCellHandle );
+	float* hidden = GetRaw( hiddenHandle );
+	float* cell = GetRaw( cellHandle );
+
+	// The hidden units are split between the threads; each thread multiplies its part of the recurrent weights
+	// and applies the activations to the result right away
+	const int curThreadCount = IsOmpRelevant( hiddenSize,
+		static_cast<int64_t>( sequenceLength ) * batchSize * gatesSize * hiddenSize ) ? threadCount : 1;
+	NEOML_OMP_NUM_THREADS( curThreadCount )
+	{
+		int unitStart;
+		int unitCount;
+		const bool hasUnits = OmpGetTaskIndexAndCount( hiddenSize, unitStart, unitCount );
+		for( int step = 0; step < sequenceLength; ++step ) {
+			int pos;
+			int prevPos;
+			getRnnStepPositions( reverse, sequenceLength, step, pos, prevPos );
+			const float* prevHidden = step == 0 ? initialHidden : hidden + prevPos * stateSize;
+			const float* prevCell = step == 0 ? initialCell : cell + prevPos * stateSize;
+			float* stepGates = gates + pos * batchSize * gatesSize;
+
+			if( hasUnits ) {
+				if( prevHidden != nullptr ) {
+					for( int gate = 0; gate < LstmGateCount; ++gate ) {
+						multiplyMatrixByTransposedMatrixAndAdd( prevHidden, batchSize, hiddenSize, hiddenSize,
+							recurWeights + ( gate * hiddenSize + unitStart ) * hiddenSize, unitCount, hiddenSize,
+							stepGates + gate * hiddenSize + unitStart, gatesSize );
+					}
+				}
+				lstmStep( stepGates, prevCell, batchSize, hiddenSize, unitStart, unitCount,
+					hidden + pos * stateSize, cell + pos * stateSize );
+			}
+
+			if( curThreadCount > 1 ) {
+#pragma omp barrier
+			}
+		}
+	}
+}
+
+void CCpuMathEngine::LstmSequenceBackward( bool reverse, int sequenceLength, int batchSize, int inputSize,
+	int hiddenSize, const CConstFloatHandle& inputHandle, const CConstFloatHandle& inputWeightsHandle,
+	const CConstFloatHandle& recurWeightsHandle, const CConstFloatHandle& initialHiddenHandle,
+	const CConstFloatHandle& initialCellHandle, const CConstFloatHandle& gatesHandle,
+	const CConstFloatHandle& hiddenHandle, const CConstFloatHandle& cellHandle,
+	const CConstFloatHandle& hiddenDiffHandle, const CConstFloatHandle& cellDiffHandle,
+	const CFloatHandle& inputDiffHandle, const CFloatHandle& inputWeightsDiffHandle,
+	const CFloatHandle& recurWeightsDiffHandle, const CFloatHandle& freeTermDiffHandle )
+{
+	ASSERT_EXPR( sequenceLength >= 1 );
+	ASSERT_EXPR( batchSize >= 1 );
+	ASSERT_EXPR( inputSize >= 1 );
+	ASSERT_EXPR( hiddenSize >= 1 );
+	ASSERT_EXPR( inputHandle.GetMathEngine() == this );
+	ASSERT_EXPR( inputWeightsHandle.GetMathEngine() == this );
+	ASSERT_EXPR( recurWeightsHandle.GetMathEngine() == this );
+	ASSERT_EXPR( initialHiddenHandle.IsNull() || initialHiddenHandle.GetMathEngine() == this );
+	ASSERT_EXPR( initialCellHandle.IsNull() || initialCellHandle.GetMathEngine() == this );
+	ASSERT_EXPR( gatesHandle.GetMathEngine() == this );
+	ASSERT_EXPR( hiddenHandle.GetMathEngine() == this );
+	ASSERT_EXPR( cellHandle.GetMathEngine() == this );
+	ASSERT_EXPR( hiddenDiffHandle.GetMathEngine() == this );
+	ASSERT_EXPR( cellDiffHandle.IsNull() || cellDiffHandle.GetMathEngine() == this );
+	ASSERT_EXPR( inputDiffHandle.IsNull() || inputDiffHandle.GetMathEngine() == this );
+	ASSERT_EXPR( inputWeightsDiffHandle.IsNull() || inputWeightsDiffHandle.GetMathEngine() == this );
+	ASSERT_EXPR( recurWeightsDiffHandle.IsNull() || recurWeightsDiffHandle.GetMathEngine() == this );
+	ASSERT_EXPR( freeTermDiffHandle.IsNull() || freeTermDiffHandle.GetMathEngine() == this );
+	CCpuExecutionScope scope;
+
+	const int gatesSize = LstmGateCount * hiddenSize;
+	const int stateSize = batchSize * hiddenSize;
+	const int rowCount = sequenceLength * batchSize;
+
+	CFloatHandleStackVar gatesDiffBuffer( *this, rowCount * gatesSize );
+	CFloatHandleStackVar stateDiffBuffer( *this, 2 * stateSize );
+	float* gatesDiff = GetRaw( gatesDiffBuffer.GetHandle() );
+	float* hiddenDiff = GetRaw( stateDiffBuffer.GetHandle() );
+	float* cellDiff = hiddenDiff + stateSize;
+	vectorFill( hiddenDiff, 0.f, 2 * stateSize );
+
+	const float* recurWeights = GetRaw( recurWeightsHandle );
+	const float* initialCell = initialCellHandle.IsNull() ? nullptr : GetRaw( initialCellHandle );
+	const float* gates = GetRaw( gatesHandle );
+	const float* hidden = GetRaw( hiddenHandle );
+	const float* cell = GetRaw( cellHandle );
+	const float* outputHiddenDiff = GetRaw( hiddenDiffHandle );
+	const float* outputCellDiff = cellDiffHandle.IsNull() ? nullptr : GetRaw( cellDiffHandle );
+
+	// The steps are processed in the reverse order; the diffs of the gates are kept for the whole sequence
+	// so that the weights diffs are calculated in several large matrix multiplications afterwards
+	const int curThreadCount = IsOmpRelevant( hiddenSize,
+		static_cast<int64_t>( sequenceLength ) * batchSize * gatesSize * hiddenSize ) ? threadCount : 1;
+	NEOML_OMP_NUM_THREADS( curThreadCount )
+	{
+		int unitStart;
+		int unitCount;
+		const bool hasUnits = OmpGetTaskIndexAndCount( hiddenSize, unitStart, unitCount );
+		for( int step = sequenceLength - 1; step >= 0; --step ) {
+			int pos;
+			int prevPos;
+			getRnnStepPositions( reverse, sequenceLength, step, pos, prevPos );
+			const float* prevCell = step == 0 ? initialCell : cell + prevPos * stateSize;
+			float* stepGatesDiff = gatesDiff + pos * batchSize * gatesSize;
+
+			if( hasUnits ) {
+				lstmStepBackward( gates + pos * batchSize * gatesSize, prevCell, cell + pos * stateSize,
+					outputHiddenDiff + pos * stateSize, outputCellDiff == nullptr ? nullptr : outputCellDiff + pos * stateSize,
+					batchSize, hiddenSize, unitStart, unitCount, hiddenDiff, cellDiff, stepGatesDiff );
+			}
+
+			if( curThreadCount > 1 ) {
+#pragma omp barrier
+			}
+
+			if( hasUnits && step > 0 ) {
+				// The diff of the previous hidden state
+				multiplyMatrixByMatrix( stepGatesDiff, batchSize, gatesSize, gatesSize,
+					recurWeights + unitStart, unitCount, hiddenSize, hiddenDiff + unitStart, hiddenSize );
+			}
+		}
+	}
+
+	const float* input = GetRaw( inputHandle );
+	if( !inputDiffHandle.IsNull() ) {
+		rnnMultiplyMatrixByMatrix( false, gatesDiff, rowCount, gatesSize, gatesSize,
+			GetRaw( inputWeightsHandle ), inputSize, inputSize, GetRaw( inputDiffHandle ), inputSize );
+	}
+	if( !inputWeightsDiffHandle.IsNull() ) {
+		rnnMultiplyTransposedMatrixByMatrixAndAdd( gatesDiff, rowCount, gatesSize, gatesSize,
+			input, inputSize, inputSize, GetRaw( inputWeightsDiffHandle ), inputSize );
+	}
+	if( !recurWeightsDiffHandle.IsNull() ) {
+		rnnAddRecurrentWeightsDiff( reverse, sequenceLength, batchSize, hiddenSize, gatesDiff, gatesSize, gatesSize,
+			hidden, initialHiddenHandle.IsNull() ? nullptr : GetRaw( initialHiddenHandle ),
+			GetRaw( recurWeightsDiffHandle ), hiddenSize );
+	}
+	if( !freeTermDiffHandle.IsNull() ) {
+		float* freeTermDiff = GetRaw( freeTermDiffHandle );
+		for( int row = 0; row < rowCount; ++row ) {
+			vectorAdd( freeTermDiff, gatesDiff + row * gatesSize, freeTermDiff, gatesSize );
+		}
+	}
+}
+
+//------------------------------------------------------------------------------------------------------------
+
+// Applies the activations to the GRU update and reset gates of the given hidden units
+// and calculates the reset hidden state
+static void gruGatesStep( float* gates, const float* prevHidden, int batchSize, int hiddenSize,
+	int unitStart, int unitCount, float* resetHidden )
+{
+	const int gatesSize = GruGateCount * hiddenSize;
+	const int unitEnd = unitStart + unitCount;
+	for( int b = 0; b < batchSize; ++b ) {
+		float* update = gates + b * gatesSize;
+		float* reset = update + hiddenSize;
+		const float* h = prevHidden == nullptr ? nullptr : prevHidden + b * hiddenSize;
+		float* rh = resetHidden + b * hiddenSize;
+		for( int i = unitStart; i < unitEnd; ++i ) {
+			update[i] = rnnSigmoid( update[i] );
+			reset[i] = rnnSigmoid( reset[i] );
+			rh[i] = h == nullptr ? 0.f : reset[i] * h[i];
+		}
+	}
+}
+
+// Applies the activation to the GRU main gate of the given hidden units and calculates the new state
+static void gruMainStep( float* gates, const float* prevHidden, int batchSize, int hiddenSize,
+	int unitStart, int unitCount, float* hidden )
+{
+	const int gatesSize = GruGateCount * hiddenSize;
+	const int unitEnd = unitStart + unitCount;
+	for( int b = 0; b < batchSize; ++b ) {
+		const float* update = gates + b * gatesSize;
+		float* main = gates + b * gatesSize + 2 * hiddenSize;
+		const float* h = prevHidden == nullptr ? nullptr : prevHidden + b * hiddenSize;
+		float* newHidden = hidden + b * hiddenSize;
+		for( int i = unitStart; i < unitEnd; ++i ) {
+			main[i] = rnnTanh( main[i] );
+			newHidden[i] = ( 1.f - update[i] ) * main[i] + ( h == nullptr ? 0.f : update[i] * h[i] );
+		}
+	}
+}
+
+void CCpuMathEngine::GruSequence( bool reverse, int sequenceLength, int batchSize, int inputSize, int hiddenSize,
+	const CConstFloatHandle& inputHandle, const CConstFloatHandle& gateWeightsHandle,
+	const CConstFloatHandle& gateFreeTermHandle, const CConstFloatHandle& mainWeightsHandle,
+	const CConstFloatHandle& mainFreeTermHandle, const CConstFloatHandle& initialHiddenHandle,
+	const CFloatHandle& gatesHandle, const CFloatHandle& hiddenHandle )
+{
+	ASSERT_EXPR( sequenceLength >= 1 );
+	ASSERT_EXPR( batchSize >= 1 );
+	ASSERT_EXPR( inputSize >= 1 );
+	ASSERT_EXPR( hiddenSize >= 1 );
+	ASSERT_EXPR( inputHandle.GetMathEngine() == this );
+	ASSERT_EXPR( gateWeightsHandle.GetMathEngine() == this );
+	ASSERT_EXPR( gateFreeTermHandle.IsNull() || gateFreeTermHandle.GetMathEngine() == this );
+	ASSERT_EXPR( mainWeightsHandle.GetMathEngine() == this );
+	ASSERT_EXPR( mainFreeTermHandle.IsNull() || mainFreeTermHandle.GetMathEngine() == this );
+	ASSERT_EXPR( initialHiddenHandle.IsNull() || initialHiddenHandle.GetMathEngine() == this );
+	ASSERT_EXPR( gatesHandle.IsNull() || gatesHandle.GetMathEngine() == this );
+	ASSERT_EXPR( hiddenHandle.GetMathEngine() == this );
+	CCpuExecutionScope scope;
+
+	const int gatesSize = GruGateCount * hiddenSize;
+	const int stateSize = batchSize * hiddenSize;
+	const int weightsRowSize = inputSize + hiddenSize;
+	const int rowCount = sequenceLength * batchSize;
+
+	CFloatHandleStackVar gatesBuffer( *this, gatesHandle.IsNull() ? rowCount * gatesSize : 1 );
+	float* gates = GetRaw( gatesHandle.IsNull() ? gatesBuffer.GetHandle() : gatesHandle );
+	CFloatHandleStackVar resetHiddenBuffer( *this, stateSize );
+	float* resetHidden = GetRaw( resetHiddenBuffer.GetHandle() );
+
+	const float* input = GetRaw( inputHandle );
+	const float* gateWeights = GetRaw( gateWeightsHandle );
+	const float* mainWeights = GetRaw( mainWeightsHandle );
+
+	// The input projections for the whole sequence
+	rnnMultiplyMatrixByTransposedMatrix( input, rowCount, inputSize, inputSize, gateWeights, 2 * hiddenSize,
+		weightsRowSize, gateFreeTermHandle.IsNull() ? nullptr : GetRaw( gateFreeTermHandle ), gates, gatesSize );
+	rnnMultiplyMatrixByTransposedMatrix( input, rowCount, inputSize, inputSize, mainWeights, hiddenSize,
+		weightsRowSize, mainFreeTermHandle.IsNull() ? nullptr : GetRaw( mainFreeTermHandle ),
+		gates + 2 * hiddenSize, gatesSize );
+
+	const float* initialHidden = initialHiddenHandle.IsNull() ? nullptr : GetRaw( initialHiddenHandle );
+	float* hidden = GetRaw( hiddenHandle );
+
+	// The main gate depends on the reset gate of all the units, so each step has two stages
+	const int curThreadCount = IsOmpRelevant( hiddenSize,
+		static_cast<int64_t>( sequenceLength ) * batchSize * gatesSize * hiddenSize ) ? threadCount : 1;
+	NEOML_OMP_NUM_THREADS( curThreadCount )
+	{
+		int unitStart;
+		int unitCount;
+		const bool hasUnits = OmpGetTaskIndexAndCount( hiddenSize, unitStart, unitCount );
+		for( int step = 0; step < sequenceLength; ++step ) {
+			int pos;
+			int prevPos;
+			getRnnStepPositions( reverse, sequenceLength, step, pos, prevPos );
+			const float* prevHidden = step == 0 ? initialHidden : hidden + prevPos * stateSize;
+			float* stepGates = gates + pos * batchSize * gatesSize;
+
+			if( hasUnits ) {
+				if( prevHidden != nullptr ) {
+					for( int gate = 0; gate < 2; ++gate ) {
+						multiplyMatrixByTransposedMatrixAndAdd( prevHidden, batchSize, hiddenSize, hiddenSize,
+							gateWeights + ( gate * hiddenSize + unitStart ) * weightsRowSize + inputSize, unitCount,
+							weightsRowSize, stepGates + gate * hiddenSize + unitStart, gatesSize );
+					}
+				}
+				gruGatesStep( stepGates, prevHidden, batchSize, hiddenSize, unitStart, unitCount, resetHidden );
+			}
+
+			if( curThreadCount > 1 ) {
+#pragma omp barrier
+			}
+
+			if( hasUnits ) {
+				if( prevHidden != nullptr ) {
+					multiplyMatrixByTransposedMatrixAndAdd( resetHidden, batchSize, hiddenSize, hiddenSize,
+						mainWeights + unitStart * weightsRowSize + inputSize, unitCount, weightsRowSize,
+						stepGates + 2 * hiddenSize + unitStart, gatesSize );
+				}
+				gruMainStep( stepGates, prevHidden, batchSize, hiddenSize, unitStart, unitCount, hidden + pos * stateSize );
+			}
+
+			if( curThreadCount > 1 ) {
+#pragma omp barrier
+			}
+		}
+	}
+}
+
+// Calculates the diffs of the GRU update and main gates pre-activation values for the given hidden units
+// hiddenDiff contains the diff from the next step on entry and the part of the previous state diff on exit
+static void gruStepBackward( const float* gates, const float* prevHidden, const float* outputHiddenDiff,
+	int batchSize, int hiddenSize, int unitStart, int unitCount, float* hiddenDiff, float* gatesDiff,
+	float* resetHidden )
+{
+	const int gatesSize = GruGateCount * hiddenSize;
+	const int unitEnd = unitStart + unitCount;
+	for( int b = 0; b < batchSize; ++b ) {
+		const float* update = gates + b * gatesSize;
+		const float* reset = update + hiddenSize;
+		const float* main = reset + hiddenSize;
+		float* updateDiff = gatesDiff + b * gatesSize;
+		float* mainDiff = updateDiff + 2 * hiddenSize;
+		const float* h = prevHidden == nullptr ? nullptr : prevHidden + b * hiddenSize;
+		const float* outH = outputHiddenDiff + b * hiddenSize;
+		float* hDiff = hiddenDiff + b * hiddenSize;
+		float* rh = resetHidden + b * hiddenSize;
+		for( int i = unitStart; i < unitEnd; ++i ) {
+			const float prev = h == nullptr ? 0.f : h[i];
+			const float diff = outH[i] + hDiff[i];
+			mainDiff[i] = diff * ( 1.f - update[i] ) * ( 1.f - main[i] * main[i] );
+			updateDiff[i] = diff * ( prev - main[i] ) * update[i] * ( 1.f - update[i] );
+			hDiff[i] = diff * update[i];
+			rh[i] = reset[i] * prev;
+		}
+	}
+}
+
+// Calculates the diff of the GRU reset gate pre-activation values for the given hidden units
+// and adds the reset hidden state part to the previous state diff
+static void gruResetStepBackward( const float* gates, const float* prevHidden, const float* resetHiddenDiff,
+	int batchSize, int hiddenSize, int unitStart, int unitCount, float* hiddenDiff, float* gatesDiff )
+{
+	const int gatesSize = GruGateCount * hiddenSize;
+	const int unitEnd = unitStart + unitCount;
+	for( int b = 0; b < batchSize; ++b ) {
+		const float* reset = gates + b * gatesSize + hiddenSize;
+		float* resetDiff = gatesDiff + b * gatesSize + hiddenSize;
+		const float* h = prevHidden == nullptr ? nullptr : prevHidden + b * hiddenSize;
+		const float* rhDiff = resetHiddenDiff + b * hiddenSize;
+		float* hDiff = hiddenDiff + b * hiddenSize;
+		for( int i = unitStart; i < unitEnd; ++i ) {
+			const float prev = h == nullptr ? 0.f : h[i];
+			resetDiff[i] = rhDiff[i] * prev * reset[i] * ( 1.f - reset[i] );
+			hDiff[i] += rhDiff[i] * reset[i];
+		}
+	}
+}
+
+void CCpuMathEngine::GruSequenceBackward( bool reverse, int sequenceLength, int batchSize, int inputSize,
+	int hiddenSize, const CConstFloatHandle& inputHandle, const CConstFloatHandle& gateWeightsHandle,
+	const CConstFloatHandle& mainWeightsHandle, const CConstFloatHandle& initialHiddenHandle,
+	const CConstFloatHandle& gatesHandle, const CConstFloatHandle& hiddenHandle, const CConstFloatHandle& hiddenDiffHandle,
+	const CFloatHandle& inputDiffHandle, const CFloatHandle& gateWeightsDiffHandle,
+	const CFloatHandle& gateFreeTermDiffHandle, const CFloatHandle& mainWeightsDiffHandle,
+	const CFloatHandle& mainFreeTermDiffHandle )
+{
+	ASSERT_EXPR( sequenceLength >= 1 );
+	ASSERT_EXPR( batchSize >= 1 );
+	ASSERT_EXPR( inputSize >= 1 );
+	ASSERT_EXPR( hiddenSize >= 1 );
+	ASSERT_EXPR( inputHandle.GetMathEngine() == this );
+	ASSERT_EXPR( gateWeightsHandle.GetMathEngine() == this );
+	ASSERT_EXPR( mainWeightsHandle.GetMathEngine() == this );
+	ASSERT_EXPR( initialHiddenHandle.IsNull() || initialHiddenHandle.GetMathEngine() == this );
+	ASSERT_EXPR( gatesHandle.GetMathEngine() == this );
+	ASSERT_EXPR( hiddenHandle.GetMathEngine() == this );
+	ASSERT_EXPR( hiddenDiffHandle.GetMathEngine() == this );
+	ASSERT_EXPR( inputDiffHandle.IsNull() || inputDiffHandle.GetMathEngine() == this );
+	ASSERT_EXPR( gateWeightsDiffHandle.IsNull() || gateWeightsDiffHandle.GetMathEngine() == this );
+	ASSERT_EXPR( gateFreeTermDiffHandle.IsNull() || gateFreeTermDiffHandle.GetMathEngine() == this );
+	ASSERT_EXPR( mainWeightsDiffHandle.IsNull() || mainWeightsDiffHandle.GetMathEngine() == this );
+	ASSERT_EXPR( mainFreeTermDiffHandle.IsNull() || mainFreeTermDiffHandle.GetMathEngine() == this );
+	CCpuExecutionScope scope;
+
+	const int gatesSize = GruGateCount * hiddenSize;
+	const int stateSize = batchSize * hiddenSize;
+	const int weightsRowSize = inputSize + hiddenSize;
+	const int rowCount = sequenceLength * batchSize;
+
+	// The reset hidden states are kept for the whole sequence for the main weights diff
+	CFloatHandleStackVar gatesDiffBuffer( *this, rowCount * gatesSize );
+	CFloatHandleStackVar resetHiddenBuffer( *this, rowCount * hiddenSize );
+	CFloatHandleStackVar stateDiffBuffer( *this, 2 * stateSize );
+	float* gatesDiff = GetRaw( gatesDiffBuffer.GetHandle() );
+	float* resetHidden = GetRaw( resetHiddenBuffer.GetHandle() );
+	float* hiddenDiff = GetRaw( stateDiffBuffer.GetHandle() );
+	float* resetHiddenDiff = hiddenDiff + stateSize;
+	vectorFill( hiddenDiff, 0.f, stateSize );
+
+	const float* gateWeights = GetRaw( gateWeightsHandle );
+	const float* mainWeights = GetRaw( mainWeightsHandle );
+	const float* initialHidden = initialHiddenHandle.IsNull() ? nullptr : GetRaw( initialHiddenHandle );
+	const float* gates = GetRaw( gatesHandle );
+	const float* hidden = GetRaw( hiddenHandle );
+	const float* outputHiddenDiff = GetRaw( hiddenDiffHandle );
+
+	const int curThreadCount = IsOmpRelevant( hiddenSize,
+		static_cast<int64_t>( sequenceLength ) * batchSize * gatesSize * hiddenSize ) ? threadCount : 1;
+	NEOML_OMP_NUM_THREADS( curThreadCount )
+	{
+		int unitStart;
+		int unitCount;
+		const bool hasUnits = OmpGetTaskIndexAndCount( hiddenSize, unitStart, unitCount );
+		for( int step = sequenceLength - 1; step >= 0; --step ) {
+			int pos;
+			int prevPos;
+			getRnnStepPositions( reverse, sequenceLength, step, pos, prevPos );
+			const float* prevHidden = step == 0 ? initialHidden : hidden + prevPos * stateSize;
+			const float* stepGates = gates + pos * batchSize * gatesSize;
+			float* stepGatesDiff = gatesDiff + pos * batchSize * gatesSize;
+
+			if( hasUnits ) {
+				gruStepBackward( stepGates, prevHidden, outputHiddenDiff + pos * stateSize, batchSize, hiddenSize,
+					unitStart, unitCount, hiddenDiff, stepGatesDiff, resetHidden + pos * stateSize );
+			}
+
+			if( curThreadCount > 1 ) {
+#pragma omp barrier
+			}
+
+			if( hasUnits ) {
+				// The diff of the reset hidden state
+				multiplyMatrixByMatrix( stepGatesDiff + 2 * hiddenSize, batchSize, hiddenSize, gatesSize,
+					mainWeights + inputSize + unitStart, unitCount, weightsRowSize, resetHiddenDiff + unitStart, hiddenSize );
+				gruResetStepBackward( stepGates, prevHidden, resetHiddenDiff, batchSize, hiddenSize,
+					unitStart, unitCount, hiddenDiff, stepGatesDiff );
+			}
+
+			if( curThreadCount > 1 ) {
+#pragma omp barrier
+			}
+
+			if( hasUnits && step > 0 ) {
+				// The gates part of the previous hidden state diff
+				multiplyMatrixByMatrixAndAdd( stepGatesDiff, batchSize, 2 * hiddenSize, gatesSize,
+					gateWeights + inputSize + unitStart, unitCount, weightsRowSize, hiddenDiff + unitStart, hiddenSize );
+			}
+		}
+	}
+
+	const float* input = GetRaw( inputHandle );
+	if( !inputDiffHandle.IsNull() ) {
+		float* inputDiff = GetRaw( inputDiffHandle );
+		rnnMultiplyMatrixByMatrix( false, gatesDiff, rowCount, 2 * hiddenSize, gatesSize,
+			gateWeights, inputSize, weightsRowSize, inputDiff, inputSize );
+		rnnMultiplyMatrixByMatrix( true, gatesDiff + 2 * hiddenSize, rowCount, hiddenSize, gatesSize,
+			mainWeights, inputSize, weightsRowSize, inputDiff, inputSize );
+	}
+	if( !gateWeightsDiffHandle.IsNull() ) {
+		float* gateWeightsDiff = GetRaw( gateWeightsDiffHandle );
+		rnnMultiplyTransposedMatrixByMatrixAndAdd( gatesDiff, rowCount, 2 * hiddenSize, gatesSize,
+			input, inputSize, inputSize, gateWeightsDiff, weightsRowSize );
+		rnnAddRecurrentWeightsDiff( reverse, sequenceLength, batchSize, hiddenSize, gatesDiff, 2 * hiddenSize, gatesSize,
+			hidden, initialHidden, gateWeightsDiff + inputSize, weightsRowSize );
+	}
+	if( !mainWeightsDiffHandle.IsNull() ) {
+		float* mainWeightsDiff = GetRaw( mainWeightsDiffHandle );
+		rnnMultiplyTransposedMatrixByMatrixAndAdd( gatesDiff + 2 * hiddenSize, rowCount, hiddenSize, gatesSize,
+			input, inputSize, inputSize, mainWeightsDiff, weightsRowSize );
+		rnnMultiplyTransposedMatrixByMatrixAndAdd( gatesDiff + 2 * hiddenSize, rowCount, hiddenSize, gatesSize,
+			resetHidden, hiddenSize, hiddenSize, mainWeightsDiff + inputSize, weightsRowSize );
+	}
+	if( !gateFreeTermDiffHandle.IsNull() ) {
+		float* gateFreeTermDiff = GetRaw( gateFreeTermDiffHandle );
+		for( int row = 0; row < rowCount; ++row ) {
+			vectorAdd( gateFreeTermDiff, gatesDiff + row * gatesSize, gateFreeTermDiff, 2 * hiddenSize );
+		}
+	}
+	if( !mainFreeTermDiffHandle.IsNull() ) {
+		float* mainFreeTermDiff = GetRaw( mainFreeTermDiffHandle );
+		for( int row = 0; row < rowCount; ++row ) {
+			vectorAdd( mainFreeTermDiff, gatesDiff + row * gatesSize + 2 * hiddenSize, mainFreeTermDiff, hiddenSize );
+		}
+	}
+}
+
+//------------------------------------------------------------------------------------------------------------
+
+void CCpuMathEngine::rnnMultiplyMatrixByTransposedMatrix( const float* first, int firstHeight, int firstWidth,
+	int firstRowSize, const float* second, int secondHeight, int secondRowSize, const float* freeTerm,
+	float* result, int resultRowSize )
+{
+	const int curThreadCount = IsOmpRelevant( firstHeight,
+		static_cast<int64_t>( firstHeight ) * firstWidth * secondHeight ) ? threadCount : 1;
+	NEOML_OMP_NUM_THREADS( curThreadCount )
+	{
+		int start;
+		int count;
+		if( OmpGetTaskIndexAndCount( firstHeight, start, count ) ) {
+			float* resultData = result + start * resultRowSize;
+			multiplyMatrixByTransposedMatrix( first + start * firstRowSize, count, firstWidth, firstRowSize,
+				second, secondHeight, secondRowSize, resultData, resultRowSize );
+			if( freeTerm != nullptr ) {
+				for( int i = 0; i < count; ++i ) {
+					vectorAdd( resultData, freeTerm, resultData, secondHeight );
+					resultData += resultRowSize;
+				}
+			}
+		}
+	}
+}
+
+void CCpuMathEngine::rnnMultiplyMatrixByMatrix( bool add, const float* first, int firstHeight, int firstWidth,
+	int firstRowSize, const float* second, int secondWidth, int secondRowSize, float* result, int resultRowSize )
+{
+	const int curThreadCount = IsOmpRelevant( firstHeight,
+		static_cast<int64_t>( firstHeight ) * firstWidth * secondWidth ) ? threadCount : 1;
+	NEOML_OMP_NUM_THREADS( curThreadCount )
+	{
+		int start;
+		int count;
+		if( OmpGetTaskIndexAndCount( firstHeight, start, count ) ) {
+			if( add ) {
+				multiplyMatrixByMatrixAndAdd( first + start * firstRowSize, count, firstWidth, firstRowSize,
+					second, secondWidth, secondRowSize, result + start * resultRowSize, resultRowSize );
+			} else {
+				multiplyMatrixByMatrix( first + start * firstRowSize, count, firstWidth, firstRowSize,
+					second, secondWidth, secondRowSize, result + start * resultRowSize, resultRowSize );
+			}
+		}
+	}
+}
+
+void CCpuMathEngine::rnnMultiplyTransposedMatrixByMatrixAndAdd( const float* first, int firstHeight, int firstWidth,
+	int firstRowSize, const float* second, int secondWidth, int secondRowSize, float* result, int resultRowSize )
+{
+	const int curThreadCount = IsOmpRelevant( firstWidth,
+		static_cast<int64_t>( firstHeight ) * firstWidth * secondWidth ) ? threadCount : 1;
+	NEOML_OMP_NUM_THREADS( curThreadCount )
+	{
+		int start;
+		int count;
+		if( OmpGetTaskIndexAndCount( firstWidth, start, count ) ) {
+			multiplyTransposedMatrixByMatrixAndAdd( first + start, firstHeight, count, firstRowSize,
+				second, secondWidth, secondRowSize, result + start * resultRowSize, resultRowSize );
+		}
+	}
+}
+
+// Adds the sum over the sequence of diff_t^T * h_(t-1)
+void CCpuMathEngine::rnnAddRecurrentWeightsDiff( bool reverse, int sequenceLength, int batchSize, int hiddenSize,
+	const float* diff, int diffWidth, int diffRowSize, const float* hidden, const float* initialHidden,
+	float* result, int resultRowSize )
+{
+	const int stateSize = batchSize * hiddenSize;
+	if( sequenceLength > 1 ) {
+		// The previous states of all the steps except the first one are the shifted outputs
+		const float* shiftedDiff = reverse ? diff : diff + batchSize * diffRowSize;
+		const float* shiftedHidden = reverse ? hidden + stateSize : hidden;
+		rnnMultiplyTransposedMatrixByMatrixAndAdd( shiftedDiff, ( sequenceLength - 1 ) * batchSize, diffWidth,
+			diffRowSize, shiftedHidden, hiddenSize, hiddenSize, result, resultRowSize );
+	}
+	if( initialHidden != nullptr ) {
+		const int firstPos = reverse ? sequenceLength - 1 : 0;
+		multiplyTransposedMatrixByMatrixAndAdd( diff + firstPos * batchSize * diffRowSize, batchSize, diffWidth,
+			diffRowSize, initialHidden, hiddenSize, hiddenSize, result, resultRowSize );
+	}
+}
+
+} // namespace NeoML
@@ -0,0 +1,302 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <common.h>
+#pragma hdrstop
+
+#include <CpuMathEngine.h>
+#include <CpuExecutionScope.h>
+#include <CpuMathEnginePrivate.h>
+#include <MemoryHandleInternal.h>
+#include <NeoMathEngine/NeoMathEngineException.h>
+#include <NeoMathEngine/OpenMP.h>
+#include <cmath>
+
+namespace NeoML {
+
+// The quantized values are symmetric: [-127, 127]
+static const float MaxQuantizedValue = 127.f;
+
+// The number of the first and the second matrix rows processed together
+static const int QuantizedFirstBlockSize = 2;
+static const int QuantizedSecondBlockSize = 4;
+
+static inline int8_t quantize( float value, float multiplier )
+{
+	const float result = std::nearbyint( value * multiplier );
+	return static_cast<int8_t>( min( MaxQuantizedValue, max( -MaxQuantizedValue, result ) ) );
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+
+#ifdef NEOML_USE_SSE
+
+// The products are accumulated in four 32-bit integers
+typedef __m128i CQuantizedSum;
+// 16 values extended to 16-bit integers
+struct CQuantizedVector {
+	__m128i Low;
+	__m128i High;
+};
+
+static const int QuantizedVectorSize = 16;
+
+static inline CQuantizedSum zeroQuantizedSum()
+{
+	return _mm_setzero_si128();
+}
+
+static inline CQuantizedVector loadQuantizedVector( const int8_t* data )
+{
+	const __m128i value = _mm_loadu_si128( reinterpret_cast<const __m128i*>( data ) );
+	const __m128i sign = _mm_cmpgt_epi8( _mm_setzero_si128(), value );
+	CQuantizedVector result;
+	result.Low = _mm_unpacklo_epi8( value, sign );
+	result.High = _mm_unpackhi_epi8( value, sign );
+	return result;
+}
+
+static inline CQuantizedSum quantizedMultiplyAdd( const CQuantizedSum& sum,
+	const CQuantizedVector& first, const CQuantizedVector& second )
+{
+	// The products of [-127, 127] values fit into 16 bits, so the pairwise sums can't overflow
+	return _mm_add_epi32( sum, _mm_add_epi32( _mm_madd_epi16( first.Low, second.Low ),
+		_mm_madd_epi16( first.High, second.High ) ) );
+}
+
+static inline int horizontalQuantizedSum( const CQuantizedSum& sum )
+{
+	__m128i result = _mm_add_epi32( sum, _mm_shuffle_epi32( sum, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+	result = _mm_add_epi32( result, _mm_shuffle_epi32( result, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+	return _mm_cvtsi128_si32( result );
+}
+
+static void vectorQuantize( const float* from, int8_t* to, int vectorSize, float multiplier )
+{
+	const __m128 mult = _mm_set1_ps( multiplier );
+	const __m128 maxValue = _mm_set1_ps( MaxQuantizedValue );
+	const __m128 minValue = _mm_set1_ps( -MaxQuantizedValue );
+
+	int sseSize = vectorSize / 16;
+	for( int i = 0; i < sseSize; ++i ) {
+		__m128i values[4];
+		for( int j = 0; j < 4; ++j ) {
+			const __m128 value = _mm_mul_ps( _mm_loadu_ps( from + 4 * j ), mult );
+			values[j] = _mm_cvtps_epi32( _mm_min_ps( maxValue, _mm_max_ps( minValue, value ) ) );
+		}
+		const __m128i result = _mm_packs_epi16( _mm_packs_epi32( values[0], values[1] ),
+			_mm_packs_epi32( values[2], values[3] ) );
+		_mm_storeu_si128( reinterpret_cast<__m128i*>( to ), result );
+		from += 16;
+		to += 16;
+	}
+
+	for( int i = sseSize * 16; i < vectorSize; ++i ) {
+		*to++ = quantize( *from++, multiplier );
+	}
+}
+
+#elif defined(NEOML_USE_NEON)
+
+// The products are accumulated in four 32-bit integers
+typedef int32x4_t CQuantizedSum;
+struct CQuantizedVector {
+	int8x16_t Value;
+};
+
+static const int QuantizedVectorSize = 16;
+
+static inline CQuantizedSum zeroQuantizedSum()
+{
+	return vdupq_n_s32( 0 );
+}
+
+static inline CQuantizedVector loadQuantizedVector( const int8_t* data )
+{
+	CQuantizedVector result;
+	result.Value = vld1q_s8( data );
+	return result;
+}
+
+static inline CQuantizedSum quantizedMultiplyAdd( const CQuantizedSum& sum,
+	const CQuantizedVector& first, const CQuantizedVector& second )
+{
+	// The products of [-127, 127] values fit into 16 bits
+	CQuantizedSum result = vpadalq_s16( sum, vmull_s8( vget_low_s8( first.Value ), vget_low_s8( second.Value ) ) );
+	return vpadalq_s16( result, vmull_s8( vget_high_s8( first.Value ), vget_high_s8( second.Value ) ) );
+}
+
+static inline int horizontalQuantizedSum( const CQuantizedSum& sum )
+{
+	return vgetq_lane_s32( sum, 0 ) + vgetq_lane_s32( sum, 1 ) + vgetq_lane_s32( sum, 2 ) + vgetq_lane_s32( sum, 3 );
+}
+
+static void vectorQuantize( const float* from, int8_t* to, int vectorSize, float multiplier )
+{
+	for( int i = 0; i < vectorSize; ++i ) {
+		to[i] = quantize( from[i], multiplier );
+	}
+}
+
+#else
+#error "Unknown architecure"
+#endif
+
+// --------------------------------------------------------------------------------------------------------------------
+
+// Calculates the dot products of FirstCount rows of the first matrix and SecondCount rows of the second matrix
+// The rows of both matrices are of the width size
+template<int FirstCount, int SecondCount>
+static inline void quantizedDotProducts( const int8_t* first, const int8_t* second, int width, int* result )
+{
+	CQuantizedSum sums[FirstCount][SecondCount];
+	for( int i = 0; i < FirstCount; ++i ) {
+		for( int j = 0; j < SecondCount; ++j ) {
+			sums[i][j] = zeroQuantizedSum();
+		}
+	}
+
+	const int vectorWidth = width - width % QuantizedVectorSize;
+	for( int k = 0; k < vectorWidth; k += QuantizedVectorSize ) {
+		CQuantizedVector firstVectors[FirstCount];
+		for( int i = 0; i < FirstCount; ++i ) {
+			firstVectors[i] = loadQuantizedVector( first + i * width + k );
+		}
+		for( int j = 0; j < SecondCount; ++j ) {
+			const CQuantizedVector secondVector = loadQuantizedVector( second + j * width + k );
+			for( int i = 0; i < FirstCount; ++i ) {
+				sums[i][j] = quantizedMultiplyAdd( sums[i][j], firstVectors[i], secondVector );
+			}
+		}
+	}
+
+	for( int i = 0; i < FirstCount; ++i ) {
+		for( int j = 0; j < SecondCount; ++j ) {
+			int sum = horizontalQuantizedSum( sums[i][j] );
+			for( int k = vectorWidth; k < width; ++k ) {
+				sum += static_cast<int>( first[i * width + k] ) * second[j * width + k];
+			}
+			result[i * SecondCount + j] = sum;
+		}
+	}
+}
+
+// Multiplies FirstCount rows of the first matrix by the transposed second matrix and converts the result to float
+template<int FirstCount>
+static inline void multiplyQuantizedRowsByTransposedMatrix( const int8_t* first, int firstWidth, float firstScale,
+	const int8_t* second, int secondHeight, const float* secondScales, const float* freeTerm,
+	float* result, int resultRowSize )
+{
+	int sums[FirstCount * QuantizedSecondBlockSize];
+	int j = 0;
+	while( j < secondHeight ) {
+		int blockSize = QuantizedSecondBlockSize;
+		if( j + QuantizedSecondBlockSize <= secondHeight ) {
+			quantizedDotProducts<FirstCount, QuantizedSecondBlockSize>( first, second + j * firstWidth, firstWidth, sums );
+		} else {
+			blockSize = 1;
+			quantizedDotProducts<FirstCount, 1>( first, second + j * firstWidth, firstWidth, sums );
+		}
+
+		for( int i = 0; i < FirstCount; ++i ) {
+			for( int k = 0; k < blockSize; ++k ) {
+				const float value = sums[i * blockSize + k] * firstScale * secondScales[j + k];
+				result[i * resultRowSize + j + k] = freeTerm == nullptr ? value : value + freeTerm[j + k];
+			}
+		}
+		j += blockSize;
+	}
+}
+
+void CCpuMathEngine::multiplyQuantizedMatrixByTransposedMatrix( const int8_t* first, int firstHeight, int firstWidth,
+	float firstScale, const int8_t* second, int secondHeight, const float* secondScales, const float* freeTerm,
+	float* result, int resultRowSize )
+{
+	int i = 0;
+	for( ; i + QuantizedFirstBlockSize <= firstHeight; i += QuantizedFirstBlockSize ) {
+		multiplyQuantizedRowsByTransposedMatrix<QuantizedFirstBlockSize>( first + i * firstWidth, firstWidth, firstScale,
+			second, secondHeight, secondScales, freeTerm, result + i * resultRowSize, resultRowSize );
+	}
+	for( ; i < firstHeight; ++i ) {
+		multiplyQuantizedRowsByTransposedMatrix<1>( first + i * firstWidth, firstWidth, firstScale,
+			second, secondHeight, secondScales, freeTerm, result + i * resultRowSize, resultRowSize );
+	}
+}
+
+void CCpuMathEngine::quantizeVector( const float* from, int8_t* to, int vectorSize, float scale )
+{
+	ASSERT_EXPR( scale > 0 );
+	vectorQuantize( from, to, vectorSize, 1.f / scale );
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+
+void CCpuMathEngine::VectorQuantize( const CConstFloatHandle& fromHandle, const CInt8Handle& toHandle,
+	int vectorSize, float scale )
+{
+	ASSERT_EXPR( fromHandle.GetMathEngine() == this );
+	ASSERT_EXPR( toHandle.GetMathEngine() == this );
+	ASSERT_EXPR( vectorSize >= 0 );
+	CCpuExecutionScope scope;
+
+	const float* from = GetRaw( fromHandle );
+	int8_t* to = GetRaw( toHandle );
+
+	const int curThreadCount = IsOmpRelevant( vectorSize ) ? threadCount : 1;
+	NEOML_OMP_NUM_THREADS( curThreadCount )
+	{
+		int index;
+		int count;
+		if( OmpGetTaskIndexAndCount( vectorSize, 16, index, count ) ) {
+			quantizeVector( from + index, to + index, count, scale );
+		}
+	}
+}
+
+void CCpuMathEngine::MultiplyQuantizedMatrixByTransposedMatrix( const CConstInt8Handle& firstHandle, int firstHeight,
+	int firstWidth, float firstScale, const CConstInt8Handle& secondHandle, int secondHeight,
+	const CConstFloatHandle& secondScalesHandle, const CFloatHandle& resultHandle, int resultBufferSize )
+{
+	ASSERT_EXPR( firstHandle.GetMathEngine() == this );
+	ASSERT_EXPR( secondHandle.GetMathEngine() == this );
+	ASSERT_EXPR( secondScalesHandle.GetMathEngine() == this );
+	ASSERT_EXPR( resultHandle.GetMathEngine() == this );
+	ASSERT_EXPR( resultBufferSize >= firstHeight * secondHeight );
+	CCpuExecutionScope scope;
+
+	const int8_t* first = GetRaw( firstHandle );
+	const int8_t* second = GetRaw( secondHandle );
+	const float* secondScales = GetRaw( secondScalesHandle );
+	float* result = GetRaw( resultHandle );
+
+	const int curThreadCount = IsOmpRelevant( firstHeight * secondHeight,
+		static_cast<int64_t>( firstHeight ) * secondHeight * firstWidth ) ? threadCount : 1;
+	NEOML_OMP_NUM_THREADS( curThreadCount )
+	{
+		int firstStart;
+		int firstCount;
+		int secondStart;
+		int secondCount;
+		if( OmpGetTaskIndexAndCount2D( firstHeight, QuantizedFirstBlockSize, secondHeight, QuantizedSecondBlockSize,
+			firstStart, firstCount, secondStart, secondCount ) )
+		{
+			multiplyQuantizedMatrixByTransposedMatrix( first + firstStart * firstWidth, firstCount, firstWidth, firstScale,
+				second + secondStart * firstWidth, secondCount, secondScales + secondStart, nullptr,
+				result + firstStart * secondHeight + secondStart, secondHeight );
+		}
+	}
+}
+
+} // namespace NeoML
@@ -67,6 +67,28 @@ static std::string getModuleDir()
 #endif
 	return result;
 }
+
+// The full path to the library with the given name placed next to this one
+static std::string getLibraryPath( const char* name )
+{
+	std::string result( getModuleDir() );
+#if FINE_PLATFORM( FINE_WINDOWS )
+	result += name;
+	result += ".dll";
+#elif FINE_PLATFORM( FINE_LINUX )
+	result += "lib";
+	result += name;
+	result += ".so";
+#elif FINE_PLATFORM( FINE_DARWIN )
+	result += "lib";
+	result += name;
+	result += ".dylib";
+#else
+	#error "Platform isn't supported!"
+#endif
+	return result;
+}
+
 namespace NeoML {
 
 CAvxDll::CAvxDll() :
@@ -89,17 +111,15 @@ bool CAvxDll::Load()
 		return false;
 	}
 
-	std::string dllPath( getModuleDir() );
-#if FINE_PLATFORM( FINE_WINDOWS )
-	dllPath += "NeoMathEngineAvx.dll";
-#elif FINE_PLATFORM( FINE_LINUX )
-	dllPath += "libNeoMathEngineAvx.so";
-#elif FINE_PLATFORM( FINE_DARWIN )
-	dllPath += "libNeoMathEngineAvx.dylib";
-#else
-	#error "Platform isn't supported!"
-#endif
-	ASSERT_EXPR( CDll::Load( dllPath.c_str() ) );
+	if( CCPUInfo::IsAvx512Available() ) {
+		// The AVX version is slower than MKL on these processors, so only the AVX-512 version is used
+		// The library may be absent (e.g. if it was not shipped with the application)
+		if( !CCPUInfo::IsAvx512FDqBwVlAvailable() || !CDll::Load( getLibraryPath( "NeoMathEngineAvx512" ).c_str() ) ) {
+			return false;
+		}
+	} else {
+		ASSERT_EXPR( CDll::Load( getLibraryPath( "NeoMathEngineAvx" ).c_str() ) );
+	}
 
 	ASSERT_EXPR( loadFunctions() );
 
@@ -137,7 +157,7 @@ bool CAvxDll::isAvxAvailable()
 	return false;
 #endif
 
-	static bool res = CCPUInfo::IsAvxAndFmaAvailable() && !CCPUInfo::IsAvx512Available();
+	static bool res = CCPUInfo::IsAvxAndFmaAvailable();
 	return res;
 }
 
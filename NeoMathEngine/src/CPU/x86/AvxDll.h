@@ -25,6 +25,7 @@ class ISimdMathEngine;
 class IMathEngine;
 
 // The dynamic link simd library
+// The AVX-512 version of the library is loaded on the processors that support it, the AVX version on the others
 class CAvxDll : public CDll {
 public:
 	CAvxDll();
@@ -55,7 +55,7 @@ public:
 		const CBlobDesc& result ) const override;
 
 	void BlobConvolution( const CConvolutionDesc& convDesc, const float* source,
-		const float* filter, const float* freeTerm, float* result ) const override;
+		const float* filter, const float* freeTerm, float* result, bool isParamChanged ) const override;
 
 	SgemmFunc GetSgemmFunction() const override;
 
@@ -68,18 +68,18 @@ CConvolutionDesc* CAvxMathEngine::InitBlobConvolution( const CBlobDesc& source,
 	int strideHeight, int strideWidth, int dilationHeight, int dilationWidth, const CBlobDesc& filter,
 	const CBlobDesc& result ) const
 {
-	if( CBlobConvolutionFabric::IsBlobConvolutionAvailable( filter.BatchWidth() , filter.Height(), filter.Width() ) ) {
+	if( CBlobConvolutionFabric::IsBlobConvolutionAvailable( filter.BatchWidth(), filter.Height(), filter.Width(), strideHeight, strideWidth ) ) {
 		return new CAvxConvolutionDesc( mathEngine, source, result, filter, paddingHeight, paddingWidth, strideHeight, strideWidth, dilationHeight, dilationWidth );
 	}
 	return nullptr;
 }
 
 void CAvxMathEngine::BlobConvolution( const CConvolutionDesc& convDesc, const float* source,
-	const float* filter, const float* freeTerm, float* result ) const
+	const float* filter, const float* freeTerm, float* result, bool isParamChanged ) const
 {
 	const CAvxConvolutionDesc& desc = static_cast<const CAvxConvolutionDesc&>( convDesc );
 	
-	desc.BlobConvolution->ProcessConvolution( threadCount, source, filter, freeTerm, result );
+	desc.BlobConvolution->ProcessConvolution( threadCount, source, filter, freeTerm, result, isParamChanged );
 
 }
 
@@ -31,7 +31,9 @@ using reg64_t = Xbyak::Reg64;
 class CBlobConvolutionBase : public CCrtAllocatedObject {
 public:
     virtual ~CBlobConvolutionBase() = default;
-    virtual void ProcessConvolution( int threadCount, const float* sourceData, const float* filterData, const float* freeTermData, float* resultData ) = 0;
+    // isParamChanged is set if the filter or free term values changed since the previous call
+    virtual void ProcessConvolution( int threadCount, const float* sourceData, const float* filterData, const float* freeTermData,
+        float* resultData, bool isParamChanged ) = 0;
 };
 
 template<int FltCnt>
@@ -41,11 +43,11 @@ public:
         IMathEngine* mathEngine,
         int channelCount, int filterHeight, int filterWidth, int sourceHeight, int sourceWidth,
         int paddingHeight, int paddingWidth, int strideHeight, int strideWidth,
-        int dilationHeight, int dilationWidth, int resultHeight, int resultWidth, int resObjCnt );
+        int dilationHeight, int dilationWidth, int resultHeight, int resultWidth, int resObjCnt, int resPixelStride );
     ~CBlobConvolution() override = default;
 
-    void ProcessConvolution( int threadCount,
-        const float* sourceData, const float* filterData, const float* freeTermData, float* resultData ) override;
+    void ProcessConvolution( int threadCount, const float* sourceData, const float* filterData, const float* freeTermData,
+        float* resultData, bool isParamChanged ) override;
 
 private:
     struct CSize {
@@ -68,6 +70,10 @@ private:
 
         static constexpr unsigned int NumFloatInYmm = 8;
         static constexpr unsigned int SizeOfYmm = NumFloatInYmm * sizeof( float );
+#ifdef NEOML_USE_AVX512
+        static constexpr unsigned int NumFloatInZmm = 16;
+        static constexpr unsigned int SizeOfZmm = NumFloatInZmm * sizeof( float );
+#endif
     private:
         // Passed to 'Run()' function as arguments
         const reg64_t regUseNarrowProcessing = Param1;
@@ -108,13 +114,25 @@ private:
             size_t windowIndex, bool useNarrowProcessing = false, std::function<void()>* callBeforeFlush = nullptr );
 
         void circularShift( Xbyak::Ymm* dst, Xbyak::Ymm* src, Xbyak::Ymm* temp = nullptr ) {}
+
+#ifdef NEOML_USE_AVX512
+        // initResRegs and flushResRegs for the filter counts multiple of 16:
+        // the result of one pixel takes stepSize zmm registers
+        void initZmmResRegs( size_t stepCount, size_t stepSize );
+        void flushZmmResRegs( CBlobConvolution<FltCnt>& bc, size_t stepCount, size_t stepSize );
+#endif
     };
 
     IMathEngine* mathEngine;
 
     const int ChCnt;
+    // The filter window size. The algorithm needs the central pixel of the window,
+    // so an even filter size is extended by one zero pixel at the beginning
     const int FltH;
     const int FltW;
+    // The original filter size
+    const int OrigFltH;
+    const int OrigFltW;
     const int SrcH;
     const int SrcW;
     const int PaddingH;
@@ -137,6 +155,13 @@ private:
     const float* freeTerm;
     float* res;
 
+    // The filter and the free term rearranged for the JIT code
+    // They are kept between the calls and rearranged again only if the source data changes
+    CFloatHandleVar rearrangedFilter;
+    CFloatHandleVar rearrangedFreeTerm;
+    const float* rearrangedFilterSource; // the filter from which rearrangedFilter was calculated
+    const float* rearrangedFreeTermSource; // the free term from which rearrangedFreeTerm was calculated
+
     // !!! SrcXStep, SrcYStep and ResLineStride are read from JIT as 8-byte values, hence they must have 8 byte length.
     // Length of one source line.
     const size_t SrcLineStride;
@@ -149,6 +174,9 @@ private:
     const size_t SrcYDilation;
     // Width of source window in floats
     const size_t SrcXWindowSize;
+    // Distance in floats between two neighbor pixels in result.
+    // It is greater than FltCnt if the result has more channels and only FltCnt of them are calculated here.
+    const size_t ResPixelStride;
     const size_t ResLineStride;
 
     // When we move filter window over the source image we have different combination of intersection this window with
@@ -179,9 +207,9 @@ private:
 
     void initJitCodes();
 
-    // Rearrange filter and fill 'Filter' and 'FreeTerm' members.
-    const float* rearrangeFilter( const float* filterData, CFloatHandleStackVar& Filter );
-    const float* rearrangeFreeTerm( const float* freeTermData, CFloatHandleStackVar& FreeTerm );
+    // Rearrange filter and free term into 'rearrangedFilter' and 'rearrangedFreeTerm' members.
+    void rearrangeFilter( const float* filterData );
+    void rearrangeFreeTerm( const float* freeTermData );
     // Function calculates offsets of center of filter window over the source image, where intersection over
     // them is changed. This function helps to calculate further PixelOffsetResStepsWidthX/Y, SrcPixelsOffset and FltPixelsOffset.
     // Src (source), F(filter), D(dilation), S(stride) and P(padding) linear dimention by X or Y axis.
@@ -197,14 +225,64 @@ const int CBlobConvolution<FltCnt>::NarrowBatchKernelHeight = INT_MAX;
 template<int FltCnt>
 const int CBlobConvolution<FltCnt>::NarrowBatchKernelWidth = INT_MAX;
 
+// The convolution with the filter count which has no JIT kernel
+// The filters are split into the chunks, each chunk calculates its channels of the result
+// The last chunk may have less than TailChunkFilterCount filters (the tail of the filter count which is not a multiple of 8)
+// Its filters are extended with zeroes to TailChunkFilterCount and its result is calculated in a separate buffer,
+// otherwise the extra channels would overwrite the result of the next pixel
+class CBlobConvolutionChunked : public CBlobConvolutionBase {
+public:
+    static const int TailChunkFilterCount = 8;
+
+    // filterSize is the number of floats in one filter, resultPixelCount is the number of the pixels in the result
+    CBlobConvolutionChunked( int _filterSize, int _resultPixelCount ) :
+        filterSize( _filterSize ), resultPixelCount( _resultPixelCount ), filterCount( 0 ),
+        tailFilterSource( nullptr ), tailFreeTermSource( nullptr ) {}
+
+    // Adds the convolution for the next chunkFilterCount filters
+    // The chunk with less than TailChunkFilterCount filters should calculate TailChunkFilterCount filters
+    void AddChunk( int chunkFilterCount, std::unique_ptr<CBlobConvolutionBase> chunk );
+
+    void ProcessConvolution( int threadCount, const float* sourceData, const float* filterData, const float* freeTermData,
+        float* resultData, bool isParamChanged ) override;
+
+private:
+    const int filterSize;
+    const int resultPixelCount;
+    int filterCount;
+    std::vector<std::unique_ptr<CBlobConvolutionBase>> chunks;
+    // The index of the first filter of each chunk
+    std::vector<int> chunkFirstFilters;
+
+    // The tail filters and free terms extended with zeroes and the result of the tail chunk
+    std::vector<float> tailFilter;
+    std::vector<float> tailFreeTerm;
+    std::vector<float> tailResult;
+    const float* tailFilterSource; // the filter from which tailFilter was copied
+    const float* tailFreeTermSource; // the free term from which tailFreeTerm was copied
+
+    void processTail( int threadCount, int firstFilter, const float* sourceData, const float* filterData,
+        const float* freeTermData, float* resultData, bool isParamChanged );
+};
+
 class CBlobConvolutionFabric : public CCrtAllocatedObject {
 public:
-    static bool IsBlobConvolutionAvailable( int FltCnt, int FltH, int FltW );
+    // Checks if JIT is available and is expected to be faster than the im2col algorithms for the given convolution
+    static bool IsBlobConvolutionAvailable( int FltCnt, int FltH, int FltW, int StrideH, int StrideW );
     static std::unique_ptr<CBlobConvolutionBase> GetProperInstance(
         IMathEngine* mathEngine, int FltCnt,
         int channelCount, int filterHeight, int filterWidth, int sourceHeight, int sourceWidth,
         int paddingHeight, int paddingWidth, int strideHeight, int strideWidth,
         int dilationHeight, int dilationWidth, int resultHeight, int resultWidth, int resObjCnt );
+
+private:
+    // Splits the filters into the chunks with JIT kernels
+    static bool getFilterChunks( int filterCount, std::vector<int>& chunks );
+    static std::unique_ptr<CBlobConvolutionBase> createInstance(
+        IMathEngine* mathEngine, int FltCnt,
+        int channelCount, int filterHeight, int filterWidth, int sourceHeight, int sourceWidth,
+        int paddingHeight, int paddingWidth, int strideHeight, int strideWidth,
+        int dilationHeight, int dilationWidth, int resultHeight, int resultWidth, int resObjCnt, int resPixelStride );
 };
 
 } // namespace NeoML
@@ -215,7 +293,11 @@ public:
 #include <BlobConvolution_jit_FltCnt_3.inl>
 #include <BlobConvolution_jit_FltCnt_6.inl>
 #include <BlobConvolution_jit_FltCnt_8.inl>
-#include <BlobConvolution_jit_FltCnt_16.inl>
 #include <BlobConvolution_jit_FltCnt_18.inl>
 #include <BlobConvolution_jit_FltCnt_24.inl>
-#include <BlobConvolution_jit_FltCnt_32.inl>
\ No newline at end of file
+#ifdef NEOML_USE_AVX512
+#include <BlobConvolution_jit_Avx512.inl>
+#else
+#include <BlobConvolution_jit_FltCnt_16.inl>
+#include <BlobConvolution_jit_FltCnt_32.inl>
+#endif
\ No newline at end of file
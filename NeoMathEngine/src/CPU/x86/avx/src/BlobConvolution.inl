@@ -15,22 +15,19 @@ limitations under the License.
 
 namespace NeoML {
 
-bool CBlobConvolutionFabric::IsBlobConvolutionAvailable( int FltCnt, int FltH, int FltW )
+bool CBlobConvolutionFabric::IsBlobConvolutionAvailable( int FltCnt, int FltH, int FltW, int StrideH, int StrideW )
 {
-    if( FltH % 2 == 0 || FltW % 2 == 0 ) {
+    std::vector<int> chunks;
+    if( !getFilterChunks( FltCnt, chunks ) ) {
         return false;
     }
-    if(
-        FltCnt == 32 ||
-        FltCnt == 24 ||
-        FltCnt == 18 ||
-        FltCnt == 16 ||
-        FltCnt == 8 ||
-        FltCnt == 6 ||
-        FltCnt == 3 ) {
+    if( chunks.size() == 1 ) {
         return true;
     }
-    return false;
+    // Every chunk reads the whole source once again, while im2col copies every source pixel
+    // about FltH * FltW / ( StrideH * StrideW ) times before the matrix multiplication.
+    // Use JIT only if it doesn't read the source more times than im2col writes it.
+    return static_cast<int>( chunks.size() ) * StrideH * StrideW <= FltH * FltW;
 }
 
 std::unique_ptr<CBlobConvolutionBase> CBlobConvolutionFabric::GetProperInstance(
@@ -38,6 +35,75 @@ std::unique_ptr<CBlobConvolutionBase> CBlobConvolutionFabric::GetProperInstance(
     int channelCount, int filterHeight, int filterWidth, int sourceHeight, int sourceWidth,
     int paddingHeight, int paddingWidth, int strideHeight, int strideWidth,
     int dilationHeight, int dilationWidth, int resultHeight, int resultWidth, int resObjCnt )
+{
+    std::vector<int> chunks;
+    if( !getFilterChunks( filterCount, chunks ) ) {
+        return nullptr;
+    }
+    if( chunks.size() == 1 ) {
+        return createInstance( mathEngine, filterCount, channelCount, filterHeight, filterWidth, sourceHeight, sourceWidth,
+            paddingHeight, paddingWidth, strideHeight, strideWidth,
+            dilationHeight, dilationWidth, resultHeight, resultWidth, resObjCnt, filterCount );
+    }
+
+    std::unique_ptr<CBlobConvolutionChunked> result( new CBlobConvolutionChunked( channelCount * filterHeight * filterWidth,
+        resultHeight * resultWidth * resObjCnt ) );
+    for( int chunk : chunks ) {
+        // The tail chunk writes its own buffer
+        const bool isTail = chunk < CBlobConvolutionChunked::TailChunkFilterCount;
+        int chunkFilterCount = chunk;
+        if( isTail ) {
+            chunkFilterCount = CBlobConvolutionChunked::TailChunkFilterCount;
+        }
+        result->AddChunk( chunk, createInstance( mathEngine, chunkFilterCount, channelCount, filterHeight, filterWidth,
+            sourceHeight, sourceWidth, paddingHeight, paddingWidth, strideHeight, strideWidth,
+            dilationHeight, dilationWidth, resultHeight, resultWidth, resObjCnt, isTail ? chunkFilterCount : filterCount ) );
+    }
+    return std::unique_ptr<CBlobConvolutionBase>( result.release() );
+}
+
+bool CBlobConvolutionFabric::getFilterChunks( int filterCount, std::vector<int>& chunks )
+{
+    chunks.clear();
+    switch( filterCount ) {
+        case 32:
+        case 24:
+        case 18:
+        case 16:
+        case 8:
+        case 6:
+        case 3:
+            chunks.push_back( filterCount );
+            return true;
+        default:
+            break;
+    }
+
+    // The other filter counts are split into the chunks of 32, 24, 16 or 8 filters and the tail of less than 8 filters
+    // The chunks write the result with the stride, which is supported only by the kernels without the register shifts
+    // The small filter counts are left to im2col: the kernel for 8 filters would mostly calculate zeroes
+    if( filterCount < CBlobConvolutionChunked::TailChunkFilterCount ) {
+        return false;
+    }
+    int rest = filterCount;
+    for( ; rest >= 32; rest -= 32 ) {
+        chunks.push_back( 32 );
+    }
+    if( rest >= 8 ) {
+        chunks.push_back( rest / 8 * 8 );
+        rest %= 8;
+    }
+    if( rest > 0 ) {
+        chunks.push_back( rest );
+    }
+    return true;
+}
+
+std::unique_ptr<CBlobConvolutionBase> CBlobConvolutionFabric::createInstance(
+    IMathEngine* mathEngine, int filterCount,
+    int channelCount, int filterHeight, int filterWidth, int sourceHeight, int sourceWidth,
+    int paddingHeight, int paddingWidth, int strideHeight, int strideWidth,
+    int dilationHeight, int dilationWidth, int resultHeight, int resultWidth, int resObjCnt, int resPixelStride )
 {
     switch( filterCount ) {
     case 32:
@@ -45,43 +111,43 @@ std::unique_ptr<CBlobConvolutionBase> CBlobConvolutionFabric::GetProperInstance(
             new CBlobConvolution<32>(
                 mathEngine, channelCount, filterHeight, filterWidth, sourceHeight, sourceWidth,
                 paddingHeight, paddingWidth, strideHeight, strideWidth,
-                dilationHeight, dilationWidth, resultHeight, resultWidth, resObjCnt ) );
+                dilationHeight, dilationWidth, resultHeight, resultWidth, resObjCnt, resPixelStride ) );
     case 24:
         return std::unique_ptr<CBlobConvolutionBase>(
             new CBlobConvolution<24>(
                 mathEngine, channelCount, filterHeight, filterWidth, sourceHeight, sourceWidth,
                 paddingHeight, paddingWidth, strideHeight, strideWidth,
-                dilationHeight, dilationWidth, resultHeight, resultWidth, resObjCnt ) );
+                dilationHeight, dilationWidth, resultHeight, resultWidth, resObjCnt, resPixelStride ) );
     case 18:
         return std::unique_ptr<CBlobConvolutionBase>(
             new CBlobConvolution<18>(
                 mathEngine, channelCount, filterHeight, filterWidth, sourceHeight, sourceWidth,
                 paddingHeight, paddingWidth, strideHeight, strideWidth,
-                dilationHeight, dilationWidth, resultHeight, resultWidth, resObjCnt ) );
+                dilationHeight, dilationWidth, resultHeight, resultWidth, resObjCnt, resPixelStride ) );
     case 16:
         return std::unique_ptr<CBlobConvolutionBase>(
             new CBlobConvolution<16>(
                 mathEngine, channelCount, filterHeight, filterWidth, sourceHeight, sourceWidth,
                 paddingHeight, paddingWidth, strideHeight, strideWidth,
-                dilationHeight, dilationWidth, resultHeight, resultWidth, resObjCnt ) );
+                dilationHeight, dilationWidth, resultHeight, resultWidth, resObjCnt, resPixelStride ) );
     case 8:
         return std::unique_ptr<CBlobConvolutionBase>(
             new CBlobConvolution<8>(
                 mathEngine, channelCount, filterHeight, filterWidth, sourceHeight, sourceWidth,
                 paddingHeight, paddingWidth, strideHeight, strideWidth,
-                dilationHeight, dilationWidth, resultHeight, resultWidth, resObjCnt ) );
+                dilationHeight, dilationWidth, resultHeight, resultWidth, resObjCnt, resPixelStride ) );
     case 6:
         return std::unique_ptr<CBlobConvolutionBase>(
             new CBlobConvolution<6>(
                 mathEngine, channelCount, filterHeight, filterWidth, sourceHeight, sourceWidth,
                 paddingHeight, paddingWidth, strideHeight, strideWidth,
-                dilationHeight, dilationWidth, resultHeight, resultWidth, resObjCnt ) );
+                dilationHeight, dilationWidth, resultHeight, resultWidth, resObjCnt, resPixelStride ) );
     case 3:
         return std::unique_ptr<CBlobConvolutionBase>(
             new CBlobConvolution<3>(
                 mathEngine, channelCount, filterHeight, filterWidth, sourceHeight, sourceWidth,
                 paddingHeight, paddingWidth, strideHeight, strideWidth,
-                dilationHeight, dilationWidth, resultHeight, resultWidth, resObjCnt ) );
+                dilationHeight, dilationWidth, resultHeight, resultWidth, resObjCnt, resPixelStride ) );
     default:
         return nullptr;
     }
@@ -89,19 +155,78 @@ std::unique_ptr<CBlobConvolutionBase> CBlobConvolutionFabric::GetProperInstance(
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void CBlobConvolutionChunked::AddChunk( int chunkFilterCount, std::unique_ptr<CBlobConvolutionBase> chunk )
+{
+    ASSERT_EXPR( chunk != nullptr );
+    chunkFirstFilters.push_back( filterCount );
+    chunks.push_back( std::move( chunk ) );
+    filterCount += chunkFilterCount;
+}
+
+void CBlobConvolutionChunked::ProcessConvolution( int threadCount, const float* sourceData, const float* filterData,
+    const float* freeTermData, float* resultData, bool isParamChanged )
+{
+    for( size_t i = 0; i < chunks.size(); i++ ) {
+        const int firstFilter = chunkFirstFilters[i];
+        if( filterCount - firstFilter < TailChunkFilterCount ) {
+            processTail( threadCount, firstFilter, sourceData, filterData, freeTermData, resultData, isParamChanged );
+            continue;
+        }
+        chunks[i]->ProcessConvolution( threadCount, sourceData, filterData + firstFilter * filterSize,
+            freeTermData == nullptr ? nullptr : freeTermData + firstFilter, resultData + firstFilter, isParamChanged );
+    }
+}
+
+void CBlobConvolutionChunked::processTail( int threadCount, int firstFilter, const float* sourceData,
+    const float* filterData, const float* freeTermData, float* resultData, bool isParamChanged )
+{
+    const int tailFilterCount = filterCount - firstFilter;
+    const float* tailFilterData = filterData + firstFilter * filterSize;
+    const float* tailFreeTermData = freeTermData == nullptr ? nullptr : freeTermData + firstFilter;
+
+    bool isTailChanged = false;
+    if( isParamChanged || tailFilterData != tailFilterSource ) {
+        tailFilter.assign( static_cast<size_t>( TailChunkFilterCount ) * filterSize, 0.f );
+        std::copy( tailFilterData, tailFilterData + tailFilterCount * filterSize, tailFilter.begin() );
+        tailFilterSource = tailFilterData;
+        isTailChanged = true;
+    }
+    if( tailFreeTermData != nullptr && ( isParamChanged || tailFreeTermData != tailFreeTermSource ) ) {
+        tailFreeTerm.assign( TailChunkFilterCount, 0.f );
+        std::copy( tailFreeTermData, tailFreeTermData + tailFilterCount, tailFreeTerm.begin() );
+        tailFreeTermSource = tailFreeTermData;
+        isTailChanged = true;
+    }
+    tailResult.resize( static_cast<size_t>( resultPixelCount ) * TailChunkFilterCount );
+
+    chunks.back()->ProcessConvolution( threadCount, sourceData, tailFilter.data(),
+        tailFreeTermData == nullptr ? nullptr : tailFreeTerm.data(), tailResult.data(), isTailChanged );
+
+    for( int pixel = 0; pixel < resultPixelCount; pixel++ ) {
+        std::copy( tailResult.data() + pixel * TailChunkFilterCount,
+            tailResult.data() + pixel * TailChunkFilterCount + tailFilterCount,
+            resultData + static_cast<size_t>( pixel ) * filterCount + firstFilter );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 template<int FltCnt>
 CBlobConvolution<FltCnt>::CBlobConvolution(
     IMathEngine* _mathEngine, int channelCount, int filterHeight, int filterWidth,
     int sourceHeight, int sourceWidth, int paddingHeight, int paddingWidth, int strideHeight, int strideWidth,
-    int dilationHeight, int dilationWidth, int resultHeight, int resultWidth, int resObjCnt ) :
+    int dilationHeight, int dilationWidth, int resultHeight, int resultWidth, int resObjCnt, int resPixelStride ) :
     mathEngine( _mathEngine ),
     ChCnt( channelCount ),
-    FltH( filterHeight ),
-    FltW( filterWidth ),
+    FltH( filterHeight + 1 - filterHeight % 2 ),
+    FltW( filterWidth + 1 - filterWidth % 2 ),
+    OrigFltH( filterHeight ),
+    OrigFltW( filterWidth ),
     SrcH( sourceHeight ),
     SrcW( sourceWidth ),
-    PaddingH( paddingHeight ),
-    PaddingW( paddingWidth ),
+    // The extended filter starts one dilated pixel earlier
+    PaddingH( paddingHeight + ( FltH - OrigFltH ) * dilationHeight ),
+    PaddingW( paddingWidth + ( FltW - OrigFltW ) * dilationWidth ),
     StrideH( strideHeight ),
     StrideW( strideWidth ),
     DilationH( dilationHeight ),
@@ -114,31 +239,46 @@ CBlobConvolution<FltCnt>::CBlobConvolution(
     flt( nullptr ),
     freeTerm( nullptr ),
     res( nullptr ),
+    rearrangedFilter( *mathEngine, FltW * FltH * FltCntM8 * ChCnt ),
+    rearrangedFreeTerm( *mathEngine, FltCntM8 ),
+    rearrangedFilterSource( nullptr ),
+    rearrangedFreeTermSource( nullptr ),
     SrcLineStride( SrcW* ChCnt ),
     SrcXStep( StrideW* ChCnt ),
     SrcYStep( StrideH* SrcLineStride ),
     SrcXDilation( DilationW* ChCnt ),
     SrcYDilation( DilationH* SrcLineStride ),
     SrcXWindowSize( FltW* SrcXDilation ),
-    ResLineStride( ResW* FltCnt ),
+    ResPixelStride( resPixelStride ),
+    ResLineStride( ResW* ResPixelStride ),
     NarrowBatchProcessSize( getNarrowBatchProcessSize() ),
     WideBatchProcessSize( getWideBatchProcessSize() )
 {
+    // Only the kernels without the register shifts may write the result with the stride
+    ASSERT_EXPR( ResPixelStride == FltCnt || ( FltCnt == FltCntM8 && ResPixelStride > FltCnt ) );
     // // Initialize PixelOffsetResStepsX, PixelOffsetResStepsY, SrcPixelsOffset and FltPixelsOffset
     fillPixelOffset();
 }
 
 template<int FltCnt>
-void CBlobConvolution<FltCnt>::ProcessConvolution(
-    int threadCount, const float* sourceData, const float* filterData, const float* freeTermData, float* resultData )
+void CBlobConvolution<FltCnt>::ProcessConvolution( int threadCount, const float* sourceData, const float* filterData,
+    const float* freeTermData, float* resultData, bool isParamChanged )
 {
-    CFloatHandleStackVar filterTempBuffer( *mathEngine, FltW * FltH * FltCntM8 * ChCnt );
-    CFloatHandleStackVar freeTermTempBuffer( *mathEngine, FltCntM8 );
+    if( isParamChanged || filterData != rearrangedFilterSource ) {
+        rearrangeFilter( filterData );
+        rearrangedFilterSource = filterData;
+    }
+    if( freeTermData != nullptr && ( isParamChanged || freeTermData != rearrangedFreeTermSource ) ) {
+        rearrangeFreeTerm( freeTermData );
+        rearrangedFreeTermSource = freeTermData;
+    }
 
     src = sourceData;
     // Filter offset also are calculated from center
-    flt = rearrangeFilter( filterData, filterTempBuffer ) + ( FltW * FltH ) / 2 * ChCnt * FltCntM8;
-    freeTerm = rearrangeFreeTerm( freeTermData, freeTermTempBuffer );
+    flt = static_cast<const float*>( mathEngine->GetBuffer( rearrangedFilter.GetHandle(), 0, rearrangedFilter.Size() * sizeof( float ), false ) )
+        + ( FltW * FltH ) / 2 * ChCnt * FltCntM8;
+    freeTerm = freeTermData == nullptr ? nullptr
+        : static_cast<const float*>( mathEngine->GetBuffer( rearrangedFreeTerm.GetHandle(), 0, rearrangedFreeTerm.Size() * sizeof( float ), false ) );
     res = resultData;
 
     if( !jitIsInited ) {
@@ -147,7 +287,7 @@ void CBlobConvolution<FltCnt>::ProcessConvolution(
     }
 
     const int SrcObjSize = SrcW * SrcH * ChCnt;
-    const int ResObjSize = ResW * ResH * FltCnt;
+    const int ResObjSize = ResW * ResH * static_cast<int>( ResPixelStride );
     const int ResRowCount = ResObjCnt * ResH;
     const int curThreadCount = IsOmpRelevant( ResRowCount, ResRowCount * ResW * FltCnt * FltW * FltH * ChCnt ) ? threadCount : 1;
 
@@ -227,7 +367,7 @@ inline void CBlobConvolution<FltCnt>::initJitCodes()
 }
 
 template<int FltCnt>
-const float* CBlobConvolution<FltCnt>::rearrangeFilter( const float* filterData, CFloatHandleStackVar& filterTempBuffer )
+void CBlobConvolution<FltCnt>::rearrangeFilter( const float* filterData )
 {
     // Rearrange filter data.
     // Initial packing:
@@ -256,17 +396,25 @@ const float* CBlobConvolution<FltCnt>::rearrangeFilter( const float* filterData,
     // Pixel[1] Channel[0] Filter[0-23] Filter[0-5]
     // ...
     // Pixel[8] Channel[23] Filter[0-23] Filter[0-5]
+    //
+    // The pixels of the extended even filter, which are absent in the original filter, are filled with zeroes.
 
-    float* resFilterStartPtr = static_cast< float* >( mathEngine->GetBuffer( filterTempBuffer.GetHandle(), 0, filterTempBuffer.Size() * sizeof( float ), false ) );
-    float* resFilter = resFilterStartPtr;
+    float* resFilter = static_cast< float* >( mathEngine->GetBuffer( rearrangedFilter.GetHandle(), 0, rearrangedFilter.Size() * sizeof( float ), false ) );
     ASSERT_EXPR( reinterpret_cast< uintptr_t >( resFilter ) % AvxAlignment == 0 );
     for( int y = 0; y < FltH; y++ ) {
+        const int origY = y - ( FltH - OrigFltH );
         for( int x = 0; x < FltW; x++ ) {
+            const int origX = x - ( FltW - OrigFltW );
+            if( origY < 0 || origX < 0 ) {
+                memset( resFilter, 0, ChCnt * FltCntM8 * sizeof( float ) );
+                resFilter += ChCnt * FltCntM8;
+                continue;
+            }
             for( int c = 0; c < ChCnt; c++ ) {
-                const float* srcFilter = filterData + ( x + y * FltW ) * ChCnt + c;
+                const float* srcFilter = filterData + ( origX + origY * OrigFltW ) * ChCnt + c;
                 for( int f = 0; f < FltCnt; f++ ) {
                     resFilter[f] = *srcFilter;
-                    srcFilter += FltW * FltH * ChCnt;
+                    srcFilter += OrigFltW * OrigFltH * ChCnt;
                 }
                 for( int f = FltCnt; f < FltCntM8; f++ ) {
                     resFilter[f] = resFilter[f % FltCnt];
@@ -275,50 +423,39 @@ const float* CBlobConvolution<FltCnt>::rearrangeFilter( const float* filterData,
             }
         }
     }
-
-    return resFilterStartPtr;
 }
 
 template<int FltCnt>
-const float* CBlobConvolution<FltCnt>::rearrangeFreeTerm( const float* freeTermData, CFloatHandleStackVar& freeTermTempBuffer )
+void CBlobConvolution<FltCnt>::rearrangeFreeTerm( const float* freeTermData )
 {
-    if( freeTermData == nullptr ) {
-        return nullptr;
-    }
-
-    float* resFreeTermStartPtr = static_cast< float* >( mathEngine->GetBuffer( freeTermTempBuffer.GetHandle(), 0, freeTermTempBuffer.Size() * sizeof( float ), false ) );
-    float* resFreeTerm = resFreeTermStartPtr;
+    float* resFreeTerm = static_cast< float* >( mathEngine->GetBuffer( rearrangedFreeTerm.GetHandle(), 0, rearrangedFreeTerm.Size() * sizeof( float ), false ) );
     ASSERT_EXPR( reinterpret_cast< uintptr_t >( resFreeTerm ) % AvxAlignment == 0 );
 
     for( int f = 0; f < FltCntM8; f++ ) {
         *resFreeTerm++ = freeTermData[f % FltCnt];
     }
-    return resFreeTermStartPtr;
 }
 
 template<int FltCnt>
 std::vector<int> CBlobConvolution<FltCnt>::getPixelOffsetSrcSteps( int srcDim, int fDim, int dDim, int sDim, int pDim )
 {
-    vector<int> ret( fDim );
+    vector<int> ret;
     const int halfFDim = fDim / 2;
 
     // First offset of center of the filter window (Take in consideration paddings)
     const int firstOffset = halfFDim * dDim - pDim;
-    const int lastSrcPixelIdx = srcDim - 1;
-    // Last offset of center of the filter window (Take in consideration paddings)
-    // (lastSrcPixelIdx - 2 * firstOffset) - width of window
-    const int lastOffset = firstOffset + ( lastSrcPixelIdx - 2 * firstOffset ) / sDim * sDim;
-    ret[0] = firstOffset;
-
-    for( int i = 1; i <= halfFDim; i++ ) {
-        // up to middle
-        ret[i] = firstOffset + ( i * dDim - firstOffset + sDim - 1 ) / sDim * sDim;
-    }
-
+    ret.push_back( firstOffset );
 
-    for( int i = fDim - 1, j = 1; i > fDim / 2; i--, j++ ) {
-        // from last to next to middle
-        ret[i] = ( ( ( srcDim - j * dDim ) - firstOffset ) + sDim - 1 ) / sDim * sDim + firstOffset;
+    // First offset of center of the filter window on the stride grid, which is not less than the given one
+    auto alignToStep = [&]( int offset ) {
+        return offset <= firstOffset ? firstOffset : firstOffset + ( offset - firstOffset + sDim - 1 ) / sDim * sDim;
+    };
+    for( int i = -halfFDim; i <= halfFDim; i++ ) {
+        // the i-th pixel of the filter enters the image
+        ret.push_back( alignToStep( -i * dDim ) );
+        // the i-th pixel of the filter leaves the image
+        // (the center itself may be out of the image if the padding is greater than the half of the filter)
+        ret.push_back( alignToStep( srcDim - i * dDim ) );
     }
 
     sort( ret.begin(), ret.end() );
@@ -368,16 +505,26 @@ void CBlobConvolution<FltCnt>::fillPixelOffset()
     PixelOffsetResStepsWidthX = getPixelOffsetResStepsWidth( pixelOffsetSrcStepsX, SrcW, FltW, DilationW, StrideW, PaddingW );
     PixelOffsetResStepsWidthY = getPixelOffsetResStepsWidth( pixelOffsetSrcStepsY, SrcH, FltH, DilationH, StrideH, PaddingH );
 
+    // The extended even filter has more positions at the end of the row than the original one.
+    // Don't process them (the number of steps must stay the same because it is used for the window indices).
+    int resXRest = ResW;
+    for( auto& rxSize : PixelOffsetResStepsWidthX ) {
+        rxSize = min( rxSize, resXRest );
+        resXRest -= rxSize;
+    }
+
     // Get size of intersection of filter window and source image
     auto getFilterWindowSize = []( const vector<int>& pixelOffsetSrcSteps, int srcDim, int fDim, int dDim ) -> vector<pair<int, int>> {
+        // The center of the window may be out of the image because of the padding, so the division must round down
+        auto floorDiv = []( int a, int b ) { return a >= 0 ? a / b : -( ( -a + b - 1 ) / b ); };
         // first - count of items in filter from center to top
         // second - count of items in filter from center to bottom
         vector<pair<int, int>> ret( pixelOffsetSrcSteps.size() );
         for( int i = 0; i < pixelOffsetSrcSteps.size(); i++ ) {
             const int halfFDim = fDim / 2;
             ret[i] = make_pair(
-                min( pixelOffsetSrcSteps[i] / dDim, halfFDim ),
-                min( ( ( srcDim - 1 ) - pixelOffsetSrcSteps[i] ) / dDim, halfFDim ) );
+                min( floorDiv( pixelOffsetSrcSteps[i], dDim ), halfFDim ),
+                min( floorDiv( ( srcDim - 1 ) - pixelOffsetSrcSteps[i], dDim ), halfFDim ) );
         }
         return ret;
     };
@@ -390,13 +537,16 @@ void CBlobConvolution<FltCnt>::fillPixelOffset()
         vector<vector<int>> offsets( offsetSizeX.size() * offsetSizeY.size() );
         auto it = offsets.begin();
 
+        // The first row and column of the extended even filter are zero, skip them
+        const int firstY = FltH != OrigFltH ? -FltH / 2 + 1 : -FltH / 2;
+        const int firstX = FltW != OrigFltW ? -FltW / 2 + 1 : -FltW / 2;
+
         for( const auto& y : offsetSizeY ) {
             for( const auto& x : offsetSizeX ) {
-                it->resize( ( x.first + x.second + 1 ) * ( y.first + y.second + 1 ) );
-                auto it_offt = it->begin();
-                for( int i = -y.first; i <= y.second; i++ ) {
-                    for( int j = -x.first; j <= x.second; j++ ) {
-                        *it_offt++ = static_cast< int >( i * hStride + j * wStride );
+                it->clear();
+                for( int i = max( -y.first, firstY ); i <= y.second; i++ ) {
+                    for( int j = max( -x.first, firstX ); j <= x.second; j++ ) {
+                        it->push_back( static_cast< int >( i * hStride + j * wStride ) );
                     }
                 }
                 it++;
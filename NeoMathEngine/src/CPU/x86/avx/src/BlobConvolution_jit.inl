@@ -51,7 +51,7 @@ CBlobConvolution<FltCnt>::CJitConvolution::CJitConvolution( CBlobConvolution<Flt
             }
 
             add( regSrcPtr, static_cast<uint32_t>( stepSize * bc.SrcXStep * sizeof( float ) ) );
-            add( regResPtr, static_cast< uint32_t >( stepSize * FltCnt * sizeof( float ) ) );
+            add( regResPtr, static_cast< uint32_t >( stepSize * bc.ResPixelStride * sizeof( float ) ) );
         }
 
         if( numSteps > 1 ) {
@@ -253,12 +253,17 @@ inline void CBlobConvolution<FltCnt>::CJitConvolution::flushResRegs( CBlobConvol
         vmovdqa( regMask, ptr[rip + labelPartialStore] );
     }
 
+    // The filter chunk writes only a part of the result pixel, skip the rest of it
+    // (the partial store is used only when the whole pixel is written, so the gap isn't needed there)
+    const size_t resPixelGap = bc.ResPixelStride - FltCnt;
+
     size_t offsetDisp = 0;
     size_t resNarrowStepDisp = 0;
     for( int i = 0; i < RowCount; i++ ) {
         int j = 0;
         for( ; j < FullFlushCount; j++ ) {
-            vmovups( ptr[regResPtr + ( resNarrowStepDisp  + offsetDisp ) * sizeof( float )], resRegs[i * ColCount + j] );
+            const size_t pixelGapDisp = resPixelGap * ( j * NumFloatInYmm / FltCnt );
+            vmovups( ptr[regResPtr + ( resNarrowStepDisp  + offsetDisp + pixelGapDisp ) * sizeof( float )], resRegs[i * ColCount + j] );
             offsetDisp += NumFloatInYmm;
         }
 
@@ -0,0 +1,241 @@
+/* Copyright © 2017-2021 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+// CBlobConvolution class specializations for AVX-512
+// The filter counts 16 and 32 keep the result of one pixel in one or two zmm registers,
+// so 32 registers allow processing more pixels at once than the AVX version
+
+namespace NeoML {
+
+template<int FltCnt>
+inline void CBlobConvolution<FltCnt>::CJitConvolution::initZmmResRegs( size_t stepCount, size_t stepSize )
+{
+    using namespace Xbyak;
+
+    Label labelFillWithZeroes, labelEnd;
+    test( regFreeTermPtr, regFreeTermPtr );
+    jz( labelFillWithZeroes );
+
+    // Load the free terms for the first pixel and copy them to the others
+    for( int i = 0; i < static_cast<int>( stepSize ); i++ ) {
+        vmovups( Zmm( i ), ptr[regFreeTermPtr + SizeOfZmm * i] );
+    }
+    for( int i = static_cast<int>( stepSize ); i < static_cast<int>( stepCount * stepSize ); i++ ) {
+        vmovaps( Zmm( i ), Zmm( i % stepSize ) );
+    }
+    jmp( labelEnd, T_NEAR );
+
+    L( labelFillWithZeroes );
+    for( int i = 0; i < static_cast<int>( stepCount * stepSize ); i++ ) {
+        vpxord( Zmm( i ), Zmm( i ), Zmm( i ) );
+    }
+    L( labelEnd );
+}
+
+template<int FltCnt>
+inline void CBlobConvolution<FltCnt>::CJitConvolution::flushZmmResRegs( CBlobConvolution<FltCnt>& bc, size_t stepCount, size_t stepSize )
+{
+    using namespace Xbyak;
+
+    // The filter count is a multiple of 16, so the pixels are stored without masks
+    for( int i = 0; i < static_cast<int>( stepCount * stepSize ); i++ ) {
+        const size_t pixelDisp = ( i / stepSize ) * bc.ResPixelStride * sizeof( float );
+        vmovups( ptr[regResPtr + pixelDisp + ( i % stepSize ) * SizeOfZmm], Zmm( i ) );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Channel count: 16
+
+template<>
+const int CBlobConvolution<16>::WideBatchKernelHeight = 1;
+
+template<>
+const int CBlobConvolution<16>::WideBatchKernelWidth = 12;
+
+template<>
+inline void CBlobConvolution<16>::CJitConvolution::initResRegs( size_t stepCount, size_t stepSize )
+{
+    initZmmResRegs( stepCount, stepSize );
+}
+
+template<>
+inline void CBlobConvolution<16>::CJitConvolution::flushResRegs( CBlobConvolution<16>& bc, size_t stepCount, size_t stepSize,
+    bool useNarrowProcessing )
+{
+    PRESUME_EXPR( !useNarrowProcessing );
+    flushZmmResRegs( bc, stepCount, stepSize );
+}
+
+template<>
+inline void CBlobConvolution<16>::CJitConvolution::fillBatchProcessingKernel( CBlobConvolution<16>& bc, bool useNarrowProcessing, size_t windowIndex )
+{
+    using namespace Xbyak;
+
+    const int StepCount = 12;
+    const int StepSize = 1;
+    const int BatchChannelSize = 4;
+
+    // res: zmm0 - zmm11
+    const Zmm f = zmm16;
+
+    std::function<void( int )> fillKernel( [&]( int channelCount ) {
+        for( int i = 0; i < channelCount; i++ ) {
+            // Load one channel for the same pixel as in source for all filters.
+            vmovups( f, ptr[regTempFltPtr + i * FltCntM8 * sizeof( float )] );
+            // Multiply by the channel of the sequenced windows broadcast from memory
+            for( int j = 0; j < StepCount; j++ ) {
+                vfmadd231ps( Zmm( j ), f, ptr_b[regTempSrcPtr + ( j * bc.SrcXStep + i ) * sizeof( float )] );
+            }
+        }
+        } );
+
+    initProcessingMainLoop( bc, StepCount, StepSize, BatchChannelSize, fillKernel, windowIndex );
+}
+
+template<>
+inline void CBlobConvolution<16>::CJitConvolution::fillSingleProcessingKernel( CBlobConvolution<16>& bc, bool useNarrowProcessing, size_t windowIndex )
+{
+    using namespace Xbyak;
+
+    const int StepCount = 1;
+    const int StepSize = 1;
+    const int BatchChannelSize = 4;
+
+    // The channels are accumulated in separate registers to hide the latency
+    const Zmm tempRes[4] = { zmm0, zmm1, zmm2, zmm3 };
+    const Zmm f[4] = { zmm16, zmm17, zmm18, zmm19 };
+
+    for( int i = 1; i < 4; i++ ) {
+        vpxord( tempRes[i], tempRes[i], tempRes[i] );
+    }
+    std::function<void()> mergeResRegs( [&]() {
+        vaddps( tempRes[0], tempRes[0], tempRes[1] );
+        vaddps( tempRes[2], tempRes[2], tempRes[3] );
+        vaddps( tempRes[0], tempRes[0], tempRes[2] );
+    } );
+
+    std::function<void( int )> fillKernel( [&]( int channelCount ) {
+        PRESUME_EXPR( channelCount <= 4 );
+        for( int i = 0; i < channelCount; i++ ) {
+            vmovups( f[i], ptr[regTempFltPtr + i * FltCntM8 * sizeof( float )] );
+        }
+        for( int i = 0; i < channelCount; i++ ) {
+            vfmadd231ps( tempRes[i], f[i], ptr_b[regTempSrcPtr + i * sizeof( float )] );
+        }
+        } );
+    initProcessingMainLoop( bc, StepCount, StepSize, BatchChannelSize, fillKernel,
+        windowIndex, false, &mergeResRegs );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Channel count: 32
+
+template<>
+const int CBlobConvolution<32>::WideBatchKernelHeight = 1;
+
+template<>
+const int CBlobConvolution<32>::WideBatchKernelWidth = 8;
+
+template<>
+inline void CBlobConvolution<32>::CJitConvolution::initResRegs( size_t stepCount, size_t stepSize )
+{
+    initZmmResRegs( stepCount, stepSize );
+}
+
+template<>
+inline void CBlobConvolution<32>::CJitConvolution::flushResRegs( CBlobConvolution<32>& bc, size_t stepCount, size_t stepSize,
+    bool useNarrowProcessing )
+{
+    PRESUME_EXPR( !useNarrowProcessing );
+    flushZmmResRegs( bc, stepCount, stepSize );
+}
+
+template<>
+inline void CBlobConvolution<32>::CJitConvolution::fillBatchProcessingKernel( CBlobConvolution<32>& bc, bool useNarrowProcessing, size_t windowIndex )
+{
+    using namespace Xbyak;
+
+    const int StepCount = 8;
+    const int StepSize = 2;
+    const int BatchChannelSize = 4;
+
+    // res: zmm0 - zmm15, two registers per pixel
+    const Zmm f[2] = { zmm16, zmm17 };
+    const Zmm st[StepCount] = { zmm18, zmm19, zmm20, zmm21, zmm22, zmm23, zmm24, zmm25 };
+
+    std::function<void( int )> fillKernel( [&]( int channelCount ) {
+        for( int i = 0; i < channelCount; i++ ) {
+            const size_t fltOffset = i * FltCntM8 * sizeof( float );
+            // Load one channel for the same pixel as in source for all filters.
+            vmovups( f[0], ptr[regTempFltPtr + fltOffset] );
+            vmovups( f[1], ptr[regTempFltPtr + fltOffset + SizeOfZmm] );
+            // Load one channel from one pixels in sequenced windows and fill one zmm register with its value.
+            for( int j = 0; j < StepCount; j++ ) {
+                vbroadcastss( st[j], ptr[regTempSrcPtr + ( j * bc.SrcXStep + i ) * sizeof( float )] );
+            }
+            for( int j = 0; j < StepCount; j++ ) {
+                vfmadd231ps( Zmm( 2 * j ), f[0], st[j] );
+                vfmadd231ps( Zmm( 2 * j + 1 ), f[1], st[j] );
+            }
+        }
+        } );
+
+    initProcessingMainLoop( bc, StepCount, StepSize, BatchChannelSize, fillKernel, windowIndex );
+}
+
+template<>
+inline void CBlobConvolution<32>::CJitConvolution::fillSingleProcessingKernel( CBlobConvolution<32>& bc, bool useNarrowProcessing, size_t windowIndex )
+{
+    using namespace Xbyak;
+
+    const int StepCount = 1;
+    const int StepSize = 2;
+    const int BatchChannelSize = 4;
+
+    // The channels are accumulated in separate registers to hide the latency
+    const Zmm tempRes[4][2] = { { zmm0, zmm1 }, { zmm2, zmm3 }, { zmm4, zmm5 }, { zmm6, zmm7 } };
+    const Zmm s[4] = { zmm16, zmm17, zmm18, zmm19 };
+    const Zmm f[4][2] = { { zmm20, zmm21 }, { zmm22, zmm23 }, { zmm24, zmm25 }, { zmm26, zmm27 } };
+
+    for( int i = 1; i < 4; i++ ) {
+        vpxord( tempRes[i][0], tempRes[i][0], tempRes[i][0] );
+        vpxord( tempRes[i][1], tempRes[i][1], tempRes[i][1] );
+    }
+    std::function<void()> mergeResRegs( [&]() {
+        for( int j = 0; j < 2; j++ ) {
+            vaddps( tempRes[0][j], tempRes[0][j], tempRes[1][j] );
+            vaddps( tempRes[2][j], tempRes[2][j], tempRes[3][j] );
+            vaddps( tempRes[0][j], tempRes[0][j], tempRes[2][j] );
+        }
+    } );
+
+    std::function<void( int )> fillKernel( [&]( int channelCount ) {
+        PRESUME_EXPR( channelCount <= 4 );
+        for( int i = 0; i < channelCount; i++ ) {
+            vbroadcastss( s[i], ptr[regTempSrcPtr + i * sizeof( float )] );
+            vmovups( f[i][0], ptr[regTempFltPtr + i * FltCntM8 * sizeof( float )] );
+            vmovups( f[i][1], ptr[regTempFltPtr + i * FltCntM8 * sizeof( float ) + SizeOfZmm] );
+        }
+        for( int i = 0; i < channelCount; i++ ) {
+            vfmadd231ps( tempRes[i][0], f[i][0], s[i] );
+            vfmadd231ps( tempRes[i][1], f[i][1], s[i] );
+        }
+        } );
+    initProcessingMainLoop( bc, StepCount, StepSize, BatchChannelSize, fillKernel,
+        windowIndex, false, &mergeResRegs );
+}
+
+} // namespace NeoML
@@ -20,6 +20,9 @@ limitations under the License.
 #include <MatrixMultiplyingInterleavedCommon/CpuMemoryHelper.h>
 
 #include <Interleavers.h>
+#ifdef NEOML_USE_AVX512
+#include <Kernel_AVX512_6x32.h>
+#endif
 #include <Kernel_AVX_6x16.h>
 #include <Kernel_AVX_6x8.h>
 #include <Kernel_AVX_6x4.h>
@@ -28,10 +31,20 @@ limitations under the License.
 
 namespace NeoML {
 
+#ifdef NEOML_USE_AVX512
+// The AVX-512 build processes 32 columns at once and uses the AVX kernels for the tail
+using CKernelCombi_32 = CKernelCombineHorizontal<CMicroKernel_6x32>;
+using CKernelCombi_16 = CKernelCombineHorizontal<CMicroKernel_6x32, CMicroKernel_6x16>;
+using CKernelCombi_8 = CKernelCombineHorizontal<CMicroKernel_6x32, CMicroKernel_6x16, CMicroKernel_6x8>;
+using CKernelCombi_4 = CKernelCombineHorizontal<CMicroKernel_6x32, CMicroKernel_6x16, CMicroKernel_6x8, CMicroKernel_6x4>;
+using CKernelCombi_full = CKernelCombineHorizontal<CMicroKernel_6x32, CMicroKernel_6x16, CMicroKernel_6x8,
+	CMicroKernel_6x4, CMicroKernel_6x2, CMicroKernel_6x1>;
+#else
 using CKernelCombi_16 = CKernelCombineHorizontal<CMicroKernel_6x16>;
 using CKernelCombi_8 = CKernelCombineHorizontal<CMicroKernel_6x16, CMicroKernel_6x8>;
 using CKernelCombi_4 = CKernelCombineHorizontal<CMicroKernel_6x16, CMicroKernel_6x8, CMicroKernel_6x4>;
 using CKernelCombi_full = CKernelCombineHorizontal<CMicroKernel_6x16, CMicroKernel_6x8, CMicroKernel_6x4, CMicroKernel_6x2, CMicroKernel_6x1>;
+#endif
 
 template< class Kernel>
 void AvxMultiplyMatrixSelected( bool transA, bool transB,
@@ -73,6 +86,12 @@ void AvxMultiplyMatrix( bool transA, bool transB,
 {
 	// In some cases it is better choice to calculate matrix with big kernel in one or two steps rather than iterate over all
 	// available kernels. It helps us to save time on preparing.
+#ifdef NEOML_USE_AVX512
+	if( n % 32 == 0 || n % 32 > 28 ) {
+		AvxMultiplyMatrixSelected<CKernelCombi_32>( transA, transB, engine, aPtr, aRowSize, bPtr, bRowSize, cPtr, cRowSize, m, n, k );
+		return;
+	}
+#endif
 	switch( n % 16 ) {
 	case 3:
 	case 11:
@@ -963,6 +963,18 @@ void CCudaMathEngine::vectorMultichannelLookupAndAddToTable(int batchSize, int c
 	}
 }
 
+void CCudaMathEngine::MultiplyQuantizedMatrixByTransposedMatrix( const CConstInt8Handle&, int, int, float,
+	const CConstInt8Handle&, int, const CConstFloatHandle&, const CFloatHandle&, int )
+{
+	ASSERT_NOT_SUPPORTED( "8-bit integer inference is not supported by the CUDA math engine" );
+}
+
+void CCudaMathEngine::MultiplyMatrixByTransposedBFloat16Matrix( const CConstFloatHandle&, int, int,
+	const CConstBFloat16Handle&, int, const CFloatHandle&, int )
+{
+	ASSERT_NOT_SUPPORTED( "bfloat16 is not supported by the CUDA math engine" );
+}
+
 } // namespace NeoML
 
 #endif // NEOML_USE_CUDA
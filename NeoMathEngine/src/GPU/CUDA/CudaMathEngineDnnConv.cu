@@ -245,6 +245,18 @@ void CCudaMathEngine::BlobConvolutionLearnAdd( const CConvolutionDesc& convDesc,
 	}
 }
 
+void CCudaMathEngine::BlobQuantizedConvolution( const CConvolutionDesc&, const CConstFloatHandle&, float,
+	const CConstInt8Handle&, const CConstFloatHandle&, const CConstFloatHandle*, const CFloatHandle& )
+{
+	ASSERT_NOT_SUPPORTED( "8-bit integer inference is not supported by the CUDA math engine" );
+}
+
+void CCudaMathEngine::BlobBFloat16Convolution( const CConvolutionDesc&, const CConstFloatHandle&,
+	const CConstBFloat16Handle&, const CConstFloatHandle*, const CFloatHandle& )
+{
+	ASSERT_NOT_SUPPORTED( "bfloat16 is not supported by the CUDA math engine" );
+}
+
 } // namespace NeoML
 
 #endif // NEOML_USE_CUDA
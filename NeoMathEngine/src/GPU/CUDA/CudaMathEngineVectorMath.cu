@@ -1491,6 +1491,21 @@ void CCudaMathEngine::VectorMinMaxDiff(const CConstFloatHandle& sourceGradHandle
 		GetRaw( firstHandle ), GetRaw( resultHandle ), GetRaw( minHandle ), GetRaw( maxHandle ) );
 }
 
+void CCudaMathEngine::VectorQuantize( const CConstFloatHandle&, const CInt8Handle&, int, float )
+{
+	ASSERT_NOT_SUPPORTED( "8-bit integer inference is not supported by the CUDA math engine" );
+}
+
+void CCudaMathEngine::VectorConvert( const CConstFloatHandle&, const CBFloat16Handle&, int )
+{
+	ASSERT_NOT_SUPPORTED( "bfloat16 is not supported by the CUDA math engine" );
+}
+
+void CCudaMathEngine::VectorConvert( const CConstBFloat16Handle&, const CFloatHandle&, int )
+{
+	ASSERT_NOT_SUPPORTED( "bfloat16 is not supported by the CUDA math engine" );
+}
+
 } // namespace NeoML
 
 #endif // NEOML_USE_CUDA
@@ -1292,6 +1292,18 @@ void CMetalMathEngine::SumMatrixRows( int batchSize, const CFloatHandle& resultH
 	SumMatrixRowsAdd(batchSize, resultHandle, matrixHandle, matrixHeight, matrixWidth);
 }
 
+void CMetalMathEngine::MultiplyQuantizedMatrixByTransposedMatrix( const CConstInt8Handle&, int, int, float,
+	const CConstInt8Handle&, int, const CConstFloatHandle&, const CFloatHandle&, int )
+{
+	ASSERT_NOT_SUPPORTED( "8-bit integer inference is not supported by the Metal math engine" );
+}
+
+void CMetalMathEngine::MultiplyMatrixByTransposedBFloat16Matrix( const CConstFloatHandle&, int, int,
+	const CConstBFloat16Handle&, int, const CFloatHandle&, int )
+{
+	ASSERT_NOT_SUPPORTED( "bfloat16 is not supported by the Metal math engine" );
+}
+
 } // namespace NeoML
 
 #endif // NEOML_USE_METAL
@@ -663,6 +663,18 @@ void CMetalMathEngine::BlobRleConvolutionLearnAdd( const CRleConvolutionDesc&, c
 	ASSERT_EXPR( false );
 }
 
+void CMetalMathEngine::BlobQuantizedConvolution( const CConvolutionDesc&, const CConstFloatHandle&, float,
+	const CConstInt8Handle&, const CConstFloatHandle&, const CConstFloatHandle*, const CFloatHandle& )
+{
+	ASSERT_NOT_SUPPORTED( "8-bit integer inference is not supported by the Metal math engine" );
+}
+
+void CMetalMathEngine::BlobBFloat16Convolution( const CConvolutionDesc&, const CConstFloatHandle&,
+	const CConstBFloat16Handle&, const CConstFloatHandle*, const CFloatHandle& )
+{
+	ASSERT_NOT_SUPPORTED( "bfloat16 is not supported by the Metal math engine" );
+}
+
 } // namespace NeoML
 
 #endif // NEOML_USE_METAL
@@ -1205,6 +1205,21 @@ void CMetalMathEngine::VectorEltwiseLess( float, const CConstFloatHandle&,
 	ASSERT_EXPR( false );
 }
 
+void CMetalMathEngine::VectorQuantize( const CConstFloatHandle&, const CInt8Handle&, int, float )
+{
+	ASSERT_NOT_SUPPORTED( "8-bit integer inference is not supported by the Metal math engine" );
+}
+
+void CMetalMathEngine::VectorConvert( const CConstFloatHandle&, const CBFloat16Handle&, int )
+{
+	ASSERT_NOT_SUPPORTED( "bfloat16 is not supported by the Metal math engine" );
+}
+
+void CMetalMathEngine::VectorConvert( const CConstBFloat16Handle&, const CFloatHandle&, int )
+{
+	ASSERT_NOT_SUPPORTED( "bfloat16 is not supported by the Metal math engine" );
+}
+
 } // namespace NeoML
 
 #endif // NEOML_USE_METAL
@@ -81,6 +81,9 @@ public:
 	void VectorFill(const CIntHandle& result, int vectorSize, const CConstIntHandle& value) override;
 	void VectorConvert(const CConstFloatHandle& from, const CIntHandle& to, int vectorSize) override;
 	void VectorConvert(const CConstIntHandle& from, const CFloatHandle& to, int vectorSize) override;
+	void VectorConvert(const CConstFloatHandle& from, const CBFloat16Handle& to, int vectorSize) override;
+	void VectorConvert(const CConstBFloat16Handle& from, const CFloatHandle& to, int vectorSize) override;
+	void VectorQuantize(const CConstFloatHandle& from, const CInt8Handle& to, int vectorSize, float scale) override;
 	void VectorFillBernoulli( const CFloatHandle& result, float p, int vectorSize, float value, int seed ) override;
 	void FilterSmallValues( const CFloatHandle& data, int dataSize, float threshold ) override;
 	void VectorCopy(const CFloatHandle& first, const CConstFloatHandle& second, int vectorSize) override;
@@ -345,6 +348,11 @@ public:
 	void MultiplyTransposedMatrixByMatrixAndAdd(const CConstFloatHandle& firstHandle, int firstHeight, int firstWidth,
 		int firstRowSize, const CConstFloatHandle& secondHandle, int secondWidth, int secondRowSize,
 		const CFloatHandle& resultHandle, int resultRowSize, int resultBufferSize) override;
+	void MultiplyQuantizedMatrixByTransposedMatrix(const CConstInt8Handle& firstHandle, int firstHeight, int firstWidth,
+		float firstScale, const CConstInt8Handle& secondHandle, int secondHeight, const CConstFloatHandle& secondScalesHandle,
+		const CFloatHandle& resultHandle, int resultBufferSize) override;
+	void MultiplyMatrixByTransposedBFloat16Matrix(const CConstFloatHandle& firstHandle, int firstHeight, int firstWidth,
+		const CConstBFloat16Handle& secondHandle, int secondHeight, const CFloatHandle& resultHandle, int resultBufferSize) override;
 	void MultiplyTransposedMatrixByMatrix(int batchSize, const CConstFloatHandle& firstHandle, int firstHeight, int firstWidth,
 		const CConstFloatHandle& secondHandle, int secondWidth, const CFloatHandle& resultHandle, int resultBufferSize) override;
 	void MultiplyDiagMatrixByMatrix(const CConstFloatHandle& firstHandle, int firstSize,
@@ -418,6 +426,11 @@ public:
 	void BlobConvolutionLearnAdd( const CConvolutionDesc& desc,
 		const CFloatHandle& input, const CFloatHandle& outputDiff, const CFloatHandle& filterDiff,
 		const CFloatHandle* freeTermDiff, bool isFreeTermDiffFromInput ) override;
+	void BlobQuantizedConvolution( const CConvolutionDesc& desc, const CConstFloatHandle& source, float sourceScale,
+		const CConstInt8Handle& filter, const CConstFloatHandle& filterScales, const CConstFloatHandle* freeTerm,
+		const CFloatHandle& result ) override;
+	void BlobBFloat16Convolution( const CConvolutionDesc& desc, const CConstFloatHandle& source,
+		const CConstBFloat16Handle& filter, const CConstFloatHandle* freeTerm, const CFloatHandle& result ) override;
 	CChannelwiseConvolutionDesc* InitBlobChannelwiseConvolution( const CBlobDesc& input,
 		int paddingHeight, int paddingWidth, int strideHeight, int strideWidth,
 		const CBlobDesc& filter, const CBlobDesc* freeTerm, const CBlobDesc& output ) override;
@@ -531,6 +544,36 @@ public:
 	void IndRnnRecurrentLearn( bool reverse, int sequenceLength, int batchSize, int objectSize, TActivationFunction activation,
 		const CConstFloatHandle& mask, const CConstFloatHandle& u, const CConstFloatHandle& h, const CConstFloatHandle& hDiff,
 		const CFloatHandle& uDiff ) override;
+	void LstmSequence( bool reverse, int sequenceLength, int batchSize, int inputSize, int hiddenSize,
+		const CConstFloatHandle& input, const CConstFloatHandle& inputWeights, const CConstFloatHandle& recurWeights,
+		const CConstFloatHandle& inputFreeTerm, const CConstFloatHandle& recurFreeTerm,
+		const CConstFloatHandle& initialHidden, const CConstFloatHandle& initialCell,
+		const CFloatHandle& gates, const CFloatHandle& hidden, const CFloatHandle& cell ) override;
+	void LstmSequenceBackward( bool reverse, int sequenceLength, int batchSize, int inputSize, int hiddenSize,
+		const CConstFloatHandle& input, const CConstFloatHandle& inputWeights, const CConstFloatHandle& recurWeights,
+		const CConstFloatHandle& initialHidden, const CConstFloatHandle& initialCell,
+		const CConstFloatHandle& gates, const CConstFloatHandle& hidden, const CConstFloatHandle& cell,
+		const CConstFloatHandle& hiddenDiff, const CConstFloatHandle& cellDiff, const CFloatHandle& inputDiff,
+		const CFloatHandle& inputWeightsDiff, const CFloatHandle& recurWeightsDiff, const CFloatHandle& freeTermDiff ) override;
+	void GruSequence( bool reverse, int sequenceLength, int batchSize, int inputSize, int hiddenSize,
+		const CConstFloatHandle& input, const CConstFloatHandle& gateWeights, const CConstFloatHandle& gateFreeTerm,
+		const CConstFloatHandle& mainWeights, const CConstFloatHandle& mainFreeTerm,
+		const CConstFloatHandle& initialHidden, const CFloatHandle& gates, const CFloatHandle& hidden ) override;
+	void GruSequenceBackward( bool reverse, int sequenceLength, int batchSize, int inputSize, int hiddenSize,
+		const CConstFloatHandle& input, const CConstFloatHandle& gateWeights, const CConstFloatHandle& mainWeights,
+		const CConstFloatHandle& initialHidden, const CConstFloatHandle& gates, const CConstFloatHandle& hidden,
+		const CConstFloatHandle& hiddenDiff, const CFloatHandle& inputDiff,
+		const CFloatHandle& gateWeightsDiff, const CFloatHandle& gateFreeTermDiff,
+		const CFloatHandle& mainWeightsDiff, const CFloatHandle& mainFreeTermDiff ) override;
+	void ScaledDotProductAttention( int batchSize, int headCount, int queryLength, int keyLength, int headSize,
+		float scale, const CConstFloatHandle& query, const CConstFloatHandle& key, const CConstFloatHandle& value,
+		const CConstFloatHandle& mask, float maskMultiplier, const CFloatHandle& logSumExp,
+		const CFloatHandle& result ) override;
+	void ScaledDotProductAttentionBackward( int batchSize, int headCount, int queryLength, int keyLength,
+		int headSize, float scale, const CConstFloatHandle& query, const CConstFloatHandle& key,
+		const CConstFloatHandle& value, const CConstFloatHandle& mask, float maskMultiplier,
+		const CConstFloatHandle& logSumExp, const CConstFloatHandle& result, const CConstFloatHandle& resultDiff,
+		const CFloatHandle& queryDiff, const CFloatHandle& keyDiff, const CFloatHandle& valueDiff ) override;
 	CLrnDesc* InitLrn( const CBlobDesc& source, int windowSize, float bias, float alpha, float beta ) override;
 	void Lrn( const CLrnDesc& desc, const CConstFloatHandle& input, const CFloatHandle& invSum,
 		const CFloatHandle& invSumBeta, const CFloatHandle& outputHandle ) override;
@@ -1157,6 +1157,18 @@ void CVulkanMathEngine::MultiplyVectorByTransposedLookupVectorAndAddToTable( int
 	ASSERT_EXPR( false );
 }
 
+void CVulkanMathEngine::MultiplyQuantizedMatrixByTransposedMatrix( const CConstInt8Handle&, int, int, float,
+	const CConstInt8Handle&, int, const CConstFloatHandle&, const CFloatHandle&, int )
+{
+	ASSERT_NOT_SUPPORTED( "8-bit integer inference is not supported by the Vulkan math engine" );
+}
+
+void CVulkanMathEngine::MultiplyMatrixByTransposedBFloat16Matrix( const CConstFloatHandle&, int, int,
+	const CConstBFloat16Handle&, int, const CFloatHandle&, int )
+{
+	ASSERT_NOT_SUPPORTED( "bfloat16 is not supported by the Vulkan math engine" );
+}
+
 } // namespace NeoML
 
 #endif // NEOML_USE_VULKAN
@@ -632,6 +632,61 @@ void CVulkanMathEngine::IndRnnRecurrentLearn( bool /*reverse*/, int /*sequenceLe
 	ASSERT_EXPR( false );
 }
 
+void CVulkanMathEngine::LstmSequence( bool /*reverse*/, int /*sequenceLength*/, int /*batchSize*/, int /*inputSize*/, int /*hiddenSize*/,
+	const CConstFloatHandle& /*input*/, const CConstFloatHandle& /*inputWeights*/, const CConstFloatHandle& /*recurWeights*/,
+	const CConstFloatHandle& /*inputFreeTerm*/, const CConstFloatHandle& /*recurFreeTerm*/,
+	const CConstFloatHandle& /*initialHidden*/, const CConstFloatHandle& /*initialCell*/,
+	const CFloatHandle& /*gates*/, const CFloatHandle& /*hidden*/, const CFloatHandle& /*cell*/ )
+{
+	ASSERT_EXPR( false );
+}
+
+void CVulkanMathEngine::LstmSequenceBackward( bool /*reverse*/, int /*sequenceLength*/, int /*batchSize*/, int /*inputSize*/,
+	int /*hiddenSize*/, const CConstFloatHandle& /*input*/, const CConstFloatHandle& /*inputWeights*/,
+	const CConstFloatHandle& /*recurWeights*/, const CConstFloatHandle& /*initialHidden*/, const CConstFloatHandle& /*initialCell*/,
+	const CConstFloatHandle& /*gates*/, const CConstFloatHandle& /*hidden*/, const CConstFloatHandle& /*cell*/,
+	const CConstFloatHandle& /*hiddenDiff*/, const CConstFloatHandle& /*cellDiff*/, const CFloatHandle& /*inputDiff*/,
+	const CFloatHandle& /*inputWeightsDiff*/, const CFloatHandle& /*recurWeightsDiff*/, const CFloatHandle& /*freeTermDiff*/ )
+{
+	ASSERT_EXPR( false );
+}
+
+void CVulkanMathEngine::GruSequence( bool /*reverse*/, int /*sequenceLength*/, int /*batchSize*/, int /*inputSize*/, int /*hiddenSize*/,
+	const CConstFloatHandle& /*input*/, const CConstFloatHandle& /*gateWeights*/, const CConstFloatHandle& /*gateFreeTerm*/,
+	const CConstFloatHandle& /*mainWeights*/, const CConstFloatHandle& /*mainFreeTerm*/,
+	const CConstFloatHandle& /*initialHidden*/, const CFloatHandle& /*gates*/, const CFloatHandle& /*hidden*/ )
+{
+	ASSERT_EXPR( false );
+}
+
+void CVulkanMathEngine::GruSequenceBackward( bool /*reverse*/, int /*sequenceLength*/, int /*batchSize*/, int /*inputSize*/,
+	int /*hiddenSize*/, const CConstFloatHandle& /*input*/, const CConstFloatHandle& /*gateWeights*/,
+	const CConstFloatHandle& /*mainWeights*/, const CConstFloatHandle& /*initialHidden*/, const CConstFloatHandle& /*gates*/,
+	const CConstFloatHandle& /*hidden*/, const CConstFloatHandle& /*hiddenDiff*/, const CFloatHandle& /*inputDiff*/,
+	const CFloatHandle& /*gateWeightsDiff*/, const CFloatHandle& /*gateFreeTermDiff*/,
+	const CFloatHandle& /*mainWeightsDiff*/, const CFloatHandle& /*mainFreeTermDiff*/ )
+{
+	ASSERT_EXPR( false );
+}
+
+void CVulkanMathEngine::ScaledDotProductAttention( int /*batchSize*/, int /*headCount*/, int /*queryLength*/, int /*keyLength*/,
+	int /*headSize*/, float /*scale*/, const CConstFloatHandle& /*query*/, const CConstFloatHandle& /*key*/,
+	const CConstFloatHandle& /*value*/, const CConstFloatHandle& /*mask*/, float /*maskMultiplier*/,
+	const CFloatHandle& /*logSumExp*/, const CFloatHandle& /*result*/ )
+{
+	ASSERT_EXPR( false );
+}
+
+void CVulkanMathEngine::ScaledDotProductAttentionBackward( int /*batchSize*/, int /*headCount*/, int /*queryLength*/,
+	int /*keyLength*/, int /*headSize*/, float /*scale*/, const CConstFloatHandle& /*query*/,
+	const CConstFloatHandle& /*key*/, const CConstFloatHandle& /*value*/, const CConstFloatHandle& /*mask*/,
+	float /*maskMultiplier*/, const CConstFloatHandle& /*logSumExp*/, const CConstFloatHandle& /*result*/,
+	const CConstFloatHandle& /*resultDiff*/, const CFloatHandle& /*queryDiff*/, const CFloatHandle& /*keyDiff*/,
+	const CFloatHandle& /*valueDiff*/ )
+{
+	ASSERT_EXPR( false );
+}
+
 void CVulkanMathEngine::CtcLossForward( int /*resultLen*/, int /*batchSize*/, int /*classCount*/, int /*labelLen*/,
 	int /*blankLabel*/, bool /*skipBlanks*/, const CConstFloatHandle& /*result*/, const CConstIntHandle& /*labels*/,
 	const CConstIntHandle& /*labelLens*/, const CConstIntHandle& /*resultLens*/, const CConstFloatHandle& /*labelWeights*/,
@@ -1061,6 +1061,18 @@ void CVulkanMathEngine::BlobChannelwiseConvolutionLearnAdd( const CChannelwiseCo
 	ASSERT_EXPR( false );
 }
 
+void CVulkanMathEngine::BlobQuantizedConvolution( const CConvolutionDesc&, const CConstFloatHandle&, float,
+	const CConstInt8Handle&, const CConstFloatHandle&, const CConstFloatHandle*, const CFloatHandle& )
+{
+	ASSERT_NOT_SUPPORTED( "8-bit integer inference is not supported by the Vulkan math engine" );
+}
+
+void CVulkanMathEngine::BlobBFloat16Convolution( const CConvolutionDesc&, const CConstFloatHandle&,
+	const CConstBFloat16Handle&, const CConstFloatHandle*, const CFloatHandle& )
+{
+	ASSERT_NOT_SUPPORTED( "bfloat16 is not supported by the Vulkan math engine" );
+}
+
 } // namespace NeoML
 
 #endif // NEOML_USE_VULKAN
@@ -1104,6 +1104,21 @@ void CVulkanMathEngine::VectorMinMaxDiff(const CConstFloatHandle& sourceGradHand
 	ASSERT_EXPR( false );
 }
 
+void CVulkanMathEngine::VectorQuantize( const CConstFloatHandle&, const CInt8Handle&, int, float )
+{
+	ASSERT_NOT_SUPPORTED( "8-bit integer inference is not supported by the Vulkan math engine" );
+}
+
+void CVulkanMathEngine::VectorConvert( const CConstFloatHandle&, const CBFloat16Handle&, int )
+{
+	ASSERT_NOT_SUPPORTED( "bfloat16 is not supported by the Vulkan math engine" );
+}
+
+void CVulkanMathEngine::VectorConvert( const CConstBFloat16Handle&, const CFloatHandle&, int )
+{
+	ASSERT_NOT_SUPPORTED( "bfloat16 is not supported by the Vulkan math engine" );
+}
+
 } // namespace NeoML
 
 #endif // NEOML_USE_VULKAN
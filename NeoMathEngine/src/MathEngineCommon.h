@@ -18,6 +18,10 @@ limitations under the License.
 #include <cassert>
 #include <NeoMathEngine/NeoMathEngine.h>
 
+// Reports the call of the operation which is not implemented in this math engine
+#define ASSERT_NOT_SUPPORTED( message ) \
+	NeoML::GetMathEngineExceptionHandler()->OnAssert( message, __UNICODEFILE__, __LINE__, 0 )
+
 namespace NeoML {
 
 inline int Ceil( int val, int discret )
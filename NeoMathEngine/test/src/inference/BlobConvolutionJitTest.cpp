@@ -26,8 +26,9 @@ static inline int calcConvOutputSize( int input, int padding, int filter, int di
     return  1 + ( input - ( filter - 1 ) * dilation + 2 * padding - 1 ) / stride;
 }
 
+// Also calculates the sum of the absolute values of the summed products (the magnitude) for each output
 static void batchConvolutionForward( const float* input, const float* filter, const float* freeTerms, float* output,
-    int inputLength, int inputBatch, int inputHeight, int inputWidth, int inputDepth, int inputChannels,
+    float* magnitudes, int inputLength, int inputBatch, int inputHeight, int inputWidth, int inputDepth, int inputChannels,
     int paddingHeight, int paddingWidth, int filterCount, int filterHeight, int filterWidth,
     int dilationHeight, int dilationWidth, int strideHeight, int strideWidth )
 {
@@ -44,6 +45,7 @@ static void batchConvolutionForward( const float* input, const float* filter, co
                 for( int outChannel = 0; outChannel < filterCount; ++outChannel ) {
                     const int outputIndex = b * outputObjectSize + h * outputWidth * filterCount + w * filterCount + outChannel;
                     output[outputIndex] = freeTerms[outChannel];
+                    magnitudes[outputIndex] = fabsf( freeTerms[outChannel] );
 
                     for( int filterH = 0; filterH < filterHeight; ++filterH ) {
                         for( int filterW = 0; filterW < filterWidth; ++filterW ) {
@@ -56,6 +58,7 @@ static void batchConvolutionForward( const float* input, const float* filter, co
                                     const int filterIndex = outChannel * filterObjectSize + filterH * filterWidth * channels + filterW * channels + inChannel;
 
                                     output[outputIndex] += filter[filterIndex] * input[inputIndex];
+                                    magnitudes[outputIndex] += fabsf( filter[filterIndex] * input[inputIndex] );
                                 }
                             }
                         }
@@ -66,6 +69,14 @@ static void batchConvolutionForward( const float* input, const float* filter, co
     }
 }
 
+// The optimized kernels use FMA and sum the products in another order than the reference does
+// The rounding error of such sums depends on the magnitude of the products, not on the result
+// which may be close to zero because of the cancellation
+static bool isConvolutionResultEq( float expected, float actual, float magnitude )
+{
+    return FloatEq( expected, actual, 1e-5 ) || fabsf( expected - actual ) <= 1e-5f * magnitude;
+}
+
 static void blobConvolutionImpl( const CTestParams& params, int seed )
 {
     CRandom random( seed );
@@ -134,15 +145,16 @@ static void blobConvolutionImpl( const CTestParams& params, int seed )
         delete convDesc;
 
         std::vector<float> expectedData( outputSize );
+        std::vector<float> magnitudes( outputSize );
 
         batchConvolutionForward( inputData.data(), filterData.data(), freeTermData.data(), expectedData.data(),
-            inputLength, inputBatch, inputHeight, inputWidth, inputDepth, channelCount,
+            magnitudes.data(), inputLength, inputBatch, inputHeight, inputWidth, inputDepth, channelCount,
             paddingHeight, paddingWidth, filterCount, filterHeight, filterWidth,
             dilationHeight, dilationWidth, strideHeight, strideWidth );
 
         for( int i = 0; i < outputSize; ++i ) {
             
-            bool res = FloatEq( expectedData[i], actualData[i], 1e-5 );
+            bool res = isConvolutionResultEq( expectedData[i], actualData[i], magnitudes[i] );
             if( !res ) {
                 GTEST_LOG_( ERROR ) << "\n                FC  FW  FH  DW  DH  SW  SH  PW  PH SrcW SrcH FT\n" <<
                     "ConvParams: " << params.GetStrValue( "MainParams" ) << std::endl <<
@@ -185,10 +197,11 @@ CTestParams JitTestParams[] = {
     CTestParams( "MainParams = {   8,  3,  3,  1,  1,  1,  1,  1,  1,   3,   3, 1 }; ChCount = (1..29); TestCount = 1;" ),
     CTestParams( "MainParams = {   8,  9,  9,  1,  1,  1,  1,  4,  1,  97,  37, 1 }; ChCount = (1..17); TestCount = 1;" ),
     // FC = 16
-    // Kernels: wide - 1x5
+    // Kernels: wide - 1x5 (1x12 for AVX-512)
     // channelCount: batch - 1; single - 4
     //                            FC  FW  FH  DW  DH  SW  SH  PW  PH SrcW SrcH FT
     CTestParams( "MainParams = {  16,  3,  3,  1,  1,  1,  1,  1,  1,   7,   3, 1 }; ChCount = (1..2); TestCount = 1;" ),
+    CTestParams( "MainParams = {  16,  3,  3,  1,  1,  1,  1,  1,  1,  14,   3, 1 }; ChCount = (1..5); TestCount = 1;" ),
     CTestParams( "MainParams = {  16,  3,  3,  1,  1,  1,  1,  1,  1,   3,   3, 1 }; ChCount = (1..5); TestCount = 1;" ),
     CTestParams( "MainParams = {  16,  9,  9,  1,  1,  1,  1,  4,  1,  97,  37, 1 }; ChCount = (1..5); TestCount = 1;" ),
     // FC = 18
@@ -206,10 +219,11 @@ CTestParams JitTestParams[] = {
     CTestParams( "MainParams = {  24,  3,  3,  1,  1,  1,  1,  1,  1,   3,   3, 1 }; ChCount = (1..15); TestCount = 1;" ),
     CTestParams( "MainParams = {  24,  9,  9,  1,  1,  1,  1,  4,  1,  97,  37, 1 }; ChCount = (1..25); TestCount = 1;" ),
     // FC = 32
-    // Kernels: wide - 1x2
+    // Kernels: wide - 1x2 (1x8 for AVX-512)
     // channelCount: batch - 16; single - 8
     //                            FC  FW  FH  DW  DH  SW  SH  PW  PH SrcW SrcH FT
     CTestParams( "MainParams = {  32,  3,  3,  1,  1,  1,  1,  1,  1,   4,   3, 1 }; ChCount = (1..17); TestCount = 1;" ),
+    CTestParams( "MainParams = {  32,  3,  3,  1,  1,  1,  1,  1,  1,  10,   3, 1 }; ChCount = (1..17); TestCount = 1;" ),
     CTestParams( "MainParams = {  32,  3,  3,  1,  1,  1,  1,  1,  1,   3,   3, 1 }; ChCount = (1..15); TestCount = 1;" ),
     CTestParams( "MainParams = {  32,  9,  9,  1,  1,  1,  1,  4,  1,  97,  37, 1 }; ChCount = (1..17); TestCount = 1;" ),
     // Huge JIT
@@ -227,7 +241,29 @@ CTestParams JitTestParams[] = {
     CTestParams( "MainParams = {  18,  9,  3,  3,  1,  3,  1,  2,  1,  27,   3, 1 }; ChCount = (7..7); TestCount = 1;" ),
     CTestParams( "MainParams = {  18,  9,  3,  3,  1,  3,  1,  3,  1,  27,   3, 1 }; ChCount = (7..7); TestCount = 1;" ),
     CTestParams( "MainParams = {  18,  9,  3,  3,  1,  3,  1,  4,  1,  27,   3, 1 }; ChCount = (7..7); TestCount = 1;" ),
-    CTestParams( "MainParams = {  18,  9,  3,  3,  1,  3,  1,  5,  1,  27,   3, 1 }; ChCount = (7..7); TestCount = 1;" )
+    CTestParams( "MainParams = {  18,  9,  3,  3,  1,  3,  1,  5,  1,  27,   3, 1 }; ChCount = (7..7); TestCount = 1;" ),
+    // Even filters (extended with zeroes to the odd size)
+    //                            FC  FW  FH  DW  DH  SW  SH  PW  PH SrcW SrcH FT
+    CTestParams( "MainParams = {   8,  2,  2,  1,  1,  1,  1,  0,  0,  17,   5, 1 }; ChCount = (1..5); TestCount = 1;" ),
+    CTestParams( "MainParams = {  16,  2,  2,  1,  1,  2,  2,  0,  0,  16,   8, 1 }; ChCount = (3..3); TestCount = 1;" ),
+    CTestParams( "MainParams = {   6,  4,  4,  1,  1,  1,  1,  1,  2,  15,   9, 1 }; ChCount = (1..3); TestCount = 1;" ),
+    CTestParams( "MainParams = {  24,  4,  2,  2,  3,  1,  1,  1,  1,  21,  11, 1 }; ChCount = (5..5); TestCount = 1;" ),
+    CTestParams( "MainParams = {  32,  2,  3,  2,  1,  1,  2,  1,  1,  19,   7, 0 }; ChCount = (4..4); TestCount = 1;" ),
+    CTestParams( "MainParams = {   3,  4,  4,  1,  1,  2,  2,  1,  1,  30,  12, 1 }; ChCount = (2..2); TestCount = 1;" ),
+    // Filter counts processed in several chunks
+    //                            FC  FW  FH  DW  DH  SW  SH  PW  PH SrcW SrcH FT
+    CTestParams( "MainParams = {  40,  3,  3,  1,  1,  1,  1,  1,  1,  13,   5, 1 }; ChCount = (1..9); TestCount = 1;" ),
+    CTestParams( "MainParams = {  48,  3,  3,  1,  1,  1,  1,  1,  1,  11,   4, 0 }; ChCount = (3..3); TestCount = 1;" ),
+    CTestParams( "MainParams = {  56,  3,  3,  2,  2,  1,  1,  2,  2,  17,   9, 1 }; ChCount = (5..5); TestCount = 1;" ),
+    CTestParams( "MainParams = {  64,  3,  3,  1,  1,  1,  1,  1,  1,  14,   6, 1 }; ChCount = (1..4); TestCount = 1;" ),
+    CTestParams( "MainParams = { 128,  2,  2,  1,  1,  1,  1,  0,  0,  10,   6, 1 }; ChCount = (8..8); TestCount = 1;" ),
+    // The tail of less than 8 filters
+    //                            FC  FW  FH  DW  DH  SW  SH  PW  PH SrcW SrcH FT
+    CTestParams( "MainParams = {  20,  3,  3,  1,  1,  1,  1,  1,  1,  13,   5, 1 }; ChCount = (1..4); TestCount = 1;" ),
+    CTestParams( "MainParams = {  13,  3,  3,  1,  1,  1,  1,  1,  1,  12,   7, 0 }; ChCount = (3..3); TestCount = 1;" ),
+    CTestParams( "MainParams = {  45,  3,  3,  2,  2,  1,  1,  2,  2,  17,   9, 1 }; ChCount = (5..5); TestCount = 1;" ),
+    CTestParams( "MainParams = {   9,  2,  2,  1,  1,  1,  1,  0,  0,  16,   8, 1 }; ChCount = (2..2); TestCount = 1;" ),
+    CTestParams( "MainParams = {  71,  5,  5,  1,  1,  1,  1,  2,  2,  11,   6, 1 }; ChCount = (3..3); TestCount = 1;" )
 };
 
 INSTANTIATE_TEST_CASE_P( CMathEngineBlobConvolutionJitTestInstantiation, CMathEngineBlobConvolutionJitTest,
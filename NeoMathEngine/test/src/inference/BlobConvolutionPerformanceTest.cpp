@@ -26,8 +26,9 @@ static inline int calcConvOutputSize( int input, int padding, int filter, int di
 	return  1 + ( input - ( filter - 1 ) * dilation + 2 * padding - 1 ) / stride;
 }
 
+// Also calculates the sum of the absolute values of the summed products (the magnitude) for each output
 static void batchConvolutionForward( const float* input, const float* filter, const float* freeTerms, float* output,
-	int inputLength, int inputBatch, int inputHeight, int inputWidth, int inputDepth, int inputChannels,
+	float* magnitudes, int inputLength, int inputBatch, int inputHeight, int inputWidth, int inputDepth, int inputChannels,
 	int paddingHeight, int paddingWidth, int filterCount, int filterHeight, int filterWidth,
 	int dilationHeight, int dilationWidth, int strideHeight, int strideWidth )
 {
@@ -44,6 +45,7 @@ static void batchConvolutionForward( const float* input, const float* filter, co
 				for( int outChannel = 0; outChannel < filterCount; ++outChannel ) {
 					const int outputIndex = b * outputObjectSize + h * outputWidth * filterCount + w * filterCount + outChannel;
 					output[outputIndex] = freeTerms[outChannel];
+					magnitudes[outputIndex] = fabsf( freeTerms[outChannel] );
 
 					for( int filterH = 0; filterH < filterHeight; ++filterH ) {
 						for( int filterW = 0; filterW < filterWidth; ++filterW ) {
@@ -56,6 +58,7 @@ static void batchConvolutionForward( const float* input, const float* filter, co
 									const int filterIndex = outChannel * filterObjectSize + filterH * filterWidth * channels + filterW * channels + inChannel;
 
 									output[outputIndex] += filter[filterIndex] * input[inputIndex];
+									magnitudes[outputIndex] += fabsf( filter[filterIndex] * input[inputIndex] );
 								}
 							}
 						}
@@ -66,6 +69,14 @@ static void batchConvolutionForward( const float* input, const float* filter, co
 	}
 }
 
+// The optimized kernels use FMA and sum the products in another order than the reference does
+// The rounding error of such sums depends on the magnitude of the products, not on the result
+// which may be close to zero because of the cancellation
+static bool isConvolutionResultEq( float expected, float actual, float magnitude )
+{
+	return FloatEq( expected, actual, 1e-5 ) || fabsf( expected - actual ) <= 1e-5f * magnitude;
+}
+
 static void blobConvolutionImpl( const CTestParams& params, int seed )
 {
 	CRandom random( seed );
@@ -141,14 +152,15 @@ static void blobConvolutionImpl( const CTestParams& params, int seed )
 	delete convDesc;
 	
 	std::vector<float> expectedData( outputSize );
+	std::vector<float> magnitudes( outputSize );
 
 	batchConvolutionForward( inputData.data(), filterData.data(), freeTermData.data(), expectedData.data(),
-		inputLength, inputBatch, inputHeight, inputWidth, inputDepth, inputChannels,
+		magnitudes.data(), inputLength, inputBatch, inputHeight, inputWidth, inputDepth, inputChannels,
 		paddingHeight, paddingWidth, filterCount, filterHeight, filterWidth,
 		dilationHeight, dilationWidth, strideHeight, strideWidth );
 
 	for( int i = 0; i < outputSize; ++i ) {
-		ASSERT_TRUE( FloatEq( expectedData[i], actualData[i] ) );
+		ASSERT_TRUE( isConvolutionResultEq( expectedData[i], actualData[i], magnitudes[i] ) );
 	}
 }
 
@@ -675,6 +675,27 @@ INSTANTIATE_TEST_CASE_P( CMathEngineBlobConvolutionTestInstantiation, CMathEngin
 			"IsZeroFreeTerm = 0;"
 			"Values = (-10..10);"
 			"TestCount = 1;"
+		),
+		CTestParams(
+			// The Winograd algorithm
+			"InputLength = 1;"
+			"InputBatch = (1..3);"
+			"InputHeight = (4..19);"
+			"InputWidth = (4..19);"
+			"InputDepth = (1..2);"
+			"InputChannels = (16..24);"
+			"FilterCount = (16..40);"
+			"FilterHeight = 3;"
+			"FilterWidth = 3;"
+			"PaddingHeight = (0..2);"
+			"PaddingWidth = (0..2);"
+			"DilationHeight = 1;"
+			"DilationWidth = 1;"
+			"StrideHeight = 1;"
+			"StrideWidth = 1;"
+			"IsZeroFreeTerm = (0..1);"
+			"Values = (-1..1);"
+			"TestCount = 20;"
 		)
 	)
 );
@@ -96,6 +96,50 @@ static void batchMultiplyMatrixByTransposedMatrixTestImpl( const CTestParams& pa
 	}
 }
 
+static void multiplyMatrixByTransposedBFloat16MatrixTestImpl( const CTestParams& params, int seed )
+{
+	if( MathEngine().GetType() != MET_Cpu ) {
+		return;
+	}
+
+	CRandom random( seed );
+
+	const CInterval heightInterval = params.GetInterval( "Height" );
+	const CInterval widthInterval = params.GetInterval( "Width" );
+	const CInterval valuesInterval = params.GetInterval( "Values" );
+
+	const int secondHeight = random.UniformInt( heightInterval.Begin, heightInterval.End );
+	const int firstHeight = random.UniformInt( heightInterval.Begin, heightInterval.End );
+	const int firstWidth = random.UniformInt( widthInterval.Begin, widthInterval.End );
+
+	CREATE_FILL_FLOAT_ARRAY( a, valuesInterval.Begin, valuesInterval.End, firstHeight * firstWidth, random )
+	// The second matrix values are taken exactly representable in bfloat16
+	std::vector<uint16_t> b;
+	b.resize( firstWidth * secondHeight );
+	std::vector<float> bFloat;
+	bFloat.resize( b.size() );
+	for( size_t i = 0; i < b.size(); ++i ) {
+		const float value = static_cast<float>( random.Uniform( valuesInterval.Begin, valuesInterval.End ) );
+		uint32_t bits;
+		memcpy( &bits, &value, sizeof( bits ) );
+		b[i] = static_cast<uint16_t>( bits >> 16 );
+		bits = static_cast<uint32_t>( b[i] ) << 16;
+		memcpy( &bFloat[i], &bits, sizeof( bits ) );
+	}
+
+	std::vector<float> exp;
+	exp.insert( exp.begin(), firstHeight * secondHeight, 0.f );
+	multiplyMatrixByTransposedMatrixAndAddNaive( 1, a, bFloat, firstHeight, firstWidth, secondHeight, exp );
+
+	std::vector<float> result;
+	result.resize( firstHeight * secondHeight );
+	MathEngine().MultiplyMatrixByTransposedBFloat16Matrix( CARRAY_FLOAT_WRAPPER( a ), firstHeight, firstWidth,
+		CARRAY_WRAPPER( uint16_t, b ), secondHeight, CARRAY_FLOAT_WRAPPER( result ), firstHeight * secondHeight );
+
+	for( int i = 0; i < firstHeight * secondHeight; ++i ) {
+		ASSERT_NEAR( exp[i], result[i], 1e-3 );
+	}
+}
 
 //---------------------------------------------------------------------------------------------------------------------
 
@@ -124,6 +168,11 @@ TEST_P( CMultiplyMatrixByTransposedMatrixTest, Random )
 	RUN_TEST_IMPL( multiplyMatrixByTransposedMatrixTestImpl )
 }
 
+TEST_P( CMultiplyMatrixByTransposedMatrixTest, BFloat16Random )
+{
+	RUN_TEST_IMPL( multiplyMatrixByTransposedBFloat16MatrixTestImpl )
+}
+
 class CBatchMultiplyMatrixByTransposedMatrixTest : public CTestFixtureWithParams {
 };
 
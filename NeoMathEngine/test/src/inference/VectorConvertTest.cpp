@@ -52,6 +52,77 @@ static void vectorConvertIntToFloatTestImpl( const CTestParams& params, int seed
 	}
 }
 
+// The bfloat16 value nearest to the float (the ties are rounded to even)
+static uint16_t floatToBFloat16( float value )
+{
+	uint32_t bits;
+	memcpy( &bits, &value, sizeof( bits ) );
+	if( ( bits & 0x7fffffff ) > 0x7f800000 ) {
+		return static_cast<uint16_t>( ( bits >> 16 ) | 0x40 );
+	}
+	const uint32_t rest = bits & 0xffff;
+	uint32_t result = bits >> 16;
+	if( rest > 0x8000 || ( rest == 0x8000 && ( result & 1 ) != 0 ) ) {
+		result++;
+	}
+	return static_cast<uint16_t>( result );
+}
+
+static void vectorConvertFloatToBFloat16TestImpl( const CTestParams& params, int seed )
+{
+	if( MathEngine().GetType() != MET_Cpu ) {
+		return;
+	}
+
+	CRandom random( seed );
+
+	const CInterval vectorSizeInterval = params.GetInterval( "VectorSize" );
+	const int vectorSize = random.UniformInt( vectorSizeInterval.Begin, vectorSizeInterval.End );
+
+	CREATE_FILL_FLOAT_ARRAY( fromArr, -100500.f, 123456.f, vectorSize, random );
+	// The values which are exactly between two bfloat16 values and the special values
+	const float specialValues[] = { 1.00390625f, 1.01171875f, -1.00390625f, 0.f, -0.f,
+		std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(),
+		std::numeric_limits<float>::quiet_NaN(), std::numeric_limits<float>::max(), std::numeric_limits<float>::denorm_min() };
+	for( int i = 0; i < vectorSize; i += 7 ) {
+		fromArr[i] = specialValues[random.UniformInt( 0, sizeof( specialValues ) / sizeof( float ) - 1 )];
+	}
+	std::vector<uint16_t> toArr;
+	toArr.resize( vectorSize );
+
+	MathEngine().VectorConvert( CARRAY_FLOAT_WRAPPER( fromArr ), CARRAY_WRAPPER( uint16_t, toArr ), vectorSize );
+	for( int i = 0; i < vectorSize; ++i ) {
+		ASSERT_EQ( floatToBFloat16( fromArr[i] ), toArr[i] ) << fromArr[i];
+	}
+}
+
+static void vectorConvertBFloat16ToFloatTestImpl( const CTestParams& params, int seed )
+{
+	if( MathEngine().GetType() != MET_Cpu ) {
+		return;
+	}
+
+	CRandom random( seed );
+
+	const CInterval vectorSizeInterval = params.GetInterval( "VectorSize" );
+	const int vectorSize = random.UniformInt( vectorSizeInterval.Begin, vectorSizeInterval.End );
+
+	std::vector<uint16_t> fromArr;
+	fromArr.resize( vectorSize );
+	for( int i = 0; i < vectorSize; ++i ) {
+		fromArr[i] = static_cast<uint16_t>( random.UniformInt( 0, 0xffff ) );
+	}
+	std::vector<float> toArr;
+	toArr.resize( vectorSize );
+
+	MathEngine().VectorConvert( CARRAY_WRAPPER( uint16_t, fromArr ), CARRAY_FLOAT_WRAPPER( toArr ), vectorSize );
+	for( int i = 0; i < vectorSize; ++i ) {
+		uint32_t bits;
+		memcpy( &bits, &toArr[i], sizeof( bits ) );
+		ASSERT_EQ( static_cast<uint32_t>( fromArr[i] ) << 16, bits ) << i;
+	}
+}
+
 //------------------------------------------------------------------------------------------------------------
 
 class CMathEngineVectorConvertTest : public CTestFixtureWithParams {
@@ -83,3 +154,13 @@ TEST_P( CMathEngineVectorConvertTest, IntToFloatRandom )
 {
 	RUN_TEST_IMPL( vectorConvertIntToFloatTestImpl );
 }
+
+TEST_P( CMathEngineVectorConvertTest, FloatToBFloat16Random )
+{
+	RUN_TEST_IMPL( vectorConvertFloatToBFloat16TestImpl );
+}
+
+TEST_P( CMathEngineVectorConvertTest, BFloat16ToFloatRandom )
+{
+	RUN_TEST_IMPL( vectorConvertBFloat16ToFloatTestImpl );
+}
@@ -37,7 +37,8 @@ enum TDnnErrorType {
 	DET_NoAvailableCPU, // no CPU available
 	DET_InvalidParameter, // parameter value is invalid
 	DET_RunDnnError, // error when running the network, details in error description
-	DET_LoadDnnError // error when loading the network, details in error description
+	DET_LoadDnnError, // error when loading the network, details in error description
+	DET_Timeout // the operation has not finished in the given time
 };
 
 // Error description
@@ -167,4 +168,76 @@ NEOPROXY_API const char* GetOutputName( const struct CDnnDesc* dnn, int index, s
 // If an error occurs its description will be written into the errorInfo parameter and the function will return 0
 NEOPROXY_API const struct CDnnBlobDesc* GetOutputBlob( const struct CDnnDesc* dnn, int index, struct CDnnErrorInfo* errorInfo );
 
+//------------------------------------------------------------------------------------------------------------
+// Dynamic batching functions
+
+// The batcher collects single-sample requests submitted from many threads into batches
+// and runs the network once per batch on its own thread
+// The requests are merged along the BatchWidth dimension; only the requests with the same input sizes are merged
+// While the batcher exists the network must not be used directly
+struct NEOPROXY_API CDnnBatcherDesc {
+	const CDnnDesc* Dnn; // the network
+	int MaxBatchSize; // the maximum number of requests in one batch
+	int MaxLatency; // the maximum time in milliseconds a request waits for the batch to fill up
+};
+
+// The queue metrics of the batcher
+struct NEOPROXY_API CDnnBatcherStats {
+	long long SubmittedCount; // the number of submitted requests
+	long long CompletedCount; // the number of successfully processed requests
+	long long FailedCount; // the number of requests which failed to run
+	long long BatchCount; // the number of network runs
+	int QueueLength; // the number of requests waiting in the queue now
+	int MaxQueueLength; // the largest number of requests ever waiting in the queue
+	float AverageBatchSize; // the average number of requests in a batch
+	float AverageQueueTime; // the average time in milliseconds from submitting a request to running its batch
+	float AverageRunTime; // the average time in milliseconds of one network run
+};
+
+// The request descriptor
+struct NEOPROXY_API CDnnRequestDesc {
+	const CDnnBatcherDesc* Batcher; // the batcher which processes the request; not valid after the batcher is destroyed
+};
+
+// The function called on the batcher thread after the request is processed (successfully or not)
+typedef void ( *TDnnRequestCallback )( const struct CDnnRequestDesc* request, void* userData );
+
+// Creates a batcher for the network
+// The batcher should be destroyed after use with the help of the DestroyDnnBatcher function
+// If an error occurs its description will be written into the errorInfo parameter and the function will return 0
+NEOPROXY_API const struct CDnnBatcherDesc* CreateDnnBatcher( const struct CDnnDesc* dnn, int maxBatchSize, int maxLatency,
+	struct CDnnErrorInfo* errorInfo );
+
+// Destroys the batcher
+// The requests still in the queue are processed before the function returns
+// The processed requests and their outputs may be used until they are destroyed
+NEOPROXY_API void DestroyDnnBatcher( const struct CDnnBatcherDesc* batcher );
+
+// Puts a request into the queue and returns immediately
+// The inputs array contains InputCount blobs, each with BatchWidth equal to 1; their data is copied
+// The callback (may be 0) is called with the userData once the request is processed
+// The request should be destroyed after use with the help of the DestroyDnnRequest function
+// If an error occurs its description will be written into the errorInfo parameter and the function will return 0
+NEOPROXY_API const struct CDnnRequestDesc* SubmitDnnRequest( const struct CDnnBatcherDesc* batcher,
+	const struct CDnnBlobDesc* const* inputs, TDnnRequestCallback callback, void* userData, struct CDnnErrorInfo* errorInfo );
+
+// Waits until the request is processed; a negative timeout means waiting without limit
+// Returns false if the request has not been processed in time (DET_Timeout) or has failed
+// If an error occurs its description will be written into the errorInfo parameter
+NEOPROXY_API bool WaitDnnRequest( const struct CDnnRequestDesc* request, int timeout, struct CDnnErrorInfo* errorInfo );
+
+// Retrieves the output blob of the processed request; its BatchWidth is 1
+// The blob should be destroyed after use with the help of the DestroyDnnBlob function
+// If an error occurs its description will be written into the errorInfo parameter and the function will return 0
+NEOPROXY_API const struct CDnnBlobDesc* GetDnnRequestOutput( const struct CDnnRequestDesc* request, int index,
+	struct CDnnErrorInfo* errorInfo );
+
+// Destroys the request; a request still in the queue is processed but its results are dropped
+NEOPROXY_API void DestroyDnnRequest( const struct CDnnRequestDesc* request );
+
+// Retrieves the queue metrics of the batcher
+// If an error occurs its description will be written into the errorInfo parameter and the function will return false
+NEOPROXY_API bool GetDnnBatcherStats( const struct CDnnBatcherDesc* batcher, struct CDnnBatcherStats* stats,
+	struct CDnnErrorInfo* errorInfo );
+
 } // extern "C"
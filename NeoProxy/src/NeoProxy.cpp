@@ -23,6 +23,10 @@ limitations under the License.
 #include <NeoOnnx/NeoOnnx.h>
 
 #include <cstdio>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 using namespace NeoML;
 
@@ -762,4 +766,504 @@ const struct CDnnBlobDesc* GetOutputBlob( const struct CDnnDesc* dnnDesc, int in
 	return nullptr;
 }
 
+//------------------------------------------------------------------------------------------------------------
+// CDnnRequestDesc implementation
+
+// The single-sample request
+// It is referenced by the caller until DestroyDnnRequest and by the batcher until it is processed
+class CDnnRequestDescImpl : public CDnnRequestDesc, public IObject {
+public:
+	CDnnRequestDescImpl( const CDnnBatcherDesc* batcher, const CObjectArray<CDnnBlob>& inputs,
+		TDnnRequestCallback callback, void* userData );
+
+	// The network is used instead of the batcher, which may be destroyed before the request
+	const CDnnDescImpl& DnnDesc() const { return dnn; }
+	const CObjectArray<CDnnBlob>& Inputs() const { return inputs; }
+	std::chrono::steady_clock::time_point SubmitTime() const { return submitTime; }
+	// Checks if the request may be processed in one batch with the other one
+	bool CanBatchWith( const CDnnRequestDescImpl& other ) const;
+
+	// Called by the batcher thread; the outputs are empty if the request has failed
+	void Complete( const CObjectArray<CDnnBlob>& outputs, const CDnnErrorInfo& error );
+
+	bool Wait( int timeout, struct CDnnErrorInfo* errorInfo ) const;
+	CPtr<CDnnBlob> GetOutput( int index, struct CDnnErrorInfo* errorInfo ) const;
+
+	// The reference held by the caller
+	const CDnnRequestDesc* AttachToCaller() { callerReference = this; return this; }
+	void DetachFromCaller();
+
+private:
+	const CDnnDescImpl& dnn;
+	CObjectArray<CDnnBlob> inputs;
+	const TDnnRequestCallback callback;
+	void* const userData;
+	const std::chrono::steady_clock::time_point submitTime;
+	CPtr<CDnnRequestDescImpl> callerReference;
+
+	mutable std::mutex mutex;
+	mutable std::condition_variable completed;
+	bool isCompleted;
+	CObjectArray<CDnnBlob> outputs;
+	CDnnErrorInfo error;
+};
+
+CDnnRequestDescImpl::CDnnRequestDescImpl( const CDnnBatcherDesc* batcher, const CObjectArray<CDnnBlob>& _inputs,
+		TDnnRequestCallback _callback, void* _userData ) :
+	dnn( *static_cast<const CDnnDescImpl*>( batcher->Dnn ) ),
+	callback( _callback ),
+	userData( _userData ),
+	submitTime( std::chrono::steady_clock::now() ),
+	isCompleted( false )
+{
+	CDnnRequestDesc::Batcher = batcher;
+	_inputs.CopyTo( inputs );
+	initErrorInfo( DET_OK, "", &error );
+}
+
+bool CDnnRequestDescImpl::CanBatchWith( const CDnnRequestDescImpl& other ) const
+{
+	for( int i = 0; i < inputs.Size(); ++i ) {
+		if( inputs[i]->GetDataType() != other.inputs[i]->GetDataType()
+			|| !inputs[i]->HasEqualDimensions( other.inputs[i] ) )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void CDnnRequestDescImpl::Complete( const CObjectArray<CDnnBlob>& newOutputs, const CDnnErrorInfo& newError )
+{
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+		newOutputs.CopyTo( outputs );
+		error = newError;
+		isCompleted = true;
+	}
+	completed.notify_all();
+
+	if( callback != nullptr ) {
+		callback( this, userData );
+	}
+}
+
+bool CDnnRequestDescImpl::Wait( int timeout, struct CDnnErrorInfo* errorInfo ) const
+{
+	std::unique_lock<std::mutex> lock( mutex );
+	if( timeout < 0 ) {
+		completed.wait( lock, [this] { return isCompleted; } );
+	} else if( !completed.wait_for( lock, std::chrono::milliseconds( timeout ), [this] { return isCompleted; } ) ) {
+		initErrorInfo( DET_Timeout, "The request has not been processed yet.", errorInfo );
+		return false;
+	}
+
+	if( error.Type != DET_OK ) {
+		initErrorInfo( error.Type, error.Description, errorInfo );
+		return false;
+	}
+	return true;
+}
+
+CPtr<CDnnBlob> CDnnRequestDescImpl::GetOutput( int index, struct CDnnErrorInfo* errorInfo ) const
+{
+	std::lock_guard<std::mutex> lock( mutex );
+	if( !isCompleted ) {
+		initErrorInfo( DET_RunDnnError, "The request has not been processed yet.", errorInfo );
+		return nullptr;
+	}
+	if( error.Type != DET_OK ) {
+		initErrorInfo( error.Type, error.Description, errorInfo );
+		return nullptr;
+	}
+	if( index < 0 || index >= outputs.Size() ) {
+		initErrorInfo( DET_InvalidParameter, "Invalid index.", errorInfo );
+		return nullptr;
+	}
+	return outputs[index];
+}
+
+void CDnnRequestDescImpl::DetachFromCaller()
+{
+	// The request may be destroyed here, so the reference is released after the member is cleared
+	CPtr<CDnnRequestDescImpl> self = callerReference;
+	callerReference = nullptr;
+}
+
+//------------------------------------------------------------------------------------------------------------
+// CDnnBatcherDesc implementation
+
+class CDnnBatcherImpl : public CDnnBatcherDesc {
+public:
+	CDnnBatcherImpl( const CDnnDescImpl* dnn, int maxBatchSize, int maxLatency );
+	~CDnnBatcherImpl();
+
+	const CDnnDescImpl& DnnDesc() const { return dnn; }
+
+	void Submit( CDnnRequestDescImpl* request );
+	void GetStats( CDnnBatcherStats& result ) const;
+
+private:
+	const CDnnDescImpl& dnn;
+	const CDnnMathEngineDescImpl& mathEngineDesc;
+
+	std::thread thread;
+	mutable std::mutex mutex;
+	// Signaled when a request is submitted and when the batcher is destroyed
+	std::condition_variable queueChanged;
+	bool isDestroying;
+	CObjectArray<CDnnRequestDescImpl> queue;
+
+	CDnnBatcherStats stats;
+	double totalQueueTime;
+	double totalRunTime;
+
+	IMathEngine& mathEngine() const { return mathEngineDesc.MathEngineOwner->MathEngine(); }
+	int countReadyRequests() const;
+	void extractBatch( CObjectArray<CDnnRequestDescImpl>& batch );
+	void runBatch( const CObjectArray<CDnnRequestDescImpl>& batch, CObjectArray<CDnnBlob>& outputs,
+		CDnnErrorInfo& error );
+	void workerThread();
+};
+
+CDnnBatcherImpl::CDnnBatcherImpl( const CDnnDescImpl* _dnn, int maxBatchSize, int maxLatency ) :
+	dnn( *_dnn ),
+	mathEngineDesc( *static_cast<const CDnnMathEngineDescImpl*>( _dnn->MathEngine ) ),
+	isDestroying( false ),
+	totalQueueTime( 0 ),
+	totalRunTime( 0 )
+{
+	CDnnBatcherDesc::Dnn = _dnn;
+	CDnnBatcherDesc::MaxBatchSize = maxBatchSize;
+	CDnnBatcherDesc::MaxLatency = maxLatency;
+	memset( &stats, 0, sizeof( stats ) );
+	thread = std::thread( &CDnnBatcherImpl::workerThread, this );
+}
+
+CDnnBatcherImpl::~CDnnBatcherImpl()
+{
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+		isDestroying = true;
+	}
+	queueChanged.notify_one();
+	thread.join();
+}
+
+void CDnnBatcherImpl::Submit( CDnnRequestDescImpl* request )
+{
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+		queue.Add( request );
+		stats.SubmittedCount++;
+		stats.MaxQueueLength = max( stats.MaxQueueLength, queue.Size() );
+	}
+	queueChanged.notify_one();
+}
+
+void CDnnBatcherImpl::GetStats( CDnnBatcherStats& result ) const
+{
+	std::lock_guard<std::mutex> lock( mutex );
+	result = stats;
+	result.QueueLength = queue.Size();
+	const long long processedCount = stats.CompletedCount + stats.FailedCount;
+	result.AverageBatchSize = stats.BatchCount == 0 ? 0.f : static_cast<float>( processedCount ) / stats.BatchCount;
+	result.AverageQueueTime = processedCount == 0 ? 0.f : static_cast<float>( totalQueueTime / processedCount );
+	result.AverageRunTime = stats.BatchCount == 0 ? 0.f : static_cast<float>( totalRunTime / stats.BatchCount );
+}
+
+// The number of requests which would be taken into the next batch
+int CDnnBatcherImpl::countReadyRequests() const
+{
+	int count = 0;
+	for( int i = 0; i < queue.Size() && count < MaxBatchSize; ++i ) {
+		if( queue[i]->CanBatchWith( *queue[0] ) ) {
+			++count;
+		}
+	}
+	return count;
+}
+
+// Takes the oldest request and the following requests with the same input sizes
+void CDnnBatcherImpl::extractBatch( CObjectArray<CDnnRequestDescImpl>& batch )
+{
+	const CPtr<CDnnRequestDescImpl> first = queue[0];
+	for( int i = 0; i < queue.Size() && batch.Size() < MaxBatchSize; ) {
+		if( queue[i]->CanBatchWith( *first ) ) {
+			batch.Add( queue[i] );
+			queue.DeleteAt( i );
+		} else {
+			++i;
+		}
+	}
+}
+
+void CDnnBatcherImpl::runBatch( const CObjectArray<CDnnRequestDescImpl>& batch, CObjectArray<CDnnBlob>& outputs,
+	CDnnErrorInfo& error )
+{
+	const int batchSize = batch.Size();
+	try {
+		for( int inputIndex = 0; inputIndex < dnn.InputCount; ++inputIndex ) {
+			const CDnnBlob* first = batch[0]->Inputs()[inputIndex];
+			CPtr<CDnnBlob> input;
+			if( batchSize == 1 ) {
+				input = first->GetCopy();
+			} else {
+				CObjectArray<CDnnBlob> parts;
+				for( int i = 0; i < batchSize; ++i ) {
+					parts.Add( batch[i]->Inputs()[inputIndex] );
+				}
+				CBlobDesc desc = first->GetDesc();
+				desc.SetDimSize( BD_BatchWidth, batchSize );
+				input = CDnnBlob::CreateBlob( mathEngine(), first->GetDataType(), desc );
+				CDnnBlob::MergeByDim( mathEngine(), BD_BatchWidth, parts, input );
+			}
+			dnn.SetInputBlob( inputIndex, input );
+		}
+
+		if( !dnn.RunOnce( &error ) ) {
+			return;
+		}
+
+		// The outputs are stored output by output, the output of the request i is at outputIndex * batchSize + i
+		for( int outputIndex = 0; outputIndex < dnn.GetOutputCount(); ++outputIndex ) {
+			CPtr<CDnnBlob> output = dnn.GetOutputBlob( outputIndex );
+			if( output == nullptr || output->GetBatchWidth() != batchSize ) {
+				initErrorInfo( DET_RunDnnError, "The network output does not keep the BatchWidth of the inputs.", &error );
+				return;
+			}
+			// The sink blob is overwritten by the next run, so the outputs are always copied
+			CObjectArray<CDnnBlob> parts;
+			CBlobDesc desc = output->GetDesc();
+			desc.SetDimSize( BD_BatchWidth, 1 );
+			for( int i = 0; i < batchSize; ++i ) {
+				parts.Add( CDnnBlob::CreateBlob( mathEngine(), output->GetDataType(), desc ) );
+			}
+			if( batchSize == 1 ) {
+				parts[0]->CopyFrom( output );
+			} else {
+				CDnnBlob::SplitByDim( mathEngine(), BD_BatchWidth, output, parts );
+			}
+			for( int i = 0; i < batchSize; ++i ) {
+				outputs.Add( parts[i] );
+			}
+		}
+#ifdef NEOML_USE_FINEOBJ
+	} catch( CException* e ) {
+		initErrorInfo( DET_RunDnnError, e->MessageText().CreateString( CP_UTF8 ), &error );
+		delete e;
+	}
+#else
+	} catch( std::exception& e ) {
+		initErrorInfo( DET_RunDnnError, e.what(), &error );
+	}
+#endif
+}
+
+void CDnnBatcherImpl::workerThread()
+{
+	std::unique_lock<std::mutex> lock( mutex );
+	while( true ) {
+		if( queue.IsEmpty() ) {
+			if( isDestroying ) {
+				return;
+			}
+			queueChanged.wait( lock );
+			continue;
+		}
+
+		// The batch is started when it is full or when its oldest request has waited for MaxLatency
+		const std::chrono::steady_clock::time_point deadline = queue[0]->SubmitTime() + std::chrono::milliseconds( MaxLatency );
+		if( !isDestroying && countReadyRequests() < MaxBatchSize && std::chrono::steady_clock::now() < deadline ) {
+			queueChanged.wait_until( lock, deadline );
+			continue;
+		}
+
+		CObjectArray<CDnnRequestDescImpl> batch;
+		extractBatch( batch );
+		lock.unlock();
+
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		CObjectArray<CDnnBlob> outputs;
+		CDnnErrorInfo error;
+		initErrorInfo( DET_OK, "", &error );
+		runBatch( batch, outputs, error );
+		const std::chrono::steady_clock::time_point finish = std::chrono::steady_clock::now();
+
+		lock.lock();
+		stats.BatchCount++;
+		if( error.Type == DET_OK ) {
+			stats.CompletedCount += batch.Size();
+		} else {
+			stats.FailedCount += batch.Size();
+		}
+		totalRunTime += std::chrono::duration<double, std::milli>( finish - start ).count();
+		for( int i = 0; i < batch.Size(); ++i ) {
+			totalQueueTime += std::chrono::duration<double, std::milli>( start - batch[i]->SubmitTime() ).count();
+		}
+		lock.unlock();
+
+		for( int i = 0; i < batch.Size(); ++i ) {
+			CObjectArray<CDnnBlob> requestOutputs;
+			if( error.Type == DET_OK ) {
+				for( int outputIndex = 0; outputIndex < dnn.GetOutputCount(); ++outputIndex ) {
+					requestOutputs.Add( outputs[outputIndex * batch.Size() + i] );
+				}
+			}
+			batch[i]->Complete( requestOutputs, error );
+		}
+		batch.DeleteAll();
+		lock.lock();
+	}
+}
+
+//------------------------------------------------------------------------------------------------------------
+// Dynamic batching functions
+
+const struct CDnnBatcherDesc* CreateDnnBatcher( const struct CDnnDesc* dnnDesc, int maxBatchSize, int maxLatency,
+	struct CDnnErrorInfo* errorInfo )
+{
+	if( dnnDesc == 0 ) {
+		initErrorInfo( DET_InvalidParameter, "Invalid CDnnDesc parameter.", errorInfo );
+		return nullptr;
+	}
+	if( maxBatchSize <= 0 ) {
+		initErrorInfo( DET_InvalidParameter, "Invalid maxBatchSize parameter.", errorInfo );
+		return nullptr;
+	}
+	if( maxLatency < 0 ) {
+		initErrorInfo( DET_InvalidParameter, "Invalid maxLatency parameter.", errorInfo );
+		return nullptr;
+	}
+
+	try {
+		return FINE_DEBUG_NEW CDnnBatcherImpl( static_cast<const CDnnDescImpl*>( dnnDesc ), maxBatchSize, maxLatency );
+#ifdef NEOML_USE_FINEOBJ
+	} catch( CException* e ) {
+		initErrorInfo( DET_InternalError, e->MessageText().CreateString( CP_UTF8 ), errorInfo );
+		delete e;
+	}
+#else
+	} catch( std::exception& e ) {
+		initErrorInfo( DET_InternalError, e.what(), errorInfo );
+	}
+#endif
+	return nullptr;
+}
+
+void DestroyDnnBatcher( const struct CDnnBatcherDesc* batcher )
+{
+	delete static_cast<const CDnnBatcherImpl*>( batcher );
+}
+
+const struct CDnnRequestDesc* SubmitDnnRequest( const struct CDnnBatcherDesc* batcherDesc,
+	const struct CDnnBlobDesc* const* inputDescs, TDnnRequestCallback callback, void* userData, struct CDnnErrorInfo* errorInfo )
+{
+	if( batcherDesc == 0 ) {
+		initErrorInfo( DET_InvalidParameter, "Invalid CDnnBatcherDesc parameter.", errorInfo );
+		return nullptr;
+	}
+	CDnnBatcherImpl* batcher = const_cast<CDnnBatcherImpl*>( static_cast<const CDnnBatcherImpl*>( batcherDesc ) );
+	const CDnnDescImpl& dnn = batcher->DnnDesc();
+	if( inputDescs == 0 && dnn.InputCount > 0 ) {
+		initErrorInfo( DET_InvalidParameter, "Invalid inputs parameter.", errorInfo );
+		return nullptr;
+	}
+	for( int i = 0; i < dnn.InputCount; ++i ) {
+		if( inputDescs[i] == 0 || inputDescs[i]->MathEngine != dnn.MathEngine ) {
+			initErrorInfo( DET_InvalidParameter, "Invalid CDnnBlobDesc parameter.", errorInfo );
+			return nullptr;
+		}
+		if( inputDescs[i]->BatchWidth != 1 ) {
+			initErrorInfo( DET_InvalidParameter, "The request inputs must have BatchWidth equal to 1.", errorInfo );
+			return nullptr;
+		}
+	}
+
+	try {
+		// The caller may change or destroy the blobs right after submitting
+		CObjectArray<CDnnBlob> inputs;
+		for( int i = 0; i < dnn.InputCount; ++i ) {
+			inputs.Add( static_cast<const CDnnBlobDescImpl*>( inputDescs[i] )->Blob->GetCopy() );
+		}
+		CPtr<CDnnRequestDescImpl> request = FINE_DEBUG_NEW CDnnRequestDescImpl( batcher, inputs, callback, userData );
+		const CDnnRequestDesc* result = request->AttachToCaller();
+		batcher->Submit( request );
+		return result;
+#ifdef NEOML_USE_FINEOBJ
+	} catch( CException* e ) {
+		initErrorInfo( DET_InternalError, e->MessageText().CreateString( CP_UTF8 ), errorInfo );
+		delete e;
+	}
+#else
+	} catch( std::exception& e ) {
+		initErrorInfo( DET_InternalError, e.what(), errorInfo );
+	}
+#endif
+	return nullptr;
+}
+
+bool WaitDnnRequest( const struct CDnnRequestDesc* request, int timeout, struct CDnnErrorInfo* errorInfo )
+{
+	if( request == 0 ) {
+		initErrorInfo( DET_InvalidParameter, "Invalid CDnnRequestDesc parameter.", errorInfo );
+		return false;
+	}
+	return static_cast<const CDnnRequestDescImpl*>( request )->Wait( timeout, errorInfo );
+}
+
+const struct CDnnBlobDesc* GetDnnRequestOutput( const struct CDnnRequestDesc* requestDesc, int index,
+	struct CDnnErrorInfo* errorInfo )
+{
+	if( requestDesc == 0 ) {
+		initErrorInfo( DET_InvalidParameter, "Invalid CDnnRequestDesc parameter.", errorInfo );
+		return nullptr;
+	}
+
+	const CDnnRequestDescImpl* request = static_cast<const CDnnRequestDescImpl*>( requestDesc );
+	CPtr<CDnnBlob> blob = request->GetOutput( index, errorInfo );
+	if( blob == 0 ) {
+		return nullptr;
+	}
+
+	const CDnnDescImpl& dnn = request->DnnDesc();
+	const CDnnMathEngineDescImpl* mathEngineDescImpl = static_cast<const CDnnMathEngineDescImpl*>( dnn.MathEngine );
+
+	try {
+		return FINE_DEBUG_NEW CDnnBlobDescImpl( blob, mathEngineDescImpl );
+#ifdef NEOML_USE_FINEOBJ
+	} catch( CException* e ) {
+		initErrorInfo( DET_InternalError, e->MessageText().CreateString( CP_UTF8 ), errorInfo );
+		delete e;
+	}
+#else
+	} catch( std::exception& e ) {
+		initErrorInfo( DET_InternalError, e.what(), errorInfo );
+	}
+#endif
+	return nullptr;
+}
+
+void DestroyDnnRequest( const struct CDnnRequestDesc* request )
+{
+	if( request != 0 ) {
+		const_cast<CDnnRequestDescImpl*>( static_cast<const CDnnRequestDescImpl*>( request ) )->DetachFromCaller();
+	}
+}
+
+bool GetDnnBatcherStats( const struct CDnnBatcherDesc* batcher, struct CDnnBatcherStats* stats,
+	struct CDnnErrorInfo* errorInfo )
+{
+	if( batcher == 0 ) {
+		initErrorInfo( DET_InvalidParameter, "Invalid CDnnBatcherDesc parameter.", errorInfo );
+		return false;
+	}
+	if( stats == 0 ) {
+		initErrorInfo( DET_InvalidParameter, "Invalid stats parameter.", errorInfo );
+		return false;
+	}
+	static_cast<const CDnnBatcherImpl*>( batcher )->GetStats( *stats );
+	return true;
+}
+
 } // extern "C"
@@ -0,0 +1,250 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <NeoProxy/NeoProxy.h>
+
+#include <NeoML/NeoML.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+using namespace NeoML;
+
+static const char* const TestDnnFileName = "neoproxy_batcher_dnn";
+static const float TestMultiplier = 2.f;
+static const float TestFreeTerm = 1.f;
+
+// Saves the network that calculates TestMultiplier * x + TestFreeTerm for the input of any size
+static void saveTestDnn()
+{
+	IMathEngine& mathEngine = GetSingleThreadCpuMathEngine();
+	CRandom random( 0x123 );
+	CDnn dnn( random, mathEngine );
+
+	CPtr<CSourceLayer> source = new CSourceLayer( mathEngine );
+	source->SetName( "in" );
+	dnn.AddLayer( *source );
+
+	CPtr<CLinearLayer> linear = new CLinearLayer( mathEngine );
+	linear->SetName( "linear" );
+	linear->SetMultiplier( TestMultiplier );
+	linear->SetFreeTerm( TestFreeTerm );
+	linear->Connect( *source );
+	dnn.AddLayer( *linear );
+
+	CPtr<CSinkLayer> sink = new CSinkLayer( mathEngine );
+	sink->SetName( "out" );
+	sink->Connect( *linear );
+	dnn.AddLayer( *sink );
+
+	CArchiveFile file( TestDnnFileName, CArchive::store );
+	CArchive archive( &file, CArchive::SD_Storing );
+	dnn.Serialize( archive );
+}
+
+// The math engine and the network loaded through NeoProxy
+class CDnnBatcherTest : public ::testing::Test {
+protected:
+	const CDnnMathEngineDesc* MathEngine = nullptr;
+	const CDnnDesc* Dnn = nullptr;
+
+	void SetUp() override
+	{
+		saveTestDnn();
+		CDnnErrorInfo error;
+		MathEngine = CreateCPUMathEngine( 1, &error );
+		ASSERT_NE( nullptr, MathEngine ) << error.Description;
+		Dnn = CreateDnnFromFile( MathEngine, TestDnnFileName, &error );
+		ASSERT_NE( nullptr, Dnn ) << error.Description;
+	}
+
+	void TearDown() override
+	{
+		DestroyDnn( Dnn );
+		DestroyMathEngine( MathEngine );
+		::remove( TestDnnFileName );
+	}
+
+	// Submits the single-sample request with the input of the given size filled by the values starting from firstValue
+	const CDnnRequestDesc* Submit( const CDnnBatcherDesc* batcher, int height, int width, float firstValue,
+		TDnnRequestCallback callback = nullptr, void* userData = nullptr );
+	// Checks that the request is processed and its output is calculated from the input
+	void CheckOutput( const CDnnRequestDesc* request, int height, int width, float firstValue );
+};
+
+const CDnnRequestDesc* CDnnBatcherTest::Submit( const CDnnBatcherDesc* batcher, int height, int width, float firstValue,
+	TDnnRequestCallback callback, void* userData )
+{
+	CDnnErrorInfo error;
+	const CDnnBlobDesc* input = CreateDnnBlob( MathEngine, DBT_Float, 1, 1, height, width, 1, 1, &error );
+	EXPECT_NE( nullptr, input ) << error.Description;
+	std::vector<float> data( height * width );
+	for( size_t i = 0; i < data.size(); ++i ) {
+		data[i] = firstValue + i;
+	}
+	EXPECT_TRUE( CopyToBlob( input, data.data(), &error ) ) << error.Description;
+
+	const CDnnRequestDesc* request = SubmitDnnRequest( batcher, &input, callback, userData, &error );
+	EXPECT_NE( nullptr, request ) << error.Description;
+	// The request keeps its own copy of the input
+	DestroyDnnBlob( input );
+	return request;
+}
+
+void CDnnBatcherTest::CheckOutput( const CDnnRequestDesc* request, int height, int width, float firstValue )
+{
+	CDnnErrorInfo error;
+	ASSERT_TRUE( WaitDnnRequest( request, 0, &error ) ) << error.Description;
+	const CDnnBlobDesc* output = GetDnnRequestOutput( request, 0, &error );
+	ASSERT_NE( nullptr, output ) << error.Description;
+	EXPECT_EQ( 1, output->BatchWidth );
+	EXPECT_EQ( height, output->Height );
+	EXPECT_EQ( width, output->Width );
+
+	std::vector<float> data( height * width );
+	EXPECT_TRUE( CopyFromBlob( data.data(), output, &error ) ) << error.Description;
+	for( size_t i = 0; i < data.size(); ++i ) {
+		EXPECT_EQ( TestMultiplier * ( firstValue + i ) + TestFreeTerm, data[i] );
+	}
+	DestroyDnnBlob( output );
+}
+
+TEST_F( CDnnBatcherTest, MixedShapes )
+{
+	// The latency is long enough for all requests to be queued before the first batch
+	CDnnErrorInfo error;
+	const CDnnBatcherDesc* batcher = CreateDnnBatcher( Dnn, 8, 1000, &error );
+	ASSERT_NE( nullptr, batcher ) << error.Description;
+
+	// The requests of two shapes are interleaved; each shape makes its own batch
+	const int RequestCount = 6;
+	const int heights[2] = { 2, 4 };
+	const int widths[2] = { 3, 1 };
+	const CDnnRequestDesc* requests[RequestCount];
+	for( int i = 0; i < RequestCount; ++i ) {
+		requests[i] = Submit( batcher, heights[i % 2], widths[i % 2], 10.f * i );
+	}
+	for( int i = 0; i < RequestCount; ++i ) {
+		ASSERT_TRUE( WaitDnnRequest( requests[i], -1, &error ) ) << error.Description;
+		CheckOutput( requests[i], heights[i % 2], widths[i % 2], 10.f * i );
+		DestroyDnnRequest( requests[i] );
+	}
+
+	CDnnBatcherStats stats;
+	ASSERT_TRUE( GetDnnBatcherStats( batcher, &stats, &error ) ) << error.Description;
+	EXPECT_EQ( RequestCount, stats.SubmittedCount );
+	EXPECT_EQ( RequestCount, stats.CompletedCount );
+	EXPECT_EQ( 0, stats.FailedCount );
+	EXPECT_EQ( 2, stats.BatchCount );
+	EXPECT_EQ( 3.f, stats.AverageBatchSize );
+	EXPECT_EQ( 0, stats.QueueLength );
+	EXPECT_EQ( RequestCount, stats.MaxQueueLength );
+	DestroyDnnBatcher( batcher );
+}
+
+TEST_F( CDnnBatcherTest, WaitTimeout )
+{
+	// The batch is not full, so the request waits for the whole latency
+	CDnnErrorInfo error;
+	const CDnnBatcherDesc* batcher = CreateDnnBatcher( Dnn, 4, 2000, &error );
+	ASSERT_NE( nullptr, batcher ) << error.Description;
+
+	const CDnnRequestDesc* request = Submit( batcher, 2, 2, 1.f );
+	EXPECT_FALSE( WaitDnnRequest( request, 10, &error ) );
+	EXPECT_EQ( DET_Timeout, error.Type );
+	EXPECT_EQ( nullptr, GetDnnRequestOutput( request, 0, &error ) );
+
+	ASSERT_TRUE( WaitDnnRequest( request, -1, &error ) ) << error.Description;
+	CheckOutput( request, 2, 2, 1.f );
+	DestroyDnnRequest( request );
+	DestroyDnnBatcher( batcher );
+}
+
+// The callback data of the request
+struct CCallbackData {
+	const CDnnRequestDesc* Request = nullptr; // the request passed to the callback
+	bool IsCompleted = false;
+	std::atomic<int>* CallCount = nullptr;
+};
+
+static void testCallback( const CDnnRequestDesc* request, void* userData )
+{
+	CCallbackData* data = static_cast<CCallbackData*>( userData );
+	data->Request = request;
+	// The request is already processed when the callback is called
+	data->IsCompleted = WaitDnnRequest( request, 0, nullptr );
+	( *data->CallCount )++;
+}
+
+TEST_F( CDnnBatcherTest, Callback )
+{
+	CDnnErrorInfo error;
+	const CDnnBatcherDesc* batcher = CreateDnnBatcher( Dnn, 3, 10, &error );
+	ASSERT_NE( nullptr, batcher ) << error.Description;
+
+	const int RequestCount = 5;
+	std::atomic<int> callCount( 0 );
+	CCallbackData callbackData[RequestCount];
+	const CDnnRequestDesc* requests[RequestCount];
+	for( int i = 0; i < RequestCount; ++i ) {
+		callbackData[i].CallCount = &callCount;
+		requests[i] = Submit( batcher, 1, 4, 1.f * i, testCallback, &callbackData[i] );
+	}
+
+	// The callback is called after the request is marked as processed, so the batcher thread is joined first
+	for( int i = 0; i < RequestCount; ++i ) {
+		ASSERT_TRUE( WaitDnnRequest( requests[i], -1, &error ) ) << error.Description;
+	}
+	DestroyDnnBatcher( batcher );
+
+	EXPECT_EQ( RequestCount, callCount.load() );
+	for( int i = 0; i < RequestCount; ++i ) {
+		EXPECT_EQ( requests[i], callbackData[i].Request );
+		EXPECT_TRUE( callbackData[i].IsCompleted );
+		CheckOutput( requests[i], 1, 4, 1.f * i );
+		DestroyDnnRequest( requests[i] );
+	}
+}
+
+TEST_F( CDnnBatcherTest, DestroyWithQueuedRequests )
+{
+	// Without the destruction the requests would wait for a minute
+	const int MaxLatency = 60000;
+	CDnnErrorInfo error;
+	const CDnnBatcherDesc* batcher = CreateDnnBatcher( Dnn, 16, MaxLatency, &error );
+	ASSERT_NE( nullptr, batcher ) << error.Description;
+
+	const int RequestCount = 3;
+	const CDnnRequestDesc* requests[RequestCount];
+	for( int i = 0; i < RequestCount; ++i ) {
+		requests[i] = Submit( batcher, 3, 2, 5.f * i );
+	}
+	// The request destroyed by the caller is still processed, but its results are dropped
+	DestroyDnnRequest( Submit( batcher, 3, 2, 0.f ) );
+
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	DestroyDnnBatcher( batcher );
+	EXPECT_LT( std::chrono::steady_clock::now() - start, std::chrono::milliseconds( MaxLatency / 2 ) );
+
+	// The results are available after the batcher is destroyed
+	for( int i = 0; i < RequestCount; ++i ) {
+		CheckOutput( requests[i], 3, 2, 5.f * i );
+		DestroyDnnRequest( requests[i] );
+	}
+}
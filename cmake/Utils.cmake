@@ -38,20 +38,22 @@ function(add_gtest_for_target TARGET_NAME MATH_ENGINE_TYPE WORKING_DIR)
 
     if(NEOML_USE_AVX)
 
-    add_dependencies(${TARGET_NAME} NeoMathEngineAvx)
-        if(TARGET NeoMathEngineAvx)
+    foreach(AVX_TARGET NeoMathEngineAvx NeoMathEngineAvx512)
+        if(TARGET ${AVX_TARGET})
+            add_dependencies(${TARGET_NAME} ${AVX_TARGET})
             if(WIN32)
                 add_custom_command(TARGET ${TARGET_NAME} POST_BUILD
-                    COMMAND ${CMAKE_COMMAND} -E copy $<TARGET_FILE:NeoMathEngineAvx> $<TARGET_FILE_DIR:${TARGET_NAME}>
-                    COMMENT "Copy NeoMathEngineAvx to ${TARGET_NAME} binary dir to discover tests."
+                    COMMAND ${CMAKE_COMMAND} -E copy $<TARGET_FILE:${AVX_TARGET}> $<TARGET_FILE_DIR:${TARGET_NAME}>
+                    COMMENT "Copy ${AVX_TARGET} to ${TARGET_NAME} binary dir to discover tests."
                 )
             else()
                 add_custom_command(TARGET ${TARGET_NAME} POST_BUILD
-                    COMMAND ${CMAKE_COMMAND} -E copy $<TARGET_FILE:NeoMathEngineAvx> $<TARGET_FILE_DIR:NeoMathEngine>
-                    COMMENT "Copy NeoMathEngineAvx to NeoMathEngine binary dir to discover tests."
+                    COMMAND ${CMAKE_COMMAND} -E copy $<TARGET_FILE:${AVX_TARGET}> $<TARGET_FILE_DIR:NeoMathEngine>
+                    COMMENT "Copy ${AVX_TARGET} to NeoMathEngine binary dir to discover tests."
                 )
             endif()
         endif()
+    endforeach()
     endif()
 
     string(TOLOWER ${MATH_ENGINE_TYPE} TYPE)